@@ -0,0 +1,81 @@
+#include "samplekernels.h"
+
+#include "common/simd.h"
+
+void SampleKernels::Gain(const float *input, float *output, int sample_count, float gain)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 gain_vec = _mm_set1_ps(gain);
+
+  for (;i+4<=sample_count;i+=4) {
+    _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(input + i), gain_vec));
+  }
+#endif
+
+  for (;i<sample_count;i++) {
+    output[i] = input[i] * gain;
+  }
+}
+
+void SampleKernels::GainCurve(const float *input, float *output, int frame_count, int channels, const float *gains)
+{
+  if (channels == 2) {
+    // Stereo is by far the most common case so it gets its own kernel
+    StereoGainCurve(input, output, frame_count, gains, gains);
+    return;
+  }
+
+  for (int i=0;i<frame_count;i++) {
+    int frame_start = i * channels;
+
+    for (int j=0;j<channels;j++) {
+      output[frame_start + j] = input[frame_start + j] * gains[i];
+    }
+  }
+}
+
+void SampleKernels::StereoGain(const float *input, float *output, int frame_count, float left, float right)
+{
+  int sample_count = frame_count * 2;
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  // Samples are interleaved L R L R so the gain vector is too
+  __m128 gain_vec = _mm_setr_ps(left, right, left, right);
+
+  for (;i+4<=sample_count;i+=4) {
+    _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(input + i), gain_vec));
+  }
+#endif
+
+  for (;i<sample_count;i+=2) {
+    output[i] = input[i] * left;
+    output[i+1] = input[i+1] * right;
+  }
+}
+
+void SampleKernels::StereoGainCurve(const float *input, float *output, int frame_count, const float *left, const float *right)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  // Process four frames (eight samples) at a time, interleaving the gain curves to match the sample layout
+  for (;i+4<=frame_count;i+=4) {
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+
+    const float* in = input + i * 2;
+    float* out = output + i * 2;
+
+    _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(in), _mm_unpacklo_ps(l, r)));
+    _mm_storeu_ps(out + 4, _mm_mul_ps(_mm_loadu_ps(in + 4), _mm_unpackhi_ps(l, r)));
+  }
+#endif
+
+  for (;i<frame_count;i++) {
+    output[i*2] = input[i*2] * left[i];
+    output[i*2+1] = input[i*2+1] * right[i];
+  }
+}
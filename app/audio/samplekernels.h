@@ -0,0 +1,59 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SAMPLEKERNELS_H
+#define SAMPLEKERNELS_H
+
+/**
+ * @brief Vectorized kernels for processing blocks of interleaved float samples
+ *
+ * All functions accept `input` and `output` pointing to the same buffer. Counts are in samples (i.e. one value in one
+ * channel) unless a parameter is explicitly named `frame_count`, in which case it's one sample in every channel.
+ */
+class SampleKernels
+{
+public:
+  /**
+   * @brief Multiply every sample by a constant gain
+   */
+  static void Gain(const float* input, float* output, int sample_count, float gain);
+
+  /**
+   * @brief Multiply every sample by a gain that changes per sample frame
+   *
+   * `gains` must contain `frame_count` values, each is applied to every channel of that frame.
+   */
+  static void GainCurve(const float* input, float* output, int frame_count, int channels, const float* gains);
+
+  /**
+   * @brief Multiply the left and right channels of a stereo buffer by separate constant gains
+   */
+  static void StereoGain(const float* input, float* output, int frame_count, float left, float right);
+
+  /**
+   * @brief Multiply the left and right channels of a stereo buffer by separate gains that change per sample frame
+   *
+   * `left` and `right` must both contain `frame_count` values.
+   */
+  static void StereoGainCurve(const float* input, float* output, int frame_count, const float* left, const float* right);
+
+};
+
+#endif // SAMPLEKERNELS_H
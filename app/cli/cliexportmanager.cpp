@@ -0,0 +1,345 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "cliexportmanager.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMatrix4x4>
+#include <stdio.h>
+
+#include "common/timecodefunctions.h"
+#include "project/projectloadmanager.h"
+#include "render/backend/cpu/cpuexporter.h"
+#include "render/backend/opengl/openglexporter.h"
+#include "render/pixelservice.h"
+
+CLIExportManager::CLIExportManager(const QString &project_filename,
+                                   const QString &sequence_name,
+                                   const QString &output_filename,
+                                   QObject *parent) :
+  QObject(parent),
+  project_filename_(project_filename),
+  sequence_name_(sequence_name),
+  output_filename_(output_filename),
+  use_cpu_(false),
+  ctx_(nullptr),
+  last_progress_(-1)
+{
+}
+
+CLIExportManager::~CLIExportManager()
+{
+  if (ctx_) {
+    ctx_->doneCurrent();
+    delete ctx_;
+  }
+
+  surface_.destroy();
+}
+
+void CLIExportManager::SetRange(const QString &range)
+{
+  range_ = range;
+}
+
+void CLIExportManager::SetVideoCodec(const QString &codec)
+{
+  video_codec_ = codec;
+}
+
+void CLIExportManager::SetAudioCodec(const QString &codec)
+{
+  audio_codec_ = codec;
+}
+
+void CLIExportManager::SetUseCPU(bool use_cpu)
+{
+  use_cpu_ = use_cpu;
+}
+
+void CLIExportManager::Start()
+{
+  // Load the project in this thread, there's nothing else to do until it's loaded anyway
+  ProjectLoadManager plm(project_filename_);
+  connect(&plm, &ProjectLoadManager::ProjectLoaded, this, &CLIExportManager::ProjectLoaded, Qt::DirectConnection);
+  plm.Start();
+
+  if (!project_) {
+    Finish(false, tr("Failed to load project \"%1\"").arg(project_filename_));
+    return;
+  }
+
+  Sequence* sequence = FindSequence(project_->root(), sequence_name_);
+
+  if (!sequence) {
+    Finish(false, tr("Failed to find sequence \"%1\"").arg(sequence_name_));
+    return;
+  }
+
+  ViewerOutput* viewer = sequence->viewer_output();
+
+  if (viewer->Length() == 0) {
+    Finish(false, tr("This Sequence is empty. There is nothing to export."));
+    return;
+  }
+
+  TimeRange range;
+
+  if (!ParseRange(viewer->Length(), viewer->video_params().time_base(), &range)) {
+    Finish(false, tr("Invalid range \"%1\"").arg(range_));
+    return;
+  }
+
+  // Use the output format's default codecs for anything that wasn't specified
+  QByteArray output_bytes = output_filename_.toUtf8();
+  AVOutputFormat* output_fmt = av_guess_format(nullptr, output_bytes.constData(), nullptr);
+
+  if (!output_fmt) {
+    Finish(false, tr("Failed to determine a format for \"%1\"").arg(output_filename_));
+    return;
+  }
+
+  QString video_codec = video_codec_;
+  QString audio_codec = audio_codec_;
+
+  if (video_codec.isEmpty() && output_fmt->video_codec != AV_CODEC_ID_NONE) {
+    AVCodec* codec = avcodec_find_encoder(output_fmt->video_codec);
+
+    if (codec) {
+      video_codec = codec->name;
+    }
+  }
+
+  if (audio_codec.isEmpty() && output_fmt->audio_codec != AV_CODEC_ID_NONE) {
+    AVCodec* codec = avcodec_find_encoder(output_fmt->audio_codec);
+
+    if (codec) {
+      audio_codec = codec->name;
+    }
+  }
+
+  if (video_codec.isEmpty() && audio_codec.isEmpty()) {
+    Finish(false, tr("No video or audio encoder is available for \"%1\"").arg(output_filename_));
+    return;
+  }
+
+  bool use_cpu = use_cpu_;
+
+  if (!use_cpu && !InitializeOpenGL()) {
+    // Still possible to export, just slower on machines that do have a GPU
+    qWarning() << "Failed to create an offscreen OpenGL context, rendering on the CPU instead";
+    use_cpu = true;
+  }
+
+  // Export at the Sequence's own parameters
+  RenderMode::Mode render_mode = RenderMode::kOnline;
+
+  VideoRenderingParams video_render_params(viewer->video_params().width(),
+                                           viewer->video_params().height(),
+                                           viewer->video_params().time_base(),
+                                           PixelService::instance()->GetConfiguredFormatForMode(render_mode),
+                                           render_mode);
+
+  AudioRenderingParams audio_render_params(viewer->audio_params().sample_rate(),
+                                           viewer->audio_params().channel_layout(),
+                                           SampleFormat::GetConfiguredFormatForMode(render_mode));
+
+  ColorManager* color_manager = project_->color_manager();
+  QString display = color_manager->GetDefaultDisplay();
+
+  ColorProcessorPtr color_processor = ColorProcessor::Create(color_manager->GetConfig(),
+                                                             OCIO::ROLE_SCENE_LINEAR,
+                                                             display,
+                                                             color_manager->GetDefaultView(display),
+                                                             QString());
+
+  // Set up encoder
+  EncodingParams encoding_params;
+  encoding_params.SetFilename(output_filename_);
+
+  if (!video_codec.isEmpty()) {
+    encoding_params.EnableVideo(video_render_params, video_codec);
+  }
+
+  if (!audio_codec.isEmpty()) {
+    encoding_params.EnableAudio(audio_render_params, audio_codec);
+  }
+
+  Encoder* encoder = Encoder::CreateFromID("ffmpeg", encoding_params);
+
+  Exporter* exporter;
+
+  if (use_cpu) {
+    exporter = new CPUExporter(viewer, encoder, this);
+  } else {
+    exporter = new OpenGLExporter(viewer, encoder, this);
+  }
+
+  if (!video_codec.isEmpty()) {
+    exporter->EnableVideo(video_render_params, QMatrix4x4(), color_processor);
+  }
+
+  if (!audio_codec.isEmpty()) {
+    exporter->EnableAudio(audio_render_params);
+  }
+
+  exporter->SetExportRange(range);
+
+  connect(exporter, &Exporter::ProgressChanged, this, &CLIExportManager::ExportProgressChanged);
+  connect(exporter, &Exporter::ExportEnded, this, &CLIExportManager::ExportEnded);
+
+  exporter->StartExporting();
+}
+
+Sequence *CLIExportManager::FindSequence(Item *folder, const QString &name)
+{
+  foreach (ItemPtr item, folder->children()) {
+    if (item->type() == Item::kSequence && item->name() == name) {
+      return static_cast<Sequence*>(item.get());
+    }
+
+    if (item->CanHaveChildren()) {
+      Sequence* child_sequence = FindSequence(item.get(), name);
+
+      if (child_sequence) {
+        return child_sequence;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+bool CLIExportManager::ParseRange(const rational &length, const rational &timebase, TimeRange *range) const
+{
+  rational in = 0;
+  rational out = length;
+
+  if (!range_.isEmpty()) {
+    QStringList in_out = range_.split(':');
+
+    if (in_out.size() != 2) {
+      return false;
+    }
+
+    bool ok;
+
+    if (!in_out.at(0).isEmpty()) {
+      double in_secs = in_out.at(0).toDouble(&ok);
+
+      if (!ok || in_secs < 0) {
+        return false;
+      }
+
+      // Snap to the nearest frame so the exporter's frame times line up with what's rendered
+      in = Timecode::timestamp_to_time(Timecode::time_to_timestamp(in_secs, timebase), timebase);
+    }
+
+    if (!in_out.at(1).isEmpty()) {
+      double out_secs = in_out.at(1).toDouble(&ok);
+
+      if (!ok) {
+        return false;
+      }
+
+      out = Timecode::timestamp_to_time(Timecode::time_to_timestamp(out_secs, timebase), timebase);
+
+      if (out > length) {
+        out = length;
+      }
+    }
+  }
+
+  if (in >= out) {
+    return false;
+  }
+
+  *range = TimeRange(in, out);
+
+  return true;
+}
+
+bool CLIExportManager::InitializeOpenGL()
+{
+  surface_.create();
+
+  ctx_ = new QOpenGLContext();
+  ctx_->setShareContext(QOpenGLContext::globalShareContext());
+
+  if (!ctx_->create()) {
+    return false;
+  }
+
+  // The exporter and render backend both use whatever context is current in this thread
+  return ctx_->makeCurrent(&surface_);
+}
+
+void CLIExportManager::Finish(bool success, const QString &message)
+{
+  if (success) {
+    PrintLine(QStringLiteral("done %1").arg(message));
+  } else {
+    PrintLine(QStringLiteral("error %1").arg(message));
+  }
+
+  QCoreApplication::exit(success ? 0 : 1);
+}
+
+void CLIExportManager::PrintLine(const QString &s)
+{
+  // Debug output goes to stderr, so stdout only ever contains these lines
+  fprintf(stdout, "%s\n", s.toLocal8Bit().constData());
+  fflush(stdout);
+}
+
+void CLIExportManager::ProjectLoaded(ProjectPtr project)
+{
+  project_ = project;
+}
+
+void CLIExportManager::ExportProgressChanged(int p)
+{
+  if (p != last_progress_) {
+    last_progress_ = p;
+
+    PrintLine(QStringLiteral("progress %1").arg(p));
+  }
+}
+
+void CLIExportManager::ExportEnded()
+{
+  Exporter* exporter = static_cast<Exporter*>(sender());
+
+  if (exporter->GetTotalFrameCount() > 0) {
+    PrintLine(QStringLiteral("frames %1/%2").arg(QString::number(exporter->GetUniqueFrameCount()),
+                                                 QString::number(exporter->GetTotalFrameCount())));
+  }
+
+  if (exporter->GetExportStatus()) {
+    Finish(true, output_filename_);
+  } else {
+    Finish(false, exporter->GetExportError());
+  }
+}
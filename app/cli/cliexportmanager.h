@@ -0,0 +1,144 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef CLIEXPORTMANAGER_H
+#define CLIEXPORTMANAGER_H
+
+#include <QObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "common/timerange.h"
+#include "project/item/sequence/sequence.h"
+#include "project/project.h"
+
+/**
+ * @brief Exports a Sequence from a project file without any UI
+ *
+ * Used by the `--export` command line mode. Loads the project, finds the Sequence by name and drives an Exporter
+ * through an offscreen OpenGL surface, so it can run on machines with no display (e.g. with Mesa's llvmpipe). On
+ * machines without OpenGL at all (or with `--cpu`), it renders with CPUBackend instead.
+ *
+ * Progress and the result are printed to stdout one per line so that they can be parsed by render farm scripts:
+ *
+ *     progress <0-100>
+ *     frames <unique frames rendered>/<total frames>
+ *     done <output filename>
+ *     error <message>
+ *
+ * The application exits with code 0 on success and 1 on failure once the export has ended.
+ */
+class CLIExportManager : public QObject
+{
+  Q_OBJECT
+public:
+  CLIExportManager(const QString& project_filename,
+                   const QString& sequence_name,
+                   const QString& output_filename,
+                   QObject* parent = nullptr);
+
+  virtual ~CLIExportManager() override;
+
+  /**
+   * @brief Only export part of the Sequence
+   *
+   * @param range
+   *
+   * A string in the form "in:out" where both are in seconds (e.g. "10:25.5"). Either side may be left empty to use
+   * the start/end of the Sequence.
+   */
+  void SetRange(const QString& range);
+
+  /**
+   * @brief Override the encoder used for video (defaults to the output format's default codec)
+   */
+  void SetVideoCodec(const QString& codec);
+
+  /**
+   * @brief Override the encoder used for audio (defaults to the output format's default codec)
+   */
+  void SetAudioCodec(const QString& codec);
+
+  /**
+   * @brief Render with CPUBackend rather than OpenGL, even if an OpenGL context is available
+   */
+  void SetUseCPU(bool use_cpu);
+
+public slots:
+  /**
+   * @brief Start exporting
+   *
+   * Should be called once the application event loop is running, since the export itself runs asynchronously and
+   * exits the application when it ends.
+   */
+  void Start();
+
+private:
+  /**
+   * @brief Recursively search a folder for a Sequence by name
+   */
+  static Sequence* FindSequence(Item* folder, const QString& name);
+
+  /**
+   * @brief Parse the range string set by SetRange() into frame-aligned times within the Sequence
+   */
+  bool ParseRange(const rational& length, const rational& timebase, TimeRange* range) const;
+
+  /**
+   * @brief Create and make current an OpenGL context on an offscreen surface for the exporter to render with
+   */
+  bool InitializeOpenGL();
+
+  void Finish(bool success, const QString& message);
+
+  static void PrintLine(const QString& s);
+
+  QString project_filename_;
+
+  QString sequence_name_;
+
+  QString output_filename_;
+
+  QString range_;
+
+  QString video_codec_;
+
+  QString audio_codec_;
+
+  bool use_cpu_;
+
+  ProjectPtr project_;
+
+  QOffscreenSurface surface_;
+
+  QOpenGLContext* ctx_;
+
+  int last_progress_;
+
+private slots:
+  void ProjectLoaded(ProjectPtr project);
+
+  void ExportProgressChanged(int p);
+
+  void ExportEnded();
+
+};
+
+#endif // CLIEXPORTMANAGER_H
@@ -170,6 +170,9 @@ void Decoder::Conform(const AudioRenderingParams &params)
   abort();
 }
 
-void Decoder::Index()
+bool Decoder::Index(const QAtomicInt *cancelled)
 {
+  Q_UNUSED(cancelled)
+
+  return true;
 }
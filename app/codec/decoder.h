@@ -21,6 +21,7 @@
 #ifndef DECODER_H
 #define DECODER_H
 
+#include <QAtomicInt>
 #include <QObject>
 #include <stdint.h>
 
@@ -227,8 +228,25 @@ public:
    *
    * Indexing is slow so it's recommended to do it in a background thread. Index() must be called while the Decoder is
    * open, and does not automatically call Open() and Close() the Decoder. The caller must call thse manually.
+   *
+   * Progress is reported through IndexProgress().
+   *
+   * @param cancelled
+   *
+   * An optional flag polled during indexing (e.g. Task's cancelled state). If it becomes non-zero, indexing stops as
+   * soon as possible. Decoders may keep partial progress on disk so that the next call resumes where this one stopped.
+   *
+   * @return
+   *
+   * TRUE if the index is complete, FALSE if indexing was cancelled or failed.
+   */
+  virtual bool Index(const QAtomicInt* cancelled = nullptr);
+
+signals:
+  /**
+   * @brief Emitted during Index() with a percentage between 0 and 100
    */
-  virtual void Index();
+  void IndexProgress(int p);
 
 protected:
   bool open_;
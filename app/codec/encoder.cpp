@@ -103,6 +103,8 @@ void Encoder::WriteFrame(FramePtr frame)
   if (open_) {
     WriteInternal(frame);
   }
+
+  emit FrameWritten();
 }
 
 void Encoder::Close()
@@ -27,6 +27,7 @@ extern "C" {
 #include <libavutil/pixdesc.h>
 }
 
+#include <algorithm>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
@@ -38,21 +39,35 @@ extern "C" {
 #include "common/filefunctions.h"
 #include "common/timecodefunctions.h"
 #include "ffmpegcommon.h"
-#include "render/diskmanager.h"
 #include "render/pixelservice.h"
 
+const int FFmpegDecoder::kReadAheadFrameCount = 8;
+
+// "OIDX" in little endian
+const quint32 FFmpegDecoder::kIndexMagic = 0x5844494F;
+const quint32 FFmpegDecoder::kIndexVersion = 2;
+const int FFmpegDecoder::kIndexCheckpointInterval = 256;
+
 FFmpegDecoder::FFmpegDecoder() :
   fmt_ctx_(nullptr),
   codec_ctx_(nullptr),
   scale_ctx_(nullptr),
   pkt_(nullptr),
   frame_(nullptr),
-  opts_(nullptr)
+  opts_(nullptr),
+  read_ahead_thread_(nullptr),
+  read_ahead_active_(false),
+  read_ahead_quit_(false),
+  read_ahead_converting_ts_(AV_NOPTS_VALUE),
+  timestamp_base_{0, 1},
+  timestamp_start_(0)
 {
 }
 
 FFmpegDecoder::~FFmpegDecoder()
 {
+  StopReadAhead();
+
   Close();
 }
 
@@ -193,6 +208,8 @@ bool FFmpegDecoder::Open()
 
 FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
 {
+  QMutexLocker locker(&decode_lock_);
+
   if (!open_ && !Open()) {
     return nullptr;
   }
@@ -202,25 +219,32 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
   }
 
   // Convert timecode to AVStream timebase
-  int64_t target_ts = GetTimestampFromTime(timecode);
+  int64_t target_ts = GetTimestampFromTimeInternal(timecode);
 
   if (target_ts < 0) {
     Error(QStringLiteral("Index failed to produce a valid timestamp"));
     return nullptr;
   }
 
-  // Allocate frame that we'll return
-  FramePtr frame_container = Frame::Create();
-  frame_container->set_width(avstream_->codecpar->width);
-  frame_container->set_height(avstream_->codecpar->height);
-  frame_container->set_format(native_pix_fmt_);
-  frame_container->set_timestamp(Timecode::timestamp_to_time(target_ts, avstream_->time_base));
-  frame_container->set_sample_aspect_ratio(av_guess_sample_aspect_ratio(fmt_ctx_, avstream_, nullptr));
-  frame_container->allocate();
+  // If the read-ahead thread is converting this very frame, it's quicker to wait for it than to decode it again. Any
+  // other frame is retrieved without waiting.
+  while (read_ahead_converting_ts_ == target_ts) {
+    read_ahead_converted_.wait(&decode_lock_);
+  }
+
+  // See if the read-ahead thread already decoded this frame
+  FramePtr prefetched = TakePrefetchedFrame(target_ts);
+
+  if (prefetched) {
+    // Wake the read-ahead thread to replace the frame we just took
+    read_ahead_wait_.wakeAll();
+
+    return prefetched;
+  }
 
   bool got_frame = (frame_->pts == target_ts);
 
-  QByteArray frame_loader;
+  const uchar* stored_frame = nullptr;
   uint8_t* input_data[4];
   int input_linesize[4];
 
@@ -230,21 +254,18 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
     input_linesize[i] = frame_->linesize[i];
   }
 
-  // See if we stored this frame in the disk cache
-  if (!got_frame) {
-    QFile compressed_frame(GetIndexFilename().append(QString::number(target_ts)));
-    if (compressed_frame.exists()
-        && compressed_frame.size() > 0
-        && compressed_frame.open(QFile::ReadOnly)) {
-      DiskManager::instance()->Accessed(compressed_frame.fileName());
+  if (!frame_store_) {
+    frame_store_ = FrameStore::Open(GetIndexFilename().append(QStringLiteral(".frames")));
+  }
 
-      // Read data
-      frame_loader = qUncompress(compressed_frame.readAll());
-      //frame_loader = compressed_frame.readAll();
+  // See if we stored this frame in the media index, if so we can convert it straight from the mapped file
+  if (!got_frame && frame_store_) {
+    stored_frame = frame_store_->Map(target_ts);
 
+    if (stored_frame) {
       av_image_fill_arrays(input_data,
                            input_linesize,
-                           reinterpret_cast<uint8_t*>(frame_loader.data()),
+                           stored_frame,
                            static_cast<AVPixelFormat>(avstream_->codecpar->format),
                            avstream_->codecpar->width,
                            avstream_->codecpar->height,
@@ -258,11 +279,19 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
   if (!got_frame) {
     int64_t second_ts = qRound64(av_q2d(av_inv_q(avstream_->time_base)));
 
-    if (frame_->pts < target_ts - 2*second_ts || frame_->pts > target_ts) {
-      Seek(target_ts);
-    }
+    int64_t seek_ts = GetClosestKeyframeInIndex(target_ts);
 
-    int64_t seek_ts = target_ts;
+    if (seek_ts == AV_NOPTS_VALUE) {
+      // No keyframe information, fall back to letting FFmpeg find a keyframe before the target
+      seek_ts = target_ts;
+
+      if (frame_->pts < target_ts - 2*second_ts || frame_->pts > target_ts) {
+        Seek(seek_ts);
+      }
+    } else if (frame_->pts < seek_ts || frame_->pts > target_ts) {
+      // Seek directly to the keyframe before the target, unless decoding forward from where we are is quicker
+      Seek(seek_ts);
+    }
 
     int ret;
 
@@ -275,8 +304,15 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
       }
 
       if (frame_->pts > target_ts) {
-        // Seek failed, try again
-        seek_ts -= second_ts;
+        // Seek failed, try again from the keyframe before the one we tried (or a second earlier if we don't know it)
+        int64_t earlier_keyframe = GetClosestKeyframeInIndex(seek_ts - 1);
+
+        if (earlier_keyframe != AV_NOPTS_VALUE && earlier_keyframe < seek_ts) {
+          seek_ts = earlier_keyframe;
+        } else {
+          seek_ts -= second_ts;
+        }
+
         Seek(seek_ts);
         continue;
       }
@@ -285,69 +321,95 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode)
         // We found the frame we want
         got_frame = true;
 
+        // The decoder is now positioned right before the frames that will likely be requested next
+        StartReadAhead();
+
         // Set data arrays to the frame's data
         for (int i=0;i<4;i++) {
           input_data[i] = frame_->data[i];
           input_linesize[i] = frame_->linesize[i];
         }
 
-        QFile save_frame(GetIndexFilename().append(QString::number(frame_->pts)));
-        if (save_frame.open(QFile::WriteOnly)) {
-
+        if (frame_store_) {
           // Save frame to media index
           int cached_buffer_sz = av_image_get_buffer_size(static_cast<AVPixelFormat>(frame_->format),
                                                           frame_->width,
                                                           frame_->height,
                                                           1);
 
-          QByteArray cached_frame(cached_buffer_sz, Qt::Uninitialized);
+          uchar* cached_frame = frame_store_->Reserve(frame_->pts, cached_buffer_sz);
 
-          av_image_copy_to_buffer(reinterpret_cast<uint8_t*>(cached_frame.data()),
-                                  cached_frame.size(),
-                                  frame_->data,
-                                  frame_->linesize,
-                                  static_cast<AVPixelFormat>(frame_->format),
-                                  frame_->width,
-                                  frame_->height,
-                                  1);
+          if (cached_frame) {
+            av_image_copy_to_buffer(cached_frame,
+                                    cached_buffer_sz,
+                                    frame_->data,
+                                    frame_->linesize,
+                                    static_cast<AVPixelFormat>(frame_->format),
+                                    frame_->width,
+                                    frame_->height,
+                                    1);
 
-          save_frame.write(qCompress(cached_frame, 1));
-          save_frame.close();
-
-          DiskManager::instance()->CreatedFile(save_frame.fileName(), QByteArray());
+            frame_store_->Commit(cached_frame);
+          }
         }
         break;
       }
     }
   }
 
-  // If we're here and got the frame, we'll convert it and return it
-  if (got_frame) {
-    // Convert frame to RGBA for the rest of the pipeline
-    uint8_t* output_data = reinterpret_cast<uint8_t*>(frame_container->data());
-    int output_linesize = frame_container->width() * kRGBAChannels * PixelService::BytesPerChannel(native_pix_fmt_);
+  if (!got_frame) {
+    return nullptr;
+  }
+
+  // Take our own reference to the decoded data so the read-ahead thread can decode into frame_ while we convert
+  AVFrame* decoded = nullptr;
 
-    sws_scale(scale_ctx_,
-              input_data,
-              input_linesize,
-              0,
-              avstream_->codecpar->height,
-              &output_data,
-              &output_linesize);
+  if (!stored_frame) {
+    decoded = av_frame_clone(frame_);
+
+    if (!decoded) {
+      Error(QStringLiteral("Failed to reference decoded frame"));
+      return nullptr;
+    }
 
-    return frame_container;
+    for (int i=0;i<4;i++) {
+      input_data[i] = decoded->data[i];
+      input_linesize[i] = decoded->linesize[i];
+    }
   }
 
-  return nullptr;
+  FrameStorePtr store = frame_store_;
+
+  // Conversion doesn't touch the decoding state, so hand over to the scaler's lock before converting
+  scale_lock_.lock();
+  locker.unlock();
+
+  FramePtr converted_frame = ConvertFrame(input_data, input_linesize, target_ts);
+
+  scale_lock_.unlock();
+
+  if (decoded) {
+    av_frame_free(&decoded);
+  }
+
+  if (stored_frame) {
+    store->Unmap(stored_frame);
+  }
+
+  return converted_frame;
 }
 
 FramePtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &length, const AudioRenderingParams &params)
 {
+  decode_lock_.lock();
+
   if (!open_ && !Open()) {
+    decode_lock_.unlock();
     return nullptr;
   }
 
   if (avstream_->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+    decode_lock_.unlock();
     return nullptr;
   }
 
@@ -355,7 +417,12 @@ FramePtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &
 
   Conform(params);
 
-  WaveInput input(GetConformedFilename(params));
+  QString conformed_fn = GetConformedFilename(params);
+
+  // Reading the conformed PCM doesn't touch any decoder state
+  decode_lock_.unlock();
+
+  WaveInput input(conformed_fn);
 
   if (input.open()) {
     const AudioRenderingParams& input_params = input.params();
@@ -380,6 +447,17 @@ FramePtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &
 void FFmpegDecoder::Close()
 {
   frame_index_.clear();
+  keyframe_index_.clear();
+
+  timestamp_lock_.lock();
+  timestamp_index_.clear();
+  timestamp_lock_.unlock();
+
+  // Any prefetched frames are no longer valid
+  prefetched_frames_.clear();
+  read_ahead_active_ = false;
+
+  frame_store_ = nullptr;
 
   if (opts_) {
     av_dict_free(&opts_);
@@ -396,6 +474,9 @@ void FFmpegDecoder::Close()
     pkt_ = nullptr;
   }
 
+  // Wait for any conversion still using the scaler and format context
+  scale_lock_.lock();
+
   if (scale_ctx_) {
     sws_freeContext(scale_ctx_);
     scale_ctx_ = nullptr;
@@ -411,6 +492,8 @@ void FFmpegDecoder::Close()
     fmt_ctx_ = nullptr;
   }
 
+  scale_lock_.unlock();
+
   open_ = false;
 }
 
@@ -420,6 +503,25 @@ QString FFmpegDecoder::id()
 }
 
 int64_t FFmpegDecoder::GetTimestampFromTime(const rational &time)
+{
+  // Read the published index rather than taking decode_lock_, which may be held for a whole decode
+  timestamp_lock_.lock();
+  QVector<FrameIndexEntry> index = timestamp_index_;
+  AVRational time_base = timestamp_base_;
+  int64_t start_time = timestamp_start_;
+  timestamp_lock_.unlock();
+
+  if (index.isEmpty()) {
+    // Not opened or indexed yet, which has to be done by the decoder itself
+    QMutexLocker locker(&decode_lock_);
+
+    return GetTimestampFromTimeInternal(time);
+  }
+
+  return FindClosestTimestamp(index, Timecode::time_to_timestamp(time, time_base) + start_time);
+}
+
+int64_t FFmpegDecoder::GetTimestampFromTimeInternal(const rational &time)
 {
   if (!open_ && !Open()) {
     return -1;
@@ -670,7 +772,7 @@ bool FFmpegDecoder::Probe(Footage *f)
 
     // Use last frame index as the duration
     // FIXME: Does this skip the last frame?
-    int64_t duration = frame_index_.last();
+    int64_t duration = frame_index_.last().pts;
 
     f->stream(0)->set_duration(duration);
 
@@ -706,13 +808,15 @@ void FFmpegDecoder::Error(const QString &s)
   Close();
 }
 
-void FFmpegDecoder::Index()
+bool FFmpegDecoder::Index(const QAtomicInt *cancelled)
 {
   if (!open_) {
     qWarning() << "Indexing function tried to run while decoder was closed";
-    return;
+    return false;
   }
 
+  bool complete = true;
+
   stream()->index_lock_.lock();
 
   if (!LoadIndex()) {
@@ -721,9 +825,9 @@ void FFmpegDecoder::Index()
     Seek(0);
 
     if (avstream_->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-      IndexVideo(pkt_, frame_);
+      complete = IndexVideo(pkt_, cancelled);
     } else if (avstream_->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-      IndexAudio(pkt_, frame_);
+      complete = IndexAudio(pkt_, frame_, cancelled);
     }
 
     // Reset state
@@ -732,6 +836,8 @@ void FFmpegDecoder::Index()
   }
 
   stream()->index_lock_.unlock();
+
+  return complete;
 }
 
 QString FFmpegDecoder::GetIndexFilename()
@@ -784,16 +890,32 @@ bool FFmpegDecoder::LoadIndex()
     }
 
     if (index_file.open(QFile::ReadOnly)) {
-      // Resize based on filesize
-      frame_index_.resize(static_cast<int>(static_cast<size_t>(index_file.size()) / sizeof(int64_t)));
+      FrameIndexHeader header;
+
+      bool valid = (index_file.read(reinterpret_cast<char*>(&header), static_cast<qint64>(sizeof(FrameIndexHeader)))
+                    == static_cast<qint64>(sizeof(FrameIndexHeader)));
+
+      // Indexes from older versions (or interrupted writes) are discarded so that the media gets indexed again
+      valid = valid
+          && header.magic == kIndexMagic
+          && header.version == kIndexVersion
+          && header.count >= 0
+          && index_file.size() == static_cast<qint64>(sizeof(FrameIndexHeader))
+                                  + header.count * static_cast<qint64>(sizeof(FrameIndexEntry));
 
-      // Read frame index into vector
-      index_file.read(reinterpret_cast<char*>(frame_index_.data()),
-                      index_file.size());
+      if (valid) {
+        frame_index_.resize(static_cast<int>(header.count));
+
+        // Read frame index into vector
+        index_file.read(reinterpret_cast<char*>(frame_index_.data()),
+                        header.count * static_cast<qint64>(sizeof(FrameIndexEntry)));
+
+        UpdateKeyframeIndex();
+      }
 
       index_file.close();
 
-      return true;
+      return valid;
     }
     break;
   }
@@ -813,9 +935,17 @@ void FFmpegDecoder::SaveIndex()
   // Save index to file
   QFile index_file(GetIndexFilename());
   if (index_file.open(QFile::WriteOnly)) {
+    FrameIndexHeader header;
+    header.magic = kIndexMagic;
+    header.version = kIndexVersion;
+    header.count = frame_index_.size();
+
     // Write index in binary
+    index_file.write(reinterpret_cast<const char*>(&header),
+                     static_cast<qint64>(sizeof(FrameIndexHeader)));
+
     index_file.write(reinterpret_cast<const char*>(frame_index_.constData()),
-                     frame_index_.size() * static_cast<int>(sizeof(int64_t)));
+                     frame_index_.size() * static_cast<qint64>(sizeof(FrameIndexEntry)));
 
     index_file.close();
   } else {
@@ -823,7 +953,25 @@ void FFmpegDecoder::SaveIndex()
   }
 }
 
-void FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame)
+void FFmpegDecoder::UpdateKeyframeIndex()
+{
+  keyframe_index_.clear();
+
+  foreach (const FrameIndexEntry& entry, frame_index_) {
+    if (entry.flags & kFrameIsKeyframe) {
+      keyframe_index_.append(entry.pts);
+    }
+  }
+
+  // Share the finished index with GetTimestampFromTime() (the copy is implicitly shared so this is cheap)
+  timestamp_lock_.lock();
+  timestamp_index_ = frame_index_;
+  timestamp_base_ = avstream_->time_base;
+  timestamp_start_ = avstream_->start_time;
+  timestamp_lock_.unlock();
+}
+
+bool FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame, const QAtomicInt *cancelled)
 {
   // Iterate through each audio frame and extract the PCM data
 
@@ -831,7 +979,7 @@ void FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame)
   if (!channel_layout) {
     if (!avstream_->codecpar->channels) {
       // No channel data - we can't do anything with this
-      return;
+      return false;
     }
 
     channel_layout = static_cast<uint64_t>(av_get_default_channel_layout(avstream_->codecpar->channels));
@@ -858,18 +1006,32 @@ void FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame)
     dst_sample_fmt = src_sample_fmt;
   }
 
-  WaveOutput wave_out(GetIndexFilename(),
+  // Decode into a partial file first so an interrupted index is never mistaken for a complete one
+  QString index_fn = GetIndexFilename();
+  QString partial_fn = QStringLiteral("%1.partial").arg(index_fn);
+
+  WaveOutput wave_out(partial_fn,
                       AudioRenderingParams(avstream_->codecpar->sample_rate,
                                            channel_layout,
                                            FFmpegCommon::GetNativeSampleFormat(dst_sample_fmt)));
 
   int ret;
+  bool complete = false;
 
   if (wave_out.open()) {
+    int64_t file_size = avio_size(fmt_ctx_->pb);
+    int last_progress = -1;
+
     while (true) {
+      if (cancelled && cancelled->load()) {
+        break;
+      }
+
       ret = GetFrame(pkt, frame);
 
       if (ret < 0) {
+        // Assume we've reached the end of the file
+        complete = true;
         break;
       } else {
         AVFrame* data_frame;
@@ -908,10 +1070,21 @@ void FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame)
         if (data_frame != frame) {
           av_frame_free(&data_frame);
         }
+
+        UpdateIndexProgress(avio_tell(fmt_ctx_->pb), file_size, &last_progress);
       }
     }
 
     wave_out.close();
+
+    if (complete) {
+      QFile::remove(index_fn);
+      complete = QFile::rename(partial_fn, index_fn);
+    }
+
+    if (!complete) {
+      QFile::remove(partial_fn);
+    }
   } else {
     qWarning() << "Failed to open WAVE output for indexing";
   }
@@ -919,31 +1092,176 @@ void FFmpegDecoder::IndexAudio(AVPacket *pkt, AVFrame *frame)
   if (resampler != nullptr) {
     swr_free(&resampler);
   }
+
+  return complete;
 }
 
-void FFmpegDecoder::IndexVideo(AVPacket* pkt, AVFrame* frame)
+bool FFmpegDecoder::IndexVideo(AVPacket* pkt, const QAtomicInt* cancelled)
 {
-  // This should be unnecessary, but just in case...
   frame_index_.clear();
 
-  // Iterate through every single frame and get each timestamp
-  // NOTE: Expects no frames to have been read so far
+  // Collect each packet's timestamp, position and keyframe flag straight from the demuxer. Nothing here needs the
+  // decoded image so we skip decoding entirely, which is what made indexing so slow.
+  QFile partial_file(QStringLiteral("%1.partial").arg(GetIndexFilename()));
 
-  int ret;
+  if (!partial_file.open(QFile::ReadWrite)) {
+    qWarning() << QStringLiteral("Failed to open partial index for %1").arg(stream()->footage()->filename());
+    return false;
+  }
+
+  int64_t resume_pos = ResumePartialIndex(&partial_file);
+
+  int64_t file_size = avio_size(fmt_ctx_->pb);
+  int last_progress = -1;
+  int packets_since_checkpoint = 0;
+  bool complete = false;
 
   while (true) {
-    ret = GetFrame(pkt, frame);
+    if (cancelled && cancelled->load()) {
+      break;
+    }
 
-    if (ret >= 0) {
-      frame_index_.append(frame->pts);
-    } else {
+    av_packet_unref(pkt);
+
+    if (av_read_frame(fmt_ctx_, pkt) < 0) {
       // Assume we've reached the end of the file
+      complete = true;
       break;
     }
+
+    if (pkt->stream_index != avstream_->index) {
+      continue;
+    }
+
+    // Packets before this point were already indexed before the interruption
+    if (resume_pos >= 0 && pkt->pos >= 0 && pkt->pos <= resume_pos) {
+      continue;
+    }
+
+    FrameIndexEntry entry;
+
+    entry.pts = (pkt->pts == AV_NOPTS_VALUE) ? pkt->dts : pkt->pts;
+    entry.pos = pkt->pos;
+    entry.flags = (pkt->flags & AV_PKT_FLAG_KEY) ? kFrameIsKeyframe : 0;
+    entry.reserved = 0;
+
+    if (entry.pts == AV_NOPTS_VALUE) {
+      continue;
+    }
+
+    frame_index_.append(entry);
+
+    partial_file.write(reinterpret_cast<const char*>(&entry), static_cast<qint64>(sizeof(FrameIndexEntry)));
+
+    packets_since_checkpoint++;
+    if (packets_since_checkpoint == kIndexCheckpointInterval) {
+      partial_file.flush();
+      packets_since_checkpoint = 0;
+    }
+
+    UpdateIndexProgress(pkt->pos, file_size, &last_progress);
   }
 
+  av_packet_unref(pkt);
+
+  if (!complete) {
+    // Leave the partial index on disk so the next call can pick up from here
+    partial_file.close();
+    frame_index_.clear();
+    return false;
+  }
+
+  partial_file.remove();
+
+  // Lookups rely on the index being in presentation order
+  std::sort(frame_index_.begin(), frame_index_.end(), [](const FrameIndexEntry& a, const FrameIndexEntry& b) {
+    return a.pts < b.pts;
+  });
+
+  UpdateKeyframeIndex();
+
   // Save index to file
   SaveIndex();
+
+  return true;
+}
+
+int64_t FFmpegDecoder::ResumePartialIndex(QFile *partial_file)
+{
+  FrameIndexHeader header;
+
+  bool valid = (partial_file->read(reinterpret_cast<char*>(&header), static_cast<qint64>(sizeof(FrameIndexHeader)))
+                == static_cast<qint64>(sizeof(FrameIndexHeader)))
+      && header.magic == kIndexMagic
+      && header.version == kIndexVersion;
+
+  if (valid) {
+    // The entry count isn't known until the index is finished, so derive it from the file size and drop any entry that
+    // was only partially written
+    qint64 count = (partial_file->size() - static_cast<qint64>(sizeof(FrameIndexHeader)))
+        / static_cast<qint64>(sizeof(FrameIndexEntry));
+
+    frame_index_.resize(static_cast<int>(count));
+
+    partial_file->read(reinterpret_cast<char*>(frame_index_.data()),
+                       count * static_cast<qint64>(sizeof(FrameIndexEntry)));
+  }
+
+  // Entries are stored in demux order, so resume from the last keyframe we saw and skip anything at or before the
+  // last recorded packet
+  int64_t resume_pos = -1;
+  int64_t resume_pts = AV_NOPTS_VALUE;
+
+  foreach (const FrameIndexEntry& entry, frame_index_) {
+    if (entry.pos < 0) {
+      // Without byte positions we can't tell which packets have already been seen
+      resume_pos = -1;
+      break;
+    }
+
+    resume_pos = qMax(resume_pos, entry.pos);
+
+    if (entry.flags & kFrameIsKeyframe) {
+      resume_pts = entry.pts;
+    }
+  }
+
+  if (resume_pos >= 0 && resume_pts != AV_NOPTS_VALUE
+      && av_seek_frame(fmt_ctx_, avstream_->index, resume_pts, AVSEEK_FLAG_BACKWARD) >= 0) {
+    partial_file->seek(static_cast<qint64>(sizeof(FrameIndexHeader))
+                       + frame_index_.size() * static_cast<qint64>(sizeof(FrameIndexEntry)));
+    partial_file->resize(partial_file->pos());
+
+    return resume_pos;
+  }
+
+  // Nothing usable, start again from the beginning
+  frame_index_.clear();
+
+  header.magic = kIndexMagic;
+  header.version = kIndexVersion;
+  header.count = 0;
+
+  partial_file->resize(0);
+  partial_file->seek(0);
+  partial_file->write(reinterpret_cast<const char*>(&header), static_cast<qint64>(sizeof(FrameIndexHeader)));
+
+  return -1;
+}
+
+void FFmpegDecoder::UpdateIndexProgress(int64_t position, int64_t total, int *last_progress)
+{
+  if (position < 0 || total <= 0) {
+    return;
+  }
+
+  int progress = static_cast<int>(qBound(static_cast<int64_t>(0), position * 100 / total, static_cast<int64_t>(100)));
+
+  if (progress != *last_progress) {
+    *last_progress = progress;
+
+    emit IndexProgress(progress);
+  }
 }
 
 int FFmpegDecoder::GetFrame(AVPacket *pkt, AVFrame *frame)
@@ -998,26 +1316,46 @@ int64_t FFmpegDecoder::GetClosestTimestampInIndex(const int64_t &ts)
     Index();
   }
 
-  if (frame_index_.isEmpty()) {
+  return FindClosestTimestamp(frame_index_, ts);
+}
+
+int64_t FFmpegDecoder::FindClosestTimestamp(const QVector<FrameIndexEntry> &index, const int64_t &ts)
+{
+  if (index.isEmpty()) {
     return -1;
   }
 
-  if (ts <= 0) {
-    return frame_index_.first();
+  // Find the last frame at or before this timestamp
+  QVector<FrameIndexEntry>::const_iterator next = std::upper_bound(index.constBegin(),
+                                                                   index.constEnd(),
+                                                                   ts,
+                                                                   [](const int64_t& t, const FrameIndexEntry& e) {
+    return t < e.pts;
+  });
+
+  if (next == index.constBegin()) {
+    return index.first().pts;
   }
 
-  // Use index to find closest frame in file
-  for (int i=1;i<frame_index_.size();i++) {
-    int64_t this_ts = frame_index_.at(i);
+  return (next - 1)->pts;
+}
 
-    if (this_ts == ts) {
-      return ts;
-    } else if (this_ts > ts) {
-      return frame_index_.at(i - 1);
-    }
+int64_t FFmpegDecoder::GetClosestKeyframeInIndex(const int64_t &ts)
+{
+  if (keyframe_index_.isEmpty()) {
+    return AV_NOPTS_VALUE;
+  }
+
+  // Find the last keyframe at or before this timestamp
+  QVector<int64_t>::const_iterator next = std::upper_bound(keyframe_index_.constBegin(),
+                                                           keyframe_index_.constEnd(),
+                                                           ts);
+
+  if (next == keyframe_index_.constBegin()) {
+    return keyframe_index_.first();
   }
 
-  return frame_index_.last();
+  return *(next - 1);
 }
 
 void FFmpegDecoder::Seek(int64_t timestamp)
@@ -1025,3 +1363,146 @@ void FFmpegDecoder::Seek(int64_t timestamp)
   avcodec_flush_buffers(codec_ctx_);
   av_seek_frame(fmt_ctx_, avstream_->index, timestamp, AVSEEK_FLAG_BACKWARD);
 }
+
+FramePtr FFmpegDecoder::ConvertFrame(uint8_t **input_data, int *input_linesize, int64_t pts)
+{
+  // Allocate frame that we'll return
+  FramePtr frame_container = Frame::Create();
+  frame_container->set_width(avstream_->codecpar->width);
+  frame_container->set_height(avstream_->codecpar->height);
+  frame_container->set_format(native_pix_fmt_);
+  frame_container->set_timestamp(Timecode::timestamp_to_time(pts, avstream_->time_base));
+  frame_container->set_sample_aspect_ratio(av_guess_sample_aspect_ratio(fmt_ctx_, avstream_, nullptr));
+  frame_container->allocate();
+
+  // Convert frame to RGBA for the rest of the pipeline
+  uint8_t* output_data = reinterpret_cast<uint8_t*>(frame_container->data());
+  int output_linesize = frame_container->width() * kRGBAChannels * PixelService::BytesPerChannel(native_pix_fmt_);
+
+  sws_scale(scale_ctx_,
+            input_data,
+            input_linesize,
+            0,
+            avstream_->codecpar->height,
+            &output_data,
+            &output_linesize);
+
+  return frame_container;
+}
+
+FramePtr FFmpegDecoder::TakePrefetchedFrame(int64_t pts)
+{
+  while (!prefetched_frames_.isEmpty()) {
+    const PrefetchedFrame& f = prefetched_frames_.first();
+
+    if (f.pts == pts) {
+      FramePtr frame = f.frame;
+      prefetched_frames_.removeFirst();
+      return frame;
+    } else if (f.pts > pts) {
+      // The requested frame is before the buffer, we must be seeking backwards
+      break;
+    }
+
+    // This frame was skipped over so it won't be needed anymore
+    prefetched_frames_.removeFirst();
+  }
+
+  // The decoder is about to move elsewhere, so anything left in the buffer is useless
+  prefetched_frames_.clear();
+  read_ahead_active_ = false;
+
+  return nullptr;
+}
+
+void FFmpegDecoder::StartReadAhead()
+{
+  read_ahead_active_ = true;
+
+  if (!read_ahead_thread_) {
+    read_ahead_thread_ = new ReadAheadThread(this);
+    read_ahead_thread_->start(QThread::LowPriority);
+  }
+
+  read_ahead_wait_.wakeAll();
+}
+
+void FFmpegDecoder::StopReadAhead()
+{
+  if (!read_ahead_thread_) {
+    return;
+  }
+
+  decode_lock_.lock();
+  read_ahead_quit_ = true;
+  read_ahead_wait_.wakeAll();
+  decode_lock_.unlock();
+
+  read_ahead_thread_->wait();
+  delete read_ahead_thread_;
+  read_ahead_thread_ = nullptr;
+
+  read_ahead_quit_ = false;
+}
+
+void FFmpegDecoder::ReadAheadLoop()
+{
+  QMutexLocker locker(&decode_lock_);
+
+  while (!read_ahead_quit_) {
+    if (!open_
+        || !read_ahead_active_
+        || prefetched_frames_.size() >= kReadAheadFrameCount) {
+      // Nothing to do until another frame is requested
+      read_ahead_wait_.wait(&decode_lock_);
+      continue;
+    }
+
+    if (GetFrame(pkt_, frame_) < 0) {
+      // Most likely the end of the file, wait until the decoder is moved somewhere else
+      read_ahead_active_ = false;
+      continue;
+    }
+
+    AVFrame* decoded = av_frame_clone(frame_);
+
+    if (!decoded) {
+      read_ahead_active_ = false;
+      continue;
+    }
+
+    // Convert without decode_lock_ so a worker can decode a frame that isn't in the buffer in the meantime. Only a
+    // worker after this exact frame waits for it (see RetrieveVideo()).
+    read_ahead_converting_ts_ = decoded->pts;
+
+    scale_lock_.lock();
+    locker.unlock();
+
+    FramePtr converted = ConvertFrame(decoded->data, decoded->linesize, decoded->pts);
+
+    scale_lock_.unlock();
+
+    int64_t pts = decoded->pts;
+    av_frame_free(&decoded);
+
+    locker.relock();
+
+    read_ahead_converting_ts_ = AV_NOPTS_VALUE;
+    read_ahead_converted_.wakeAll();
+
+    // The decoder may have been closed while we were converting
+    if (read_ahead_active_) {
+      prefetched_frames_.append({pts, converted});
+    }
+  }
+}
+
+FFmpegDecoder::ReadAheadThread::ReadAheadThread(FFmpegDecoder *decoder) :
+  decoder_(decoder)
+{
+}
+
+void FFmpegDecoder::ReadAheadThread::run()
+{
+  decoder_->ReadAheadLoop();
+}
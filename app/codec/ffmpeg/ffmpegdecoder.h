@@ -27,14 +27,23 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <QFile>
+#include <QMutex>
+#include <QThread>
 #include <QVector>
+#include <QWaitCondition>
 
 #include "audio/sampleformat.h"
 #include "codec/decoder.h"
+#include "codec/framestore.h"
 #include "codec/waveoutput.h"
 
 /**
  * @brief A Decoder derivative that wraps FFmpeg functions as on Olive decoder
+ *
+ * FFmpegDecoder is thread-safe so that it can be shared between render workers through the DecoderPool. After a video
+ * frame is decoded, a background thread continues decoding the frames following it so that sequential retrieval
+ * (playback/export) rarely has to wait for the decoder.
  */
 class FFmpegDecoder : public Decoder
 {
@@ -62,6 +71,99 @@ public:
   virtual bool SupportsAudio() override;
 
 private:
+  /**
+   * @brief Thread that runs ReadAheadLoop()
+   */
+  class ReadAheadThread : public QThread
+  {
+  public:
+    ReadAheadThread(FFmpegDecoder* decoder);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    FFmpegDecoder* decoder_;
+
+  };
+
+  /**
+   * @brief A single frame in the video index
+   *
+   * Written to the index file as-is, so kIndexVersion must be bumped if this layout changes.
+   */
+  struct FrameIndexEntry {
+    int64_t pts;
+
+    /// Byte position of the frame's packet in the file (-1 if unknown)
+    int64_t pos;
+
+    int32_t flags;
+    int32_t reserved;
+  };
+
+  enum FrameIndexFlag {
+    kFrameIsKeyframe = 0x1
+  };
+
+  struct FrameIndexHeader {
+    quint32 magic;
+    quint32 version;
+    qint64 count;
+  };
+
+  static const quint32 kIndexMagic;
+  static const quint32 kIndexVersion;
+
+  /**
+   * @brief Number of packets read between flushes of a partial index to disk
+   */
+  static const int kIndexCheckpointInterval;
+
+  struct PrefetchedFrame {
+    int64_t pts;
+    FramePtr frame;
+  };
+
+  /**
+   * @brief Number of frames the read-ahead thread will decode past the most recently retrieved one
+   */
+  static const int kReadAheadFrameCount;
+
+  /**
+   * @brief Internal non-locking version of GetTimestampFromTime()
+   */
+  int64_t GetTimestampFromTimeInternal(const rational& time);
+
+  /**
+   * @brief Convert raw decoded data into a Frame in the native pixel format
+   */
+  FramePtr ConvertFrame(uint8_t** input_data, int* input_linesize, int64_t pts);
+
+  /**
+   * @brief Take a frame with this timestamp from the read-ahead buffer if it's there
+   *
+   * Any frames before `pts` are discarded. If the frame wasn't found, the buffer is cleared entirely since the decoder
+   * is about to move to another position.
+   */
+  FramePtr TakePrefetchedFrame(int64_t pts);
+
+  /**
+   * @brief Signal the read-ahead thread to start decoding frames from the decoder's current position
+   *
+   * Must be called with decode_lock_ held.
+   */
+  void StartReadAhead();
+
+  /**
+   * @brief Stop and destroy the read-ahead thread
+   *
+   * Must be called without decode_lock_ held.
+   */
+  void StopReadAhead();
+
+  void ReadAheadLoop();
+
   void ConformInternal(SwrContext *resampler, WaveOutput *output, const char *in_data, int in_sample_count);
 
   /**
@@ -92,7 +194,7 @@ private:
    */
   int GetFrame(AVPacket* pkt, AVFrame* frame);
 
-  virtual void Index() override;
+  virtual bool Index(const QAtomicInt* cancelled = nullptr) override;
 
   /**
    * @brief Returns the filename for the index
@@ -121,11 +223,55 @@ private:
    */
   void SaveIndex();
 
-  void IndexAudio(AVPacket* pkt, AVFrame* frame);
-  void IndexVideo(AVPacket* pkt, AVFrame* frame);
+  /**
+   * @brief Decode the entire audio stream into a WAVE file that later retrieval is served from
+   *
+   * Written to a ".partial" file that only replaces the index once complete, so a cancelled index is never mistaken
+   * for a finished one.
+   */
+  bool IndexAudio(AVPacket* pkt, AVFrame* frame, const QAtomicInt* cancelled);
+
+  /**
+   * @brief Build the frame index by demuxing packets (no decoding)
+   *
+   * Entries are checkpointed to a ".partial" file as they're read so that an interrupted index resumes from the last
+   * recorded packet rather than from the start of the file.
+   */
+  bool IndexVideo(AVPacket* pkt, const QAtomicInt* cancelled);
 
+  /**
+   * @brief Load entries from an interrupted IndexVideo() and seek the demuxer to where it stopped
+   *
+   * @return
+   *
+   * The byte position of the last packet already indexed, or -1 if indexing must start from the beginning.
+   */
+  int64_t ResumePartialIndex(QFile* partial_file);
+
+  /**
+   * @brief Emit IndexProgress() if the integer percentage of `position` over `total` has changed
+   */
+  void UpdateIndexProgress(int64_t position, int64_t total, int* last_progress);
+
+  /**
+   * @brief Rebuild keyframe_index_ from frame_index_ and publish the index for GetTimestampFromTime()
+   */
+  void UpdateKeyframeIndex();
+
+  /**
+   * @brief Find the timestamp of the last frame at or before `ts` (O(log n))
+   */
   int64_t GetClosestTimestampInIndex(const int64_t& ts);
 
+  static int64_t FindClosestTimestamp(const QVector<FrameIndexEntry>& index, const int64_t& ts);
+
+  /**
+   * @brief Find the timestamp of the last keyframe at or before `ts` (O(log n))
+   *
+   * Returns AV_NOPTS_VALUE if the index contains no keyframe information.
+   */
+  int64_t GetClosestKeyframeInIndex(const int64_t& ts);
+
   void Seek(int64_t timestamp);
 
   AVFormatContext* fmt_ctx_;
@@ -143,7 +289,64 @@ private:
 
   AVDictionary* opts_;
 
-  QVector<int64_t> frame_index_;
+  /**
+   * @brief Every frame in the stream sorted by timestamp
+   */
+  QVector<FrameIndexEntry> frame_index_;
+
+  /**
+   * @brief Timestamps of every keyframe in frame_index_
+   */
+  QVector<int64_t> keyframe_index_;
+
+  /**
+   * @brief Decoded frames previously stored for this stream
+   */
+  FrameStorePtr frame_store_;
+
+  /**
+   * @brief Lock for all decoding state, including the read-ahead buffer
+   *
+   * Only held while demuxing and decoding. Frames are converted with scale_lock_ held instead, which is taken before
+   * this is released so Close() can't free the scaler in between.
+   */
+  QMutex decode_lock_;
+
+  /**
+   * @brief Lock for scale_ctx_ and the format context while ConvertFrame() is running
+   */
+  QMutex scale_lock_;
+
+  QWaitCondition read_ahead_wait_;
+
+  /**
+   * @brief Woken when the read-ahead thread has added the frame it was converting to the buffer
+   */
+  QWaitCondition read_ahead_converted_;
+
+  ReadAheadThread* read_ahead_thread_;
+
+  bool read_ahead_active_;
+
+  bool read_ahead_quit_;
+
+  /**
+   * @brief Timestamp of the frame the read-ahead thread is converting without decode_lock_, AV_NOPTS_VALUE if none
+   */
+  int64_t read_ahead_converting_ts_;
+
+  QList<PrefetchedFrame> prefetched_frames_;
+
+  /**
+   * @brief Copy of the finished frame index so timestamps can be looked up without decode_lock_
+   */
+  QVector<FrameIndexEntry> timestamp_index_;
+
+  AVRational timestamp_base_;
+
+  int64_t timestamp_start_;
+
+  QMutex timestamp_lock_;
 
 };
 
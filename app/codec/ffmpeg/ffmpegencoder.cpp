@@ -17,10 +17,14 @@ FFmpegEncoder::FFmpegEncoder(const EncodingParams &params) :
 {
 }
 
-void FFmpegEncoder::WriteAudio(const AudioRenderingParams &pcm_info, const QString &pcm_filename)
+void FFmpegEncoder::WriteAudio(const AudioRenderingParams &pcm_info, const QString &pcm_filename, const TimeRange &range)
 {
   QFile pcm(pcm_filename);
   if (pcm.open(QFile::ReadOnly)) {
+    // The PCM file covers the whole Sequence, only encode the requested range of it
+    pcm.seek(pcm_info.time_to_bytes(range.in()));
+    qint64 bytes_remaining = pcm_info.time_to_bytes(range.length());
+
     // Divide PCM stream into AVFrames
 
     // See if the codec defines a number of samples per frame
@@ -60,11 +64,12 @@ void FFmpegEncoder::WriteAudio(const AudioRenderingParams &pcm_info, const QStri
     av_frame_get_buffer(frame, 0);
     int sample_counter = 0;
 
-    while (!pcm.atEnd()) {
+    while (!pcm.atEnd() && bytes_remaining > 0) {
       int samples_needed = static_cast<int>(frame->nb_samples + swr_get_delay(swr_ctx, pcm_info.sample_rate()));
 
       QByteArray input_data;
-      input_data = pcm.read(pcm_info.samples_to_bytes(samples_needed));
+      input_data = pcm.read(qMin(static_cast<qint64>(pcm_info.samples_to_bytes(samples_needed)), bytes_remaining));
+      bytes_remaining -= input_data.size();
       const char* input_data_array = input_data.constData();
       samples_needed = pcm_info.bytes_to_samples(input_data.size());
 
@@ -188,11 +193,21 @@ void FFmpegEncoder::WriteInternal(FramePtr frame)
 
   // We may need to convert this frame to a frame that swscale will understand
   if (frame->format() != video_conversion_fmt_) {
-    frame = PixelService::ConvertPixelFormat(frame, video_conversion_fmt_);
+    // Reuse the same buffer for every frame rather than allocating a new one
+    video_conversion_buffer_.resize(PixelService::GetBufferSize(video_conversion_fmt_, frame->width(), frame->height()));
+
+    PixelService::ConvertPixelFormat(frame->const_data(),
+                                     frame->format(),
+                                     video_conversion_buffer_.data(),
+                                     video_conversion_fmt_,
+                                     frame->width() * frame->height());
+
+    input_data = video_conversion_buffer_.constData();
+  } else {
+    input_data = frame->const_data();
   }
 
   // Use swscale context to convert formats/linesizes
-  input_data = frame->const_data();
   input_linesize = frame->width() * PixelService::BytesPerPixel(video_conversion_fmt_);
   error_code = sws_scale(video_scale_ctx_,
                          reinterpret_cast<const uint8_t**>(&input_data),
@@ -230,6 +245,8 @@ void FFmpegEncoder::CloseInternal()
     video_scale_ctx_ = nullptr;
   }
 
+  video_conversion_buffer_.clear();
+
   if (video_codec_ctx_) {
     avcodec_free_context(&video_codec_ctx_);
     video_codec_ctx_ = nullptr;
@@ -16,7 +16,7 @@ public:
   FFmpegEncoder(const EncodingParams &params);
 
 public slots:
-  virtual void WriteAudio(const AudioRenderingParams& pcm_info, const QString& pcm_filename) override;
+  virtual void WriteAudio(const AudioRenderingParams& pcm_info, const QString& pcm_filename, const TimeRange& range) override;
 
 protected:
   virtual bool OpenInternal() override;
@@ -57,6 +57,7 @@ private:
   AVCodecContext* video_codec_ctx_;
   SwsContext* video_scale_ctx_;
   PixelFormat::Format video_conversion_fmt_;
+  QByteArray video_conversion_buffer_;
 
   AVStream* audio_stream_;
   AVCodecContext* audio_codec_ctx_;
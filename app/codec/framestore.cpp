@@ -0,0 +1,406 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "framestore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_WINDOWS
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "render/diskmanager.h"
+
+// "OFST" and "OFRM" in little endian
+const quint32 FrameStore::kFileMagic = 0x5453464F;
+const quint32 FrameStore::kFileVersion = 1;
+const quint32 FrameStore::kMagic = 0x4D52464F;
+const qint64 FrameStore::kAlignment = 64;
+const qint64 FrameStore::kFileHeaderSize = 64;
+const qint64 FrameStore::kHeaderSize = 64;
+const qint64 FrameStore::kSegmentSize = Q_INT64_C(256) * 1024 * 1024;
+
+QHash<QString, std::weak_ptr<FrameStore> > FrameStore::stores_;
+QMutex FrameStore::stores_lock_;
+
+FrameStore::FrameStore(const QString &filename) :
+  filename_(filename)
+{
+}
+
+FrameStore::~FrameStore()
+{
+  foreach (Segment* segment, segments_) {
+    CloseSegment(segment);
+    delete segment;
+  }
+}
+
+FrameStorePtr FrameStore::Open(const QString &filename)
+{
+  QMutexLocker locker(&stores_lock_);
+
+  FrameStorePtr store = stores_.value(filename).lock();
+
+  if (!store) {
+    store = FrameStorePtr(new FrameStore(filename));
+
+    if (!store->OpenInternal()) {
+      qWarning() << "Failed to open frame store" << filename;
+      return nullptr;
+    }
+
+    stores_.insert(filename, store);
+  }
+
+  return store;
+}
+
+const QString &FrameStore::filename() const
+{
+  return filename_;
+}
+
+const uchar *FrameStore::Map(int64_t pts, qint64 *size)
+{
+  lock_.lock();
+
+  QHash<int64_t, Record>::const_iterator record = records_.constFind(pts);
+
+  if (record == records_.constEnd()) {
+    lock_.unlock();
+    return nullptr;
+  }
+
+  if (size) {
+    *size = record->size;
+  }
+
+  Segment* segment = segments_.value(record->segment);
+
+  uchar* data = segment->file.map(record->offset, record->size);
+
+  QString segment_filename = segment->file.fileName();
+
+  if (data) {
+    segment->map_count++;
+    mapped_.insert(data, record->segment);
+  }
+
+  lock_.unlock();
+
+  if (data) {
+    DiskManager::instance()->Accessed(segment_filename);
+  }
+
+  return data;
+}
+
+void FrameStore::Unmap(const uchar *data)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<const uchar*, int>::iterator mapping = mapped_.find(data);
+
+  if (mapping == mapped_.end()) {
+    return;
+  }
+
+  Segment* segment = segments_.value(mapping.value());
+
+  mapped_.erase(mapping);
+
+  if (segment->file.unmap(const_cast<uchar*>(data))) {
+    segment->map_count--;
+  }
+}
+
+uchar *FrameStore::Reserve(int64_t pts, qint64 size)
+{
+  QMutexLocker locker(&lock_);
+
+  Segment* segment = segments_.isEmpty() ? nullptr : segments_.last();
+
+  // Start a new segment if this one is full or the DiskManager deleted it to free space. While other decoders still
+  // have a deleted segment mapped we keep it open, since closing it would pull their data out from under them.
+  if (!segment
+      || (segment->end > kFileHeaderSize && segment->end + kHeaderSize + size > kSegmentSize)
+      || !QFileInfo::exists(segment->file.fileName())) {
+    DropDeletedSegments();
+
+    segment = AddSegment();
+
+    if (!segment) {
+      return nullptr;
+    }
+  }
+
+  if (!segment->dirty) {
+    // Until this segment is closed cleanly, anything in it can't be trusted after a crash
+    if (!WriteFileHeader(&segment->file, false)) {
+      return nullptr;
+    }
+
+    segment->dirty = true;
+  }
+
+  qint64 header_offset = segment->end;
+  qint64 data_offset = header_offset + kHeaderSize;
+  qint64 new_end = Align(data_offset + size);
+
+  if (!segment->file.resize(new_end)) {
+    return nullptr;
+  }
+
+  uchar* data = segment->file.map(data_offset, size);
+
+  if (!data) {
+    segment->file.resize(segment->end);
+    return nullptr;
+  }
+
+  segment->end = new_end;
+  segment->map_count++;
+
+  PendingRecord p;
+  p.segment = segments_.lastKey();
+  p.header_offset = header_offset;
+  p.header.magic = kMagic;
+  p.header.codec = kCodecRaw;
+  p.header.pts = pts;
+  p.header.size = size;
+  p.header.reserved = 0;
+
+  pending_.insert(data, p);
+
+  return data;
+}
+
+void FrameStore::Commit(uchar *data)
+{
+  lock_.lock();
+
+  PendingRecord p = pending_.take(data);
+  Segment* segment = segments_.value(p.segment);
+
+  segment->file.unmap(data);
+  segment->map_count--;
+
+  // The header marks the record as complete, so it's only written once the data is in place
+  segment->file.seek(p.header_offset);
+  segment->file.write(reinterpret_cast<const char*>(&p.header), static_cast<qint64>(sizeof(Header)));
+  segment->file.flush();
+
+  records_.insert(p.header.pts, {p.segment, p.header_offset + kHeaderSize, p.header.size});
+
+  QString segment_filename = segment->file.fileName();
+
+  lock_.unlock();
+
+  DiskManager::instance()->ResizedFile(segment_filename);
+}
+
+bool FrameStore::OpenInternal()
+{
+  QFileInfo info(filename_);
+
+  if (!QDir(info.path()).mkpath(QStringLiteral("."))) {
+    return false;
+  }
+
+  // Segment files are named after the store with their number appended
+  QStringList segment_files = QDir(info.path()).entryList({info.fileName() + QStringLiteral(".*")}, QDir::Files);
+
+  foreach (const QString& fn, segment_files) {
+    bool ok;
+    int number = fn.mid(info.fileName().size() + 1).toInt(&ok);
+
+    if (ok && number >= 0) {
+      OpenSegment(number);
+    }
+  }
+
+  return true;
+}
+
+FrameStore::Segment *FrameStore::OpenSegment(int number)
+{
+  Segment* segment = new Segment(GetSegmentFilename(number));
+
+  if (!segment->file.open(QFile::ReadWrite)) {
+    delete segment;
+    return nullptr;
+  }
+
+  qint64 file_size = segment->file.size();
+
+  FileHeader fh;
+
+  bool clean = (segment->file.read(reinterpret_cast<char*>(&fh), static_cast<qint64>(sizeof(FileHeader)))
+                == static_cast<qint64>(sizeof(FileHeader)))
+      && fh.magic == kFileMagic
+      && fh.version == kFileVersion
+      && fh.clean;
+
+  qint64 offset = kFileHeaderSize;
+
+  if (clean) {
+    while (offset + kHeaderSize <= file_size) {
+      Header h;
+
+      if (!segment->file.seek(offset)
+          || segment->file.read(reinterpret_cast<char*>(&h), static_cast<qint64>(sizeof(Header))) != static_cast<qint64>(sizeof(Header))) {
+        break;
+      }
+
+      if (h.magic != kMagic
+          || h.codec != kCodecRaw
+          || h.size < 0
+          || offset + kHeaderSize + h.size > file_size) {
+        // This record was never completed, nothing after it can be trusted
+        break;
+      }
+
+      records_.insert(h.pts, {number, offset + kHeaderSize, h.size});
+
+      offset = Align(offset + kHeaderSize + h.size);
+    }
+  } else if (file_size > 0) {
+    qWarning() << "Discarding frame store segment that wasn't closed cleanly:" << segment->file.fileName();
+  }
+
+  segment->end = offset;
+
+  if (file_size != segment->end) {
+    // Discard incomplete data so that new records are appended right after the last complete one
+    segment->file.resize(segment->end);
+    DiskManager::instance()->ResizedFile(segment->file.fileName());
+  }
+
+  segments_.insert(number, segment);
+
+  return segment;
+}
+
+FrameStore::Segment *FrameStore::AddSegment()
+{
+  int number = segments_.isEmpty() ? 0 : segments_.lastKey() + 1;
+
+  // Start from scratch in case a file was left behind with this number
+  QFile::remove(GetSegmentFilename(number));
+
+  return OpenSegment(number);
+}
+
+void FrameStore::DropDeletedSegments()
+{
+  QList<int> dropped;
+
+  for (QMap<int, Segment*>::iterator it=segments_.begin();it!=segments_.end();) {
+    Segment* segment = it.value();
+
+    if (segment->map_count == 0 && !QFileInfo::exists(segment->file.fileName())) {
+      dropped.append(it.key());
+
+      segment->file.close();
+      delete segment;
+
+      it = segments_.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  if (dropped.isEmpty()) {
+    return;
+  }
+
+  for (QHash<int64_t, Record>::iterator it=records_.begin();it!=records_.end();) {
+    if (dropped.contains(it->segment)) {
+      it = records_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void FrameStore::CloseSegment(Segment *segment)
+{
+  if (segment->dirty && QFileInfo::exists(segment->file.fileName())) {
+    // Only mark the segment clean once its frames are on disk, a crash before this discards it on the next open
+    if (SyncFile(&segment->file)) {
+      WriteFileHeader(&segment->file, true);
+      SyncFile(&segment->file);
+    } else {
+      qWarning() << "Failed to sync frame store segment" << segment->file.fileName();
+    }
+  }
+
+  segment->file.close();
+}
+
+bool FrameStore::SyncFile(QFile *file)
+{
+  if (!file->flush()) {
+    return false;
+  }
+
+#ifdef Q_OS_WINDOWS
+  return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file->handle()))) != 0;
+#else
+  return fsync(file->handle()) == 0;
+#endif
+}
+
+bool FrameStore::WriteFileHeader(QFile *file, bool clean)
+{
+  FileHeader fh = {kFileMagic, kFileVersion, clean ? 1u : 0u, 0};
+
+  if (file->size() < kFileHeaderSize && !file->resize(kFileHeaderSize)) {
+    return false;
+  }
+
+  return file->seek(0)
+      && file->write(reinterpret_cast<const char*>(&fh), static_cast<qint64>(sizeof(FileHeader))) == static_cast<qint64>(sizeof(FileHeader))
+      && file->flush();
+}
+
+QString FrameStore::GetSegmentFilename(int number) const
+{
+  return QStringLiteral("%1.%2").arg(filename_, QString::number(number));
+}
+
+qint64 FrameStore::Align(qint64 offset)
+{
+  return ((offset + kAlignment - 1) / kAlignment) * kAlignment;
+}
+
+FrameStore::Segment::Segment(const QString &filename) :
+  file(filename),
+  end(0),
+  map_count(0),
+  dirty(false)
+{
+}
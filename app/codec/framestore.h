@@ -0,0 +1,236 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMESTORE_H
+#define FRAMESTORE_H
+
+#include <memory>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <stdint.h>
+
+#include "common/constructors.h"
+
+class FrameStore;
+using FrameStorePtr = std::shared_ptr<FrameStore>;
+
+/**
+ * @brief An append-only, memory-mapped container of raw decoded frames
+ *
+ * Used by decoders to keep already decoded source frames on disk so they don't have to be decoded again. The frames
+ * of a stream are stored in a series of segment files (`filename` with the segment number appended), each holding a
+ * series of records (a small header followed by the frame data) aligned to kAlignment bytes. Frames are read by
+ * mapping their record directly into memory, so they can be passed straight to a converter without being copied or
+ * decompressed first.
+ *
+ * Every segment is a separate DiskManager entry so that evicting old frames only discards one segment rather than the
+ * whole stream.
+ *
+ * Nothing is synced while frames are being written since this is only a cache. Instead, a segment is marked as being
+ * written the first time a frame is added to it and only marked clean again once it's been synced when the store is
+ * closed. Segments that weren't closed cleanly (e.g. the application crashed) are discarded when they're opened.
+ *
+ * FrameStores are shared by every decoder using the same filename and are thread-safe.
+ */
+class FrameStore
+{
+public:
+  ~FrameStore();
+
+  DISABLE_COPY_MOVE(FrameStore)
+
+  /**
+   * @brief Get the FrameStore for a filename, opening (or creating) it if nobody else has it open
+   *
+   * @return
+   *
+   * A FrameStore or nullptr if the store could not be opened
+   */
+  static FrameStorePtr Open(const QString& filename);
+
+  const QString& filename() const;
+
+  /**
+   * @brief Map the frame with this timestamp into memory
+   *
+   * Also counts as an access of the frame's segment for the DiskManager.
+   *
+   * @return
+   *
+   * A pointer to the frame's data or nullptr if this frame isn't stored. The pointer stays valid until it's passed
+   * to Unmap(), even if the segment is deleted in the meantime.
+   */
+  const uchar* Map(int64_t pts, qint64* size = nullptr);
+
+  /**
+   * @brief Release a pointer returned by Map()
+   */
+  void Unmap(const uchar* data);
+
+  /**
+   * @brief Allocate space for a new frame at the end of the current segment and map it for writing
+   *
+   * The frame is not visible to Map() until Commit() is called with the returned pointer.
+   *
+   * @return
+   *
+   * A writable pointer of `size` bytes or nullptr if the space could not be allocated.
+   */
+  uchar* Reserve(int64_t pts, qint64 size);
+
+  /**
+   * @brief Finish writing a frame allocated with Reserve()
+   */
+  void Commit(uchar* data);
+
+private:
+  FrameStore(const QString& filename);
+
+  struct Segment {
+    Segment(const QString& filename);
+
+    QFile file;
+
+    /**
+     * @brief Offset new records are appended at
+     */
+    qint64 end;
+
+    /**
+     * @brief Number of pointers into this segment returned by Map() or Reserve() that haven't been released yet
+     */
+    int map_count;
+
+    /**
+     * @brief Whether this segment has been marked as being written since it was opened
+     */
+    bool dirty;
+  };
+
+  /**
+   * @brief Open every existing segment and read the headers of their complete records into records_
+   */
+  bool OpenInternal();
+
+  /**
+   * @brief Open a segment, discarding its contents if it wasn't closed cleanly
+   */
+  Segment* OpenSegment(int number);
+
+  /**
+   * @brief Start a new empty segment after the last one
+   */
+  Segment* AddSegment();
+
+  /**
+   * @brief Close and forget segments the DiskManager has deleted, if nothing is mapped from them
+   *
+   * Must be called with `lock_` held.
+   */
+  void DropDeletedSegments();
+
+  /**
+   * @brief Sync a segment to disk and mark it clean, used when the store is closed
+   */
+  static void CloseSegment(Segment* segment);
+
+  static bool SyncFile(QFile* file);
+
+  static bool WriteFileHeader(QFile* file, bool clean);
+
+  QString GetSegmentFilename(int number) const;
+
+  static qint64 Align(qint64 offset);
+
+  /**
+   * @brief Written at the start of every segment
+   */
+  struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 clean;
+    quint32 reserved;
+  };
+
+  struct Header {
+    quint32 magic;
+    quint32 codec;
+    qint64 pts;
+    qint64 size;
+    qint64 reserved;
+  };
+
+  struct Record {
+    int segment;
+    qint64 offset;
+    qint64 size;
+  };
+
+  struct PendingRecord {
+    int segment;
+    qint64 header_offset;
+    Header header;
+  };
+
+  enum Codec {
+    kCodecRaw = 0
+  };
+
+  static const quint32 kFileMagic;
+
+  static const quint32 kFileVersion;
+
+  static const quint32 kMagic;
+
+  static const qint64 kAlignment;
+
+  static const qint64 kFileHeaderSize;
+
+  static const qint64 kHeaderSize;
+
+  /**
+   * @brief Size a segment may grow to before frames are written to a new one
+   */
+  static const qint64 kSegmentSize;
+
+  QString filename_;
+
+  QMap<int, Segment*> segments_;
+
+  QHash<int64_t, Record> records_;
+
+  QHash<uchar*, PendingRecord> pending_;
+
+  /**
+   * @brief Segment of every pointer returned by Map() that hasn't been passed to Unmap() yet
+   */
+  QHash<const uchar*, int> mapped_;
+
+  QMutex lock_;
+
+  static QHash<QString, std::weak_ptr<FrameStore> > stores_;
+
+  static QMutex stores_lock_;
+
+};
+
+#endif // FRAMESTORE_H
@@ -130,11 +130,16 @@ bool OIIODecoder::Open()
 
   pix_fmt_info_ = PixelService::GetPixelFormatInfo(static_cast<PixelFormat::Format>(pix_fmt_));
 
+  open_ = true;
+
   return true;
 }
 
 FramePtr OIIODecoder::RetrieveVideo(const rational &timecode)
 {
+  // Decoders are shared between render threads
+  QMutexLocker locker(&lock_);
+
   if (!open_ && !Open()) {
     return nullptr;
   }
@@ -172,6 +177,8 @@ void OIIODecoder::Close()
   }
 
   frame_ = nullptr;
+
+  open_ = false;
 }
 
 int64_t OIIODecoder::GetTimestampFromTime(const rational &time)
@@ -22,6 +22,7 @@
 #define OIIODECODER_H
 
 #include <OpenImageIO/imageio.h>
+#include <QMutex>
 
 #include "codec/decoder.h"
 #include "render/pixelservice.h"
@@ -64,6 +65,8 @@ private:
 
   FramePtr frame_;
 
+  QMutex lock_;
+
   static QStringList supported_formats_;
 
 };
@@ -40,3 +40,75 @@ double Bezier::CubicTtoY(double a, double b, double c, double d, double t)
 {
   return qPow(1.0 - t, 3)*a + 3*qPow(1.0 - t, 2)*t*b + 3*(1.0 - t)*qPow(t, 2)*c + qPow(t, 3)*d;
 }
+
+void Bezier::QuadraticToPolynomial(double a, double b, double c, double *coeffs)
+{
+  coeffs[0] = 0.0;
+  coeffs[1] = a - 2.0*b + c;
+  coeffs[2] = 2.0*(b - a);
+  coeffs[3] = a;
+}
+
+void Bezier::CubicToPolynomial(double a, double b, double c, double d, double *coeffs)
+{
+  coeffs[0] = -a + 3.0*b - 3.0*c + d;
+  coeffs[1] = 3.0*a - 6.0*b + 3.0*c;
+  coeffs[2] = -3.0*a + 3.0*b;
+  coeffs[3] = a;
+}
+
+double Bezier::PolynomialTtoY(const double *coeffs, double t)
+{
+  return ((coeffs[0]*t + coeffs[1])*t + coeffs[2])*t + coeffs[3];
+}
+
+double Bezier::PolynomialXtoT(double x_target, const double *coeffs, double t_guess)
+{
+  const double tolerance = 0.0000001;
+
+  double t = qBound(0.0, t_guess, 1.0);
+
+  for (int i=0;i<8;i++) {
+    double x = PolynomialTtoY(coeffs, t) - x_target;
+
+    if (qAbs(x) <= tolerance) {
+      return t;
+    }
+
+    double derivative = (3.0*coeffs[0]*t + 2.0*coeffs[1])*t + coeffs[2];
+
+    if (qAbs(derivative) < tolerance) {
+      break;
+    }
+
+    t -= x / derivative;
+
+    if (t < 0.0 || t > 1.0) {
+      break;
+    }
+  }
+
+  // Newton's method didn't converge (e.g. the curve is nearly flat here), fall back to bisection
+  double lower = 0.0;
+  double upper = 1.0;
+
+  t = 0.5;
+
+  for (int i=0;i<64;i++) {
+    double x = PolynomialTtoY(coeffs, t);
+
+    if (qAbs(x_target - x) <= tolerance) {
+      break;
+    }
+
+    if (x_target > x) {
+      lower = t;
+    } else {
+      upper = t;
+    }
+
+    t = (upper + lower) / 2.0;
+  }
+
+  return t;
+}
@@ -12,6 +12,31 @@ public:
   static double CubicXtoT(double x_target, double a, double b, double c, double d);
 
   static double CubicTtoY(double a, double b, double c, double d, double t);
+
+  /**
+   * @brief Convert quadratic control points to polynomial coefficients of `t` (highest order first)
+   *
+   * `coeffs` must have room for 4 values. The result can be used with PolynomialTtoY() and PolynomialXtoT(), which
+   * are much cheaper than the functions above when the same curve is evaluated many times.
+   */
+  static void QuadraticToPolynomial(double a, double b, double c, double* coeffs);
+
+  /**
+   * @brief Convert cubic control points to polynomial coefficients of `t` (highest order first)
+   *
+   * `coeffs` must have room for 4 values.
+   */
+  static void CubicToPolynomial(double a, double b, double c, double d, double* coeffs);
+
+  static double PolynomialTtoY(const double* coeffs, double t);
+
+  /**
+   * @brief Solve a monotonic polynomial from QuadraticToPolynomial() or CubicToPolynomial() for `t`
+   *
+   * Uses Newton's method starting from `t_guess` (e.g. the result for a nearby `x`), falling back to bisection if it
+   * fails to converge.
+   */
+  static double PolynomialXtoT(double x_target, const double* coeffs, double t_guess);
 };
 
 #endif // BEZIER_H
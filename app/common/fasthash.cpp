@@ -0,0 +1,199 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "fasthash.h"
+
+#include <string.h>
+
+namespace {
+
+const uint64_t kC1 = 0x87c37b91114253d5ULL;
+const uint64_t kC2 = 0x4cf5ad432745937fULL;
+
+inline uint64_t RotateLeft(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t FinalMix(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+
+  return k;
+}
+
+inline uint64_t ReadLittleEndian64(const unsigned char* p)
+{
+  uint64_t v = 0;
+
+  for (int i=7;i>=0;i--) {
+    v = (v << 8) | p[i];
+  }
+
+  return v;
+}
+
+}
+
+FastHash::FastHash(uint64_t seed) :
+  seed_(seed)
+{
+  reset();
+}
+
+void FastHash::addData(const char *data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t remaining = static_cast<size_t>(length);
+
+  length_ += remaining;
+
+  // Fill up any partial block left from last time
+  if (buffer_size_ > 0) {
+    size_t copy = qMin(remaining, static_cast<size_t>(16 - buffer_size_));
+
+    memcpy(buffer_ + buffer_size_, bytes, copy);
+    buffer_size_ += static_cast<int>(copy);
+    bytes += copy;
+    remaining -= copy;
+
+    if (buffer_size_ < 16) {
+      return;
+    }
+
+    ProcessBlock(buffer_);
+    buffer_size_ = 0;
+  }
+
+  while (remaining >= 16) {
+    ProcessBlock(bytes);
+    bytes += 16;
+    remaining -= 16;
+  }
+
+  if (remaining > 0) {
+    memcpy(buffer_, bytes, remaining);
+    buffer_size_ = static_cast<int>(remaining);
+  }
+}
+
+void FastHash::addData(const QByteArray &data)
+{
+  addData(data.constData(), data.size());
+}
+
+void FastHash::addData(const QString &s)
+{
+  addData(reinterpret_cast<const char*>(s.constData()), s.size() * static_cast<int>(sizeof(QChar)));
+}
+
+void FastHash::reset()
+{
+  h1_ = seed_;
+  h2_ = seed_;
+  length_ = 0;
+  buffer_size_ = 0;
+}
+
+QByteArray FastHash::result() const
+{
+  uint64_t h1 = h1_;
+  uint64_t h2 = h2_;
+
+  // Tail
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+
+  for (int i=buffer_size_-1;i>=8;i--) {
+    k2 = (k2 << 8) | buffer_[i];
+  }
+
+  for (int i=qMin(buffer_size_, 8)-1;i>=0;i--) {
+    k1 = (k1 << 8) | buffer_[i];
+  }
+
+  if (buffer_size_ > 8) {
+    k2 *= kC2;
+    k2 = RotateLeft(k2, 33);
+    k2 *= kC1;
+    h2 ^= k2;
+  }
+
+  if (buffer_size_ > 0) {
+    k1 *= kC1;
+    k1 = RotateLeft(k1, 31);
+    k1 *= kC2;
+    h1 ^= k1;
+  }
+
+  // Finalization
+  h1 ^= length_;
+  h2 ^= length_;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = FinalMix(h1);
+  h2 = FinalMix(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  QByteArray hash(16, Qt::Uninitialized);
+
+  for (int i=0;i<8;i++) {
+    hash[i] = static_cast<char>(h1 >> (8 * i));
+    hash[i + 8] = static_cast<char>(h2 >> (8 * i));
+  }
+
+  return hash;
+}
+
+void FastHash::ProcessBlock(const unsigned char *block)
+{
+  uint64_t k1 = ReadLittleEndian64(block);
+  uint64_t k2 = ReadLittleEndian64(block + 8);
+
+  k1 *= kC1;
+  k1 = RotateLeft(k1, 31);
+  k1 *= kC2;
+  h1_ ^= k1;
+
+  h1_ = RotateLeft(h1_, 27);
+  h1_ += h2_;
+  h1_ = h1_ * 5 + 0x52dce729;
+
+  k2 *= kC2;
+  k2 = RotateLeft(k2, 33);
+  k2 *= kC1;
+  h2_ ^= k2;
+
+  h2_ = RotateLeft(h2_, 31);
+  h2_ += h1_;
+  h2_ = h2_ * 5 + 0x38495ab5;
+}
@@ -77,6 +77,18 @@ QString GetMediaCacheLocation()
   return media_cache_dir.absolutePath();
 }
 
+QString GetShaderCacheLocation()
+{
+  QDir local_appdata_dir(Config::Current()["DiskCachePath"].toString());
+
+  QDir shader_cache_dir = local_appdata_dir.filePath("shadercache");
+
+  // Attempt to ensure this folder exists
+  shader_cache_dir.mkpath(".");
+
+  return shader_cache_dir.absolutePath();
+}
+
 QString GetConfigurationLocation()
 {
   if (IsPortable()) {
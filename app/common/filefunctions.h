@@ -33,6 +33,8 @@ QString GetMediaIndexFilename(const QString& filename);
 
 QString GetMediaCacheLocation();
 
+QString GetShaderCacheLocation();
+
 QString GetConfigurationLocation();
 
 QString GetApplicationPath();
@@ -0,0 +1,111 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "parallelfor.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace {
+
+/**
+ * @brief State shared between every thread working on one ParallelFor() call
+ */
+struct ParallelForJob {
+  std::function<void(int)> function;
+  int count;
+
+  QAtomicInt next_index;
+  QAtomicInt remaining;
+
+  QMutex lock;
+  QWaitCondition finished;
+};
+
+void RunParallelForJob(ParallelForJob* job)
+{
+  int index;
+
+  while ((index = job->next_index.fetchAndAddRelaxed(1)) < job->count) {
+    job->function(index);
+
+    if (!job->remaining.deref()) {
+      QMutexLocker locker(&job->lock);
+      job->finished.wakeAll();
+    }
+  }
+}
+
+class ParallelForTask : public QRunnable
+{
+public:
+  ParallelForTask(QSharedPointer<ParallelForJob> job) :
+    job_(job)
+  {
+  }
+
+  virtual void run() override
+  {
+    RunParallelForJob(job_.data());
+  }
+
+private:
+  // Shared so a task that only starts after the call returned can still see there's nothing left to do
+  QSharedPointer<ParallelForJob> job_;
+
+};
+
+}
+
+void ParallelFor(int count, const std::function<void (int)> &function)
+{
+  int thread_count = qMin(QThread::idealThreadCount(), count);
+
+  if (thread_count <= 1) {
+    for (int i=0;i<count;i++) {
+      function(i);
+    }
+
+    return;
+  }
+
+  QSharedPointer<ParallelForJob> job = QSharedPointer<ParallelForJob>::create();
+
+  job->function = function;
+  job->count = count;
+  job->remaining.store(count);
+
+  for (int i=1;i<thread_count;i++) {
+    QThreadPool::globalInstance()->start(new ParallelForTask(job));
+  }
+
+  RunParallelForJob(job.data());
+
+  QMutexLocker locker(&job->lock);
+
+  while (job->remaining.loadAcquire() > 0) {
+    job->finished.wait(&job->lock);
+  }
+}
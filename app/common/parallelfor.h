@@ -0,0 +1,34 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <functional>
+
+/**
+ * @brief Call `function` once for every index from 0 to `count - 1`, spread across the global thread pool
+ *
+ * The calling thread takes indices too, so this never waits on work that hasn't started and is safe to call from
+ * inside the pool. Returns once every call has finished. Indices are handed out in order but may finish in any order.
+ */
+void ParallelFor(int count, const std::function<void(int)>& function);
+
+#endif // PARALLELFOR_H
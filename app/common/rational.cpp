@@ -3,6 +3,8 @@
 
 #include "rational.h"
 
+#include <cmath>
+
 rational::rational(const AVRational &r) :
   numer(r.num),
   denom(r.den)
@@ -12,6 +14,11 @@ rational::rational(const AVRational &r) :
 
 rational rational::fromDouble(const double &flt)
 {
+  // Whole numbers are common (e.g. seconds) and don't need a continued fraction approximation
+  if (std::floor(flt) == flt && qAbs(flt) <= INT_MAX) {
+    return rational(static_cast<intType>(flt));
+  }
+
   // Use FFmpeg function for the time being
   return av_d2q(flt, INT_MAX);
 }
@@ -82,14 +89,17 @@ void rational::reduce()
 
 intType rational::gcd(intType &x, intType &y)
 {
-  if(y == 0)
-    return x;
-  else
-    {
-      intType tmp = x % y;
+  intType a = x;
+  intType b = y;
 
-      return gcd(y, tmp);
-    }
+  while (b != 0) {
+    intType tmp = a % b;
+
+    a = b;
+    b = tmp;
+  }
+
+  return a;
 }
 
 //Function: convert to double
@@ -137,6 +147,49 @@ QString rational::toString() const
   return QStringLiteral("%1/%2").arg(QString::number(numer), QString::number(denom));
 }
 
+int rational::compare(const rational &rhs) const
+{
+  // Denominators are never negative and zero is stored as 0/0, so the sign of a rational is the sign of its numerator
+  // and rationals with the same denominator (e.g. integers or times in the same timebase) compare by numerator alone
+  if (denom == rhs.denom || numer == 0 || rhs.numer == 0) {
+    return (numer > rhs.numer) - (numer < rhs.numer);
+  }
+
+  intType lhs_scaled = numer * rhs.denom;
+  intType rhs_scaled = rhs.numer * denom;
+
+  return (lhs_scaled > rhs_scaled) - (lhs_scaled < rhs_scaled);
+}
+
+void rational::add(const intType &rhs_numer, const intType &rhs_denom)
+{
+  if (rhs_numer == 0) {
+    // Adding zero does nothing
+  } else if (numer == 0) {
+    numer = rhs_numer;
+    denom = rhs_denom;
+  } else if (denom == rhs_denom) {
+    // Same timebase, no need to cross-multiply
+    numer += rhs_numer;
+    fixSigns();
+
+    if (denom > 1) {
+      reduce();
+    }
+  } else if (rhs_denom == 1) {
+    // Adding a multiple of the denominator can't introduce a common factor, so this is still in lowest terms
+    numer += rhs_numer * denom;
+  } else if (denom == 1) {
+    numer = numer * rhs_denom + rhs_numer;
+    denom = rhs_denom;
+  } else {
+    numer = (numer * rhs_denom) + (rhs_numer * denom);
+    denom = denom * rhs_denom;
+    fixSigns();
+    reduce();
+  }
+}
+
 void rational::validateConstructor()
 {
   if(denom != intType(0))
@@ -167,57 +220,13 @@ const rational& rational::operator=(const rational &rhs)
 
 const rational& rational::operator+=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    {
-      numer = intType(0);
-      denom = intType(0);
-    }
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          numer = rhs.numer;
-          denom = rhs.denom;
-        }
-      else
-        {
-          numer = (numer * rhs.denom) + (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
-        }
+  add(rhs.numer, rhs.denom);
   return *this;
 }
 
 const rational& rational::operator-=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    {
-      numer = intType(0);
-      denom = intType(0);
-    }
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          numer = -(rhs.numer);
-          denom = rhs.denom;
-        }
-      else
-        {
-          numer = (numer * rhs.denom) - (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
-        }
+  add(-rhs.numer, rhs.denom);
   return *this;
 }
 
@@ -232,6 +241,12 @@ const rational& rational::operator/=(const rational &rhs)
 
 const rational& rational::operator*=(const rational &rhs)
 {
+  if (denom == 1 && rhs.denom == 1) {
+    // Integers don't need reducing
+    numer = numer * rhs.numer;
+    return *this;
+  }
+
   numer = numer * rhs.numer;
   denom = denom * rhs.denom;
   fixSigns();
@@ -273,99 +288,22 @@ rational rational::operator*(const rational &rhs) const
 
 bool rational::operator<(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) < (denom * rhs.numer));
+  return compare(rhs) < 0;
 }
 
 bool rational::operator<=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) <= (denom * rhs.numer));
+  return compare(rhs) <= 0;
 }
 
 bool rational::operator>(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) > (denom * rhs.numer));
+  return compare(rhs) > 0;
 }
 
 bool rational::operator>=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-
-  return ((numer * rhs.denom) >= (denom * rhs.numer));
+  return compare(rhs) >= 0;
 }
 
 bool rational::operator==(const rational &rhs) const
@@ -108,6 +108,16 @@ private:
 
   void validateConstructor();
 
+  /**
+   * @brief Returns -1, 0 or 1 if this is less than, equal to or greater than `rhs`
+   */
+  int compare(const rational& rhs) const;
+
+  /**
+   * @brief Adds `rhs_numer/rhs_denom`, skipping the multiplications and reduction where possible
+   */
+  void add(const intType& rhs_numer, const intType& rhs_denom);
+
   //Function: ensures denom >= 0
   void fixSigns();
   //Function: ensures lowest form
@@ -0,0 +1,40 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+ * Compile-time SIMD detection
+ *
+ * SSE2 is part of the x86-64 baseline so it's always available there. Every SIMD code path must have a scalar fallback
+ * for when it isn't defined (e.g. ARM builds).
+ *
+ * Wider instruction sets aren't part of the baseline, so code using them lives in its own file that CMake builds with
+ * the extra flags, and is only called after checking the CPU at runtime (see PixelKernels::HasAVX2()).
+ * OLIVE_SIMD_AVX2_KERNELS is defined by CMake when those files are built for AVX2.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OLIVE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#endif // SIMD_H
@@ -1,5 +1,6 @@
 #include "timerange.h"
 
+#include <algorithm>
 #include <utility>
 
 TimeRange::TimeRange(const rational &in, const rational &out) :
@@ -110,6 +111,27 @@ void TimeRangeList::InsertTimeRange(const TimeRange &range)
   append(range);
 }
 
+void TimeRangeList::InsertTimeRanges(const TimeRangeList &ranges)
+{
+  QList<TimeRange> sorted = *this;
+  sorted.append(ranges);
+
+  std::sort(sorted.begin(), sorted.end(), [](const TimeRange& a, const TimeRange& b) {
+    return a.in() < b.in();
+  });
+
+  clear();
+
+  foreach (const TimeRange& range, sorted) {
+    // Same inclusive overlap test as InsertTimeRange(), so touching ranges merge too
+    if (!isEmpty() && range.in() <= last().out()) {
+      last() = TimeRange::Combine(last(), range);
+    } else {
+      append(range);
+    }
+  }
+}
+
 void TimeRangeList::RemoveTimeRange(const TimeRange &range)
 {
   for (int i=0;i<size();i++) {
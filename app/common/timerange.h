@@ -1,6 +1,8 @@
 #ifndef TIMERANGE_H
 #define TIMERANGE_H
 
+#include <QMetaType>
+
 #include "rational.h"
 
 class TimeRange {
@@ -41,6 +43,14 @@ public:
 
   void InsertTimeRange(const TimeRange& range);
 
+  /**
+   * @brief Insert many ranges at once
+   *
+   * Sorts and merges everything in one pass rather than scanning the list for each range like InsertTimeRange(). The
+   * list ends up sorted with no overlapping or touching ranges.
+   */
+  void InsertTimeRanges(const TimeRangeList& ranges);
+
   void RemoveTimeRange(const TimeRange& range);
 
   bool ContainsTimeRange(const TimeRange& range, bool in_inclusive = true, bool out_inclusive = true) const;
@@ -49,4 +59,6 @@ public:
 
 };
 
+Q_DECLARE_METATYPE(TimeRange)
+
 #endif // TIMERANGE_H
@@ -30,6 +30,7 @@
 #include "common/autoscroll.h"
 #include "common/filefunctions.h"
 #include "core.h"
+#include "render/backend/videorenderframecache.h"
 #include "window/mainwindow/mainwindow.h"
 
 Config Config::current_config_;
@@ -80,6 +81,9 @@ void Config::SetDefaults()
   config_map_["DiskCacheBehind"] = QVariant::fromValue(rational(5));
   config_map_["DiskCacheAhead"] = QVariant::fromValue(rational(30));
   config_map_["ClearDiskCacheOnClose"] = false;
+  config_map_["MemoryCacheSize"] = 1.0;
+  config_map_["TextureCacheSize"] = 0.5;
+  config_map_["DiskCacheCodec"] = VideoRenderFrameCache::kCodecCompressed;
 
   config_map_["DefaultSequenceWidth"] = 1920;
   config_map_["DefaultSequenceHeight"] = 1080;
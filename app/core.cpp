@@ -28,8 +28,10 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QStyleFactory>
+#include <stdio.h>
 
 #include "audio/audiomanager.h"
+#include "cli/cliexportmanager.h"
 #include "config/config.h"
 #include "dialog/about/about.h"
 #include "dialog/export/export.h"
@@ -46,6 +48,7 @@
 #include "project/projectsavemanager.h"
 #include "project/item/footage/footage.h"
 #include "project/item/sequence/sequence.h"
+#include "render/backend/decoderpool.h"
 #include "render/colormanager.h"
 #include "render/diskmanager.h"
 #include "render/pixelservice.h"
@@ -60,6 +63,7 @@ Core Core::instance_;
 
 Core::Core() :
   main_window_(nullptr),
+  cli_export_manager_(nullptr),
   tool_(Tool::kPointer),
   snapping_(true),
   queue_autorecovery_(false)
@@ -92,9 +96,36 @@ void Core::Start()
   QCommandLineOption fullscreen_option({"f", "fullscreen"}, tr("Start in full screen mode"));
   parser.addOption(fullscreen_option);
 
+  // Create headless export options
+  QCommandLineOption export_option("export", tr("Export a sequence from a project without starting the GUI"), tr("project"));
+  parser.addOption(export_option);
+
+  QCommandLineOption sequence_option("sequence", tr("Name of the sequence to export"), tr("name"));
+  parser.addOption(sequence_option);
+
+  QCommandLineOption output_option("out", tr("Filename to export to"), tr("file"));
+  parser.addOption(output_option);
+
+  QCommandLineOption range_option("range", tr("Only export this range of the sequence (in seconds)"), tr("in:out"));
+  parser.addOption(range_option);
+
+  QCommandLineOption video_codec_option("video-codec", tr("Video encoder to export with (defaults to the format's default)"), tr("codec"));
+  parser.addOption(video_codec_option);
+
+  QCommandLineOption audio_codec_option("audio-codec", tr("Audio encoder to export with (defaults to the format's default)"), tr("codec"));
+  parser.addOption(audio_codec_option);
+
+  QCommandLineOption cpu_option("cpu", tr("Render the export on the CPU instead of with OpenGL"));
+  parser.addOption(cpu_option);
+
   // Parse options
   parser.process(*app);
 
+  if (parser.isSet(export_option) && (!parser.isSet(sequence_option) || !parser.isSet(output_option))) {
+    fprintf(stderr, "%s\n\n", qPrintable(tr("--export requires --sequence and --out")));
+    parser.showHelp(1);
+  }
+
   QStringList args = parser.positionalArguments();
 
   // Detect project to load on startup
@@ -111,9 +142,42 @@ void Core::Start()
   // Load application config
   Config::Load();
 
+  // Initialize disk service
+  DiskManager::CreateInstance();
+
+  // Initialize shared decoder pool
+  DecoderPool::CreateInstance();
+
+  // Initialize task manager
+  TaskManager::CreateInstance();
+
+  // Initialize pixel service
+  PixelService::CreateInstance();
+
 
   //
-  // Start GUI (FIXME CLI mode)
+  // Start CLI export
+  //
+
+  if (parser.isSet(export_option)) {
+    cli_export_manager_ = new CLIExportManager(parser.value(export_option),
+                                               parser.value(sequence_option),
+                                               parser.value(output_option));
+
+    cli_export_manager_->SetRange(parser.value(range_option));
+    cli_export_manager_->SetVideoCodec(parser.value(video_codec_option));
+    cli_export_manager_->SetAudioCodec(parser.value(audio_codec_option));
+    cli_export_manager_->SetUseCPU(parser.isSet(cpu_option));
+
+    // The export runs asynchronously and exits the application when it ends, so start it from the event loop
+    QMetaObject::invokeMethod(cli_export_manager_, "Start", Qt::QueuedConnection);
+
+    return;
+  }
+
+
+  //
+  // Start GUI
   //
 
   StartGUI(parser.isSet(fullscreen_option));
@@ -132,6 +196,8 @@ void Core::Stop()
   // Save Config
   //Config::Save();
 
+  delete cli_export_manager_;
+
   MenuShared::DestroyInstance();
 
   TaskManager::DestroyInstance();
@@ -142,6 +208,8 @@ void Core::Stop()
 
   DiskManager::DestroyInstance();
 
+  DecoderPool::DestroyInstance();
+
   PixelService::DestroyInstance();
 
   NodeFactory::Destroy();
@@ -154,6 +222,11 @@ MainWindow *Core::main_window()
   return main_window_;
 }
 
+bool Core::IsHeadless()
+{
+  return cli_export_manager_;
+}
+
 UndoStack *Core::undo_stack()
 {
   return &undo_stack_;
@@ -362,6 +435,7 @@ void Core::DeclareTypesForQt()
 {
   qRegisterMetaType<NodeDependency>();
   qRegisterMetaType<rational>();
+  qRegisterMetaType<TimeRange>();
   qRegisterMetaType<OpenGLTexturePtr>();
   qRegisterMetaType<OpenGLTextureCache::ReferencePtr>();
   qRegisterMetaType<NodeValueTable>();
@@ -385,15 +459,6 @@ void Core::StartGUI(bool full_screen)
   // Initialize audio service
   AudioManager::CreateInstance();
 
-  // Initialize disk service
-  DiskManager::CreateInstance();
-
-  // Initialize task manager
-  TaskManager::CreateInstance();
-
-  // Initialize pixel service
-  PixelService::CreateInstance();
-
   // Connect the PanelFocusManager to the application's focus change signal
   connect(qApp,
           &QApplication::focusChanged,
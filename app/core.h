@@ -33,6 +33,7 @@
 #include "tool/tool.h"
 #include "undo/undostack.h"
 
+class CLIExportManager;
 class MainWindow;
 
 /**
@@ -65,7 +66,8 @@ public:
   /**
    * @brief Start Olive Core
    *
-   * Main application launcher. Parses command line arguments and constructs main window (if entering a GUI mode).
+   * Main application launcher. Parses command line arguments and constructs main window (if entering a GUI mode) or
+   * starts a headless export (if started with --export).
    */
   void Start();
 
@@ -85,6 +87,19 @@ public:
    */
   MainWindow* main_window();
 
+  /**
+   * @brief Declare custom types/classes for Qt's signal/slot system
+   *
+   * Qt's signal/slot system requires types to be declared. In the interest of doing this only at startup, we contain
+   * them all in a function here.
+   */
+  void DeclareTypesForQt();
+
+  /**
+   * @brief Returns true if running a headless export (started with --export) rather than the GUI
+   */
+  bool IsHeadless();
+
   /**
    * @brief Retrieve UndoStack object
    */
@@ -278,14 +293,6 @@ private:
    */
   void InitiateOpenSaveProcess(Task* manager, const QString &dialog_text, const QString &dialog_title);
 
-  /**
-   * @brief Declare custom types/classes for Qt's signal/slot system
-   *
-   * Qt's signal/slot system requires types to be declared. In the interest of doing this only at startup, we contain
-   * them all in a function here.
-   */
-  void DeclareTypesForQt();
-
   /**
    * @brief Start GUI portion of Olive
    *
@@ -304,6 +311,11 @@ private:
    */
   MainWindow* main_window_;
 
+  /**
+   * @brief Headless exporter when started with --export, nullptr otherwise
+   */
+  CLIExportManager* cli_export_manager_;
+
   /**
    * @brief Internal startup project object
    *
@@ -8,6 +8,7 @@
 #include <QMessageBox>
 #include <QPushButton>
 
+#include "render/backend/videorenderframecache.h"
 #include "render/diskmanager.h"
 
 PreferencesDiskTab::PreferencesDiskTab()
@@ -44,6 +45,37 @@ PreferencesDiskTab::PreferencesDiskTab()
 
   row++;
 
+  disk_management_layout->addWidget(new QLabel(tr("Maximum Memory Cache:")), row, 0);
+
+  maximum_memory_cache_slider_ = new FloatSlider();
+  maximum_memory_cache_slider_->SetSuffix(QStringLiteral(" GB"));
+  maximum_memory_cache_slider_->SetMinimum(0.0);
+  maximum_memory_cache_slider_->SetValue(Config::Current()["MemoryCacheSize"].toDouble());
+  disk_management_layout->addWidget(maximum_memory_cache_slider_, row, 1, 1, 2);
+
+  row++;
+
+  disk_management_layout->addWidget(new QLabel(tr("Maximum GPU Texture Cache:")), row, 0);
+
+  maximum_texture_cache_slider_ = new FloatSlider();
+  maximum_texture_cache_slider_->SetSuffix(QStringLiteral(" GB"));
+  maximum_texture_cache_slider_->SetMinimum(0.0);
+  maximum_texture_cache_slider_->SetValue(Config::Current()["TextureCacheSize"].toDouble());
+  disk_management_layout->addWidget(maximum_texture_cache_slider_, row, 1, 1, 2);
+
+  row++;
+
+  disk_management_layout->addWidget(new QLabel(tr("Disk Cache Format:")), row, 0);
+
+  cache_codec_combo_ = new QComboBox();
+  cache_codec_combo_->addItem(tr("Uncompressed (Fastest)"), VideoRenderFrameCache::kCodecRaw);
+  cache_codec_combo_->addItem(tr("Compressed (Fast)"), VideoRenderFrameCache::kCodecCompressed);
+  cache_codec_combo_->addItem(tr("OpenEXR (Smallest)"), VideoRenderFrameCache::kCodecEXR);
+  cache_codec_combo_->setCurrentIndex(cache_codec_combo_->findData(Config::Current()["DiskCacheCodec"].toInt()));
+  disk_management_layout->addWidget(cache_codec_combo_, row, 1, 1, 2);
+
+  row++;
+
   QPushButton* clear_cache_btn = new QPushButton(tr("Clear Disk Cache"));
   connect(clear_cache_btn, &QPushButton::clicked, this, &PreferencesDiskTab::ClearDiskCache);
   disk_management_layout->addWidget(clear_cache_btn, row, 1, 1, 2);
@@ -81,6 +113,9 @@ void PreferencesDiskTab::Accept()
 {
   Config::Current()["DiskCachePath"] = disk_cache_location_->text();
   Config::Current()["DiskCacheSize"] = maximum_cache_slider_->GetValue();
+  Config::Current()["MemoryCacheSize"] = maximum_memory_cache_slider_->GetValue();
+  Config::Current()["TextureCacheSize"] = maximum_texture_cache_slider_->GetValue();
+  Config::Current()["DiskCacheCodec"] = cache_codec_combo_->currentData();
   Config::Current()["ClearDiskCacheOnClose"] = clear_disk_cache_->isChecked();
   Config::Current()["DiskCacheBehind"] = QVariant::fromValue(rational::fromDouble(cache_behind_slider_->GetValue()));
   Config::Current()["DiskCacheAhead"] = QVariant::fromValue(rational::fromDouble(cache_ahead_slider_->GetValue()));
@@ -2,6 +2,7 @@
 #define PREFERENCESDISKTAB_H
 
 #include <QCheckBox>
+#include <QComboBox>
 #include <QLineEdit>
 
 #include "preferencestab.h"
@@ -20,6 +21,12 @@ private:
 
   FloatSlider* maximum_cache_slider_;
 
+  FloatSlider* maximum_memory_cache_slider_;
+
+  FloatSlider* maximum_texture_cache_slider_;
+
+  QComboBox* cache_codec_combo_;
+
   FloatSlider* cache_ahead_slider_;
 
   FloatSlider* cache_behind_slider_;
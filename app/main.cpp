@@ -31,6 +31,7 @@ extern "C" {
 #include <libavfilter/avfilter.h>
 }
 
+#include <cstring>
 #include <QApplication>
 #include <QSurfaceFormat>
 
@@ -49,6 +50,17 @@ int main(int argc, char *argv[]) {
   format.setProfile(QSurfaceFormat::CoreProfile);
   QSurfaceFormat::setDefaultFormat(format);
 
+  // Headless exports don't need a display, so unless a platform was chosen explicitly (e.g. eglfs on a surfaceless
+  // Mesa driver) use Qt's offscreen platform
+  for (int i=1;i<argc;i++) {
+    if (!strcmp(argv[i], "--export") || !strncmp(argv[i], "--export=", 9)) {
+      if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+      }
+      break;
+    }
+  }
+
   // Create application instance
   QApplication a(argc, argv);
 
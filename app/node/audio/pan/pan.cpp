@@ -1,5 +1,7 @@
 #include "pan.h"
 
+#include "audio/samplekernels.h"
+
 PanNode::PanNode()
 {
   samples_input_ = new NodeInput("samples_in", NodeParam::kSamples);
@@ -41,27 +43,36 @@ NodeInput *PanNode::ProcessesSamplesFrom() const
   return samples_input_;
 }
 
-void PanNode::ProcessSamples(const NodeValueDatabase *values, const AudioRenderingParams &params, const float *input, float *output, int index) const
+void PanNode::ProcessSamples(const NodeValueDatabase *values, const NodeSampleCurves &curves, const AudioRenderingParams &params, const float *input, float *output, int sample_count) const
 {
   if (params.channel_count() != 2) {
-    // This node currently only works for stereo audio
+    // This node currently only works for stereo audio, pass everything else through untouched
+    memcpy(output, input, static_cast<size_t>(sample_count) * sizeof(float));
     return;
   }
 
-  float pan_val = (*values)[panning_input_].Get(NodeParam::kFloat).toFloat();
+  int frame_count = sample_count / 2;
 
-  output[index] = input[index];
+  NodeSampleCurves::const_iterator pan_curve = curves.constFind(panning_input_);
 
-  if (index%2 == 0) {
-    // Sample is left channel
-    if (pan_val > 0) {
-      output[index] *= (1.0F - pan_val);
-    }
+  if (pan_curve == curves.constEnd()) {
+    // Panning is constant for this entire block
+    float pan_val = (*values)[panning_input_].Get(NodeParam::kFloat).toFloat();
+
+    SampleKernels::StereoGain(input, output, frame_count, LeftGain(pan_val), RightGain(pan_val));
   } else {
-    // Sample is right channel
-    if (pan_val < 0) {
-      output[index] *= (1.0F - qAbs(pan_val));
+    // Convert pan curve into a gain curve for each channel
+    QVector<float> left_gains(frame_count);
+    QVector<float> right_gains(frame_count);
+
+    const float* pan_vals = pan_curve->constData();
+
+    for (int i=0;i<frame_count;i++) {
+      left_gains[i] = LeftGain(pan_vals[i]);
+      right_gains[i] = RightGain(pan_vals[i]);
     }
+
+    SampleKernels::StereoGainCurve(input, output, frame_count, left_gains.constData(), right_gains.constData());
   }
 }
 
@@ -70,3 +81,15 @@ void PanNode::Retranslate()
   samples_input_->set_name(tr("Samples"));
   panning_input_->set_name(tr("Pan"));
 }
+
+float PanNode::LeftGain(float pan)
+{
+  // Panning right attenuates the left channel
+  return (pan > 0) ? 1.0F - pan : 1.0F;
+}
+
+float PanNode::RightGain(float pan)
+{
+  // Panning left attenuates the right channel
+  return (pan < 0) ? 1.0F - qAbs(pan) : 1.0F;
+}
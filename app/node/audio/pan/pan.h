@@ -16,11 +16,14 @@ public:
   virtual QString Description() const override;
 
   virtual NodeInput* ProcessesSamplesFrom() const override;
-  virtual void ProcessSamples(const NodeValueDatabase* values, const AudioRenderingParams& params, const float* input, float* output, int index) const override;
+  virtual void ProcessSamples(const NodeValueDatabase* values, const NodeSampleCurves& curves, const AudioRenderingParams& params, const float* input, float* output, int sample_count) const override;
 
   virtual void Retranslate() override;
 
 private:
+  static float LeftGain(float pan);
+  static float RightGain(float pan);
+
   NodeInput* samples_input_;
   NodeInput* panning_input_;
 
@@ -1,5 +1,7 @@
 #include "volume.h"
 
+#include "audio/samplekernels.h"
+
 VolumeNode::VolumeNode()
 {
   samples_input_ = new NodeInput("samples_in", NodeParam::kSamples);
@@ -41,13 +43,22 @@ NodeInput *VolumeNode::ProcessesSamplesFrom() const
   return samples_input_;
 }
 
-void VolumeNode::ProcessSamples(const NodeValueDatabase *values, const AudioRenderingParams& params, const float* input, float* output, int index) const
+void VolumeNode::ProcessSamples(const NodeValueDatabase *values, const NodeSampleCurves &curves, const AudioRenderingParams& params, const float* input, float* output, int sample_count) const
 {
-  Q_UNUSED(params)
+  NodeSampleCurves::const_iterator volume_curve = curves.constFind(volume_input_);
 
-  float volume_val = (*values)[volume_input_].Get(NodeParam::kFloat).toFloat();
+  if (volume_curve == curves.constEnd()) {
+    // Volume is constant for this entire block
+    float volume_val = (*values)[volume_input_].Get(NodeParam::kFloat).toFloat();
 
-  output[index] = input[index] * volume_val;
+    SampleKernels::Gain(input, output, sample_count, volume_val);
+  } else {
+    SampleKernels::GainCurve(input,
+                             output,
+                             sample_count / params.channel_count(),
+                             params.channel_count(),
+                             volume_curve->constData());
+  }
 }
 
 void VolumeNode::Retranslate()
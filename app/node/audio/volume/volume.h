@@ -16,7 +16,7 @@ public:
   virtual QString Description() const override;
 
   virtual NodeInput* ProcessesSamplesFrom() const override;
-  virtual void ProcessSamples(const NodeValueDatabase* values, const AudioRenderingParams& params, const float* input, float* output, int index) const override;
+  virtual void ProcessSamples(const NodeValueDatabase* values, const NodeSampleCurves& curves, const AudioRenderingParams& params, const float* input, float* output, int sample_count) const override;
 
   virtual void Retranslate() override;
 
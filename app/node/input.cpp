@@ -57,6 +57,7 @@ NodeInput::NodeInput(const QString& id, const DataType &type, const QVariant &de
   }
 
   keyframe_tracks_.resize(track_size);
+  keyframe_segments_.resize(track_size);
 
   if (!default_value.isNull()) {
     standard_value_ = split_normal_value_into_track_values(default_value);
@@ -156,6 +157,8 @@ void NodeInput::Load(QXmlStreamReader *reader, QHash<quintptr, NodeOutput*>& par
               }
             }
 
+            UpdateKeyframeSegments(track);
+
             track++;
           }
         }
@@ -344,79 +347,99 @@ QVariant NodeInput::get_value_at_time_for_track(const rational& time, int track)
       return key_track.last()->value();
     }
 
-    // If we're here, the time must be somewhere in between the keyframes
-    for (int i=0;i<key_track.size()-1;i++) {
-      NodeKeyframePtr before = key_track.at(i);
-      NodeKeyframePtr after = key_track.at(i+1);
+    // If we're here, the time must be somewhere in between the keyframes, so binary search for the first segment that
+    // ends at/after it
+    const QVector<KeyframeSegment>& segments = keyframe_segments_.at(track);
 
-      if (before->time() == time
-          || !type_can_be_interpolated(data_type())
-          || (before->time() < time && before->type() == NodeKeyframe::kHold)) {
+    Q_ASSERT(segments.size() == key_track.size() - 1);
 
-        // Time == keyframe time, so value is precise
-        return before->value();
+    int lower = 0;
+    int upper = segments.size() - 1;
 
-      } else if (after->time() == time) {
+    while (lower < upper) {
+      int mid = (lower + upper) / 2;
 
-        // Time == keyframe time, so value is precise
-        return after->value();
+      if (segments.at(mid).out < time) {
+        lower = mid + 1;
+      } else {
+        upper = mid;
+      }
+    }
 
-      } else if (before->time() < time && after->time() > time) {
-        // We must interpolate between these keyframes
+    const KeyframeSegment& segment = segments.at(lower);
 
-        if (before->type() == NodeKeyframe::kBezier && after->type() == NodeKeyframe::kBezier) {
-          // Perform a cubic bezier with two control points
+    if (segment.out == time) {
+      // Time == keyframe time, so value is precise
+      return key_track.at(lower + 1)->value();
+    }
 
-          double t = Bezier::CubicXtoT(time.toDouble(),
-                                       before->time().toDouble(),
-                                       before->time().toDouble() + before->bezier_control_out().x(),
-                                       after->time().toDouble() + after->bezier_control_in().x(),
-                                       after->time().toDouble());
+    if (segment.interpolation == KeyframeSegment::kHold) {
+      return key_track.at(lower)->value();
+    }
 
-          double y = Bezier::CubicTtoY(before->value().toDouble(),
-                                       before->value().toDouble() + before->bezier_control_out().y(),
-                                       after->value().toDouble() + after->bezier_control_in().y(),
-                                       after->value().toDouble(),
-                                       t);
+    double t = -1.0;
 
-          return y;
+    return EvaluateKeyframeSegment(segment, time.toDouble(), &t);
+  }
 
-        } else if (before->type() == NodeKeyframe::kBezier || after->type() == NodeKeyframe::kBezier) {
-          // Perform a quadratic bezier with only one control point
+  return standard_value_.at(track);
+}
 
-          QPointF control_point;
-          double control_point_time;
-          double control_point_value;
+QVector<double> NodeInput::get_values_at_times_for_track(double start, double interval, int count, int track) const
+{
+  QVector<double> values(count);
 
-          if (before->type() == NodeKeyframe::kBezier) {
-            control_point = before->bezier_control_out();
-            control_point_time = before->time().toDouble() + control_point.x();
-            control_point_value = before->value().toDouble() + control_point.y();
-          } else {
-            control_point = after->bezier_control_in();
-            control_point_time = after->time().toDouble() + control_point.x();
-            control_point_value = after->value().toDouble() + control_point.y();
-          }
+  if (is_using_standard_value(track)) {
+    values.fill(standard_value_.at(track).toDouble());
+    return values;
+  }
 
-          // Generate T from time values - used to determine bezier progress
-          double t = Bezier::QuadraticXtoT(time.toDouble(), before->time().toDouble(), control_point_time, after->time().toDouble());
+  const KeyframeTrack& key_track = keyframe_tracks_.at(track);
+  const QVector<KeyframeSegment>& segments = keyframe_segments_.at(track);
 
-          // Generate value using T
-          double y = Bezier::QuadraticTtoY(before->value().toDouble(), control_point_value, after->value().toDouble(), t);
+  Q_ASSERT(segments.size() == key_track.size() - 1);
 
-          return y;
+  double first_time = key_track.first()->time().toDouble();
+  double last_time = key_track.last()->time().toDouble();
+  double first_value = key_track.first()->value().toDouble();
+  double last_value = key_track.last()->value().toDouble();
 
-        } else {
-          // To have arrived here, the keyframes must both be linear
-          qreal period_progress = (time.toDouble() - before->time().toDouble()) / (after->time().toDouble() - before->time().toDouble());
+  // Times are usually increasing, so rather than searching for each one we keep a cursor on the last segment used
+  int cursor = 0;
+  double t = -1.0;
 
-          return lerp(before->value().toDouble(), after->value().toDouble(), period_progress);
-        }
+  for (int i=0;i<count;i++) {
+    double time = start + static_cast<double>(i) * interval;
+
+    if (time <= first_time) {
+      values[i] = first_value;
+    } else if (time >= last_time) {
+      values[i] = last_value;
+    } else {
+      if (time < segments.at(cursor).in_dbl) {
+        // Went backwards, start again from the beginning
+        cursor = 0;
+        t = -1.0;
+      }
+
+      while (segments.at(cursor).out_dbl < time) {
+        cursor++;
+        t = -1.0;
+      }
+
+      const KeyframeSegment& segment = segments.at(cursor);
+
+      if (segment.out_dbl == time) {
+        values[i] = segment.out_value;
+      } else if (segment.interpolation == KeyframeSegment::kHold) {
+        values[i] = segment.in_value;
+      } else {
+        values[i] = EvaluateKeyframeSegment(segment, time, &t);
       }
     }
   }
 
-  return standard_value_.at(track);
+  return values;
 }
 
 QList<NodeKeyframePtr> NodeInput::get_keyframe_at_time(const rational &time) const
@@ -576,6 +599,7 @@ void NodeInput::insert_keyframe(NodeKeyframePtr key)
   Q_ASSERT(is_keyframable());
 
   insert_keyframe_internal(key);
+  UpdateKeyframeSegments(key->track());
 
   connect(key.get(), &NodeKeyframe::TimeChanged, this, &NodeInput::KeyframeTimeChanged);
   connect(key.get(), &NodeKeyframe::ValueChanged, this, &NodeInput::KeyframeValueChanged);
@@ -601,6 +625,7 @@ void NodeInput::remove_keyframe(NodeKeyframePtr key)
   disconnect(key.get(), &NodeKeyframe::BezierControlOutChanged, this, &NodeInput::KeyframeBezierOutChanged);
 
   keyframe_tracks_[key->track()].removeOne(key);
+  UpdateKeyframeSegments(key->track());
   key->set_parent(nullptr);
 
   emit KeyframeRemoved(key);
@@ -624,9 +649,12 @@ void NodeInput::KeyframeTimeChanged()
 
     // Automatically insertion sort
     insert_keyframe_internal(key_shared_ptr);
+    UpdateKeyframeSegments(key->track());
 
     // Invalidate new area that the keyframe has been moved to
     emit_time_range(get_range_around_index(FindIndexOfKeyframeFromRawPtr(key), key->track()));
+  } else {
+    UpdateKeyframeSegments(key->track());
   }
 
   // Invalidate entire area surrounding the keyframe (either where it currently is, or where it used to be before it
@@ -636,7 +664,11 @@ void NodeInput::KeyframeTimeChanged()
 
 void NodeInput::KeyframeValueChanged()
 {
-  emit_range_affected_by_keyframe(static_cast<NodeKeyframe*>(sender()));
+  NodeKeyframe* key = static_cast<NodeKeyframe*>(sender());
+
+  UpdateKeyframeSegments(key->track());
+
+  emit_range_affected_by_keyframe(key);
 }
 
 void NodeInput::KeyframeTypeChanged()
@@ -644,6 +676,8 @@ void NodeInput::KeyframeTypeChanged()
   NodeKeyframe* key = static_cast<NodeKeyframe*>(sender());
   int keyframe_index = FindIndexOfKeyframeFromRawPtr(key);
 
+  UpdateKeyframeSegments(key->track());
+
   if (keyframe_tracks_.at(key->track()).size() == 1) {
     // If there are no other frames, the interpolation won't do anything
     return;
@@ -658,6 +692,8 @@ void NodeInput::KeyframeBezierInChanged()
   NodeKeyframe* key = static_cast<NodeKeyframe*>(sender());
   int keyframe_index = FindIndexOfKeyframeFromRawPtr(key);
 
+  UpdateKeyframeSegments(key->track());
+
   rational start = RATIONAL_MIN;
   rational end = key->time();
 
@@ -673,6 +709,8 @@ void NodeInput::KeyframeBezierOutChanged()
   NodeKeyframe* key = static_cast<NodeKeyframe*>(sender());
   int keyframe_index = FindIndexOfKeyframeFromRawPtr(key);
 
+  UpdateKeyframeSegments(key->track());
+
   rational start = key->time();
   rational end = RATIONAL_MAX;
 
@@ -717,6 +755,80 @@ void NodeInput::insert_keyframe_internal(NodeKeyframePtr key)
   key_track.append(key);
 }
 
+void NodeInput::UpdateKeyframeSegments(int track)
+{
+  const KeyframeTrack& key_track = keyframe_tracks_.at(track);
+  QVector<KeyframeSegment>& segments = keyframe_segments_[track];
+
+  segments.resize(qMax(0, key_track.size() - 1));
+
+  for (int i=0;i<segments.size();i++) {
+    NodeKeyframe* before = key_track.at(i).get();
+    NodeKeyframe* after = key_track.at(i+1).get();
+    KeyframeSegment& segment = segments[i];
+
+    segment.in = before->time();
+    segment.out = after->time();
+    segment.in_dbl = segment.in.toDouble();
+    segment.out_dbl = segment.out.toDouble();
+    segment.in_value = before->value().toDouble();
+    segment.out_value = after->value().toDouble();
+
+    if (!type_can_be_interpolated(data_type()) || before->type() == NodeKeyframe::kHold) {
+      segment.interpolation = KeyframeSegment::kHold;
+    } else if (before->type() == NodeKeyframe::kBezier && after->type() == NodeKeyframe::kBezier) {
+      // Cubic bezier with two control points
+      segment.interpolation = KeyframeSegment::kBezier;
+
+      Bezier::CubicToPolynomial(segment.in_dbl,
+                                segment.in_dbl + before->bezier_control_out().x(),
+                                segment.out_dbl + after->bezier_control_in().x(),
+                                segment.out_dbl,
+                                segment.time_coeffs);
+
+      Bezier::CubicToPolynomial(segment.in_value,
+                                segment.in_value + before->bezier_control_out().y(),
+                                segment.out_value + after->bezier_control_in().y(),
+                                segment.out_value,
+                                segment.value_coeffs);
+    } else if (before->type() == NodeKeyframe::kBezier || after->type() == NodeKeyframe::kBezier) {
+      // Quadratic bezier with only one control point
+      segment.interpolation = KeyframeSegment::kBezier;
+
+      QPointF control_point;
+
+      if (before->type() == NodeKeyframe::kBezier) {
+        control_point = QPointF(segment.in_dbl, segment.in_value) + before->bezier_control_out();
+      } else {
+        control_point = QPointF(segment.out_dbl, segment.out_value) + after->bezier_control_in();
+      }
+
+      Bezier::QuadraticToPolynomial(segment.in_dbl, control_point.x(), segment.out_dbl, segment.time_coeffs);
+      Bezier::QuadraticToPolynomial(segment.in_value, control_point.y(), segment.out_value, segment.value_coeffs);
+    } else {
+      segment.interpolation = KeyframeSegment::kLinear;
+    }
+  }
+}
+
+double NodeInput::EvaluateKeyframeSegment(const KeyframeSegment &segment, double time, double *t_guess)
+{
+  double period_progress = (time - segment.in_dbl) / (segment.out_dbl - segment.in_dbl);
+
+  if (segment.interpolation == KeyframeSegment::kLinear) {
+    return lerp(segment.in_value, segment.out_value, period_progress);
+  }
+
+  // Start from the linear progress if we have nothing better
+  if (*t_guess < 0.0) {
+    *t_guess = period_progress;
+  }
+
+  *t_guess = Bezier::PolynomialXtoT(time, segment.time_coeffs, *t_guess);
+
+  return Bezier::PolynomialTtoY(segment.value_coeffs, *t_guess);
+}
+
 bool NodeInput::is_using_standard_value(int track) const
 {
   return (!is_keyframing() || keyframe_tracks_.at(track).isEmpty());
@@ -882,6 +994,7 @@ void NodeInput::CopyValues(NodeInput *source, NodeInput *dest, bool include_conn
     foreach (NodeKeyframePtr key, source->keyframe_tracks_.at(i)) {
       dest->keyframe_tracks_[i].append(key->copy());
     }
+    dest->UpdateKeyframeSegments(i);
   }
 
   // Copy keyframing state
@@ -101,6 +101,15 @@ public:
    */
   QVariant get_value_at_time_for_track(const rational& time, int track) const;
 
+  /**
+   * @brief Calculate the stored value for a specific track at `count` evenly spaced times
+   *
+   * Equivalent to calling get_value_at_time_for_track() at `start + i * interval` for each `i` and converting the
+   * result to a double, but walks the keyframes once for the whole batch instead of searching for every time. Used
+   * for sampling automation per audio sample.
+   */
+  QVector<double> get_values_at_times_for_track(double start, double interval, int count, int track) const;
+
   /**
    * @brief Retrieve a list of keyframe objects for all tracks at a given time
    *
@@ -270,6 +279,46 @@ private:
    */
   void insert_keyframe_internal(NodeKeyframePtr key);
 
+  /**
+   * @brief Interpolation between two adjacent keyframes, precalculated so values can be evaluated quickly
+   */
+  struct KeyframeSegment {
+    enum Interpolation {
+      kHold,
+      kLinear,
+      kBezier
+    };
+
+    rational in;
+    rational out;
+
+    double in_dbl;
+    double out_dbl;
+
+    Interpolation interpolation;
+
+    double in_value;
+    double out_value;
+
+    // Polynomial coefficients of time and value for kBezier (see Bezier::CubicToPolynomial())
+    double time_coeffs[4];
+    double value_coeffs[4];
+  };
+
+  /**
+   * @brief Regenerate keyframe_segments_ for a track after its keyframes have changed
+   */
+  void UpdateKeyframeSegments(int track);
+
+  /**
+   * @brief Interpolate a value within a segment
+   *
+   * @param t_guess
+   *
+   * Bezier progress to start solving from, updated with the solved progress so sequential calls converge quickly.
+   */
+  static double EvaluateKeyframeSegment(const KeyframeSegment& segment, double time, double* t_guess);
+
   /**
    * @brief Return whether the standard value should be used over keyframe data
    */
@@ -319,6 +368,13 @@ private:
    */
   QVector< QList<NodeKeyframePtr> > keyframe_tracks_;
 
+  /**
+   * @brief Segments between each pair of keyframes in keyframe_tracks_
+   *
+   * Updated whenever keyframes change rather than when values are requested, so render threads can read them freely.
+   */
+  QVector< QVector<KeyframeSegment> > keyframe_segments_;
+
   /**
    * @brief Internal keyframing enabled setting
    */
@@ -301,6 +301,66 @@ void Node::DuplicateConnectionsBetweenLists(const QList<Node *> &source, const Q
   }
 }
 
+void SyncConnectionsInternal(const QHash<Node*, Node*>& copies, NodeInput* source_input, NodeInput* dest_input)
+{
+  NodeOutput* expected_output = nullptr;
+
+  if (source_input->IsConnected()) {
+    NodeOutput* source_output = source_input->get_connected_output();
+    Node* dest_output_node = copies.value(source_output->parentNode());
+
+    if (dest_output_node) {
+      expected_output = static_cast<NodeOutput*>(dest_output_node->GetParameterWithID(source_output->id()));
+    }
+  }
+
+  if (dest_input->get_connected_output() != expected_output) {
+    if (dest_input->IsConnected()) {
+      NodeParam::DisconnectEdge(dest_input->edges().first());
+    }
+
+    if (expected_output) {
+      NodeParam::ConnectEdge(expected_output, dest_input);
+    }
+  }
+
+  // If inputs are arrays, sync their connections too
+  if (source_input->IsArray()) {
+    NodeInputArray* source_array = static_cast<NodeInputArray*>(source_input);
+    NodeInputArray* dest_array = static_cast<NodeInputArray*>(dest_input);
+
+    if (dest_array->GetSize() != source_array->GetSize()) {
+      dest_array->SetSize(source_array->GetSize());
+    }
+
+    for (int i=0;i<source_array->GetSize();i++) {
+      SyncConnectionsInternal(copies, source_array->At(i), dest_array->At(i));
+    }
+  }
+}
+
+void Node::SyncConnections(const QHash<Node *, Node *> &copies)
+{
+  QHash<Node*, Node*>::const_iterator i;
+
+  for (i=copies.constBegin();i!=copies.constEnd();i++) {
+    Node* source_node = i.key();
+    Node* dest_node = i.value();
+
+    Q_ASSERT(source_node->id() == dest_node->id());
+
+    for (int j=0;j<source_node->params_.size();j++) {
+      NodeParam* source_param = source_node->params_.at(j);
+
+      if (source_param->type() == NodeInput::kInput) {
+        SyncConnectionsInternal(copies,
+                                static_cast<NodeInput*>(source_param),
+                                static_cast<NodeInput*>(dest_node->params_.at(j)));
+      }
+    }
+  }
+}
+
 bool Node::CanBeDeleted() const
 {
   return can_be_deleted_;
@@ -429,13 +489,14 @@ NodeInput* Node::ProcessesSamplesFrom() const
   return nullptr;
 }
 
-void Node::ProcessSamples(const NodeValueDatabase *values, const AudioRenderingParams &params, const float *input, float *output, int index) const
+void Node::ProcessSamples(const NodeValueDatabase *values, const NodeSampleCurves &curves, const AudioRenderingParams &params, const float *input, float *output, int sample_count) const
 {
   Q_UNUSED(values)
+  Q_UNUSED(curves)
   Q_UNUSED(params)
   Q_UNUSED(input)
   Q_UNUSED(output)
-  Q_UNUSED(index)
+  Q_UNUSED(sample_count)
 }
 
 NodeParam *Node::GetParameterWithID(const QString &id) const
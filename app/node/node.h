@@ -174,9 +174,13 @@ public:
   virtual NodeInput* ProcessesSamplesFrom() const;
 
   /**
-   * @brief If ProcessesSamples() is true, this is the function that will process them.
+   * @brief If ProcessesSamplesFrom() is set, this is the function that will process them.
+   *
+   * Samples are processed a whole block at a time. `input` and `output` both contain `sample_count` interleaved
+   * samples. Inputs that change during the block have one value per sample frame in `curves`, all other inputs are
+   * constant for the block and can be read from `values`.
    */
-  virtual void ProcessSamples(const NodeValueDatabase *values, const AudioRenderingParams& params, const float* input, float* output, int index) const;
+  virtual void ProcessSamples(const NodeValueDatabase *values, const NodeSampleCurves& curves, const AudioRenderingParams& params, const float* input, float* output, int sample_count) const;
 
   /**
    * @brief Returns the parameter with the specified ID (or nullptr if it doesn't exist)
@@ -266,6 +270,18 @@ public:
    */
   static void DuplicateConnectionsBetweenLists(const QList<Node*>& source, const QList<Node *> &destination);
 
+  /**
+   * @brief Make the connections between copied Nodes match the connections between their sources
+   *
+   * Unlike DuplicateConnectionsBetweenLists(), this can be used on copies that are already connected. Only edges that
+   * differ are changed, and Nodes are matched with a hash rather than by searching lists.
+   *
+   * @param copies
+   *
+   * Maps each source Node to its copy. Connections to Nodes that aren't in the map are removed.
+   */
+  static void SyncConnections(const QHash<Node*, Node*>& copies);
+
   /**
    * @brief Return whether this Node can be deleted or not
    */
@@ -20,6 +20,7 @@
 
 #include "track.h"
 
+#include <algorithm>
 #include <QApplication>
 #include <QDebug>
 #include <QFontMetrics>
@@ -28,6 +29,8 @@
 #include "node/graph.h"
 
 TrackOutput::TrackOutput() :
+  inout_dirty_from_(-1),
+  block_edit_stack_(0),
   track_type_(Timeline::kTrackTypeNone),
   block_invalidate_cache_stack_(0),
   index_(-1),
@@ -127,11 +130,15 @@ void TrackOutput::SetIndex(const int &index)
 
 Block *TrackOutput::BlockContainingTime(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    if (block->in() < time && block->out() > time) {
+  // Find the first slot that ends after this time
+  int index = static_cast<int>(std::upper_bound(block_out_points_.constBegin(), block_out_points_.constEnd(), time)
+                               - block_out_points_.constBegin());
+
+  if (index < block_cache_.size()) {
+    Block* block = block_cache_.at(index);
+
+    if (block && block->in() < time) {
       return block;
-    } else if (block->out() == time) {
-      break;
     }
   }
 
@@ -140,10 +147,13 @@ Block *TrackOutput::BlockContainingTime(const rational &time) const
 
 Block *TrackOutput::NearestBlockBefore(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block who's out point is at/after this time is the correct Block
-    if (block->out() >= time) {
-      return block;
+  // Blocks are sorted by time, so the first Block who's out point is at/after this time is the correct Block
+  int index = static_cast<int>(std::lower_bound(block_out_points_.constBegin(), block_out_points_.constEnd(), time)
+                               - block_out_points_.constBegin());
+
+  for (int i=index;i<block_cache_.size();i++) {
+    if (block_cache_.at(i)) {
+      return block_cache_.at(i);
     }
   }
 
@@ -152,10 +162,18 @@ Block *TrackOutput::NearestBlockBefore(const rational &time) const
 
 Block *TrackOutput::NearestBlockAfter(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block after this time is the correct Block
-    if (block->in() >= time) {
-      return block;
+  // A slot's in point is the previous slot's out point, so the first Block after this time follows the first slot
+  // that ends at/after it
+  int index = 0;
+
+  if (time > 0) {
+    index = static_cast<int>(std::lower_bound(block_out_points_.constBegin(), block_out_points_.constEnd(), time)
+                             - block_out_points_.constBegin()) + 1;
+  }
+
+  for (int i=index;i<block_cache_.size();i++) {
+    if (block_cache_.at(i)) {
+      return block_cache_.at(i);
     }
   }
 
@@ -168,10 +186,14 @@ Block *TrackOutput::BlockAtTime(const rational &time) const
     return nullptr;
   }
 
-  foreach (Block* block, block_cache_) {
-    if (block
-        && block->in() <= time
-        && block->out() > time) {
+  // Empty slots repeat the previous out point, so the first slot that ends after this time is always a Block
+  int index = static_cast<int>(std::upper_bound(block_out_points_.constBegin(), block_out_points_.constEnd(), time)
+                               - block_out_points_.constBegin());
+
+  if (index < block_cache_.size()) {
+    Block* block = block_cache_.at(index);
+
+    if (block && block->in() <= time) {
       return block;
     }
   }
@@ -187,10 +209,18 @@ QList<Block *> TrackOutput::BlocksAtTimeRange(const TimeRange &range) const
     return list;
   }
 
-  foreach (Block* block, block_cache_) {
-    if (block
-        && block->out() > range.in()
-        && block->in() < range.out()) {
+  int index = static_cast<int>(std::upper_bound(block_out_points_.constBegin(),
+                                                block_out_points_.constEnd(),
+                                                range.in()) - block_out_points_.constBegin());
+
+  for (int i=index;i<block_cache_.size();i++) {
+    Block* block = block_cache_.at(i);
+
+    if (block) {
+      if (block->in() >= range.out()) {
+        break;
+      }
+
       list.append(block);
     }
   }
@@ -236,11 +266,13 @@ void TrackOutput::PrependBlock(Block *block)
 void TrackOutput::InsertBlockAtIndex(Block *block, int index)
 {
   BlockInvalidateCache();
+  BeginBlockEdit();
 
   block_input_->InsertAt(index);
   NodeParam::ConnectEdge(block->output(),
                          block_input_->At(index));
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(block->in(), track_length());
@@ -249,12 +281,14 @@ void TrackOutput::InsertBlockAtIndex(Block *block, int index)
 void TrackOutput::AppendBlock(Block *block)
 {
   BlockInvalidateCache();
+  BeginBlockEdit();
 
   int last_index = block_input_->GetSize();
   block_input_->Append();
   NodeParam::ConnectEdge(block->output(),
                          block_input_->At(last_index));
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   // Invalidate area that block was added to
@@ -274,6 +308,7 @@ void TrackOutput::UnblockInvalidateCache()
 void TrackOutput::RippleRemoveBlock(Block *block)
 {
   BlockInvalidateCache();
+  BeginBlockEdit();
 
   rational remove_in = block->in();
 
@@ -281,6 +316,7 @@ void TrackOutput::RippleRemoveBlock(Block *block)
 
   block_input_->RemoveAt(index_of_block_to_remove);
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(remove_in, track_length());
@@ -291,6 +327,7 @@ void TrackOutput::ReplaceBlock(Block *old, Block *replace)
   Q_ASSERT(old->length() == replace->length());
 
   BlockInvalidateCache();
+  BeginBlockEdit();
 
   int index_of_old_block = block_cache_.indexOf(old);
 
@@ -300,6 +337,7 @@ void TrackOutput::ReplaceBlock(Block *old, Block *replace)
   NodeParam::ConnectEdge(replace->output(),
                          block_input_->At(index_of_old_block));
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(replace->in(), replace->out());
@@ -388,36 +426,43 @@ void TrackOutput::SetLocked(bool e)
   locked_ = e;
 }
 
+void TrackOutput::InvalidateInOutFrom(int index)
+{
+  if (inout_dirty_from_ == -1 || index < inout_dirty_from_) {
+    inout_dirty_from_ = index;
+  }
+
+  if (block_edit_stack_ == 0) {
+    UpdateInOutFrom(inout_dirty_from_);
+  }
+}
+
 void TrackOutput::UpdateInOutFrom(int index)
 {
   Q_ASSERT(index >= 0);
-  Q_ASSERT(index < block_cache_.size());
 
-  rational new_track_length;
+  // Slots may have been removed since this index was marked
+  index = qMin(index, block_cache_.size());
 
-  // Find block just before this one to find the last out point
-  for (int i=index-1;i>=0;i--) {
-    Block* b = block_cache_.at(i);
+  inout_dirty_from_ = -1;
 
-    if (b) {
-      new_track_length = b->out();
-      break;
-    }
-  }
+  // Slots before this one are up to date, so the last out point is simply the previous slot's
+  rational new_track_length = (index > 0) ? block_out_points_.at(index - 1) : rational(0);
 
   for (int i=index;i<block_cache_.size();i++) {
     Block* b = block_cache_.at(i);
 
     if (b) {
-      // Set in
       b->set_in(new_track_length);
 
-      // Set out
       new_track_length += b->length();
       b->set_out(new_track_length);
 
+      // The timeline redraws Blocks on this, so signal every Block from the edit point on
       emit b->Refreshed();
     }
+
+    block_out_points_.replace(i, new_track_length);
   }
 
   // Update track length
@@ -427,6 +472,20 @@ void TrackOutput::UpdateInOutFrom(int index)
   }
 }
 
+void TrackOutput::BeginBlockEdit()
+{
+  block_edit_stack_++;
+}
+
+void TrackOutput::EndBlockEdit()
+{
+  block_edit_stack_--;
+
+  if (block_edit_stack_ == 0 && inout_dirty_from_ != -1) {
+    UpdateInOutFrom(inout_dirty_from_);
+  }
+}
+
 void TrackOutput::UpdatePreviousAndNextOfIndex(int index)
 {
   Block* ref = block_cache_.at(index);
@@ -482,7 +541,7 @@ void TrackOutput::BlockConnected(NodeEdgePtr edge)
   Block* connected_block = connected_node->IsBlock() ? static_cast<Block*>(connected_node) : nullptr;
   block_cache_.replace(block_index, connected_block);
   UpdatePreviousAndNextOfIndex(block_index);
-  UpdateInOutFrom(block_index);
+  InvalidateInOutFrom(block_index);
 
   if (connected_block) {
     connect(connected_block, SIGNAL(LengthChanged(const rational&)), this, SLOT(BlockLengthChanged()));
@@ -499,7 +558,7 @@ void TrackOutput::BlockDisconnected(NodeEdgePtr edge)
 
   block_cache_.replace(block_index, nullptr);
   UpdatePreviousAndNextOfIndex(block_index);
-  UpdateInOutFrom(block_index);
+  InvalidateInOutFrom(block_index);
 
   Node* connected_node = edge->output()->parentNode();
   Block* connected_block = connected_node->IsBlock() ? static_cast<Block*>(connected_node) : nullptr;
@@ -515,11 +574,16 @@ void TrackOutput::BlockListSizeChanged(int size)
 {
   int old_size = block_cache_.size();
 
+  // New slots are empty so they end where the last slot did
+  rational last_out = (old_size > 0) ? block_out_points_.at(old_size - 1) : rational(0);
+
   block_cache_.resize(size);
+  block_out_points_.resize(size);
 
   // Fill new slots with nullptr
   for (int i=old_size;i<size;i++) {
     block_cache_.replace(i, nullptr);
+    block_out_points_.replace(i, last_out);
   }
 }
 
@@ -532,5 +596,5 @@ void TrackOutput::BlockLengthChanged()
 
   Q_ASSERT(index >= 0);
 
-  UpdateInOutFrom(index);
+  InvalidateInOutFrom(index);
 }
@@ -163,12 +163,36 @@ signals:
 protected:
 
 private:
+  /**
+   * @brief Mark in/out points as out of date from `index` onwards and update them unless an edit is in progress
+   *
+   * InsertBlockAtIndex() and RippleRemoveBlock() shift every connection after the edit point one by one, so updating
+   * in/out points on each connection is quadratic. While inside BeginBlockEdit()/EndBlockEdit() the update is only
+   * recorded and applied once when the edit ends.
+   */
+  void InvalidateInOutFrom(int index);
+
   void UpdateInOutFrom(int index);
 
+  void BeginBlockEdit();
+
+  void EndBlockEdit();
+
   void UpdatePreviousAndNextOfIndex(int index);
 
   QVector<Block*> block_cache_;
 
+  /**
+   * @brief Out point of each slot in block_cache_, used for binary searching Blocks by time
+   *
+   * Empty slots repeat the previous out point so this is always sorted.
+   */
+  QVector<rational> block_out_points_;
+
+  int inout_dirty_from_;
+
+  int block_edit_stack_;
+
   NodeInputArray* block_input_;
 
   NodeInput* muted_input_;
@@ -65,6 +65,14 @@ private:
 
 };
 
+/**
+ * @brief Per-sample-frame values of inputs that change over the course of an audio block
+ *
+ * Only inputs that can change within a block (i.e. keyframed or connected ones) are included. Everything else is
+ * constant for the block and should be read from the NodeValueDatabase as usual.
+ */
+using NodeSampleCurves = QHash<const NodeInput*, QVector<float> >;
+
 Q_DECLARE_METATYPE(NodeValueTable)
 
 #endif // VALUE_H
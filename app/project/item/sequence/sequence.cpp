@@ -191,6 +191,11 @@ void Sequence::Open(Sequence* sequence)
   node_panel->SetGraph(sequence);
 }
 
+ViewerOutput *Sequence::viewer_output() const
+{
+  return viewer_output_;
+}
+
 void Sequence::add_default_nodes()
 {
   // Create tracks and connect them to the viewer
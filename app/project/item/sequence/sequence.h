@@ -71,6 +71,11 @@ public:
 
   void set_default_parameters();
 
+  /**
+   * @brief The ViewerOutput node that the rest of this Sequence's graph renders into
+   */
+  ViewerOutput* viewer_output() const;
+
 protected:
   virtual void NameChangedEvent(const QString& name) override;
 
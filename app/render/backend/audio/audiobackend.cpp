@@ -54,8 +54,6 @@ void AudioBackend::ConnectWorkerToThis(RenderWorker *worker)
 
 void AudioBackend::ThreadCompletedCache(NodeDependency dep, NodeValueTable data, qint64 job_time)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   if (job_time == render_job_info_.value(dep.range())) {
     render_job_info_.remove(dep.range());
 
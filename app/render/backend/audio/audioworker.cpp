@@ -12,16 +12,13 @@ void AudioWorker::FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable
   table->Push(NodeParam::kSamples, frame->ToByteArray());
 }
 
-void AudioWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, const NodeValueDatabase &input_params_in, NodeValueTable *output_params)
+void AudioWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, const NodeValueDatabase &input_params, NodeValueTable *output_params)
 {
   // Check if node processes samples
   if (!node->ProcessesSamplesFrom()) {
     return;
   }
 
-  // Copy database so we can make some temporary modifications to it
-  NodeValueDatabase input_params = input_params_in;
-
   // Try to find the sample buffer in the table
   QVariant samples_var = input_params[node->ProcessesSamplesFrom()].Get(NodeParam::kSamples);
 
@@ -33,36 +30,129 @@ void AudioWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, c
   QByteArray input_buffer = samples_var.toByteArray();
   QByteArray output_buffer(input_buffer.size(), 0);
 
+  // FIXME: Hardcoded float sample format
   int sample_count = input_buffer.size() / audio_params().bytes_per_sample_per_channel();
+  int frame_count = sample_count / audio_params().channel_count();
 
-  // FIXME: Hardcoded float sample format
-  for (int i=0;i<sample_count;i++) {
-    // Calculate the exact rational time at this sample
-    int sample_out_of_channel = i / audio_params().channel_count();
-    double sample_to_second = static_cast<double>(sample_out_of_channel) / static_cast<double>(audio_params().sample_rate());
-
-    rational this_sample_time = rational::fromDouble(range.in().toDouble() + sample_to_second);
-
-    // Update all non-sample and non-footage inputs
-    foreach (NodeParam* param, node->parameters()) {
-      if (param->type() == NodeParam::kInput
-          && param != node->ProcessesSamplesFrom()) {
-        NodeInput* input = static_cast<NodeInput*>(param);
-
-        // If the input isn't keyframing, we don't need to update it unless it's connected, in which case it may change
-        if (input->IsConnected() || input->is_keyframing()) {
-          input_params.Insert(input, ProcessInput(input,
-                                                  TimeRange(this_sample_time, this_sample_time)));
+  // Inputs that may change over the course of this block are sampled once per sample frame, everything else is
+  // already in the database at its value for the start of the block
+  NodeSampleCurves curves;
+  QVector<NodeInput*> stepped_inputs;
+
+  foreach (NodeParam* param, node->parameters()) {
+    if (param->type() == NodeParam::kInput
+        && param != node->ProcessesSamplesFrom()) {
+      NodeInput* input = static_cast<NodeInput*>(param);
+
+      if (input->IsConnected() || input->is_keyframing()) {
+        if (input->data_type() == NodeParam::kFloat) {
+          curves.insert(input, SampleInputCurve(input, range.in(), frame_count));
+        } else {
+          stepped_inputs.append(input);
         }
       }
     }
+  }
 
+  const float* input_samples = reinterpret_cast<const float*>(input_buffer.constData());
+  float* output_samples = reinterpret_cast<float*>(output_buffer.data());
+
+  if (stepped_inputs.isEmpty()) {
     node->ProcessSamples(&input_params,
+                         curves,
                          audio_params(),
-                         reinterpret_cast<const float*>(input_buffer.constData()),
-                         reinterpret_cast<float*>(output_buffer.data()),
-                         i);
+                         input_samples,
+                         output_samples,
+                         sample_count);
+  } else {
+    // Inputs that can't be represented as a float curve are evaluated per sample frame into the database instead.
+    // Runs of frames where none of them change are still processed together.
+    NodeValueDatabase frame_params = input_params;
+
+    double start_dbl = range.in().toDouble();
+    double sample_rate = static_cast<double>(audio_params().sample_rate());
+    int channels = audio_params().channel_count();
+
+    QVector<QVariant> run_values;
+    int run_start = 0;
+
+    for (int i=0;i<=frame_count;i++) {
+      QVector<QVariant> values;
+      QVector<NodeValueTable> tables;
+
+      if (i < frame_count) {
+        rational this_sample_time = rational::fromDouble(start_dbl + static_cast<double>(i) / sample_rate);
+
+        foreach (NodeInput* input, stepped_inputs) {
+          NodeValueTable table = ProcessInput(input, TimeRange(this_sample_time, this_sample_time));
+
+          values.append(table.Get(input->data_type()));
+          tables.append(table);
+        }
+      }
+
+      if (i > run_start && (i == frame_count || values != run_values)) {
+        // Values changed (or the block ended), process the frames that had the previous ones
+        ProcessSampleRange(node, frame_params, curves, input_samples, output_samples, run_start, i - run_start, channels);
+
+        run_start = i;
+      }
+
+      if (i == run_start && i < frame_count) {
+        for (int j=0;j<stepped_inputs.size();j++) {
+          frame_params.Insert(stepped_inputs.at(j), tables.at(j));
+        }
+
+        run_values = values;
+      }
+    }
   }
 
   output_params->Push(NodeParam::kSamples, output_buffer);
 }
+
+void AudioWorker::ProcessSampleRange(const Node *node, const NodeValueDatabase &params, const NodeSampleCurves &curves, const float *input, float *output, int first_frame, int frame_count, int channels)
+{
+  NodeSampleCurves range_curves;
+
+  for (NodeSampleCurves::const_iterator i=curves.constBegin();i!=curves.constEnd();i++) {
+    range_curves.insert(i.key(), i.value().mid(first_frame, frame_count));
+  }
+
+  int offset = first_frame * channels;
+
+  node->ProcessSamples(&params,
+                       range_curves,
+                       audio_params(),
+                       input + offset,
+                       output + offset,
+                       frame_count * channels);
+}
+
+QVector<float> AudioWorker::SampleInputCurve(const NodeInput *input, const rational &start, int frame_count)
+{
+  QVector<float> curve(frame_count);
+
+  double start_dbl = start.toDouble();
+  double sample_rate = static_cast<double>(audio_params().sample_rate());
+
+  if (!input->IsConnected()) {
+    // The value only comes from keyframes, so evaluate the whole block in one pass rather than per sample
+    QVector<double> values = input->get_values_at_times_for_track(start_dbl, 1.0 / sample_rate, frame_count, 0);
+
+    for (int i=0;i<frame_count;i++) {
+      curve[i] = static_cast<float>(values.at(i));
+    }
+
+    return curve;
+  }
+
+  for (int i=0;i<frame_count;i++) {
+    // Calculate the exact rational time at this sample frame
+    rational this_sample_time = rational::fromDouble(start_dbl + static_cast<double>(i) / sample_rate);
+
+    curve[i] = ProcessInput(input, TimeRange(this_sample_time, this_sample_time)).Get(NodeParam::kFloat).toFloat();
+  }
+
+  return curve;
+}
@@ -14,6 +14,22 @@ protected:
   virtual void RunNodeAccelerated(const Node *node, const TimeRange& range, const NodeValueDatabase& input_params, NodeValueTable* output_params) override;
 
 private:
+  /**
+   * @brief Sample an input's value once per sample frame starting at `start`
+   */
+  QVector<float> SampleInputCurve(const NodeInput* input, const rational& start, int frame_count);
+
+  /**
+   * @brief Run ProcessSamples() on `frame_count` sample frames of the block starting at `first_frame`
+   */
+  void ProcessSampleRange(const Node* node,
+                          const NodeValueDatabase& params,
+                          const NodeSampleCurves& curves,
+                          const float* input,
+                          float* output,
+                          int first_frame,
+                          int frame_count,
+                          int channels);
 
 };
 
@@ -0,0 +1,61 @@
+#include "cpubackend.h"
+
+#include <QDebug>
+
+#include "cpuworker.h"
+
+CPUBackend::CPUBackend(QObject *parent) :
+  VideoRenderBackend(parent)
+{
+}
+
+CPUBackend::~CPUBackend()
+{
+  Close();
+}
+
+bool CPUBackend::InitInternal()
+{
+  if (!VideoRenderBackend::InitInternal()) {
+    return false;
+  }
+
+  // Initiate one thread per CPU core
+  for (int i=0;i<threads().size();i++) {
+    // Create one processor object for each thread
+    CPUWorker* processor = new CPUWorker(frame_cache());
+    processor->SetParameters(params());
+    processors_.append(processor);
+  }
+
+  return true;
+}
+
+bool CPUBackend::CompileInternal()
+{
+  if (!viewer_node() || !viewer_node()->texture_input()->IsConnected()) {
+    // Nothing to be done, nothing to compile
+    return true;
+  }
+
+  // There's nothing to compile, but nodes we can't render will be missing from the output so it's worth a warning
+  QList<Node*> nodes = viewer_node()->GetDependencies();
+
+  foreach (Node* n, nodes) {
+    if (n->IsAccelerated() && !CPUWorker::CanRenderNode(n->id())) {
+      qWarning() << "No CPU implementation for" << n->id() << "- it will be skipped";
+    }
+  }
+
+  return true;
+}
+
+void CPUBackend::DecompileInternal()
+{
+}
+
+void CPUBackend::EmitCachedFrameReady(const rational &time, const QVariant &value, qint64 job_time)
+{
+  // Frames are never written to once they're finished, so they can be passed on without a copy
+  emit CachedFrameReady(time, value, job_time);
+}
@@ -0,0 +1,31 @@
+#ifndef CPUBACKEND_H
+#define CPUBACKEND_H
+
+#include "../videorenderbackend.h"
+
+/**
+ * @brief A VideoRenderBackend that renders entirely on the CPU with one CPUWorker per thread
+ *
+ * For machines without a usable GPU. Frames are passed around as FramePtrs rather than textures, so this is only
+ * suitable for exporting and caching, not for the viewer.
+ */
+class CPUBackend : public VideoRenderBackend
+{
+  Q_OBJECT
+public:
+  CPUBackend(QObject* parent = nullptr);
+
+  virtual ~CPUBackend() override;
+
+protected:
+  virtual bool InitInternal() override;
+
+  virtual bool CompileInternal() override;
+
+  virtual void DecompileInternal() override;
+
+  virtual void EmitCachedFrameReady(const rational &time, const QVariant& value, qint64 job_time) override;
+
+};
+
+#endif // CPUBACKEND_H
@@ -0,0 +1,61 @@
+#include "cpuexporter.h"
+
+#include "cpubackend.h"
+#include "cpurenderfunctions.h"
+#include "render/backend/audio/audiobackend.h"
+#include "render/pixelservice.h"
+
+CPUExporter::CPUExporter(ViewerOutput *viewer, Encoder *encoder, QObject *parent) :
+  Exporter(viewer, encoder, parent)
+{
+}
+
+bool CPUExporter::Initialize()
+{
+  // Create rendering backends
+  if (!video_done_) {
+    video_backend_ = new CPUBackend();
+  }
+
+  if (!audio_done_) {
+    audio_backend_ = new AudioBackend();
+  }
+
+  return true;
+}
+
+void CPUExporter::Cleanup()
+{
+  downloaded_frames_.clear();
+}
+
+void CPUExporter::DownloadTexture(const QVariant &texture)
+{
+  FramePtr input = texture.value<FramePtr>();
+  FramePtr frame;
+
+  if (input && transform_.isIdentity()
+      && input->width() == video_params_.effective_width()
+      && input->height() == video_params_.effective_height()) {
+    // The same frame can be exported more than once and is changed in place later on, so give it a copy (which
+    // shares the pixels until they're written to)
+    frame = std::make_shared<Frame>(*input);
+  } else {
+    frame = CPURenderFunctions::CreateFrame(video_params_.effective_width(), video_params_.effective_height());
+
+    // Blit for transform if the width/height are different
+    if (input) {
+      CPURenderFunctions::Blit(input, frame, transform_);
+    } else {
+      CPURenderFunctions::Fill(frame, QVector4D());
+    }
+  }
+
+  // Match the precision OpenGLExporter downloads at
+  downloaded_frames_.enqueue(PixelService::ConvertPixelFormat(frame, video_params_.format()));
+}
+
+FramePtr CPUExporter::RetrieveDownloadedFrame()
+{
+  return downloaded_frames_.dequeue();
+}
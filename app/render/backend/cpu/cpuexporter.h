@@ -0,0 +1,35 @@
+#ifndef CPUEXPORTER_H
+#define CPUEXPORTER_H
+
+#include <QQueue>
+
+#include "render/backend/exporter.h"
+
+/**
+ * @brief Exporter that renders with CPUBackend, for exporting on machines without OpenGL
+ */
+class CPUExporter : public Exporter
+{
+public:
+  CPUExporter(ViewerOutput* viewer,
+              Encoder* encoder,
+              QObject* parent = nullptr);
+
+protected:
+  virtual bool Initialize() override;
+
+  virtual void Cleanup() override;
+
+  virtual void DownloadTexture(const QVariant &texture) override;
+
+  virtual FramePtr RetrieveDownloadedFrame() override;
+
+private:
+  /**
+   * @brief Frames in the order they were "downloaded", there's no transfer so they're ready straight away
+   */
+  QQueue<FramePtr> downloaded_frames_;
+
+};
+
+#endif // CPUEXPORTER_H
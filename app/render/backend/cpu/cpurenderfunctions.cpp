@@ -0,0 +1,495 @@
+#include "cpurenderfunctions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QTransform>
+
+#include "common/clamp.h"
+#include "common/define.h"
+#include "common/parallelfor.h"
+#include "common/simd.h"
+
+const int CPURenderFunctions::kRowsPerBand = 16;
+const int CPURenderFunctions::kMaximumMinifyTaps = 8;
+
+namespace {
+
+/**
+ * Any offset past this is outside every texture and just samples the edge
+ */
+const float kMaximumOffset = 1048576.0f;
+
+/**
+ * Same result as texture2D() on a GL_LINEAR/GL_CLAMP_TO_EDGE texture, except `x` and `y` are in texels rather than
+ * 0.0-1.0
+ */
+inline void Sample(const float* data, int width, int height, float x, float y, float* out)
+{
+  // Texel centers are at +0.5. Coordinates are clamped before rounding so ones far outside can't overflow.
+  x = clamp(x - 0.5f, -1.0f, static_cast<float>(width));
+  y = clamp(y - 0.5f, -1.0f, static_cast<float>(height));
+
+  float left = std::floor(x);
+  float top = std::floor(y);
+
+  float x_weight = x - left;
+  float y_weight = y - top;
+
+  int x0 = static_cast<int>(left);
+  int y0 = static_cast<int>(top);
+
+  const float* row0 = data + clamp(y0, 0, height - 1) * width * kRGBAChannels;
+  const float* row1 = data + clamp(y0 + 1, 0, height - 1) * width * kRGBAChannels;
+  int col0 = clamp(x0, 0, width - 1) * kRGBAChannels;
+  int col1 = clamp(x0 + 1, 0, width - 1) * kRGBAChannels;
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 xw = _mm_set1_ps(x_weight);
+  __m128 yw = _mm_set1_ps(y_weight);
+
+  __m128 top_left = _mm_loadu_ps(row0 + col0);
+  __m128 bottom_left = _mm_loadu_ps(row1 + col0);
+
+  __m128 top_px = _mm_add_ps(top_left, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row0 + col1), top_left), xw));
+  __m128 bottom_px = _mm_add_ps(bottom_left, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row1 + col1), bottom_left), xw));
+
+  _mm_storeu_ps(out, _mm_add_ps(top_px, _mm_mul_ps(_mm_sub_ps(bottom_px, top_px), yw)));
+#else
+  for (int i=0;i<kRGBAChannels;i++) {
+    float top_px = row0[col0 + i] + (row0[col1 + i] - row0[col0 + i]) * x_weight;
+    float bottom_px = row1[col0 + i] + (row1[col1 + i] - row1[col0 + i]) * x_weight;
+
+    out[i] = top_px + (bottom_px - top_px) * y_weight;
+  }
+#endif
+}
+
+}
+
+FramePtr CPURenderFunctions::CreateFrame(int width, int height)
+{
+  FramePtr frame = Frame::Create();
+
+  frame->set_width(width);
+  frame->set_height(height);
+  frame->set_format(PixelFormat::PIX_FMT_RGBA32F);
+  frame->allocate();
+
+  return frame;
+}
+
+FramePtr CPURenderFunctions::MatchSize(FramePtr src, int width, int height)
+{
+  if (!src || (src->width() == width && src->height() == height)) {
+    return src;
+  }
+
+  FramePtr resized = CreateFrame(width, height);
+
+  Blit(src, resized, QMatrix4x4());
+
+  return resized;
+}
+
+void CPURenderFunctions::Blit(FramePtr src, FramePtr dst, const QMatrix4x4 &matrix)
+{
+  // The quad lies on z = 0, so all that matters is the 2D projective transform between it and the screen
+  QTransform quad_to_clip(static_cast<qreal>(matrix(0, 0)), static_cast<qreal>(matrix(1, 0)), static_cast<qreal>(matrix(3, 0)),
+                          static_cast<qreal>(matrix(0, 1)), static_cast<qreal>(matrix(1, 1)), static_cast<qreal>(matrix(3, 1)),
+                          static_cast<qreal>(matrix(0, 3)), static_cast<qreal>(matrix(1, 3)), static_cast<qreal>(matrix(3, 3)));
+
+  bool invertible;
+  QTransform clip_to_quad = quad_to_clip.inverted(&invertible);
+
+  if (!invertible) {
+    // The quad has no area so it doesn't cover anything
+    Fill(dst, QVector4D());
+    return;
+  }
+
+  const float* src_data = reinterpret_cast<const float*>(src->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+
+  int src_width = src->width();
+  int src_height = src->height();
+  int dst_width = dst->width();
+  int dst_height = dst->height();
+
+  // Maps a position in destination pixels to source texels, returns false if it's outside the quad
+  auto map = [&](qreal x, qreal y, float* src_x, float* src_y) -> bool {
+    qreal clip_x = x * 2.0 / dst_width - 1.0;
+    qreal clip_y = y * 2.0 / dst_height - 1.0;
+
+    qreal quad_w = clip_to_quad.m13() * clip_x + clip_to_quad.m23() * clip_y + clip_to_quad.m33();
+
+    if (qFuzzyIsNull(quad_w)) {
+      return false;
+    }
+
+    qreal quad_x = (clip_to_quad.m11() * clip_x + clip_to_quad.m21() * clip_y + clip_to_quad.m31()) / quad_w;
+    qreal quad_y = (clip_to_quad.m12() * clip_x + clip_to_quad.m22() * clip_y + clip_to_quad.m32()) / quad_w;
+
+    *src_x = static_cast<float>((quad_x + 1.0) * 0.5 * src_width);
+    *src_y = static_cast<float>((quad_y + 1.0) * 0.5 * src_height);
+
+    return (quad_x >= -1.0 && quad_x <= 1.0 && quad_y >= -1.0 && quad_y <= 1.0);
+  };
+
+  // Measure how many texels one pixel covers in the middle of the frame to decide how many taps to average
+  float center_x, center_y, right_x, right_y, below_x, below_y;
+  map(dst_width * 0.5, dst_height * 0.5, &center_x, &center_y);
+  map(dst_width * 0.5 + 1.0, dst_height * 0.5, &right_x, &right_y);
+  map(dst_width * 0.5, dst_height * 0.5 + 1.0, &below_x, &below_y);
+
+  float footprint = qMax(std::hypot(right_x - center_x, right_y - center_y),
+                         std::hypot(below_x - center_x, below_y - center_y));
+
+  int taps = static_cast<int>(std::ceil(qBound(1.0f, footprint, static_cast<float>(kMaximumMinifyTaps))));
+  float tap_weight = 1.0f / static_cast<float>(taps * taps);
+
+  ForEachBand(dst_height, [&](int first_row, int last_row) {
+    for (int y=first_row;y<last_row;y++) {
+      float* out = dst_data + y * dst_width * kRGBAChannels;
+
+      for (int x=0;x<dst_width;x++, out+=kRGBAChannels) {
+        float src_x, src_y;
+
+        // Like OpenGL, only the pixel center decides whether the pixel is drawn
+        if (!map(x + 0.5, y + 0.5, &src_x, &src_y)) {
+          std::fill(out, out + kRGBAChannels, 0.0f);
+          continue;
+        }
+
+        if (taps == 1) {
+          Sample(src_data, src_width, src_height, src_x, src_y, out);
+          continue;
+        }
+
+        float sum[kRGBAChannels] = {};
+        float tap[kRGBAChannels];
+
+        for (int j=0;j<taps;j++) {
+          for (int i=0;i<taps;i++) {
+            map(x + (i + 0.5) / taps, y + (j + 0.5) / taps, &src_x, &src_y);
+
+            Sample(src_data, src_width, src_height, src_x, src_y, tap);
+
+            for (int k=0;k<kRGBAChannels;k++) {
+              sum[k] += tap[k];
+            }
+          }
+        }
+
+        for (int k=0;k<kRGBAChannels;k++) {
+          out[k] = sum[k] * tap_weight;
+        }
+      }
+    }
+  });
+}
+
+void CPURenderFunctions::Fill(FramePtr dst, const QVector4D &color)
+{
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+
+  float color_values[kRGBAChannels] = {color.x(), color.y(), color.z(), color.w()};
+
+  ForEachBand(dst->height(), [&](int first_row, int last_row) {
+    float* out = dst_data + first_row * width * kRGBAChannels;
+    int count = (last_row - first_row) * width * kRGBAChannels;
+
+    int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+    __m128 color_px = _mm_loadu_ps(color_values);
+
+    for (;i+4<=count;i+=4) {
+      _mm_storeu_ps(out + i, color_px);
+    }
+#endif
+
+    for (;i<count;i++) {
+      out[i] = color_values[i % kRGBAChannels];
+    }
+  });
+}
+
+void CPURenderFunctions::Multiply(FramePtr src, float factor, FramePtr dst)
+{
+  const float* src_data = reinterpret_cast<const float*>(src->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+
+  ForEachBand(dst->height(), [&](int first_row, int last_row) {
+    int offset = first_row * width * kRGBAChannels;
+    int count = (last_row - first_row) * width * kRGBAChannels;
+
+    const float* in = src_data + offset;
+    float* out = dst_data + offset;
+
+    int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+    __m128 factor_vec = _mm_set1_ps(factor);
+
+    for (;i+4<=count;i+=4) {
+      _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), factor_vec));
+    }
+#endif
+
+    for (;i<count;i++) {
+      out[i] = in[i] * factor;
+    }
+  });
+}
+
+void CPURenderFunctions::Mix(FramePtr a, float a_weight, FramePtr b, float b_weight, FramePtr dst)
+{
+  if (!a && !b) {
+    Fill(dst, QVector4D());
+    return;
+  }
+
+  if (!a) {
+    Multiply(b, b_weight, dst);
+    return;
+  }
+
+  if (!b) {
+    Multiply(a, a_weight, dst);
+    return;
+  }
+
+  const float* a_data = reinterpret_cast<const float*>(a->const_data());
+  const float* b_data = reinterpret_cast<const float*>(b->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+
+  ForEachBand(dst->height(), [&](int first_row, int last_row) {
+    int offset = first_row * width * kRGBAChannels;
+    int count = (last_row - first_row) * width * kRGBAChannels;
+
+    const float* a_in = a_data + offset;
+    const float* b_in = b_data + offset;
+    float* out = dst_data + offset;
+
+    int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+    __m128 a_weight_vec = _mm_set1_ps(a_weight);
+    __m128 b_weight_vec = _mm_set1_ps(b_weight);
+
+    for (;i+4<=count;i+=4) {
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a_in + i), a_weight_vec),
+                                        _mm_mul_ps(_mm_loadu_ps(b_in + i), b_weight_vec)));
+    }
+#endif
+
+    for (;i<count;i++) {
+      out[i] = a_in[i] * a_weight + b_in[i] * b_weight;
+    }
+  });
+}
+
+void CPURenderFunctions::AlphaOver(FramePtr base, FramePtr blend, FramePtr dst)
+{
+  const float* base_data = reinterpret_cast<const float*>(base->const_data());
+  const float* blend_data = reinterpret_cast<const float*>(blend->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+
+  ForEachBand(dst->height(), [&](int first_row, int last_row) {
+    int offset = first_row * width * kRGBAChannels;
+    int count = (last_row - first_row) * width * kRGBAChannels;
+
+    const float* base_in = base_data + offset;
+    const float* blend_in = blend_data + offset;
+    float* out = dst_data + offset;
+
+    int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+    __m128 one = _mm_set1_ps(1.0f);
+
+    // One pixel per vector
+    for (;i+4<=count;i+=4) {
+      __m128 blend_px = _mm_loadu_ps(blend_in + i);
+      __m128 blend_alpha = _mm_shuffle_ps(blend_px, blend_px, _MM_SHUFFLE(3, 3, 3, 3));
+
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(base_in + i), _mm_sub_ps(one, blend_alpha)),
+                                        blend_px));
+    }
+#endif
+
+    for (;i<count;i+=kRGBAChannels) {
+      float inverse_alpha = 1.0f - blend_in[i + kRGBChannels];
+
+      for (int j=0;j<kRGBAChannels;j++) {
+        out[i + j] = base_in[i + j] * inverse_alpha + blend_in[i + j];
+      }
+    }
+  });
+}
+
+void CPURenderFunctions::Shadow(FramePtr src, FramePtr shadow, const QVector4D &color, FramePtr dst)
+{
+  const float* src_data = reinterpret_cast<const float*>(src->const_data());
+  const float* shadow_data = reinterpret_cast<const float*>(shadow->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+
+  float color_values[kRGBAChannels] = {color.x(), color.y(), color.z(), color.w()};
+
+  ForEachBand(dst->height(), [&](int first_row, int last_row) {
+    int offset = first_row * width * kRGBAChannels;
+    int count = (last_row - first_row) * width * kRGBAChannels;
+
+    const float* src_in = src_data + offset;
+    const float* shadow_in = shadow_data + offset;
+    float* out = dst_data + offset;
+
+    int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 color_px = _mm_loadu_ps(color_values);
+
+    // Only the alpha lane of the color is scaled by the shadow
+    __m128 alpha_mask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+    for (;i+4<=count;i+=4) {
+      __m128 shadow_px = _mm_loadu_ps(shadow_in + i);
+      __m128 shadow_alpha = _mm_shuffle_ps(shadow_px, shadow_px, _MM_SHUFFLE(3, 3, 3, 3));
+      __m128 factor = _mm_or_ps(_mm_and_ps(alpha_mask, shadow_alpha), _mm_andnot_ps(alpha_mask, one));
+
+      __m128 src_px = _mm_loadu_ps(src_in + i);
+      __m128 src_alpha = _mm_shuffle_ps(src_px, src_px, _MM_SHUFFLE(3, 3, 3, 3));
+
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(color_px, factor), _mm_sub_ps(one, src_alpha)),
+                                        src_px));
+    }
+#endif
+
+    for (;i<count;i+=kRGBAChannels) {
+      float inverse_alpha = 1.0f - src_in[i + kRGBChannels];
+
+      for (int j=0;j<kRGBChannels;j++) {
+        out[i + j] = color_values[j] * inverse_alpha + src_in[i + j];
+      }
+
+      out[i + kRGBChannels] = color_values[kRGBChannels] * shadow_in[i + kRGBChannels] * inverse_alpha
+          + src_in[i + kRGBChannels];
+    }
+  });
+}
+
+CPURenderFunctions::Kernel CPURenderFunctions::FoldTaps(const QVector<float> &offsets, const QVector<float> &weights)
+{
+  Kernel kernel;
+  kernel.first = 0;
+
+  if (offsets.isEmpty()) {
+    return kernel;
+  }
+
+  QVector<float> clamped_offsets(offsets.size());
+
+  for (int i=0;i<offsets.size();i++) {
+    clamped_offsets[i] = clamp(offsets.at(i), -kMaximumOffset, kMaximumOffset);
+  }
+
+  kernel.first = static_cast<int>(std::floor(*std::min_element(clamped_offsets.constBegin(), clamped_offsets.constEnd())));
+  int last = static_cast<int>(std::floor(*std::max_element(clamped_offsets.constBegin(), clamped_offsets.constEnd()))) + 1;
+
+  kernel.weights.fill(0.0f, last - kernel.first + 1);
+
+  // A bilinear tap between two pixels is the same as a tap on each of them weighted by how close it is
+  for (int i=0;i<clamped_offsets.size();i++) {
+    float left = std::floor(clamped_offsets.at(i));
+    float right_weight = clamped_offsets.at(i) - left;
+    int index = static_cast<int>(left) - kernel.first;
+
+    kernel.weights[index] += weights.at(i) * (1.0f - right_weight);
+    kernel.weights[index + 1] += weights.at(i) * right_weight;
+  }
+
+  return kernel;
+}
+
+void CPURenderFunctions::Convolve(FramePtr src, FramePtr dst, bool horizontal, const Kernel &kernel)
+{
+  const float* src_data = reinterpret_cast<const float*>(src->const_data());
+  float* dst_data = reinterpret_cast<float*>(dst->data());
+  int width = dst->width();
+  int height = dst->height();
+  int line_size = width * kRGBAChannels;
+
+  const float* weights = kernel.weights.constData();
+  int tap_count = kernel.weights.size();
+
+  ForEachBand(height, [&](int first_row, int last_row) {
+    for (int y=first_row;y<last_row;y++) {
+      const float* in = src_data + y * line_size;
+      float* out = dst_data + y * line_size;
+
+      if (horizontal) {
+        for (int x=0;x<width;x++) {
+#ifdef OLIVE_SIMD_SSE2
+          __m128 sum = _mm_setzero_ps();
+
+          for (int k=0;k<tap_count;k++) {
+            int src_x = clamp(x + kernel.first + k, 0, width - 1);
+
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + src_x * kRGBAChannels), _mm_set1_ps(weights[k])));
+          }
+
+          _mm_storeu_ps(out + x * kRGBAChannels, sum);
+#else
+          float* out_px = out + x * kRGBAChannels;
+          std::fill(out_px, out_px + kRGBAChannels, 0.0f);
+
+          for (int k=0;k<tap_count;k++) {
+            const float* in_px = in + clamp(x + kernel.first + k, 0, width - 1) * kRGBAChannels;
+
+            for (int j=0;j<kRGBAChannels;j++) {
+              out_px[j] += in_px[j] * weights[k];
+            }
+          }
+#endif
+        }
+      } else {
+        // Vertically every tap is a whole row, so accumulate row by row
+        std::fill(out, out + line_size, 0.0f);
+
+        for (int k=0;k<tap_count;k++) {
+          const float* in_row = src_data + clamp(y + kernel.first + k, 0, height - 1) * line_size;
+          float weight = weights[k];
+
+          int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+          __m128 weight_vec = _mm_set1_ps(weight);
+
+          for (;i+4<=line_size;i+=4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in_row + i), weight_vec)));
+          }
+#endif
+
+          for (;i<line_size;i++) {
+            out[i] += in_row[i] * weight;
+          }
+        }
+      }
+    }
+  });
+}
+
+void CPURenderFunctions::ForEachBand(int height, const std::function<void (int, int)> &function)
+{
+  ParallelFor((height + kRowsPerBand - 1) / kRowsPerBand, [&](int band) {
+    int first_row = band * kRowsPerBand;
+
+    function(first_row, qMin(first_row + kRowsPerBand, height));
+  });
+}
@@ -0,0 +1,87 @@
+#ifndef CPURENDERFUNCTIONS_H
+#define CPURENDERFUNCTIONS_H
+
+#include <functional>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector4D>
+
+#include "codec/frame.h"
+
+/**
+ * @brief Software equivalents of the built-in shaders, used by CPUWorker
+ *
+ * Every frame is RGBA32F with associated alpha, like the textures OpenGLWorker renders into. Sampling follows the rules
+ * of the textures OpenGL renders with (bilinear filtering, texel centers at +0.5, clamped to the edge) so each function
+ * produces the same values as its shader up to floating point rounding. Work is split into bands of rows that run
+ * across the global thread pool.
+ */
+class CPURenderFunctions
+{
+public:
+  /**
+   * @brief A 1D convolution over whole pixels, `weights[i]` is applied to the pixel at offset `first + i`
+   */
+  struct Kernel {
+    int first;
+    QVector<float> weights;
+  };
+
+  static FramePtr CreateFrame(int width, int height);
+
+  /**
+   * @brief Returns `src` stretched to `width` x `height`, or `src` itself if it's already that size (or null)
+   */
+  static FramePtr MatchSize(FramePtr src, int width, int height);
+
+  /**
+   * @brief Draw `src` into `dst` as OpenGLRenderFunctions::Blit() would with a vertex shader that applies `matrix`
+   *
+   * `matrix` transforms the quad (-1.0 to 1.0 on both axes) into normalized device coordinates and anything outside the
+   * quad is cleared. Where the source is minified, several taps are averaged for each pixel in place of OpenGL's
+   * mipmaps.
+   */
+  static void Blit(FramePtr src, FramePtr dst, const QMatrix4x4& matrix);
+
+  static void Fill(FramePtr dst, const QVector4D& color);
+
+  static void Multiply(FramePtr src, float factor, FramePtr dst);
+
+  /**
+   * @brief dst = a * a_weight + b * b_weight, either input may be null to leave it out
+   */
+  static void Mix(FramePtr a, float a_weight, FramePtr b, float b_weight, FramePtr dst);
+
+  static void AlphaOver(FramePtr base, FramePtr blend, FramePtr dst);
+
+  /**
+   * @brief Composite `src` over `color`, whose alpha is multiplied by `shadow`'s alpha at each pixel
+   */
+  static void Shadow(FramePtr src, FramePtr shadow, const QVector4D& color, FramePtr dst);
+
+  /**
+   * @brief Turn bilinear taps at fractional pixel offsets into the equivalent Kernel
+   *
+   * The blur shaders sample between pixels to halve their texture reads, folding their taps gives exactly the weights
+   * each whole pixel ends up with.
+   */
+  static Kernel FoldTaps(const QVector<float>& offsets, const QVector<float>& weights);
+
+  static void Convolve(FramePtr src, FramePtr dst, bool horizontal, const Kernel& kernel);
+
+private:
+  static void ForEachBand(int height, const std::function<void(int first_row, int last_row)>& function);
+
+  /**
+   * @brief Rows processed by one task, small enough that every thread gets some work on an HD frame
+   */
+  static const int kRowsPerBand;
+
+  /**
+   * @brief Limit on how many taps per axis Blit() averages when minifying
+   */
+  static const int kMaximumMinifyTaps;
+
+};
+
+#endif // CPURENDERFUNCTIONS_H
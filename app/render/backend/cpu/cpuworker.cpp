@@ -0,0 +1,422 @@
+#include "cpuworker.h"
+
+#include <cmath>
+#include <QColor>
+#include <QtMath>
+
+#include "cpurenderfunctions.h"
+#include "node/block/transition/transition.h"
+#include "node/node.h"
+#include "project/item/footage/footage.h"
+#include "project/item/footage/imagestream.h"
+#include "project/project.h"
+#include "render/colormanager.h"
+#include "render/pixelservice.h"
+
+namespace {
+
+const QString kVideoInputID = QStringLiteral("org.olivevideoeditor.Olive.videoinput");
+const QString kOpacityID = QStringLiteral("org.olivevideoeditor.Olive.opacity");
+const QString kSolidID = QStringLiteral("org.olivevideoeditor.Olive.solidgenerator");
+const QString kAlphaOverID = QStringLiteral("org.olivevideoeditor.Olive.alphaoverblend");
+const QString kCrossDissolveID = QStringLiteral("org.olivevideoeditor.Olive.crossdissolve");
+const QString kDipToBlackID = QStringLiteral("org.olivevideoeditor.Olive.diptoblack");
+const QString kBoxBlurID = QStringLiteral("org.olivevideoeditor.Olive.boxblur");
+const QString kGaussianBlurID = QStringLiteral("org.olivevideoeditor.Olive.gaussianblur");
+const QString kDropShadowID = QStringLiteral("org.olivevideoeditor.Olive.dropshadow");
+
+/**
+ * Same as gaussian2() in gaussianblur.frag
+ */
+float Gaussian2(float x, float y, float sigma)
+{
+  return (1.0f / (std::pow(sigma, 2.0f) * 2.0f * static_cast<float>(M_PI)))
+      * std::exp(-0.5f * ((std::pow(x, 2.0f) + std::pow(y, 2.0f)) / std::pow(sigma, 2.0f)));
+}
+
+}
+
+CPUWorker::CPUWorker(VideoRenderFrameCache *frame_cache, QObject *parent) :
+  VideoRenderWorker(frame_cache, parent)
+{
+}
+
+bool CPUWorker::CanRenderNode(const QString &id)
+{
+  return (id == kVideoInputID
+          || id == kOpacityID
+          || id == kSolidID
+          || id == kAlphaOverID
+          || id == kCrossDissolveID
+          || id == kDipToBlackID
+          || id == kBoxBlurID
+          || id == kGaussianBlurID
+          || id == kDropShadowID);
+}
+
+void CPUWorker::FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable *table)
+{
+  // Ensure stream is video or image type
+  if (stream->type() != Stream::kVideo && stream->type() != Stream::kImage) {
+    return;
+  }
+
+  ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
+
+  // Set up OCIO context
+  OCIO::ConstConfigRcPtr color_config = video_stream->footage()->project()->color_manager()->GetConfig();
+
+  QString color_id = ColorProcessor::GenerateID(color_config, video_stream->colorspace(), OCIO::ROLE_SCENE_LINEAR);
+
+  ColorProcessorPtr color_processor = color_cache()->Get(color_id);
+
+  if (!color_processor) {
+    color_processor = ColorProcessor::Create(color_config, video_stream->colorspace(), OCIO::ROLE_SCENE_LINEAR);
+    color_cache()->Add(color_id, color_processor);
+  }
+
+  rational sample_aspect_ratio = frame->sample_aspect_ratio();
+
+  // The decoder may still hold this frame, so if it's already float it has to be copied before it's changed in place
+  // (the copy shares its pixels until they're written to)
+  if (frame->format() == PixelFormat::PIX_FMT_RGBA32F) {
+    frame = std::make_shared<Frame>(*frame);
+  }
+
+  // There's no GPU for the fast OCIO path, so footage always goes through OCIO's CPU processor. Convert to float and
+  // disassociate alpha for the color transform in the same pass.
+  frame = PixelService::ConvertPixelFormat(frame,
+                                           PixelFormat::PIX_FMT_RGBA32F,
+                                           video_stream->premultiplied_alpha()
+                                           ? PixelKernels::kAlphaDisassociate : PixelKernels::kAlphaNone);
+
+  if (!frame) {
+    return;
+  }
+
+  color_processor->ConvertFrame(frame);
+
+  // Associate alpha
+  if (video_stream->premultiplied_alpha()) {
+    ColorManager::ReassociateAlpha(frame);
+  } else {
+    ColorManager::AssociateAlpha(frame);
+  }
+
+  // Kept for the video input to stretch non-square pixels with
+  frame->set_sample_aspect_ratio(sample_aspect_ratio);
+
+  table->Push(NodeParam::kTexture, QVariant::fromValue(frame));
+}
+
+void CPUWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, const NodeValueDatabase &input_params, NodeValueTable *output_params)
+{
+  if (!node->IsAccelerated()) {
+    return;
+  }
+
+  QString id = node->id();
+  FramePtr output;
+
+  if (id == kVideoInputID) {
+
+    output = RenderVideoInput(node, input_params);
+
+  } else if (id == kOpacityID) {
+
+    FramePtr tex = GetInputFrame(node, input_params, QStringLiteral("tex_in"));
+    output = CreateOutputFrame();
+
+    if (tex) {
+      CPURenderFunctions::Multiply(tex,
+                                   GetInputValue(node, input_params, QStringLiteral("opacity_in")).toFloat() * 0.01f,
+                                   output);
+    } else {
+      CPURenderFunctions::Fill(output, QVector4D());
+    }
+
+  } else if (id == kSolidID) {
+
+    QColor color = GetInputValue(node, input_params, QStringLiteral("color_in")).value<QColor>();
+    output = CreateOutputFrame();
+
+    CPURenderFunctions::Fill(output, QVector4D(static_cast<float>(color.redF()),
+                                               static_cast<float>(color.greenF()),
+                                               static_cast<float>(color.blueF()),
+                                               static_cast<float>(color.alphaF())));
+
+  } else if (id == kAlphaOverID) {
+
+    FramePtr base = GetInputFrame(node, input_params, QStringLiteral("base_in"));
+    FramePtr blend = GetInputFrame(node, input_params, QStringLiteral("blend_in"));
+
+    if (base && blend) {
+      output = CreateOutputFrame();
+      CPURenderFunctions::AlphaOver(base, blend, output);
+    } else if (base) {
+      output = base;
+    } else if (blend) {
+      output = blend;
+    } else {
+      output = CreateOutputFrame();
+      CPURenderFunctions::Fill(output, QVector4D());
+    }
+
+  } else if ((id == kCrossDissolveID || id == kDipToBlackID)
+             && node->IsBlock()
+             && static_cast<const Block*>(node)->type() == Block::kTransition) {
+
+    const TransitionBlock* transition_node = static_cast<const TransitionBlock*>(node);
+
+    FramePtr out_block = GetInputFrame(node, input_params, QStringLiteral("out_block_in"));
+    FramePtr in_block = GetInputFrame(node, input_params, QStringLiteral("in_block_in"));
+    output = CreateOutputFrame();
+
+    if (id == kCrossDissolveID) {
+      float progress = static_cast<float>(transition_node->GetTotalProgress(range.in()));
+
+      CPURenderFunctions::Mix(out_block, 1.0f - progress, in_block, progress, output);
+    } else {
+      float out_progress = static_cast<float>(transition_node->GetOutProgress(range.in()));
+      float in_progress = static_cast<float>(transition_node->GetInProgress(range.in()));
+
+      CPURenderFunctions::Mix(out_block, std::pow(out_progress, 2.0f), in_block, std::pow(in_progress, 2.0f), output);
+    }
+
+  } else if (id == kBoxBlurID || id == kGaussianBlurID) {
+
+    output = RenderBlur(node, input_params, (id == kGaussianBlurID));
+
+  } else if (id == kDropShadowID) {
+
+    output = RenderDropShadow(node, input_params);
+
+  } else {
+
+    // Not something we can render, CPUBackend warns about these when it compiles
+    return;
+
+  }
+
+  output_params->Push(NodeParam::kTexture, QVariant::fromValue(output));
+}
+
+void CPUWorker::TextureToBuffer(const QVariant &texture, QByteArray &buffer)
+{
+  FramePtr frame = CPURenderFunctions::MatchSize(texture.value<FramePtr>(),
+                                                 video_params().effective_width(),
+                                                 video_params().effective_height());
+
+  if (!frame) {
+    return;
+  }
+
+  if (video_params().format() == PixelFormat::PIX_FMT_RGBA32F) {
+    memcpy(buffer.data(), frame->const_data(), static_cast<size_t>(qMin(buffer.size(), frame->allocated_size())));
+  } else {
+    PixelService::ConvertPixelFormat(frame->const_data(),
+                                     PixelFormat::PIX_FMT_RGBA32F,
+                                     buffer.data(),
+                                     video_params().format(),
+                                     frame->width() * frame->height());
+  }
+}
+
+QVariant CPUWorker::GetInputValue(const Node *node, const NodeValueDatabase &input_params, const QString &id)
+{
+  foreach (NodeParam* param, node->parameters()) {
+    if (param->type() == NodeParam::kInput && param->id() == id) {
+      NodeInput* input = static_cast<NodeInput*>(param);
+
+      return node->InputValueFromTable(input, input_params[input]);
+    }
+  }
+
+  return QVariant();
+}
+
+FramePtr CPUWorker::GetInputFrame(const Node *node, const NodeValueDatabase &input_params, const QString &id)
+{
+  return CPURenderFunctions::MatchSize(GetInputValue(node, input_params, id).value<FramePtr>(),
+                                       video_params().effective_width(),
+                                       video_params().effective_height());
+}
+
+FramePtr CPUWorker::CreateOutputFrame()
+{
+  return CPURenderFunctions::CreateFrame(video_params().effective_width(), video_params().effective_height());
+}
+
+FramePtr CPUWorker::RenderSeparable(FramePtr src,
+                                    const QVector<float> &x_offsets,
+                                    const QVector<float> &y_offsets,
+                                    const QVector<float> &weights,
+                                    bool horizontal,
+                                    bool vertical)
+{
+  // Shaders offset by pixels of the full resolution (ove_resolution) while rendering at the effective resolution
+  float x_scale = static_cast<float>(video_params().effective_width()) / static_cast<float>(video_params().width());
+  float y_scale = static_cast<float>(video_params().effective_height()) / static_cast<float>(video_params().height());
+
+  FramePtr current = src;
+
+  if (horizontal) {
+    QVector<float> texel_offsets(x_offsets.size());
+
+    for (int i=0;i<x_offsets.size();i++) {
+      texel_offsets[i] = x_offsets.at(i) * x_scale;
+    }
+
+    FramePtr dst = CreateOutputFrame();
+    CPURenderFunctions::Convolve(current, dst, true, CPURenderFunctions::FoldTaps(texel_offsets, weights));
+    current = dst;
+  }
+
+  if (vertical) {
+    QVector<float> texel_offsets(y_offsets.size());
+
+    for (int i=0;i<y_offsets.size();i++) {
+      texel_offsets[i] = y_offsets.at(i) * y_scale;
+    }
+
+    FramePtr dst = CreateOutputFrame();
+    CPURenderFunctions::Convolve(current, dst, false, CPURenderFunctions::FoldTaps(texel_offsets, weights));
+    current = dst;
+  }
+
+  return current;
+}
+
+FramePtr CPUWorker::RenderVideoInput(const Node *node, const NodeValueDatabase &input_params)
+{
+  FramePtr footage = GetInputValue(node, input_params, QStringLiteral("footage_in")).value<FramePtr>();
+  FramePtr output = CreateOutputFrame();
+
+  if (!footage) {
+    CPURenderFunctions::Fill(output, QVector4D());
+    return output;
+  }
+
+  QMatrix4x4 matrix = GetInputValue(node, input_params, QStringLiteral("matrix_in")).value<QMatrix4x4>();
+
+  int footage_width = footage->width();
+  int footage_height = footage->height();
+
+  // Stretch non-square pixels the same way OpenGLWorker does, without reducing the resolution
+  if (footage->sample_aspect_ratio() != 1 && footage->sample_aspect_ratio() != 0) {
+    if (footage->sample_aspect_ratio() > 1) {
+      footage_width = qRound(static_cast<double>(footage_width) * footage->sample_aspect_ratio().toDouble());
+    } else {
+      footage_height = qRound(static_cast<double>(footage_height) / footage->sample_aspect_ratio().toDouble());
+    }
+  }
+
+  // Same transform as videoinput.vert
+  QMatrix4x4 transform;
+  transform.scale(1.0f / static_cast<float>(video_params().width()), 1.0f / static_cast<float>(video_params().height()));
+  transform *= matrix;
+  transform.scale(static_cast<float>(footage_width), static_cast<float>(footage_height));
+
+  CPURenderFunctions::Blit(footage, output, transform);
+
+  return output;
+}
+
+FramePtr CPUWorker::RenderBlur(const Node *node, const NodeValueDatabase &input_params, bool gaussian)
+{
+  FramePtr tex = GetInputFrame(node, input_params, QStringLiteral("tex_in"));
+
+  if (!tex) {
+    FramePtr output = CreateOutputFrame();
+    CPURenderFunctions::Fill(output, QVector4D());
+    return output;
+  }
+
+  bool horizontal = GetInputValue(node, input_params, QStringLiteral("horiz_in")).toBool();
+  bool vertical = GetInputValue(node, input_params, QStringLiteral("vert_in")).toBool();
+
+  float size = GetInputValue(node, input_params, gaussian ? QStringLiteral("sigma_in") : QStringLiteral("radius_in")).toFloat();
+
+  if (qIsNull(size) || (!horizontal && !vertical)) {
+    return tex;
+  }
+
+  // Same taps as boxblur.frag and gaussianblur.frag, which sample between each pair of pixels
+  float radius = gaussian ? std::ceil(3.0f * size) : std::ceil(size);
+
+  QVector<float> offsets;
+  QVector<float> weights;
+
+  for (float i=-radius+0.5f;i<=radius;i+=2.0f) {
+    offsets.append(i);
+    weights.append(gaussian ? Gaussian2(i, 0.0f, size) : 1.0f / radius);
+  }
+
+  if (gaussian) {
+    float sum = 0.0f;
+
+    foreach (float w, weights) {
+      sum += w;
+    }
+
+    for (int i=0;i<weights.size();i++) {
+      weights[i] /= sum;
+    }
+  }
+
+  return RenderSeparable(tex, offsets, offsets, weights, horizontal, vertical);
+}
+
+FramePtr CPUWorker::RenderDropShadow(const Node *node, const NodeValueDatabase &input_params)
+{
+  FramePtr tex = GetInputFrame(node, input_params, QStringLiteral("tex_in"));
+
+  if (!tex) {
+    tex = CreateOutputFrame();
+    CPURenderFunctions::Fill(tex, QVector4D());
+  }
+
+  QColor color = GetInputValue(node, input_params, QStringLiteral("color_in")).value<QColor>();
+  float softness = GetInputValue(node, input_params, QStringLiteral("softness_in")).toFloat();
+  float opacity = GetInputValue(node, input_params, QStringLiteral("opacity_in")).toFloat();
+  float distance = GetInputValue(node, input_params, QStringLiteral("distance_in")).toFloat();
+  float direction = qDegreesToRadians(GetInputValue(node, input_params, QStringLiteral("direction_in")).toFloat());
+
+  // Offset of the shadow, as in dropshadow.frag
+  float adjacent = std::cos(direction) * distance;
+  float opposite = std::sin(direction) * distance;
+
+  // The shader's soft shadow is a 2D box of taps with the same weight, so it can be done as two 1D passes
+  QVector<float> x_offsets;
+  QVector<float> y_offsets;
+  QVector<float> weights;
+
+  if (softness > 0) {
+    float radius = std::ceil(softness);
+    float divider = 1.0f / softness;
+
+    for (float i=-radius+0.5f;i<=radius;i+=2.0f) {
+      x_offsets.append(i - adjacent);
+      y_offsets.append(i - opposite);
+      weights.append(divider);
+    }
+  } else {
+    x_offsets.append(-adjacent);
+    y_offsets.append(-opposite);
+    weights.append(1.0f);
+  }
+
+  FramePtr shadow = RenderSeparable(tex, x_offsets, y_offsets, weights, true, true);
+
+  FramePtr output = CreateOutputFrame();
+
+  CPURenderFunctions::Shadow(tex,
+                             shadow,
+                             QVector4D(static_cast<float>(color.redF()),
+                                       static_cast<float>(color.greenF()),
+                                       static_cast<float>(color.blueF()),
+                                       opacity * 0.01f),
+                             output);
+
+  return output;
+}
@@ -0,0 +1,58 @@
+#ifndef CPUWORKER_H
+#define CPUWORKER_H
+
+#include "../videorenderworker.h"
+
+/**
+ * @brief A VideoRenderWorker that renders into RGBA32F Frames on the CPU instead of into OpenGL textures
+ *
+ * Values that would be textures with OpenGLWorker are FramePtrs at the effective resolution. Accelerated nodes are
+ * matched by ID to a function in CPURenderFunctions that mirrors their shader, so only the built-in ones are supported.
+ */
+class CPUWorker : public VideoRenderWorker {
+  Q_OBJECT
+public:
+  CPUWorker(VideoRenderFrameCache* frame_cache,
+            QObject* parent = nullptr);
+
+  /**
+   * @brief Returns whether there's a CPU implementation of the accelerated code for this Node ID
+   */
+  static bool CanRenderNode(const QString& id);
+
+protected:
+  virtual void FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable* table) override;
+
+  virtual void RunNodeAccelerated(const Node *node, const TimeRange &range, const NodeValueDatabase &input_params, NodeValueTable* output_params) override;
+
+  virtual void TextureToBuffer(const QVariant& texture, QByteArray& buffer) override;
+
+private:
+  static QVariant GetInputValue(const Node* node, const NodeValueDatabase& input_params, const QString& id);
+
+  /**
+   * @brief Get a texture input's Frame at the effective resolution, or null if it isn't connected
+   */
+  FramePtr GetInputFrame(const Node* node, const NodeValueDatabase& input_params, const QString& id);
+
+  FramePtr CreateOutputFrame();
+
+  /**
+   * @brief Run the horizontal and vertical passes of a blur shader, with its taps in pixels of the full resolution
+   */
+  FramePtr RenderSeparable(FramePtr src,
+                           const QVector<float>& x_offsets,
+                           const QVector<float>& y_offsets,
+                           const QVector<float>& weights,
+                           bool horizontal,
+                           bool vertical);
+
+  FramePtr RenderVideoInput(const Node* node, const NodeValueDatabase& input_params);
+
+  FramePtr RenderBlur(const Node* node, const NodeValueDatabase& input_params, bool gaussian);
+
+  FramePtr RenderDropShadow(const Node* node, const NodeValueDatabase& input_params);
+
+};
+
+#endif // CPUWORKER_H
@@ -0,0 +1,159 @@
+#include "decoderpool.h"
+
+#include <QDateTime>
+
+DecoderPool* DecoderPool::instance_ = nullptr;
+const double DecoderPool::kSequentialThreshold = 2.0;
+const int DecoderPool::kMaximumDecodersPerStream = 4;
+const qint64 DecoderPool::kIdleTimeout = 60000;
+
+void DecoderPool::CreateInstance()
+{
+  instance_ = new DecoderPool();
+}
+
+void DecoderPool::DestroyInstance()
+{
+  delete instance_;
+  instance_ = nullptr;
+}
+
+DecoderPool::DecoderPool()
+{
+  idle_timer_.setInterval(static_cast<int>(kIdleTimeout));
+  connect(&idle_timer_, &QTimer::timeout, this, &DecoderPool::IdleTimerTimeout);
+  idle_timer_.start();
+}
+
+DecoderPool *DecoderPool::instance()
+{
+  return instance_;
+}
+
+DecoderPtr DecoderPool::Get(StreamPtr stream, const rational &time)
+{
+  if (!stream) {
+    return nullptr;
+  }
+
+  double time_dbl = time.toDouble();
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+  QList<DecoderPtr> idle_decoders;
+
+  QMutexLocker locker(&lock_);
+
+  idle_decoders = RemoveIdleDecoders(now);
+
+  QList<Entry>& entries = decoders_[stream.get()];
+
+  // Find the decoder that will need to do the least work to reach this time
+  int best_index = -1;
+  double best_distance = 0;
+  bool best_is_sequential = false;
+
+  for (int i=0;i<entries.size();i++) {
+    double distance = time_dbl - entries.at(i).last_time;
+    bool is_sequential = (distance >= 0 && distance <= kSequentialThreshold);
+
+    distance = qAbs(distance);
+
+    if (best_index == -1
+        || (is_sequential && !best_is_sequential)
+        || (is_sequential == best_is_sequential && distance < best_distance)) {
+      best_index = i;
+      best_distance = distance;
+      best_is_sequential = is_sequential;
+    }
+  }
+
+  // If no decoder is close to this time, open another one (within reason) rather than seek one that's in use elsewhere
+  if (best_index == -1
+      || (!best_is_sequential && entries.size() < kMaximumDecodersPerStream)) {
+    DecoderPtr decoder = Decoder::CreateFromID(stream->footage()->decoder());
+
+    if (!decoder) {
+      return nullptr;
+    }
+
+    decoder->set_stream(stream);
+
+    entries.append({decoder, time_dbl, now});
+
+    return decoder;
+  }
+
+  Entry& best = entries[best_index];
+
+  best.last_time = time_dbl;
+  best.last_access = now;
+
+  return best.decoder;
+}
+
+DecoderPtr DecoderPool::Peek(StreamPtr stream)
+{
+  if (!stream) {
+    return nullptr;
+  }
+
+  QMutexLocker locker(&lock_);
+
+  QList<Entry>& entries = decoders_[stream.get()];
+
+  if (!entries.isEmpty()) {
+    return entries.first().decoder;
+  }
+
+  DecoderPtr decoder = Decoder::CreateFromID(stream->footage()->decoder());
+
+  if (!decoder) {
+    return nullptr;
+  }
+
+  decoder->set_stream(stream);
+
+  // Hasn't been positioned anywhere yet, so any time is as good as the start
+  entries.append({decoder, 0, QDateTime::currentMSecsSinceEpoch()});
+
+  return decoder;
+}
+
+QList<DecoderPtr> DecoderPool::RemoveIdleDecoders(qint64 now)
+{
+  QList<DecoderPtr> removed;
+
+  QHash<Stream*, QList<Entry> >::iterator i = decoders_.begin();
+
+  while (i != decoders_.end()) {
+    QList<Entry>& entries = i.value();
+
+    for (int j=0;j<entries.size();j++) {
+      if (now - entries.at(j).last_access > kIdleTimeout) {
+        removed.append(entries.takeAt(j).decoder);
+        j--;
+      }
+    }
+
+    if (entries.isEmpty()) {
+      i = decoders_.erase(i);
+    } else {
+      i++;
+    }
+  }
+
+  return removed;
+}
+
+void DecoderPool::IdleTimerTimeout()
+{
+  QList<DecoderPtr> idle_decoders;
+
+  {
+    QMutexLocker locker(&lock_);
+
+    idle_decoders = RemoveIdleDecoders(QDateTime::currentMSecsSinceEpoch());
+  }
+
+  // Decoders nothing else is holding are closed here, outside the lock
+}
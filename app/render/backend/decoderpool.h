@@ -0,0 +1,96 @@
+#ifndef DECODERPOOL_H
+#define DECODERPOOL_H
+
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+
+#include "codec/decoder.h"
+#include "project/item/footage/stream.h"
+
+/**
+ * @brief Process-wide pool of open decoders shared by every render worker
+ *
+ * Previously each RenderWorker kept its own decoders, so N workers would open N demuxers for the same stream and
+ * constantly seek over each other. The pool instead keeps a small number of decoders per stream and hands out the one
+ * whose last requested position is closest to the new request, so sequential access (playback/export) keeps hitting
+ * the same decoder and its read-ahead buffer.
+ *
+ * Decoders returned from here are shared between threads and must therefore be thread-safe.
+ */
+class DecoderPool : public QObject
+{
+  Q_OBJECT
+public:
+  static void CreateInstance();
+
+  static void DestroyInstance();
+
+  static DecoderPool* instance();
+
+  /**
+   * @brief Retrieve a decoder for `stream` that is well placed to retrieve data at `time`
+   *
+   * @return
+   *
+   * A decoder or nullptr if no decoder could be created for this stream.
+   */
+  DecoderPtr Get(StreamPtr stream, const rational& time);
+
+  /**
+   * @brief Retrieve any decoder for `stream` without claiming it for a position
+   *
+   * For queries that don't move the decoder (e.g. GetTimestampFromTime()), so the pool's idea of where its decoders
+   * are stays accurate.
+   */
+  DecoderPtr Peek(StreamPtr stream);
+
+private:
+  DecoderPool();
+
+  /**
+   * @brief Remove decoders that haven't been used for a while so their file handles and memory are freed
+   *
+   * Must be called with lock_ held. The removed decoders are returned so the caller can release them after unlocking,
+   * closing a decoder can take a while.
+   */
+  QList<DecoderPtr> RemoveIdleDecoders(qint64 now);
+
+  struct Entry {
+    DecoderPtr decoder;
+    double last_time;
+    qint64 last_access;
+  };
+
+  /**
+   * @brief Maximum distance (in seconds) ahead of a decoder's last position that's considered sequential access
+   */
+  static const double kSequentialThreshold;
+
+  /**
+   * @brief Maximum number of decoders that will be opened for a single stream
+   */
+  static const int kMaximumDecodersPerStream;
+
+  /**
+   * @brief Time (in milliseconds) after which an unused decoder is closed
+   */
+  static const qint64 kIdleTimeout;
+
+  static DecoderPool* instance_;
+
+  QHash<Stream*, QList<Entry> > decoders_;
+
+  QMutex lock_;
+
+  /**
+   * @brief Periodically removes idle decoders, since Get() only does so when something is requested
+   */
+  QTimer idle_timer_;
+
+private slots:
+  void IdleTimerTimeout();
+
+};
+
+#endif // DECODERPOOL_H
@@ -3,6 +3,8 @@
 #include "render/colormanager.h"
 #include "render/pixelservice.h"
 
+const int Exporter::kMaximumDownloadsInFlight = 3;
+
 Exporter::Exporter(ViewerOutput* viewer,
                    Encoder *encoder,
                    QObject* parent) :
@@ -14,11 +16,26 @@ Exporter::Exporter(ViewerOutput* viewer,
   audio_done_(true),
   encoder_(encoder),
   export_status_(false),
-  export_msg_(tr("Export hasn't started yet"))
+  export_msg_(tr("Export hasn't started yet")),
+  unique_frame_count_(0),
+  total_frame_count_(0),
+  video_flushed_(false),
+  pipeline_slots_(kMaximumDownloadsInFlight + 2 * QThread::idealThreadCount())
 {
   connect(this, &Exporter::ExportEnded, this, &Exporter::deleteLater);
 }
 
+Exporter::~Exporter()
+{
+  color_pool_.waitForDone();
+
+  encoder_thread_.quit();
+  encoder_thread_.wait();
+
+  // The encoder was never closed, its thread has stopped so it's safe to delete from here
+  delete encoder_;
+}
+
 void Exporter::EnableVideo(const VideoRenderingParams &video_params, const QMatrix4x4 &transform, ColorProcessorPtr color_processor)
 {
   video_params_ = video_params;
@@ -35,6 +52,11 @@ void Exporter::EnableAudio(const AudioRenderingParams &audio_params)
   audio_done_ = false;
 }
 
+void Exporter::SetExportRange(const TimeRange &range)
+{
+  export_range_ = range;
+}
+
 bool Exporter::GetExportStatus() const
 {
   return export_status_;
@@ -45,11 +67,26 @@ const QString &Exporter::GetExportError() const
   return export_msg_;
 }
 
+int Exporter::GetUniqueFrameCount() const
+{
+  return unique_frame_count_;
+}
+
+int Exporter::GetTotalFrameCount() const
+{
+  return total_frame_count_;
+}
+
 void Exporter::StartExporting()
 {
   // Default to error state until ExportEnd is called
   export_status_ = false;
 
+  // Export the whole Sequence unless a range was set
+  if (export_range_.length() == 0) {
+    export_range_ = TimeRange(0, viewer_node_->Length());
+  }
+
   // Create renderers
   if (!Initialize()) {
     SetExportMessage("Failed to initialize exporter");
@@ -66,7 +103,7 @@ void Exporter::StartExporting()
                                                        video_params_.format(),
                                                        video_params_.mode()));
 
-    waiting_for_frame_ = 0;
+    waiting_for_frame_ = export_range_.in();
   }
 
   if (!audio_done_) {
@@ -74,11 +111,18 @@ void Exporter::StartExporting()
     audio_backend_->SetParameters(audio_params_);
   }
 
+  // Run the encoder in its own thread
+  encoder_->moveToThread(&encoder_thread_);
+  encoder_thread_.start();
+
   // Open encoder and wait for result
   connect(encoder_, &Encoder::OpenSucceeded, this, &Exporter::EncoderOpenedSuccessfully, Qt::QueuedConnection);
   connect(encoder_, &Encoder::OpenFailed, this, &Exporter::EncoderOpenFailed, Qt::QueuedConnection);
   connect(encoder_, &Encoder::AudioComplete, this, &Exporter::AudioEncodeComplete, Qt::QueuedConnection);
-  connect(encoder_, &Encoder::Closed, encoder_, &Encoder::deleteLater, Qt::QueuedConnection);
+  connect(encoder_, &Encoder::FrameWritten, this, &Exporter::EncoderWroteFrame, Qt::DirectConnection);
+
+  // Direct so the deletion is posted before EncoderClosed() stops the thread (which still processes deferred deletes)
+  connect(encoder_, &Encoder::Closed, encoder_, &Encoder::deleteLater, Qt::DirectConnection);
 
   QMetaObject::invokeMethod(encoder_,
                             "Open",
@@ -118,54 +162,99 @@ void Exporter::ExportFailed()
 
 void Exporter::EncodeFrame(const rational &time, QVariant value)
 {
+  cached_frames_.insert(time, value);
+
   if (time == waiting_for_frame_) {
-    bool get_cached = false;
+    SendFramesToPipeline();
+  }
+}
 
-    do {
-      if (get_cached) {
-        value = cached_frames_.take(waiting_for_frame_);
-      } else {
-        get_cached = true;
-      }
+void Exporter::SendFramesToPipeline()
+{
+  while (cached_frames_.contains(waiting_for_frame_)) {
+    // This runs on the GUI thread so it never waits for room, EncoderWroteFrame() calls it again once there is some
+    if (!pipeline_slots_.tryAcquire()) {
+      return;
+    }
 
-      // Convert texture to frame
-      FramePtr frame = TextureToFrame(value);
+    // Start reading this frame back. This returns before the transfer is done.
+    DownloadTexture(cached_frames_.take(waiting_for_frame_));
+    downloading_frames_.enqueue(waiting_for_frame_);
 
-      // OCIO conversion requires a frame in 32F format
-      if (frame->format() != PixelFormat::PIX_FMT_RGBA32F) {
-        frame = PixelService::ConvertPixelFormat(frame, PixelFormat::PIX_FMT_RGBA32F);
-      }
+    // Leave a few downloads in flight so the transfer overlaps with rendering the next frames
+    if (downloading_frames_.size() > kMaximumDownloadsInFlight) {
+      ConvertDownloadedFrame();
+    }
+
+    waiting_for_frame_ += video_params_.time_base();
+
+    // Calculate progress
+    int progress = qRound(100.0 * ((waiting_for_frame_ - export_range_.in()).toDouble()
+                                   / export_range_.length().toDouble()));
+    emit ProgressChanged(progress);
+  }
 
-      // Color conversion must be done with unassociated alpha, and the pipeline is always associated
-      ColorManager::DisassociateAlpha(frame);
+  if (!video_flushed_ && waiting_for_frame_ >= export_range_.out()) {
+    // Hand the last downloads to the color workers, ColorJobsDrained() finishes up once they've all been encoded
+    while (!downloading_frames_.isEmpty()) {
+      ConvertDownloadedFrame();
+    }
 
-      // Convert color space
-      color_processor_->ConvertFrame(frame);
+    video_flushed_ = true;
 
-      // Set frame timestamp
-      frame->set_timestamp(waiting_for_frame_);
+    ColorJobsDrained();
+  }
+}
 
-      // Encode (may require re-associating alpha?)
-      QMetaObject::invokeMethod(encoder_,
-                                "WriteFrame",
-                                Qt::QueuedConnection,
-                                Q_ARG(FramePtr, frame));
+void Exporter::ConvertDownloadedFrame()
+{
+  rational time = downloading_frames_.dequeue();
 
-      waiting_for_frame_ += video_params_.time_base();
+  FramePtr frame = RetrieveDownloadedFrame();
 
-      // Calculate progress
-      int progress = qRound(100.0 * (waiting_for_frame_.toDouble() / viewer_node_->Length().toDouble()));
-      emit ProgressChanged(progress);
+  // Set frame timestamp (relative to the start of the export)
+  frame->set_timestamp(time - export_range_.in());
 
-    } while (cached_frames_.contains(waiting_for_frame_));
+  ColorJobPtr job = std::make_shared<ColorJob>();
+  job->frame = frame;
+  job->done = false;
 
-    if (waiting_for_frame_ >= viewer_node_->Length()) {
-      video_done_ = true;
+  color_jobs_lock_.lock();
+  color_jobs_.enqueue(job);
+  color_jobs_lock_.unlock();
 
-      ExportSucceeded();
-    }
-  } else {
-    cached_frames_.insert(time, value);
+  color_pool_.start(new ColorTask(this, job));
+}
+
+FramePtr Exporter::ConvertFrameColor(FramePtr frame)
+{
+  // OCIO conversion requires a frame in 32F format, and color conversion must be done with unassociated alpha while
+  // the pipeline is always associated. Both are done in one pass.
+  frame = PixelService::ConvertPixelFormat(frame, PixelFormat::PIX_FMT_RGBA32F, PixelKernels::kAlphaDisassociate);
+
+  // Convert color space
+  color_processor_->ConvertFrame(frame);
+
+  // Encode (may require re-associating alpha?)
+  return frame;
+}
+
+void Exporter::ColorJobFinished(ColorJobPtr job)
+{
+  QMutexLocker locker(&color_jobs_lock_);
+
+  job->done = true;
+
+  // Workers can finish out of order, so only pass on frames once everything before them is done too
+  while (!color_jobs_.isEmpty() && color_jobs_.first()->done) {
+    QMetaObject::invokeMethod(encoder_,
+                              "WriteFrame",
+                              Qt::QueuedConnection,
+                              Q_ARG(FramePtr, color_jobs_.dequeue()->frame));
+  }
+
+  if (color_jobs_.isEmpty()) {
+    QMetaObject::invokeMethod(this, "ColorJobsDrained", Qt::QueuedConnection);
   }
 }
 
@@ -195,7 +284,8 @@ void Exporter::AudioRendered()
                             "WriteAudio",
                             Qt::QueuedConnection,
                             Q_ARG(const AudioRenderingParams&, audio_backend_->params()),
-                            Q_ARG(const QString&, cache_fn));
+                            Q_ARG(const QString&, cache_fn),
+                            Q_ARG(const TimeRange&, export_range_));
 
   // We don't need the audio backend anymore
   audio_backend_->deleteLater();
@@ -216,14 +306,14 @@ void Exporter::EncoderOpenedSuccessfully()
     video_backend_->SetOperatingMode(VideoRenderWorker::kHashOnly);
     connect(video_backend_, &VideoRenderBackend::QueueComplete, this, &Exporter::VideoHashesComplete);
 
-    video_backend_->InvalidateCache(0, viewer_node_->Length());
+    video_backend_->InvalidateCache(export_range_.in(), export_range_.out());
   }
 
   if (!audio_done_) {
     // We set the audio backend to render the full sequence to the disk
     connect(audio_backend_, &AudioRenderBackend::QueueComplete, this, &Exporter::AudioRendered);
 
-    audio_backend_->InvalidateCache(0, viewer_node_->Length());
+    audio_backend_->InvalidateCache(export_range_.in(), export_range_.out());
   }
 }
 
@@ -235,6 +325,9 @@ void Exporter::EncoderOpenFailed()
 
 void Exporter::EncoderClosed()
 {
+  encoder_thread_.quit();
+  encoder_thread_.wait();
+
   emit ProgressChanged(100);
   emit ExportEnded();
 }
@@ -244,34 +337,56 @@ void Exporter::VideoHashesComplete()
   // We've got our hashes, time to kick off actual rendering
   disconnect(video_backend_, &VideoRenderBackend::QueueComplete, this, &Exporter::VideoHashesComplete);
 
-  // Determine what frames will be hashed
+  const QMap<rational, QByteArray>& time_hash_map = video_backend_->frame_cache()->time_hash_map();
+  const rational& time_base = video_backend_->params().time_base();
+
+  // The first time each hash appears gets rendered, later times with the same hash reuse that frame
+  // (see FrameRendered()). Walking the frames in order lets us build the ranges to render directly.
+  QHash<QByteArray, rational> first_time_with_hash;
+  QMap<rational, QByteArray>::const_iterator hash_iterator = time_hash_map.lowerBound(export_range_.in());
+
   TimeRangeList ranges;
-  ranges.append(TimeRange(0, viewer_node_->Length()));
+  rational range_in;
+  rational range_out;
+
+  unique_frame_count_ = 0;
+  total_frame_count_ = 0;
 
-  QMap<rational, QByteArray>::const_iterator i;
-  QMap<rational, QByteArray>::iterator j;
+  for (rational t=export_range_.in(); t<export_range_.out(); t+=time_base) {
+    total_frame_count_++;
 
-  // Copy time hash map
-  QMap<rational, QByteArray> time_hash_map = video_backend_->frame_cache()->time_hash_map();
+    while (hash_iterator != time_hash_map.constEnd() && hash_iterator.key() < t) {
+      hash_iterator++;
+    }
 
-  // Check for any times that share duplicate hashes
-  for (i=time_hash_map.begin();i!=time_hash_map.end();i++) {
-    j = time_hash_map.begin();
+    if (hash_iterator != time_hash_map.constEnd() && hash_iterator.key() == t) {
+      QHash<QByteArray, rational>::const_iterator first = first_time_with_hash.constFind(hash_iterator.value());
+
+      if (first != first_time_with_hash.constEnd()) {
+        // Duplicate of an earlier frame, no need to render it
+        matched_frames_[hash_iterator.value()].append(t);
+        continue;
+      }
 
-    while (j != time_hash_map.end()) {
-      if (i != j && i.value() == j.value()) {
-        // Remove the time range from this and
-        ranges.RemoveTimeRange(TimeRange(j.key(), j.key() + video_backend_->params().time_base()));
+      first_time_with_hash.insert(hash_iterator.value(), t);
+    }
 
-        QList<rational> times_with_this_hash = matched_frames_.value(i.value());
-        times_with_this_hash.append(j.key());
-        matched_frames_.insert(i.value(), times_with_this_hash);
+    // This frame needs rendering (frames without a hash are always rendered), extend the current range or start one
+    unique_frame_count_++;
 
-        j = time_hash_map.erase(j);
-      } else {
-        j++;
+    if (range_in == range_out || range_out != t) {
+      if (range_in != range_out) {
+        ranges.append(TimeRange(range_in, range_out));
       }
+
+      range_in = t;
     }
+
+    range_out = t + time_base;
+  }
+
+  if (range_in != range_out) {
+    ranges.append(TimeRange(range_in, range_out));
   }
 
   // Set video backend to render mode but NOT hash or download
@@ -280,7 +395,44 @@ void Exporter::VideoHashesComplete()
 
   connect(video_backend_, &VideoRenderBackend::CachedFrameReady, this, &Exporter::FrameRendered);
 
-  foreach (const TimeRange& range, ranges) {
-    video_backend_->InvalidateCache(range.in(), range.out());
+  video_backend_->InvalidateCacheRanges(ranges);
+}
+
+void Exporter::EncoderWroteFrame()
+{
+  // Called from the encoder thread
+  pipeline_slots_.release();
+
+  QMetaObject::invokeMethod(this, "SendFramesToPipeline", Qt::QueuedConnection);
+}
+
+void Exporter::ColorJobsDrained()
+{
+  if (video_done_ || !video_flushed_) {
+    return;
   }
+
+  color_jobs_lock_.lock();
+  bool drained = color_jobs_.isEmpty();
+  color_jobs_lock_.unlock();
+
+  // Every WriteFrame() has been queued on the encoder by now, so the Close() queued after it runs last
+  if (drained) {
+    video_done_ = true;
+
+    ExportSucceeded();
+  }
+}
+
+Exporter::ColorTask::ColorTask(Exporter *exporter, ColorJobPtr job) :
+  exporter_(exporter),
+  job_(job)
+{
+}
+
+void Exporter::ColorTask::run()
+{
+  job_->frame = exporter_->ConvertFrameColor(job_->frame);
+
+  exporter_->ColorJobFinished(job_);
 }
@@ -2,10 +2,18 @@
 #define EXPORTER_H
 
 #include <QMatrix4x4>
-#include <QString>
+#include <QMutex>
 #include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QThreadPool>
 
 #include "codec/encoder.h"
+#include "common/timerange.h"
 #include "node/output/viewer/viewer.h"
 #include "render/backend/audiorenderbackend.h"
 #include "render/backend/videorenderbackend.h"
@@ -19,12 +27,29 @@ public:
            Encoder* encoder,
            QObject* parent = nullptr);
 
+  virtual ~Exporter() override;
+
   void EnableVideo(const VideoRenderingParams& video_params, const QMatrix4x4& transform, ColorProcessorPtr color_processor);
   void EnableAudio(const AudioRenderingParams& audio_params);
 
+  /**
+   * @brief Export only part of the Sequence (defaults to its entire length)
+   */
+  void SetExportRange(const TimeRange& range);
+
   bool GetExportStatus() const;
   const QString& GetExportError() const;
 
+  /**
+   * @brief Number of frames that were actually rendered, i.e. the frames that didn't share a hash with an earlier one
+   */
+  int GetUniqueFrameCount() const;
+
+  /**
+   * @brief Number of frames in the exported range
+   */
+  int GetTotalFrameCount() const;
+
 public slots:
   void StartExporting();
 
@@ -37,7 +62,18 @@ protected:
   virtual bool Initialize() = 0;
   virtual void Cleanup() = 0;
 
-  virtual FramePtr TextureToFrame(const QVariant &texture) = 0;
+  /**
+   * @brief Start downloading a rendered texture into system memory
+   *
+   * Should return without waiting for the transfer to complete. Downloads are retrieved in the order they were
+   * started with RetrieveDownloadedFrame().
+   */
+  virtual void DownloadTexture(const QVariant &texture) = 0;
+
+  /**
+   * @brief Retrieve the oldest download started with DownloadTexture(), waiting for it to complete if necessary
+   */
+  virtual FramePtr RetrieveDownloadedFrame() = 0;
 
   void SetExportMessage(const QString& s);
 
@@ -60,26 +96,114 @@ protected:
   bool audio_done_;
 
 private:
+  /**
+   * @brief A frame passing through the color conversion workers
+   */
+  struct ColorJob {
+    FramePtr frame;
+    bool done;
+  };
+
+  using ColorJobPtr = std::shared_ptr<ColorJob>;
+
+  /**
+   * @brief Runs ConvertFrameColor() on the color worker pool
+   */
+  class ColorTask : public QRunnable
+  {
+  public:
+    ColorTask(Exporter* exporter, ColorJobPtr job);
+
+    virtual void run() override;
+
+  private:
+    Exporter* exporter_;
+
+    ColorJobPtr job_;
+  };
+
+  /**
+   * @brief Maximum number of GPU downloads left in flight before the oldest is waited on
+   */
+  static const int kMaximumDownloadsInFlight;
+
   void ExportSucceeded();
 
   void ExportFailed();
 
   void EncodeFrame(const rational &time, QVariant value);
 
+  /**
+   * @brief Pass the oldest finished download on to the color workers
+   */
+  void ConvertDownloadedFrame();
+
+  /**
+   * @brief Convert a frame to the export's color space (runs on the color worker pool)
+   */
+  FramePtr ConvertFrameColor(FramePtr frame);
+
+  /**
+   * @brief Called from a color worker when its job is done, queues any finished frames on the encoder in order
+   */
+  void ColorJobFinished(ColorJobPtr job);
+
   ColorProcessorPtr color_processor_;
 
-  Encoder* encoder_;
+  /**
+   * @brief Deletes itself once closed, anything left (e.g. after a failed export) is deleted with the exporter
+   */
+  QPointer<Encoder> encoder_;
 
   bool export_status_;
 
   QString export_msg_;
 
+  int unique_frame_count_;
+
+  int total_frame_count_;
+
+  /**
+   * @brief Set once every frame has been handed to the color workers, the export finishes when they've drained
+   */
+  bool video_flushed_;
+
   rational waiting_for_frame_;
 
+  TimeRange export_range_;
+
   QHash<rational, QVariant> cached_frames_;
 
   QHash< QByteArray, QList<rational> > matched_frames_;
 
+  /**
+   * @brief Times of frames that have been sent to DownloadTexture() but not retrieved yet
+   */
+  QQueue<rational> downloading_frames_;
+
+  /**
+   * @brief Frames in color conversion, in the order they need to be encoded
+   */
+  QQueue<ColorJobPtr> color_jobs_;
+
+  QMutex color_jobs_lock_;
+
+  QThreadPool color_pool_;
+
+  /**
+   * @brief Bounds how many frames can be anywhere in the pipeline between download and encode
+   *
+   * Acquired when a download starts and released once the encoder has written the frame, so a slow stage stalls the
+   * ones before it rather than letting frames pile up in memory. It's never waited on, frames that don't get a slot
+   * stay in cached_frames_ until the encoder makes room (see SendFramesToPipeline()).
+   */
+  QSemaphore pipeline_slots_;
+
+  /**
+   * @brief Thread the encoder runs in so encoding overlaps with rendering and color conversion
+   */
+  QThread encoder_thread_;
+
 private slots:
   void FrameRendered(const rational& time, QVariant value);
 
@@ -93,8 +217,20 @@ private slots:
 
   void EncoderClosed();
 
+  void EncoderWroteFrame();
+
   void VideoHashesComplete();
 
+  /**
+   * @brief Start downloading cached frames in order for as long as there's room in the pipeline
+   */
+  void SendFramesToPipeline();
+
+  /**
+   * @brief Finishes the video once the color workers have queued every frame on the encoder
+   */
+  void ColorJobsDrained();
+
 };
 
 #endif // EXPORTER_H
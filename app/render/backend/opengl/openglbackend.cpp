@@ -3,12 +3,17 @@
 #include <QEventLoop>
 #include <QThread>
 
+#include "common/filefunctions.h"
+#include "config/config.h"
 #include "openglrenderfunctions.h"
+#include "render/diskmanager.h"
+
+const int OpenGLBackend::kTexturePoolSize = 8;
 
 OpenGLBackend::OpenGLBackend(QObject *parent) :
-  VideoRenderBackend(parent),
-  master_texture_(nullptr)
+  VideoRenderBackend(parent)
 {
+  connect(&shader_compiler_, &OpenGLShaderCompiler::CompileFailed, this, &OpenGLBackend::ShaderCompileFailed);
 }
 
 OpenGLBackend::~OpenGLBackend()
@@ -29,23 +34,30 @@ bool OpenGLBackend::InitInternal()
     return false;
   }
 
+  UpdateTextureCacheBudget();
+
+  // The compiler and workers would otherwise read the config from their own threads
+  QString shader_cache_dir = GetShaderCacheLocation();
+  OpenGLShader::PruneBinaryCache(shader_cache_dir);
+
+  // Not fatal if this fails, workers will compile everything themselves
+  shader_compiler_.Start(share_ctx, shader_cache_dir);
+
   // Initiate one thread per CPU core
   for (int i=0;i<threads().size();i++) {
     // Create one processor object for each thread
-    OpenGLWorker* processor = new OpenGLWorker(share_ctx, &shader_cache_, &texture_cache_, frame_cache());
+    OpenGLWorker* processor = new OpenGLWorker(share_ctx,
+                                               &shader_compiler_,
+                                               shader_cache_dir,
+                                               &texture_cache_,
+                                               frame_cache());
     processor->SetParameters(params());
     processors_.append(processor);
   }
 
-  // Create master texture (the one sent to the viewer)
-  master_texture_ = std::make_shared<OpenGLTexture>();
-  master_texture_->Create(share_ctx,
-                          params().effective_width(),
-                          params().effective_height(),
-                          params().format());
-
   // Create copy buffer/pipeline
   copy_buffer_.Create(share_ctx);
+  uploader_.Create(share_ctx);
   copy_pipeline_ = OpenGLShader::CreateDefault();
 
   return true;
@@ -53,21 +65,73 @@ bool OpenGLBackend::InitInternal()
 
 void OpenGLBackend::CloseInternal()
 {
+  shader_compiler_.Stop();
+
   copy_buffer_.Destroy();
+  uploader_.Destroy();
   copy_pipeline_ = nullptr;
-  master_texture_ = nullptr;
+  texture_pool_.clear();
 }
 
 OpenGLTexturePtr OpenGLBackend::GetCachedFrameAsTexture(const rational &time)
 {
-  const char* cached_frame = GetCachedFrame(time);
+  // Pick up changes to the setting, like VideoRenderBackend does for the memory cache
+  UpdateTextureCacheBudget();
+
+  QByteArray hash = GetCachedFrameHash(time);
 
-  if (cached_frame) {
-    master_texture_->Upload(cached_frame);
-    return master_texture_;
+  if (hash.isEmpty()) {
+    return nullptr;
   }
 
-  return nullptr;
+  // See if this frame is still uploaded from a recent request
+  for (int i=0;i<texture_pool_.size();i++) {
+    if (texture_pool_.at(i).hash == hash) {
+      PooledTexture pooled = texture_pool_.takeAt(i);
+      texture_pool_.append(pooled);
+
+      // Keep the disk cache's usage order up to date even though we didn't need the file
+      DiskManager::instance()->Accessed(hash);
+
+      return pooled.texture;
+    }
+  }
+
+  const char* cached_frame = GetCachedFrameData(hash);
+
+  if (!cached_frame) {
+    return nullptr;
+  }
+
+  OpenGLTexturePtr texture;
+
+  if (texture_pool_.size() >= kTexturePoolSize) {
+    // Reuse the least recently shown texture if nothing else is holding onto it
+    PooledTexture oldest = texture_pool_.takeFirst();
+
+    if (oldest.texture.use_count() == 1) {
+      texture = oldest.texture;
+    }
+  }
+
+  if (!texture) {
+    texture = std::make_shared<OpenGLTexture>();
+    texture->Create(QOpenGLContext::currentContext(),
+                    params().effective_width(),
+                    params().effective_height(),
+                    params().format());
+  }
+
+  uploader_.Upload(texture.get(), cached_frame);
+
+  texture_pool_.append({hash, texture});
+
+  return texture;
+}
+
+OpenGLTextureCache::Statistics OpenGLBackend::GetTextureCacheStatistics()
+{
+  return texture_cache_.GetStatistics();
 }
 
 bool OpenGLBackend::CompileInternal()
@@ -82,56 +146,12 @@ bool OpenGLBackend::CompileInternal()
   QList<Node*> nodes = viewer_node()->GetDependencies();
 
   foreach (Node* n, nodes) {
-    // Check if we have a shader or not
-    if (!shader_cache_.Has(n->id()))  {
-      // Since we don't have a shader, compile one now
-
-      // If the node has no code, it mustn't be GPU accelerated
-      if (!n->IsAccelerated()) {
-        // We enter a null shader so we don't try to compile this again
-        shader_cache_.Add(n->id(), nullptr);
-      } else {
-        // Since we have shader code, compile it now
-        OpenGLShaderPtr program;
-
-        QString frag_code = n->AcceleratedCodeFragment();
-        QString vert_code = n->AcceleratedCodeVertex();
-
-        if (frag_code.isEmpty()) {
-          frag_code = OpenGLShader::CodeDefaultFragment();
-        }
-
-        if (vert_code.isEmpty()) {
-          vert_code = OpenGLShader::CodeDefaultVertex();
-        }
-
-        if (!(program = std::make_shared<OpenGLShader>())) {
-          SetError(QStringLiteral("Failed to create OpenGL shader object"));
-          return false;
-        }
-
-        if (!program->create()) {
-          SetError(QStringLiteral("Failed to create OpenGL shader on device"));
-          return false;
-        }
-
-        if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, frag_code)) {
-          SetError(QStringLiteral("Failed to add OpenGL fragment shader code"));
-          return false;
-        }
-
-        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vert_code)) {
-          SetError(QStringLiteral("Failed to add OpenGL vertex shader code"));
-          return false;
-        }
-
-        if (!program->link()) {
-          SetError(QStringLiteral("Failed to compile OpenGL shader: %1").arg(program->log()));
-          return false;
-        }
-
-        shader_cache_.Add(n->id(), program);
-      }
+    if (n->IsAccelerated() && !compiled_ids_.contains(n->id())) {
+      // Link in the background so the main thread never waits on it, workers that get to this node before it's done
+      // will wait for it instead
+      shader_compiler_.Compile(n->id(), n->AcceleratedCodeVertex(), n->AcceleratedCodeFragment());
+
+      compiled_ids_.insert(n->id());
     }
   }
 
@@ -140,7 +160,7 @@ bool OpenGLBackend::CompileInternal()
 
 void OpenGLBackend::DecompileInternal()
 {
-  shader_cache_.Clear();
+  compiled_ids_.clear();
 }
 
 void OpenGLBackend::EmitCachedFrameReady(const rational &time, const QVariant &value, qint64 job_time)
@@ -159,14 +179,23 @@ void OpenGLBackend::EmitCachedFrameReady(const rational &time, const QVariant &v
 
 void OpenGLBackend::ParamsChangedEvent()
 {
-  // If we're initiated, we need to recreate the texture. Otherwise this backend isn't active so it doesn't matter.
-  if (IsInitiated()) {
-    master_texture_->Destroy();
-    master_texture_->Create(QOpenGLContext::currentContext(),
-                            params().effective_width(),
-                            params().effective_height(),
-                            params().format());
-  }
+  // Textures in the pool were created with the old parameters
+  texture_pool_.clear();
+
+  UpdateTextureCacheBudget();
+}
+
+void OpenGLBackend::ShaderCompileFailed(const QString &id, const QString &error)
+{
+  qWarning() << "Failed to compile shader for" << id;
+
+  SetError(error);
+}
+
+void OpenGLBackend::UpdateTextureCacheBudget()
+{
+  // Setting is in gigabytes
+  texture_cache_.SetBudget(qRound64(Config::Current()["TextureCacheSize"].toDouble() * 1073741824.0));
 }
 
 OpenGLTexturePtr OpenGLBackend::CopyTexture(OpenGLTexturePtr input)
@@ -6,8 +6,9 @@
 #include "openglworker.h"
 #include "opengltexture.h"
 #include "opengltexturecache.h"
+#include "opengltextureuploader.h"
 #include "openglshader.h"
-#include "openglshadercache.h"
+#include "openglshadercompiler.h"
 
 class OpenGLBackend : public VideoRenderBackend
 {
@@ -19,6 +20,13 @@ public:
 
   OpenGLTexturePtr GetCachedFrameAsTexture(const rational& time);
 
+  /**
+   * @brief Usage of the texture pool the workers render into (allocated, in use and hit rate) for task/debug views
+   *
+   * Thread-safe.
+   */
+  OpenGLTextureCache::Statistics GetTextureCacheStatistics();
+
 protected:
   virtual bool InitInternal() override;
 
@@ -35,15 +43,48 @@ protected:
 private:
   OpenGLTexturePtr CopyTexture(OpenGLTexturePtr input);
 
-  OpenGLShaderCache shader_cache_;
+  /**
+   * @brief Update the texture cache's budget from the config
+   *
+   * Workers never read the config themselves since it's only safe to access from the main thread.
+   */
+  void UpdateTextureCacheBudget();
+
+  OpenGLShaderCompiler shader_compiler_;
+
+  /**
+   * @brief Node IDs that have been sent to the shader compiler since the last decompile
+   */
+  QSet<QString> compiled_ids_;
 
   OpenGLTextureCache texture_cache_;
 
-  OpenGLTexturePtr master_texture_;
+  /**
+   * @brief A cached frame that has been uploaded for the viewer
+   */
+  struct PooledTexture {
+    QByteArray hash;
+    OpenGLTexturePtr texture;
+  };
+
+  /**
+   * @brief Recently displayed frames from least to most recent, so showing them again needs no upload
+   */
+  QList<PooledTexture> texture_pool_;
+
+  static const int kTexturePoolSize;
+
+  /**
+   * @brief Uploads cached frames for the viewer without stalling the main thread on the transfer
+   */
+  OpenGLTextureUploader uploader_;
 
   OpenGLFramebuffer copy_buffer_;
   OpenGLShaderPtr copy_pipeline_;
 
+private slots:
+  void ShaderCompileFailed(const QString& id, const QString& error);
+
 };
 
 #endif // OPENGLBACKEND_H
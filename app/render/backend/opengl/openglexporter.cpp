@@ -1,5 +1,8 @@
 #include "openglexporter.h"
 
+#include <QDebug>
+#include <QOpenGLExtraFunctions>
+
 #include "render/backend/opengl/openglrenderfunctions.h"
 #include "render/pixelservice.h"
 
@@ -40,6 +43,19 @@ bool OpenGLExporter::Initialize()
 
 void OpenGLExporter::Cleanup()
 {
+  QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+  while (!pending_buffers_.isEmpty()) {
+    PixelBuffer pb = pending_buffers_.dequeue();
+    f->glDeleteSync(pb.fence);
+    free_buffers_.append(pb);
+  }
+
+  foreach (const PixelBuffer& pb, free_buffers_) {
+    f->glDeleteBuffers(1, &pb.buffer);
+  }
+  free_buffers_.clear();
+
   if (texture_) {
     texture_->Destroy();
     texture_ = nullptr;
@@ -50,47 +66,101 @@ void OpenGLExporter::Cleanup()
   buffer_.Destroy();
 }
 
-FramePtr OpenGLExporter::TextureToFrame(const QVariant& texture)
+void OpenGLExporter::DownloadTexture(const QVariant& texture)
 {
-  FramePtr frame = Frame::Create();
-  frame->set_width(video_params_.width());
-  frame->set_height(video_params_.height());
-  frame->set_format(video_params_.format());
-  frame->allocate();
+  QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+  f->glViewport(0, 0, texture_->width(), texture_->height());
+
+  buffer_.Attach(texture_);
+  buffer_.Bind();
 
   // Blit for transform if the width/height are different
   OpenGLTexturePtr input_tex = texture.value<OpenGLTexturePtr>();
   if (input_tex) {
-    QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
-    f->glViewport(0, 0, texture_->width(), texture_->height());
-
-    buffer_.Attach(texture_);
-    buffer_.Bind();
     input_tex->Bind();
 
     OpenGLRenderFunctions::Blit(pipeline_, false, transform_);
 
     input_tex->Release();
-    buffer_.Release();
-    buffer_.Detach();
+  } else {
+    f->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    f->glClear(GL_COLOR_BUFFER_BIT);
+  }
+
+  PixelFormat::Info format_info = PixelService::GetPixelFormatInfo(video_params_.format());
+
+  PixelBuffer pb;
+
+  if (free_buffers_.isEmpty()) {
+    f->glGenBuffers(1, &pb.buffer);
+    f->glBindBuffer(GL_PIXEL_PACK_BUFFER, pb.buffer);
+    f->glBufferData(GL_PIXEL_PACK_BUFFER,
+                    texture_->width() * texture_->height() * format_info.bytes_per_pixel,
+                    nullptr,
+                    GL_STREAM_READ);
+  } else {
+    pb = free_buffers_.takeLast();
+    f->glBindBuffer(GL_PIXEL_PACK_BUFFER, pb.buffer);
+  }
+
+  // With a pack buffer bound, glReadPixels() queues the transfer and returns immediately
+  f->glReadPixels(0,
+                  0,
+                  texture_->width(),
+                  texture_->height(),
+                  format_info.pixel_format,
+                  format_info.gl_pixel_type,
+                  nullptr);
 
-    // Perform OpenGL read
-    buffer_.Attach(texture_);
-    buffer_.Bind();
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-    PixelFormat::Info format_info = PixelService::GetPixelFormatInfo(video_params_.format());
+  pb.fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
-    f->glReadPixels(0,
-                    0,
-                    texture_->width(),
-                    texture_->height(),
-                    format_info.pixel_format,
-                    format_info.gl_pixel_type,
-                    frame->data());
+  // Make sure the commands are submitted so the transfer actually starts
+  f->glFlush();
 
-    buffer_.Release();
-    buffer_.Detach();
+  buffer_.Release();
+  buffer_.Detach();
+
+  pending_buffers_.enqueue(pb);
+}
+
+FramePtr OpenGLExporter::RetrieveDownloadedFrame()
+{
+  QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+  PixelBuffer pb = pending_buffers_.dequeue();
+
+  FramePtr frame = Frame::Create();
+  frame->set_width(video_params_.width());
+  frame->set_height(video_params_.height());
+  frame->set_format(video_params_.format());
+  frame->allocate();
+
+  // Usually complete already since other frames were rendered in the meantime
+  f->glClientWaitSync(pb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  f->glDeleteSync(pb.fence);
+  pb.fence = nullptr;
+
+  PixelFormat::Info format_info = PixelService::GetPixelFormatInfo(video_params_.format());
+  int buffer_size = texture_->width() * texture_->height() * format_info.bytes_per_pixel;
+
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, pb.buffer);
+
+  void* data = f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer_size, GL_MAP_READ_BIT);
+
+  if (data) {
+    memcpy(frame->data(), data, static_cast<size_t>(qMin(buffer_size, frame->allocated_size())));
+
+    f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else {
+    qWarning() << "Failed to map pixel buffer for export";
   }
 
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  free_buffers_.append(pb);
+
   return frame;
 }
@@ -1,6 +1,9 @@
 #ifndef OPENGLEXPORTER_H
 #define OPENGLEXPORTER_H
 
+#include <QList>
+#include <QQueue>
+
 #include "render/backend/exporter.h"
 #include "render/backend/opengl/openglbackend.h"
 #include "render/backend/audio/audiobackend.h"
@@ -21,9 +24,29 @@ protected:
 
   virtual void Cleanup() override;
 
-  virtual FramePtr TextureToFrame(const QVariant &texture) override;
+  virtual void DownloadTexture(const QVariant &texture) override;
+
+  virtual FramePtr RetrieveDownloadedFrame() override;
 
 private:
+  /**
+   * @brief A pixel pack buffer that glReadPixels() writes into asynchronously
+   */
+  struct PixelBuffer {
+    GLuint buffer;
+    GLsync fence;
+  };
+
+  /**
+   * @brief Downloads in the order they were started
+   */
+  QQueue<PixelBuffer> pending_buffers_;
+
+  /**
+   * @brief Buffers that can be reused for the next download
+   */
+  QList<PixelBuffer> free_buffers_;
+
   OpenGLFramebuffer buffer_;
 
   OpenGLTexturePtr texture_;
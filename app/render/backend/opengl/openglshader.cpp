@@ -1,6 +1,24 @@
 #include "openglshader.h"
 
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QOpenGLExtraFunctions>
+#include <QSaveFile>
+
+// Program binaries are core in OpenGL 4.1 and ES 3.0, so older headers may not define these
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
 
 OpenGLShader::OpenGLShader()
 {
@@ -19,6 +37,64 @@ OpenGLShaderPtr OpenGLShader::CreateDefault(const QString &function_name, const
   return program;
 }
 
+OpenGLShaderPtr OpenGLShader::Create(QString vert_code, QString frag_code, QString *error, const QString& binary_cache_dir)
+{
+  if (frag_code.isEmpty()) {
+    frag_code = CodeDefaultFragment();
+  }
+
+  if (vert_code.isEmpty()) {
+    vert_code = CodeDefaultVertex();
+  }
+
+  bool use_binary = !binary_cache_dir.isEmpty() && ProgramBinariesSupported();
+  QString binary_filename;
+
+  if (use_binary) {
+    binary_filename = GetBinaryFilename(binary_cache_dir, vert_code, frag_code);
+
+    OpenGLShaderPtr cached = std::make_shared<OpenGLShader>();
+
+    if (cached->create() && cached->LoadBinary(binary_filename)) {
+      return cached;
+    }
+  }
+
+  OpenGLShaderPtr program = std::make_shared<OpenGLShader>();
+  QString message;
+
+  if (!program->create()) {
+    message = QStringLiteral("Failed to create OpenGL shader on device");
+  } else if (!program->addShaderFromSourceCode(QOpenGLShader::Fragment, frag_code)) {
+    message = QStringLiteral("Failed to add OpenGL fragment shader code");
+  } else if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vert_code)) {
+    message = QStringLiteral("Failed to add OpenGL vertex shader code");
+  } else {
+    if (use_binary) {
+      // Some drivers only keep what glGetProgramBinary() needs if they're told before linking
+      QOpenGLContext::currentContext()->extraFunctions()->glProgramParameteri(program->programId(),
+                                                                              GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                                                              GL_TRUE);
+    }
+
+    if (!program->link()) {
+      message = QStringLiteral("Failed to compile OpenGL shader: %1").arg(program->log());
+    } else {
+      if (use_binary) {
+        program->SaveBinary(binary_filename);
+      }
+
+      return program;
+    }
+  }
+
+  if (error) {
+    *error = message;
+  }
+
+  return nullptr;
+}
+
 // copied from source code to OCIODisplay
 const int OCIO_LUT3D_EDGE_SIZE = 32;
 
@@ -231,12 +307,150 @@ QString OpenGLShader::CodeAlphaAssociate(const QString &function_name)
                         "}\n").arg(function_name);
 }
 
-void OpenGLShader::Lock()
+bool OpenGLShader::ProgramBinariesSupported()
 {
-  lock_.lock();
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+  if (!ctx) {
+    return false;
+  }
+
+  bool has_functions;
+
+  if (ctx->isOpenGLES()) {
+    has_functions = (ctx->format().majorVersion() >= 3);
+  } else {
+    has_functions = (ctx->format().version() >= qMakePair(4, 1)
+                     || ctx->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary")));
+  }
+
+  if (!has_functions) {
+    return false;
+  }
+
+  // Drivers can have the functions without supporting any binary formats
+  GLint format_count = 0;
+  ctx->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+  return (format_count > 0);
 }
 
-void OpenGLShader::Unlock()
+void OpenGLShader::PruneBinaryCache(const QString &binary_cache_dir)
 {
-  lock_.unlock();
+  QDir dir(binary_cache_dir);
+  QFile driver_file(dir.filePath(QStringLiteral("driver")));
+
+  QByteArray driver = GetDriverString();
+
+  if (driver_file.open(QFile::ReadOnly)) {
+    bool same_driver = (driver_file.readAll() == driver);
+
+    driver_file.close();
+
+    if (same_driver) {
+      return;
+    }
+  }
+
+  foreach (const QFileInfo& info, dir.entryInfoList(QDir::Files)) {
+    QFile::remove(info.absoluteFilePath());
+  }
+
+  if (driver_file.open(QFile::WriteOnly)) {
+    driver_file.write(driver);
+  }
+}
+
+QByteArray OpenGLShader::GetDriverString()
+{
+  QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+
+  QByteArray driver;
+
+  driver.append(reinterpret_cast<const char*>(f->glGetString(GL_VENDOR)));
+  driver.append('\n');
+  driver.append(reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+  driver.append('\n');
+  driver.append(reinterpret_cast<const char*>(f->glGetString(GL_VERSION)));
+
+  return driver;
+}
+
+QString OpenGLShader::GetBinaryFilename(const QString& binary_cache_dir, const QString &vert_code, const QString &frag_code)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  // Binaries are only valid for the driver that created them
+  hash.addData(GetDriverString());
+
+  hash.addData(vert_code.toUtf8());
+  hash.addData(frag_code.toUtf8());
+
+  return QDir(binary_cache_dir).filePath(QString(hash.result().toHex()));
+}
+
+bool OpenGLShader::LoadBinary(const QString &filename)
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  QByteArray contents = file.readAll();
+
+  file.close();
+
+  // Files start with the binary's format
+  GLenum format;
+
+  if (contents.size() > static_cast<int>(sizeof(format))) {
+    memcpy(&format, contents.constData(), sizeof(format));
+
+    QOpenGLContext::currentContext()->extraFunctions()->glProgramBinary(programId(),
+                                                                        format,
+                                                                        contents.constData() + sizeof(format),
+                                                                        contents.size() - static_cast<int>(sizeof(format)));
+
+    // With no shaders added, link() just checks whether the binary was accepted
+    if (link()) {
+      return true;
+    }
+  }
+
+  // Usually after a driver update, it'll be replaced when the code is compiled again
+  QFile::remove(filename);
+
+  return false;
+}
+
+void OpenGLShader::SaveBinary(const QString &filename)
+{
+  QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+  GLint length = 0;
+  f->glGetProgramiv(programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+  if (length <= 0) {
+    return;
+  }
+
+  QByteArray binary(length, Qt::Uninitialized);
+  GLenum format = 0;
+  GLsizei written = 0;
+
+  f->glGetProgramBinary(programId(), length, &written, &format, binary.data());
+
+  if (written <= 0) {
+    return;
+  }
+
+  // Written to a temporary file and renamed so other threads never load half a binary
+  QSaveFile file(filename);
+
+  if (file.open(QFile::WriteOnly)) {
+    file.write(reinterpret_cast<const char*>(&format), static_cast<qint64>(sizeof(format)));
+    file.write(binary.constData(), written);
+    file.commit();
+  }
 }
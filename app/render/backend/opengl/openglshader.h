@@ -2,7 +2,6 @@
 #define OPENGLSHADER_H
 
 #include <memory>
-#include <QMutex>
 #include <QOpenGLShaderProgram>
 
 #include <OpenColorIO/OpenColorIO.h>
@@ -21,6 +20,28 @@ public:
   static OpenGLShaderPtr CreateDefault(const QString &function_name = QString(),
                                        const QString &shader_code = QString());
 
+  /**
+   * @brief Create and link a program, using the default vertex or fragment code for whichever is empty
+   *
+   * If `binary_cache_dir` is set and the driver supports program binaries, the linked program is kept in that folder
+   * and loaded from there next time instead of compiling the code again. Binaries the driver rejects are deleted and
+   * the code is compiled as usual.
+   *
+   * Returns nullptr and sets `error` (if provided) if any step fails.
+   */
+  static OpenGLShaderPtr Create(QString vert_code,
+                                QString frag_code,
+                                QString* error = nullptr,
+                                const QString& binary_cache_dir = QString());
+
+  /**
+   * @brief Empty the binary cache folder if it was filled by a different driver than the current context's
+   *
+   * Binaries only ever load on the driver that created them, so after a driver update or GPU change the old ones would
+   * otherwise sit there forever. Call with a context current, before any threads use the folder.
+   */
+  static void PruneBinaryCache(const QString& binary_cache_dir);
+
   static OpenGLShaderPtr CreateOCIO(QOpenGLContext* ctx,
                                     GLuint& lut_texture,
                                     OCIO::ConstProcessorRcPtr processor,
@@ -33,11 +54,22 @@ public:
   static QString CodeAlphaReassociate(const QString& function_name);
   static QString CodeAlphaAssociate(const QString& function_name);
 
-  void Lock();
-  void Unlock();
-
 private:
-  QMutex lock_;
+  static bool ProgramBinariesSupported();
+
+  /**
+   * @brief Vendor, renderer and version of the current context's driver
+   */
+  static QByteArray GetDriverString();
+
+  /**
+   * @brief Filename of the cached binary for this code on the current driver
+   */
+  static QString GetBinaryFilename(const QString& binary_cache_dir, const QString& vert_code, const QString& frag_code);
+
+  bool LoadBinary(const QString& filename);
+
+  void SaveBinary(const QString& filename);
 };
 
 #endif // OPENGLSHADER_H
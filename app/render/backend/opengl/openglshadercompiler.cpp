@@ -0,0 +1,142 @@
+#include "openglshadercompiler.h"
+
+#include <QDebug>
+
+#include "openglshader.h"
+
+OpenGLShaderCompiler::OpenGLShaderCompiler(QObject *parent) :
+  QObject(parent),
+  ctx_(nullptr)
+{
+  surface_.create();
+}
+
+OpenGLShaderCompiler::~OpenGLShaderCompiler()
+{
+  Stop();
+
+  surface_.destroy();
+}
+
+bool OpenGLShaderCompiler::Start(QOpenGLContext *share_ctx, const QString &binary_cache_dir)
+{
+  binary_cache_dir_ = binary_cache_dir;
+
+  ctx_ = new QOpenGLContext();
+  ctx_->setShareContext(share_ctx);
+
+  if (!ctx_->create()) {
+    qWarning() << "Failed to create OpenGL context for shader compiler";
+    delete ctx_;
+    ctx_ = nullptr;
+    return false;
+  }
+
+  // Both this and the context run in the thread, they're moved back in CloseInThread()
+  ctx_->moveToThread(&thread_);
+  moveToThread(&thread_);
+
+  thread_.start(QThread::LowPriority);
+
+  QMetaObject::invokeMethod(this, "FinishInit", Qt::QueuedConnection);
+
+  return true;
+}
+
+void OpenGLShaderCompiler::Stop()
+{
+  // Anything still queued won't be linked now, CompileInThread() skips IDs that aren't pending so the thread can get
+  // to CloseInThread() without working through the queue. This also means workers don't wait on them.
+  pending_lock_.lock();
+  pending_.clear();
+  pending_cond_.wakeAll();
+  pending_lock_.unlock();
+
+  if (thread_.isRunning()) {
+    // Blocks until the program currently being linked (if any) is done
+    QMetaObject::invokeMethod(this, "CloseInThread", Qt::BlockingQueuedConnection);
+
+    thread_.quit();
+    thread_.wait();
+  }
+}
+
+void OpenGLShaderCompiler::Compile(const QString &id, const QString &vert_code, const QString &frag_code)
+{
+  if (!thread_.isRunning()) {
+    // Workers will just compile it themselves
+    return;
+  }
+
+  pending_lock_.lock();
+  pending_.insert(id);
+  pending_lock_.unlock();
+
+  QMetaObject::invokeMethod(this,
+                            "CompileInThread",
+                            Qt::QueuedConnection,
+                            Q_ARG(QString, id),
+                            Q_ARG(QString, vert_code),
+                            Q_ARG(QString, frag_code));
+}
+
+void OpenGLShaderCompiler::WaitForCompile(const QString &id)
+{
+  pending_lock_.lock();
+
+  while (pending_.contains(id)) {
+    pending_cond_.wait(&pending_lock_);
+  }
+
+  pending_lock_.unlock();
+}
+
+void OpenGLShaderCompiler::FinishCompile(const QString &id)
+{
+  pending_lock_.lock();
+  pending_.remove(id);
+  pending_cond_.wakeAll();
+  pending_lock_.unlock();
+}
+
+void OpenGLShaderCompiler::FinishInit()
+{
+  if (!ctx_->makeCurrent(&surface_)) {
+    qWarning() << "Failed to makeCurrent() on offscreen surface in thread" << thread();
+  }
+}
+
+void OpenGLShaderCompiler::CompileInThread(const QString &id, const QString &vert_code, const QString &frag_code)
+{
+  pending_lock_.lock();
+  bool still_pending = pending_.contains(id);
+  pending_lock_.unlock();
+
+  if (!still_pending) {
+    // Cancelled by Stop() or already linked by an earlier request for the same ID
+    return;
+  }
+
+  if (ctx_ && QOpenGLContext::currentContext() == ctx_) {
+    QString error;
+
+    // The program itself isn't needed, just any error and the binary it leaves in the cache
+    if (!OpenGLShader::Create(vert_code, frag_code, &error, binary_cache_dir_)) {
+      emit CompileFailed(id, error);
+    }
+  }
+
+  FinishCompile(id);
+}
+
+void OpenGLShaderCompiler::CloseInThread()
+{
+  if (ctx_) {
+    ctx_->doneCurrent();
+    delete ctx_;
+    ctx_ = nullptr;
+  }
+
+  // Return to the main thread so we can be started again
+  moveToThread(thread_.thread());
+}
@@ -0,0 +1,88 @@
+#ifndef OPENGLSHADERCOMPILER_H
+#define OPENGLSHADERCOMPILER_H
+
+#include <QMutex>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+
+/**
+ * @brief Links shader programs in a background thread so compiling a graph never blocks the main thread
+ *
+ * Each worker links its own copy of a program (see OpenGLWorker::GetShader()). This links it once beforehand to find
+ * errors and, more importantly, leave its binary in the shader cache so the workers can load it instead of compiling
+ * it again. Workers that need a program that's still being linked wait for it with WaitForCompile().
+ */
+class OpenGLShaderCompiler : public QObject
+{
+  Q_OBJECT
+public:
+  OpenGLShaderCompiler(QObject* parent = nullptr);
+
+  virtual ~OpenGLShaderCompiler() override;
+
+  /**
+   * @brief Create a context shared with `share_ctx` and start the thread
+   *
+   * Must be called from the thread `share_ctx` is current in, see OpenGLWorker::InitInternal() for why. Linked
+   * binaries are left in `binary_cache_dir` (see OpenGLShader::Create()).
+   */
+  bool Start(QOpenGLContext* share_ctx, const QString& binary_cache_dir);
+
+  /**
+   * @brief Stop the thread, any programs that haven't been linked yet are skipped
+   */
+  void Stop();
+
+  /**
+   * @brief Queue a program to be linked in the background
+   *
+   * Thread-safe.
+   */
+  void Compile(const QString& id, const QString& vert_code, const QString& frag_code);
+
+  /**
+   * @brief Block until the program with this ID isn't queued or linking anymore
+   *
+   * Thread-safe. Returns immediately if it was never queued.
+   */
+  void WaitForCompile(const QString& id);
+
+signals:
+  void CompileFailed(const QString& id, const QString& error);
+
+private:
+  void FinishCompile(const QString& id);
+
+  QThread thread_;
+
+  QOpenGLContext* ctx_;
+
+  QOffscreenSurface surface_;
+
+  /**
+   * @brief Only set in Start() before the thread runs, so the thread can read it without locking
+   */
+  QString binary_cache_dir_;
+
+  /**
+   * @brief IDs that have been queued but haven't finished linking
+   */
+  QSet<QString> pending_;
+
+  QMutex pending_lock_;
+
+  QWaitCondition pending_cond_;
+
+private slots:
+  void FinishInit();
+
+  void CompileInThread(const QString& id, const QString& vert_code, const QString& frag_code);
+
+  void CloseInThread();
+
+};
+
+#endif // OPENGLSHADERCOMPILER_H
@@ -1,5 +1,18 @@
 #include "opengltexturecache.h"
 
+#include "render/pixelservice.h"
+
+OpenGLTextureCache::OpenGLTextureCache() :
+  use_counter_(0),
+  budget_(0),
+  allocated_bytes_(0),
+  allocated_textures_(0),
+  in_use_bytes_(0),
+  hits_(0),
+  misses_(0)
+{
+}
+
 OpenGLTextureCache::~OpenGLTextureCache()
 {
   foreach (Reference* ref, existing_references_) {
@@ -7,25 +20,49 @@ OpenGLTextureCache::~OpenGLTextureCache()
   }
 }
 
-OpenGLTextureCache::ReferencePtr OpenGLTextureCache::Get(QOpenGLContext* ctx, const VideoRenderingParams &params, const void *data)
+OpenGLTextureCache::ReferencePtr OpenGLTextureCache::Get(QOpenGLContext* ctx, const VideoRenderingParams &params)
 {
   OpenGLTexturePtr texture = nullptr;
+  QList<OpenGLTexturePtr> removed_textures;
+
+  qint64 texture_size = GetTextureSize(params.effective_width(), params.effective_height(), params.format());
 
   lock_.lock();
 
-  // Iterate through textures and see if we have one that matches these parameters
-  for (int i=0;i<available_textures_.size();i++) {
-    OpenGLTexturePtr test = available_textures_.at(i);
+  // Take the most recently used texture from this size's bucket since it's the likeliest to still be resident
+  QHash<quint64, QList<IdleTexture> >::iterator bucket = idle_textures_.find(GetBucketKey(params.effective_width(),
+                                                                                           params.effective_height(),
+                                                                                           params.format()));
 
-    if (test->width() == params.effective_width()
-        && test->height() == params.effective_height()
-        && test->format() == params.format()) {
-      texture = test;
-      available_textures_.removeAt(i);
-      break;
+  if (bucket != idle_textures_.end()) {
+    IdleTexture idle = bucket->takeLast();
+
+    if (bucket->isEmpty()) {
+      idle_textures_.erase(bucket);
     }
+
+    idle_order_.remove(idle.last_used);
+
+    texture = idle.texture;
+    hits_++;
+
+    TrimIdle(0, &removed_textures);
+  } else {
+    TrimIdle(texture_size, &removed_textures);
+
+    misses_++;
+    allocated_bytes_ += texture_size;
+    allocated_textures_++;
   }
 
+  in_use_bytes_ += texture_size;
+
+  lock_.unlock();
+
+  // Delete trimmed textures here rather than under the lock, `ctx` is current and shares with the context they were
+  // created in
+  removed_textures.clear();
+
   // If we didn't find a texture, we'll need to create one
   if (!texture) {
     texture = std::make_shared<OpenGLTexture>();
@@ -33,27 +70,99 @@ OpenGLTextureCache::ReferencePtr OpenGLTextureCache::Get(QOpenGLContext* ctx, co
   }
 
   ReferencePtr ref = std::make_shared<Reference>(this, texture);
-  existing_references_.append(ref.get());
 
+  lock_.lock();
+  existing_references_.insert(ref.get());
   lock_.unlock();
 
-  if (data) {
-    texture->Upload(data);
-  }
-
   return ref;
 }
 
+void OpenGLTextureCache::SetBudget(qint64 bytes)
+{
+  QMutexLocker locker(&lock_);
+
+  budget_ = bytes;
+}
+
+OpenGLTextureCache::Statistics OpenGLTextureCache::GetStatistics()
+{
+  QMutexLocker locker(&lock_);
+
+  Statistics stats;
+
+  stats.allocated_bytes = allocated_bytes_;
+  stats.allocated_textures = allocated_textures_;
+  stats.in_use_bytes = in_use_bytes_;
+  stats.textures_in_use = existing_references_.size();
+  stats.hits = hits_;
+  stats.misses = misses_;
+
+  return stats;
+}
+
+quint64 OpenGLTextureCache::GetBucketKey(int width, int height, PixelFormat::Format format)
+{
+  // Dimensions are well within 24 bits each and the format within 16
+  return (static_cast<quint64>(width) << 40)
+      | (static_cast<quint64>(height) << 16)
+      | static_cast<quint64>(format);
+}
+
+qint64 OpenGLTextureCache::GetTextureSize(int width, int height, PixelFormat::Format format)
+{
+  return PixelService::GetBufferSize(format, width, height);
+}
+
 void OpenGLTextureCache::Relinquish(OpenGLTextureCache::Reference *ref)
 {
   OpenGLTexturePtr tex = ref->texture();
 
-  lock_.lock();
+  QMutexLocker locker(&lock_);
 
-  existing_references_.removeOne(ref);
-  available_textures_.append(tex);
+  existing_references_.remove(ref);
+  in_use_bytes_ -= GetTextureSize(tex->width(), tex->height(), tex->format());
 
-  lock_.unlock();
+  // Trimming waits for the next Get() since there may be no context current on this thread to delete with
+  quint64 key = GetBucketKey(tex->width(), tex->height(), tex->format());
+
+  idle_textures_[key].append({tex, use_counter_});
+  idle_order_.insert(use_counter_, key);
+
+  use_counter_++;
+}
+
+void OpenGLTextureCache::TrimIdle(qint64 incoming, QList<OpenGLTexturePtr> *removed)
+{
+  while (!idle_order_.isEmpty() && allocated_bytes_ + incoming > budget_) {
+    QMap<quint64, quint64>::iterator oldest = idle_order_.begin();
+    QHash<quint64, QList<IdleTexture> >::iterator bucket = idle_textures_.find(oldest.value());
+
+    // Buckets are in the same order as `idle_order_`, so the oldest texture overall is first in its bucket
+    IdleTexture idle = bucket->takeFirst();
+
+    if (bucket->isEmpty()) {
+      idle_textures_.erase(bucket);
+    }
+
+    idle_order_.erase(oldest);
+
+    allocated_bytes_ -= GetTextureSize(idle.texture->width(), idle.texture->height(), idle.texture->format());
+    allocated_textures_--;
+
+    removed->append(idle.texture);
+  }
+}
+
+double OpenGLTextureCache::Statistics::HitRate() const
+{
+  quint64 total = hits + misses;
+
+  if (total == 0) {
+    return 0.0;
+  }
+
+  return static_cast<double>(hits) / static_cast<double>(total);
 }
 
 OpenGLTextureCache::Reference::Reference(OpenGLTextureCache *parent, OpenGLTexturePtr texture) :
@@ -1,12 +1,22 @@
 #ifndef OPENGLTEXTURECACHE_H
 #define OPENGLTEXTURECACHE_H
 
+#include <QHash>
+#include <QMap>
 #include <QMutex>
+#include <QSet>
 
 #include "openglframebuffer.h"
 #include "opengltexture.h"
 #include "render/videoparams.h"
 
+/**
+ * @brief A pool of textures that workers render into, recycled once nothing references them anymore
+ *
+ * Idle textures are bucketed by size and format so Get() finds a match without searching. The pool's total size is
+ * kept within the budget set with SetBudget() by freeing the least recently used idle textures, textures that are in
+ * use can't be freed so a busy pool may temporarily exceed it.
+ */
 class OpenGLTextureCache
 {
 public:
@@ -29,22 +39,88 @@ public:
 
   using ReferencePtr = std::shared_ptr<Reference>;
 
-  OpenGLTextureCache() = default;
+  /**
+   * @brief A snapshot of the pool's usage for diagnostics
+   */
+  struct Statistics {
+    qint64 allocated_bytes;
+    int allocated_textures;
+    qint64 in_use_bytes;
+    int textures_in_use;
+    quint64 hits;
+    quint64 misses;
+
+    double HitRate() const;
+  };
+
+  OpenGLTextureCache();
 
   ~OpenGLTextureCache();
 
   DISABLE_COPY_MOVE(OpenGLTextureCache)
 
-  ReferencePtr Get(QOpenGLContext *ctx, const VideoRenderingParams& params, const void *data = nullptr);
+  /**
+   * @brief Get a texture matching `params`, reusing an idle one if possible
+   *
+   * `ctx` must be current since this is also where idle textures over the budget get deleted.
+   */
+  ReferencePtr Get(QOpenGLContext *ctx, const VideoRenderingParams& params);
+
+  /**
+   * @brief Set how many bytes the pool may allocate, idle textures over it are freed on the next Get()
+   *
+   * Thread-safe.
+   */
+  void SetBudget(qint64 bytes);
+
+  Statistics GetStatistics();
 
 private:
+  struct IdleTexture {
+    OpenGLTexturePtr texture;
+    quint64 last_used;
+  };
+
+  static quint64 GetBucketKey(int width, int height, PixelFormat::Format format);
+
+  static qint64 GetTextureSize(int width, int height, PixelFormat::Format format);
+
   void Relinquish(Reference* ref);
 
+  /**
+   * @brief Remove the least recently used idle textures until `incoming` more bytes would fit in the budget
+   *
+   * Must be called with `lock_` held. Removed textures are appended to `removed` so they can be deleted after unlocking.
+   */
+  void TrimIdle(qint64 incoming, QList<OpenGLTexturePtr>* removed);
+
   QMutex lock_;
 
-  QList<OpenGLTexturePtr> available_textures_;
+  /**
+   * @brief Idle textures bucketed by size and format, each bucket from least to most recently used
+   */
+  QHash<quint64, QList<IdleTexture> > idle_textures_;
+
+  /**
+   * @brief Bucket of every idle texture keyed by when it was relinquished, so the oldest comes first
+   */
+  QMap<quint64, quint64> idle_order_;
+
+  quint64 use_counter_;
+
+  qint64 budget_;
+
+  QSet<Reference*> existing_references_;
+
+  qint64 allocated_bytes_;
+
+  int allocated_textures_;
+
+  qint64 in_use_bytes_;
+
+  quint64 hits_;
 
-  QList<Reference*> existing_references_;
+  quint64 misses_;
 
 };
 
@@ -0,0 +1,139 @@
+#include "opengltextureuploader.h"
+
+#include <QDebug>
+#include <QOpenGLExtraFunctions>
+
+#include "render/pixelservice.h"
+
+const int OpenGLTextureUploader::kRingSize = 3;
+
+OpenGLTextureUploader::OpenGLTextureUploader() :
+  context_(nullptr),
+  next_buffer_(0)
+{
+}
+
+OpenGLTextureUploader::~OpenGLTextureUploader()
+{
+  Destroy();
+}
+
+void OpenGLTextureUploader::Create(QOpenGLContext *ctx)
+{
+  if (ctx == nullptr) {
+    qWarning() << "OpenGLTextureUploader::Create was passed an invalid context";
+    return;
+  }
+
+  Destroy();
+
+  context_ = ctx;
+
+  connect(context_, &QOpenGLContext::aboutToBeDestroyed, this, &OpenGLTextureUploader::Destroy);
+
+  // Buffers are allocated on first use once we know how big the frames are
+  buffers_.resize(kRingSize);
+
+  for (int i=0;i<buffers_.size();i++) {
+    PixelBuffer& pb = buffers_[i];
+
+    context_->functions()->glGenBuffers(1, &pb.buffer);
+    pb.fence = nullptr;
+    pb.size = 0;
+  }
+
+  next_buffer_ = 0;
+}
+
+bool OpenGLTextureUploader::IsCreated() const
+{
+  return context_;
+}
+
+void OpenGLTextureUploader::Destroy()
+{
+  if (context_ != nullptr) {
+    disconnect(context_, &QOpenGLContext::aboutToBeDestroyed, this, &OpenGLTextureUploader::Destroy);
+
+    QOpenGLExtraFunctions* f = context_->extraFunctions();
+
+    foreach (const PixelBuffer& pb, buffers_) {
+      if (pb.fence) {
+        f->glDeleteSync(pb.fence);
+      }
+
+      f->glDeleteBuffers(1, &pb.buffer);
+    }
+
+    buffers_.clear();
+
+    context_ = nullptr;
+  }
+}
+
+void OpenGLTextureUploader::Upload(OpenGLTexture *texture, const void *data)
+{
+  if (!IsCreated()) {
+    texture->Upload(data);
+    return;
+  }
+
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+
+  if (!context) {
+    qWarning() << "OpenGLTextureUploader::Upload() called with an invalid context";
+    return;
+  }
+
+  QOpenGLExtraFunctions* f = context->extraFunctions();
+
+  int buffer_size = PixelService::GetBufferSize(texture->format(), texture->width(), texture->height());
+
+  PixelBuffer& pb = buffers_[next_buffer_];
+  next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+
+  // Usually complete already since the ring's other buffers were used in the meantime
+  if (pb.fence) {
+    f->glClientWaitSync(pb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    f->glDeleteSync(pb.fence);
+    pb.fence = nullptr;
+  }
+
+  f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.buffer);
+
+  if (pb.size < buffer_size) {
+    f->glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+    pb.size = buffer_size;
+  }
+
+  // Nothing is reading this buffer after the wait above, so there's no need for the driver to synchronize the map
+  void* staging = f->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                      0,
+                                      buffer_size,
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+  if (!staging) {
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    qWarning() << "Failed to map pixel buffer for upload";
+    texture->Upload(data);
+    return;
+  }
+
+  memcpy(staging, data, static_cast<size_t>(buffer_size));
+
+  if (!f->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+    // The buffer's contents were lost (e.g. a display mode change), send the pixels directly instead
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    texture->Upload(data);
+    return;
+  }
+
+  // With an unpack buffer bound, the data argument is an offset into it and the transfer happens asynchronously
+  texture->Upload(nullptr);
+
+  f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  pb.fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,65 @@
+#ifndef OPENGLTEXTUREUPLOADER_H
+#define OPENGLTEXTUREUPLOADER_H
+
+#include <QOpenGLContext>
+#include <QVector>
+
+#include "common/constructors.h"
+#include "opengltexture.h"
+
+/**
+ * @brief Uploads pixels into textures through a ring of pixel unpack buffers
+ *
+ * OpenGLTexture::Upload() hands glTexSubImage2D() a pointer to client memory, which the driver has to finish reading
+ * (and often converting) before the call returns. Here the pixels are copied into a mapped staging buffer instead and
+ * the transfer into the texture is queued on the GPU, so the calling thread can carry on decoding and rendering while
+ * it happens. Each buffer in the ring is fenced, so it's only written to again once its last transfer has finished.
+ *
+ * Buffers belong to the share group, so an uploader can be used from any context that shares with the one it was
+ * created in, but only from one thread at a time.
+ */
+class OpenGLTextureUploader : public QObject
+{
+  Q_OBJECT
+public:
+  OpenGLTextureUploader();
+  virtual ~OpenGLTextureUploader() override;
+
+  DISABLE_COPY_MOVE(OpenGLTextureUploader)
+
+  void Create(QOpenGLContext *ctx);
+
+  bool IsCreated() const;
+
+  /**
+   * @brief Fill `texture` with `data`, which is only read during this call
+   *
+   * `data` must be the size of the texture in its format. Falls back to OpenGLTexture::Upload() if the uploader hasn't
+   * been created or a staging buffer can't be mapped.
+   */
+  void Upload(OpenGLTexture* texture, const void* data);
+
+public slots:
+  void Destroy();
+
+private:
+  struct PixelBuffer {
+    GLuint buffer;
+    GLsync fence;
+    int size;
+  };
+
+  /**
+   * @brief How many uploads can be in flight before the oldest has to finish
+   */
+  static const int kRingSize;
+
+  QOpenGLContext* context_;
+
+  QVector<PixelBuffer> buffers_;
+
+  int next_buffer_;
+
+};
+
+#endif // OPENGLTEXTUREUPLOADER_H
@@ -9,12 +9,13 @@
 #include "render/colormanager.h"
 #include "render/pixelservice.h"
 
-OpenGLWorker::OpenGLWorker(QOpenGLContext *share_ctx, OpenGLShaderCache *shader_cache, OpenGLTextureCache *texture_cache, VideoRenderFrameCache *frame_cache, QObject *parent) :
+OpenGLWorker::OpenGLWorker(QOpenGLContext *share_ctx, OpenGLShaderCompiler *shader_compiler, const QString &shader_cache_dir, OpenGLTextureCache *texture_cache, VideoRenderFrameCache *frame_cache, QObject *parent) :
   VideoRenderWorker(frame_cache, parent),
   share_ctx_(share_ctx),
   ctx_(nullptr),
   functions_(nullptr),
-  shader_cache_(shader_cache),
+  shader_compiler_(shader_compiler),
+  shader_cache_dir_(shader_cache_dir),
   texture_cache_(texture_cache)
 {
   surface_.create();
@@ -61,27 +62,31 @@ void OpenGLWorker::FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable
   ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
 
   // Set up OCIO context
-  OpenGLColorProcessorPtr color_processor = std::static_pointer_cast<OpenGLColorProcessor>(color_cache()->Get(video_stream->colorspace()));
+  OCIO::ConstConfigRcPtr color_config = video_stream->footage()->project()->color_manager()->GetConfig();
+
+  // Match with the config's contents too so a new config with a colorspace of the same name isn't mistaken for the old
+  QString color_id = ColorProcessor::GenerateID(color_config, video_stream->colorspace(), OCIO::ROLE_SCENE_LINEAR);
+
+  OpenGLColorProcessorPtr color_processor = std::static_pointer_cast<OpenGLColorProcessor>(color_cache()->Get(color_id));
 
   if (!color_processor) {
-    // FIXME: We match with the colorspace string, but this won't change if the user sets a new config with a colorspace with the same string
-    color_processor = OpenGLColorProcessor::CreateOpenGL(video_stream->footage()->project()->color_manager()->GetConfig(),
+    // The OCIO processor itself comes from ColorProcessor's process-wide cache, only the GL resources are per-worker
+    color_processor = OpenGLColorProcessor::CreateOpenGL(color_config,
                                                          video_stream->colorspace(),
                                                          OCIO::ROLE_SCENE_LINEAR);
-    color_cache()->Add(video_stream->colorspace(), color_processor);
+    color_cache()->Add(color_id, color_processor);
   }
 
   ColorManager::OCIOMethod ocio_method = ColorManager::GetOCIOMethodForMode(video_params().mode());
 
   // OCIO's CPU conversion is more accurate, so for online we render on CPU but offline we render GPU
   if (ocio_method == ColorManager::kOCIOAccurate) {
-    // If alpha is associated, disassociate for the color transform
-    if (video_stream->premultiplied_alpha()) {
-      ColorManager::DisassociateAlpha(frame);
-    }
-
-    // Convert frame to float for OCIO
-    frame = PixelService::ConvertPixelFormat(frame, PixelFormat::PIX_FMT_RGBA32F);
+    // Convert frame to float for OCIO, and if alpha is associated, disassociate it for the color transform in the
+    // same pass
+    frame = PixelService::ConvertPixelFormat(frame,
+                                             PixelFormat::PIX_FMT_RGBA32F,
+                                             video_stream->premultiplied_alpha()
+                                             ? PixelKernels::kAlphaDisassociate : PixelKernels::kAlphaNone);
 
     // Perform color transform
     color_processor->ConvertFrame(frame);
@@ -96,7 +101,8 @@ void OpenGLWorker::FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable
 
   VideoRenderingParams footage_params(frame->width(), frame->height(), stream->timebase(), frame->format(), video_params().mode());
 
-  OpenGLTextureCache::ReferencePtr footage_tex_ref = texture_cache_->Get(ctx_, footage_params, frame->data());
+  OpenGLTextureCache::ReferencePtr footage_tex_ref = texture_cache_->Get(ctx_, footage_params);
+  uploader_.Upload(footage_tex_ref->texture().get(), frame->data());
 
   if (ocio_method == ColorManager::kOCIOFast) {
     if (!color_processor->IsEnabled()) {
@@ -149,7 +155,11 @@ void OpenGLWorker::FrameToValue(StreamPtr stream, FramePtr frame, NodeValueTable
 
 void OpenGLWorker::CloseInternal()
 {
+  // Programs belong to our context so they have to go before it does
+  shader_cache_.Clear();
+
   buffer_.Destroy();
+  uploader_.Destroy();
   functions_ = nullptr;
   delete ctx_;
 }
@@ -163,9 +173,11 @@ void OpenGLWorker::ParametersChangedEvent()
 
 void OpenGLWorker::RunNodeAccelerated(const Node *node, const TimeRange &range, const NodeValueDatabase &input_params, NodeValueTable *output_params)
 {
-  OpenGLShaderPtr shader = shader_cache_->Get(node->id());
+  OpenGLShaderPtr shader = GetShader(node);
 
   if (!shader) {
+    // Passing the inputs through would be cached as if it were this node's output
+    SetJobFailed();
     return;
   }
 
@@ -179,8 +191,6 @@ void OpenGLWorker::RunNodeAccelerated(const Node *node, const TimeRange &range,
     dst_refs.append(texture_cache_->Get(ctx_, video_params()));
   }
 
-  // Lock the shader so no other thread interferes as we set parameters and draw (and we don't interfere with any others)
-  shader->Lock();
   shader->bind();
 
   unsigned int input_texture_count = 0;
@@ -339,10 +349,6 @@ void OpenGLWorker::RunNodeAccelerated(const Node *node, const TimeRange &range,
     output_tex = destination_tex;
   }
 
-  // Make sure all OpenGL functions are complete by this point before unlocking the shader (or another thread may
-  // change its parameters before our drawing in this thread is done)
-  shader->Unlock();
-
   // Release any textures we bound before
   while (input_texture_count > 0) {
     input_texture_count--;
@@ -383,6 +389,33 @@ void OpenGLWorker::TextureToBuffer(const QVariant &tex_in, QByteArray &buffer)
   texture->texture()->Unlock();
 }
 
+OpenGLShaderPtr OpenGLWorker::GetShader(const Node *node)
+{
+  if (!shader_cache_.Has(node->id())) {
+    OpenGLShaderPtr program;
+
+    if (node->IsAccelerated()) {
+      shader_compiler_->WaitForCompile(node->id());
+
+      QString error;
+
+      program = OpenGLShader::Create(node->AcceleratedCodeVertex(),
+                                     node->AcceleratedCodeFragment(),
+                                     &error,
+                                     shader_cache_dir_);
+
+      if (!program) {
+        qWarning() << error;
+      }
+    }
+
+    // Failures are cached too so we don't try to link them again for every frame
+    shader_cache_.Add(node->id(), program);
+  }
+
+  return shader_cache_.Get(node->id());
+}
+
 void OpenGLWorker::FinishInit()
 {
   // Make context current on that surface
@@ -398,4 +431,5 @@ void OpenGLWorker::FinishInit()
   ParametersChangedEvent();
 
   buffer_.Create(ctx_);
+  uploader_.Create(ctx_);
 }
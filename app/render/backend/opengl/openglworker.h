@@ -7,13 +7,16 @@
 #include "../videorenderworker.h"
 #include "openglframebuffer.h"
 #include "openglshadercache.h"
+#include "openglshadercompiler.h"
 #include "opengltexturecache.h"
+#include "opengltextureuploader.h"
 
 class OpenGLWorker : public VideoRenderWorker {
   Q_OBJECT
 public:
   OpenGLWorker(QOpenGLContext* share_ctx,
-               OpenGLShaderCache* shader_cache,
+               OpenGLShaderCompiler* shader_compiler,
+               const QString& shader_cache_dir,
                OpenGLTextureCache* texture_cache,
                VideoRenderFrameCache* frame_cache,
                QObject* parent = nullptr);
@@ -55,6 +58,15 @@ protected:
   virtual void ParametersChangedEvent() override;
 
 private:
+  /**
+   * @brief Get this worker's own program for a Node's accelerated code, linking it the first time it's needed
+   *
+   * Every worker has its own programs so they never wait on each other to set uniforms and draw. If the backend's
+   * shader compiler is still linking this Node's code, this waits for it so the program can be loaded from the binary
+   * it leaves in the cache. Returns nullptr if the Node isn't accelerated or its code fails to link.
+   */
+  OpenGLShaderPtr GetShader(const Node* node);
+
   QOpenGLContext* share_ctx_;
 
   QOpenGLContext* ctx_;
@@ -64,10 +76,19 @@ private:
 
   OpenGLFramebuffer buffer_;
 
-  OpenGLShaderCache* shader_cache_;
+  OpenGLShaderCompiler* shader_compiler_;
+
+  /**
+   * @brief Where program binaries are cached, resolved by the backend since only the main thread can read the config
+   */
+  QString shader_cache_dir_;
+
+  OpenGLShaderCache shader_cache_;
 
   OpenGLTextureCache* texture_cache_;
 
+  OpenGLTextureUploader uploader_;
+
 private slots:
   void FinishInit();
 
@@ -6,17 +6,24 @@
 #include "core.h"
 #include "window/mainwindow/mainwindow.h"
 
+const int RenderBackend::kJobsPerWorker = 4;
+
 RenderBackend::RenderBackend(QObject *parent) :
   QObject(parent),
   compiled_(false),
+  worker_count_(0),
   started_(false),
   viewer_node_(nullptr),
-  copied_viewer_node_(nullptr),
-  recompile_queued_(false),
-  input_update_queued_(false)
+  current_snapshot_(-1),
+  idle_wait_loop_(nullptr),
+  cache_next_queued_(false)
 {
-  // FIXME: Don't create in CLI mode
-  cancel_dialog_ = new RenderCancelDialog(Core::instance()->main_window());
+  // There's no GUI to show the dialog in when exporting from the command line
+  if (Core::instance()->IsHeadless()) {
+    cancel_dialog_ = nullptr;
+  } else {
+    cancel_dialog_ = new RenderCancelDialog(Core::instance()->main_window());
+  }
 }
 
 bool RenderBackend::Init()
@@ -25,7 +32,7 @@ bool RenderBackend::Init()
     return true;
   }
 
-  threads_.resize(qMax(1, QThread::idealThreadCount() - 1));
+  threads_.resize((worker_count_ > 0) ? worker_count_ : qMax(1, QThread::idealThreadCount() - 1));
 
   for (int i=0;i<threads_.size();i++) {
     QThread* thread = new QThread(this);
@@ -35,7 +42,9 @@ bool RenderBackend::Init()
     thread->start(QThread::LowPriority);
   }
 
-  cancel_dialog_->SetWorkerCount(threads_.size());
+  if (cancel_dialog_) {
+    cancel_dialog_->SetWorkerCount(threads_.size());
+  }
 
   started_ = InitInternal();
 
@@ -111,59 +120,87 @@ bool RenderBackend::IsInitiated()
   return started_;
 }
 
+void RenderBackend::SetWorkerCount(int count)
+{
+  worker_count_ = count;
+}
+
 void RenderBackend::InvalidateCache(const rational &start_range, const rational &end_range)
+{
+  TimeRangeList ranges;
+  ranges.append(TimeRange(start_range, end_range));
+
+  InvalidateCacheRanges(ranges);
+}
+
+void RenderBackend::InvalidateCacheRanges(const TimeRangeList &ranges)
 {
   if (!CanRender()) {
     return;
   }
 
-  // Adjust range to min/max values
-  rational start_range_adj = qMax(rational(0), start_range);
-  rational end_range_adj = qMin(GetSequenceLength(), end_range);
+  rational length = GetSequenceLength();
+
+  TimeRangeList adjusted_ranges;
 
-  qDebug() << "Cache invalidated between"
-           << start_range_adj.toDouble()
-           << "and"
-           << end_range_adj.toDouble();
+  foreach (const TimeRange& range, ranges) {
+    // Adjust range to min/max values
+    rational start_range_adj = qMax(rational(0), range.in());
+    rational end_range_adj = qMin(length, range.out());
 
-  // Queue value update
-  QueueValueUpdate();
+    qDebug() << "Cache invalidated between"
+             << start_range_adj.toDouble()
+             << "and"
+             << end_range_adj.toDouble();
 
-  InvalidateCacheInternal(start_range_adj, end_range_adj);
+    adjusted_ranges.append(TimeRange(start_range_adj, end_range_adj));
+  }
+
+  InvalidateCacheInternal(adjusted_ranges);
 }
 
 bool RenderBackend::Compile()
 {
-  if (compiled_) {
-    return true;
+  if (current_snapshot_ != -1) {
+    const GraphSnapshot& current = snapshots_[current_snapshot_];
+
+    if (!current.topology_dirty && current.dirty_inputs.isEmpty() && current.orphaned_copies.isEmpty()) {
+      // Nothing has changed since the last sync
+      if (!compiled_) {
+        compiled_ = CompileInternal();
+      }
+
+      return compiled_;
+    }
   }
 
-  // Get dependencies of viewer node
-  source_node_list_.append(viewer_node_);
-  source_node_list_.append(viewer_node_->GetDependencies());
+  // Jobs that haven't started would render from the outdated graph, take them back so they use the new one
+  ReturnPendingJobs();
 
-  // Copy all dependencies into graph
-  foreach (Node* n, source_node_list_) {
-    Node* copy = n->copy();
+  // Prefer the snapshot workers aren't rendering from so that jobs already in progress can finish on the old graph
+  // while this one is brought up to date
+  int target = -1;
 
-    Node::CopyInputs(n, copy, false);
+  for (int i=1;i<=2;i++) {
+    int index = (current_snapshot_ + i) % 2;
 
-    copied_graph_.AddNode(copy);
+    if (snapshots_[index].jobs.loadAcquire() == 0) {
+      target = index;
+      break;
+    }
   }
 
-  // We just copied the inputs, so if an input update is queued, it's unnecessary
-  input_update_queued_ = false;
-
-  // We know that the first node will be the viewer node since we appended that first in the copy
-  copied_viewer_node_ = static_cast<ViewerOutput*>(copied_graph_.nodes().first());
+  if (target == -1) {
+    // Both are still in use, we'll be called again when the workers run out of jobs
+    return false;
+  }
 
-  // Copy connections
-  Node::DuplicateConnectionsBetweenLists(source_node_list_, copied_graph_.nodes());
+  bool topology_changed = SyncSnapshot(&snapshots_[target]);
 
-  compiled_ = CompileInternal();
+  current_snapshot_ = target;
 
-  if (!compiled_) {
-    Decompile();
+  if (topology_changed || !compiled_) {
+    compiled_ = CompileInternal();
   }
 
   return compiled_;
@@ -171,17 +208,163 @@ bool RenderBackend::Compile()
 
 void RenderBackend::Decompile()
 {
-  if (!compiled_) {
+  if (current_snapshot_ == -1) {
+    return;
+  }
+
+  if (compiled_) {
+    DecompileInternal();
+    compiled_ = false;
+  }
+
+  QVector<const Node*> deleted_nodes;
+
+  for (int i=0;i<2;i++) {
+    GraphSnapshot& snapshot = snapshots_[i];
+
+    foreach (Node* n, snapshot.graph.nodes()) {
+      deleted_nodes.append(n);
+    }
+
+    snapshot.graph.Clear();
+    snapshot.copies.clear();
+    snapshot.viewer = nullptr;
+    snapshot.dirty_inputs.clear();
+    snapshot.orphaned_copies.clear();
+    snapshot.topology_dirty = true;
+  }
+
+  NotifyWorkersNodesChanged(deleted_nodes);
+
+  foreach (Node* n, tracked_nodes_) {
+    foreach (NodeParam* param, n->parameters()) {
+      disconnect(param, nullptr, this, nullptr);
+    }
+
+    disconnect(n, nullptr, this, nullptr);
+  }
+
+  tracked_nodes_.clear();
+
+  current_snapshot_ = -1;
+}
+
+bool RenderBackend::SyncSnapshot(RenderBackend::GraphSnapshot *snapshot)
+{
+  QVector<const Node*> changed_nodes;
+
+  bool topology_changed = snapshot->topology_dirty || !snapshot->orphaned_copies.isEmpty();
+
+  foreach (Node* copy, snapshot->orphaned_copies) {
+    changed_nodes.append(copy);
+
+    snapshot->graph.TakeNode(copy);
+    delete copy;
+  }
+
+  snapshot->orphaned_copies.clear();
+
+  if (snapshot->topology_dirty) {
+    QList<Node*> sources = viewer_node_->GetDependencies();
+    sources.prepend(viewer_node_);
+
+    QHash<Node*, Node*> copies;
+
+    foreach (Node* n, sources) {
+      // Only Nodes that are new to the graph need to be copied
+      Node* copy = snapshot->copies.take(n);
+
+      if (!copy) {
+        copy = n->copy();
+
+        Node::CopyInputs(n, copy, false);
+
+        snapshot->graph.AddNode(copy);
+
+        // We just copied all of its inputs
+        snapshot->dirty_inputs.remove(n);
+      }
+
+      copies.insert(n, copy);
+
+      TrackSourceNode(n);
+    }
+
+    // Anything left over is no longer part of the graph
+    foreach (Node* copy, snapshot->copies) {
+      changed_nodes.append(copy);
+
+      snapshot->graph.TakeNode(copy);
+      delete copy;
+    }
+
+    snapshot->copies = copies;
+    snapshot->viewer = static_cast<ViewerOutput*>(copies.value(viewer_node_));
+
+    Node::SyncConnections(copies);
+
+    // Any Node's connections may have changed
+    foreach (Node* copy, copies) {
+      changed_nodes.append(copy);
+    }
+
+    snapshot->topology_dirty = false;
+  }
+
+  // Copy only the inputs that have changed
+  QHash<Node*, QSet<NodeInput*> >::const_iterator i;
+
+  for (i=snapshot->dirty_inputs.constBegin();i!=snapshot->dirty_inputs.constEnd();i++) {
+    Node* copy = snapshot->copies.value(i.key());
+
+    if (!copy) {
+      // Not part of the graph
+      continue;
+    }
+
+    foreach (NodeInput* input, i.value()) {
+      NodeInput::CopyValues(input, static_cast<NodeInput*>(copy->GetParameterWithID(input->id())), false);
+    }
+
+    changed_nodes.append(copy);
+  }
+
+  snapshot->dirty_inputs.clear();
+
+  NotifyWorkersNodesChanged(changed_nodes);
+
+  return topology_changed;
+}
+
+void RenderBackend::TrackSourceNode(Node *n)
+{
+  if (tracked_nodes_.contains(n)) {
     return;
   }
 
-  DecompileInternal();
+  tracked_nodes_.insert(n);
+
+  foreach (NodeParam* param, n->parameters()) {
+    if (param->type() == NodeParam::kInput) {
+      NodeInput* input = static_cast<NodeInput*>(param);
+
+      connect(input, &NodeInput::ValueChanged, this, &RenderBackend::SourceInputChanged);
+      connect(input, &NodeInput::KeyframeEnableChanged, this, &RenderBackend::SourceInputChanged);
+    }
+  }
+
+  connect(n, &QObject::destroyed, this, &RenderBackend::SourceNodeDestroyed);
+}
 
-  copied_graph_.Clear();
-  copied_viewer_node_ = nullptr;
-  source_node_list_.clear();
+void RenderBackend::NotifyWorkersNodesChanged(const QVector<const Node *> &nodes)
+{
+  if (nodes.isEmpty()) {
+    return;
+  }
 
-  compiled_ = false;
+  foreach (RenderWorker* worker, processors_) {
+    worker->NodesChanged(nodes);
+  }
 }
 
 void RenderBackend::RegenerateCacheID()
@@ -207,9 +390,37 @@ bool RenderBackend::CanRender()
   return true;
 }
 
-TimeRange RenderBackend::PopNextFrameFromQueue()
+QList<TimeRange> RenderBackend::PopNextFramesFromQueue(int count)
+{
+  QList<TimeRange> ranges;
+
+  while (ranges.size() < count && !cache_queue_.isEmpty()) {
+    ranges.append(cache_queue_.takeFirst());
+  }
+
+  return ranges;
+}
+
+void RenderBackend::RequeueFrame(const TimeRange &range)
 {
-  return cache_queue_.takeFirst();
+  cache_queue_.InsertTimeRange(range);
+}
+
+void RenderBackend::ReturnPendingJobs()
+{
+  QList<RenderScheduler::Job> jobs = scheduler_.TakePendingJobs();
+
+  foreach (const RenderScheduler::Job& job, jobs) {
+    render_job_info_.remove(job.dependency.range());
+
+    RequeueFrame(job.dependency.range());
+
+    job.graph_refs->deref();
+
+    if (cancel_dialog_) {
+      cancel_dialog_->WorkerDone();
+    }
+  }
 }
 
 rational RenderBackend::GetSequenceLength()
@@ -238,7 +449,17 @@ void RenderBackend::DisconnectViewer(ViewerOutput *node)
 
 void RenderBackend::CacheNext()
 {
-  if (cache_queue_.isEmpty()) {
+  if (!cache_next_queued_) {
+    cache_next_queued_ = true;
+    QMetaObject::invokeMethod(this, "CacheNextInternal", Qt::QueuedConnection);
+  }
+}
+
+void RenderBackend::CacheNextInternal()
+{
+  cache_next_queued_ = false;
+
+  if (cache_queue_.isEmpty() && !scheduler_.HasPendingJobs()) {
     if (AllProcessorsAreAvailable()) {
       emit QueueComplete();
     }
@@ -252,47 +473,28 @@ void RenderBackend::CacheNext()
     return;
   }
 
-  if ((input_update_queued_ || recompile_queued_) && !AllProcessorsAreAvailable()) {
+  if (!Compile()) {
     return;
   }
 
-  if (recompile_queued_) {
-    Decompile();
-    recompile_queued_ = false;
-  }
-
-  if (!compiled_ && !Compile()) {
-    return;
-  }
-
-  if (input_update_queued_) {
-    for (int i=0;i<source_node_list_.size();i++) {
-      Node* src = source_node_list_.at(i);
-      Node* dst = copied_graph_.nodes().at(i);
-
-      Node::CopyInputs(src, dst, false);
-    }
-
-    input_update_queued_ = false;
-  }
-
   Node* node_connected_to_viewer = GetDependentInput()->get_connected_node();
 
   if (!node_connected_to_viewer) {
     return;
   }
 
-  foreach (RenderWorker* worker, processors_) {
-    if (cache_queue_.isEmpty()) {
-      break;
-    }
+  ScheduleJobs(node_connected_to_viewer);
+}
 
-    if (!WorkerIsBusy(worker)) {
-      TimeRange cache_frame = PopNextFrameFromQueue();
+void RenderBackend::ScheduleJobs(Node *node_connected_to_viewer)
+{
+  int wanted = kJobsPerWorker * processors_.size() - scheduler_.PendingJobCount();
 
-      NodeDependency dep = NodeDependency(node_connected_to_viewer,
-                                          cache_frame);
+  if (wanted > 0 && !cache_queue_.isEmpty()) {
+    QList<TimeRange> frames = PopNextFramesFromQueue(wanted);
+    QList<RenderScheduler::Job> jobs;
 
+    foreach (const TimeRange& cache_frame, frames) {
       // Timestamp this render job
       qint64 job_time = QDateTime::currentMSecsSinceEpoch();
 
@@ -301,31 +503,57 @@ void RenderBackend::CacheNext()
       //       can safely assume 0 means it doesn't exist.
       qint64 existing_job_time = render_job_info_.value(cache_frame);
 
-      if (existing_job_time == job_time) {
+      if (existing_job_time >= job_time) {
         job_time = existing_job_time + 1;
       }
 
       render_job_info_.insert(cache_frame, job_time);
 
+      RenderScheduler::Job job;
+      job.dependency = NodeDependency(node_connected_to_viewer, cache_frame);
+      job.job_time = job_time;
+      job.graph_refs = &snapshots_[current_snapshot_].jobs;
+      job.graph_refs->ref();
+      jobs.append(job);
+
+      if (cancel_dialog_) {
+        cancel_dialog_->WorkerStarted();
+      }
+    }
+
+    scheduler_.Schedule(jobs);
+  }
+
+  if (!scheduler_.HasPendingJobs()) {
+    return;
+  }
+
+  // Wake any idle workers, they'll steal from the others if nothing was scheduled on their own queue
+  foreach (RenderWorker* worker, processors_) {
+    if (!WorkerIsBusy(worker)) {
       SetWorkerBusyState(worker, true);
-      cancel_dialog_->WorkerStarted();
 
       QMetaObject::invokeMethod(worker,
-                                "Render",
-                                Qt::QueuedConnection,
-                                Q_ARG(NodeDependency, dep),
-                                Q_ARG(qint64, job_time));
+                                "ProcessQueue",
+                                Qt::QueuedConnection);
     }
   }
 }
 
 ViewerOutput *RenderBackend::viewer_node() const
 {
-  return copied_viewer_node_;
+  if (current_snapshot_ == -1) {
+    return nullptr;
+  }
+
+  return snapshots_[current_snapshot_].viewer;
 }
 
 void RenderBackend::CancelQueue()
 {
+  // Return jobs that haven't started so that anything tracking missing frames still knows about them
+  ReturnPendingJobs();
+
   cache_queue_.clear();
 
   int busy = 0;
@@ -335,7 +563,17 @@ void RenderBackend::CancelQueue()
   }
   qDebug() << this << "is waiting for" << busy << "busy workers";
 
-  cancel_dialog_->RunIfWorkersAreBusy();
+  if (cancel_dialog_) {
+    cancel_dialog_->RunIfWorkersAreBusy();
+  } else if (!AllProcessorsAreAvailable()) {
+    // Callers go on to clear the graphs the workers may still be walking, so wait here like the dialog would.
+    // WorkerQueueEmpty() ends the loop once every worker has reported back.
+    QEventLoop loop;
+
+    idle_wait_loop_ = &loop;
+    loop.exec();
+    idle_wait_loop_ = nullptr;
+  }
 }
 
 bool RenderBackend::ViewerIsConnected() const
@@ -348,19 +586,14 @@ const QString &RenderBackend::cache_id() const
   return cache_id_;
 }
 
-void RenderBackend::QueueValueUpdate()
-{
-  input_update_queued_ = true;
-}
-
 bool RenderBackend::WorkerIsBusy(RenderWorker *worker) const
 {
-  return processor_busy_state_.at(processors_.indexOf(worker));
+  return processor_busy_state_.at(worker->queue_index());
 }
 
 void RenderBackend::SetWorkerBusyState(RenderWorker *worker, bool busy)
 {
-  processor_busy_state_.replace(processors_.indexOf(worker), busy);
+  processor_busy_state_.replace(worker->queue_index(), busy);
 }
 
 bool RenderBackend::AllProcessorsAreAvailable() const
@@ -379,10 +612,10 @@ const QVector<QThread *> &RenderBackend::threads()
   return threads_;
 }
 
-void RenderBackend::InvalidateCacheInternal(const rational &start_range, const rational &end_range)
+void RenderBackend::InvalidateCacheInternal(const TimeRangeList &ranges)
 {
-  // Add the range to the list
-  cache_queue_.InsertTimeRange(TimeRange(start_range, end_range));
+  // Add the ranges to the list
+  cache_queue_.InsertTimeRanges(ranges);
 
   CacheNext();
 }
@@ -402,7 +635,13 @@ void RenderBackend::InitWorkers()
     ConnectWorkerToThis(processor);
 
     // Connect cancel dialog to it
-    connect(processor, &RenderWorker::CompletedCache, cancel_dialog_, &RenderCancelDialog::WorkerDone, Qt::QueuedConnection);
+    if (cancel_dialog_) {
+      connect(processor, &RenderWorker::CompletedCache, cancel_dialog_, &RenderCancelDialog::WorkerDone, Qt::QueuedConnection);
+    }
+
+    // Workers pull their jobs from the scheduler and tell us when they've run out
+    processor->SetScheduler(&scheduler_, i);
+    connect(processor, &RenderWorker::QueueEmpty, this, &RenderBackend::WorkerQueueEmpty, Qt::QueuedConnection);
 
     // Finally, we can move it to its own thread
     processor->moveToThread(thread);
@@ -413,9 +652,61 @@ void RenderBackend::InitWorkers()
 
   processor_busy_state_.resize(processors_.size());
   processor_busy_state_.fill(false);
+
+  scheduler_.SetQueueCount(processors_.size());
 }
 
 void RenderBackend::QueueRecompile()
 {
-  recompile_queued_ = true;
+  for (int i=0;i<2;i++) {
+    snapshots_[i].topology_dirty = true;
+  }
+}
+
+void RenderBackend::WorkerQueueEmpty()
+{
+  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
+
+  CacheNext();
+
+  if (idle_wait_loop_ && AllProcessorsAreAvailable()) {
+    idle_wait_loop_->quit();
+  }
+}
+
+void RenderBackend::SourceInputChanged()
+{
+  NodeInput* input = static_cast<NodeInput*>(sender());
+  Node* n = input->parentNode();
+
+  for (int i=0;i<2;i++) {
+    snapshots_[i].dirty_inputs[n].insert(input);
+  }
+}
+
+void RenderBackend::SourceNodeDestroyed(QObject *obj)
+{
+  // The Node is already being destroyed so this pointer is only used as a key
+  Node* n = static_cast<Node*>(obj);
+
+  tracked_nodes_.remove(n);
+
+  for (int i=0;i<2;i++) {
+    GraphSnapshot& snapshot = snapshots_[i];
+
+    snapshot.dirty_inputs.remove(n);
+
+    // The copy may still be in use by a worker, so it's deleted on the next sync
+    Node* copy = snapshot.copies.take(n);
+
+    if (copy) {
+      snapshot.orphaned_copies.append(copy);
+    }
+  }
+}
+
+RenderBackend::GraphSnapshot::GraphSnapshot() :
+  viewer(nullptr),
+  topology_dirty(true)
+{
 }
@@ -1,13 +1,16 @@
 #ifndef RENDERBACKEND_H
 #define RENDERBACKEND_H
 
+#include <QAtomicInt>
+#include <QEventLoop>
 #include <QLinkedList>
+#include <QSet>
 
 #include "common/constructors.h"
 #include "dialog/rendercancel/rendercancel.h"
-#include "decodercache.h"
 #include "node/graph.h"
 #include "node/output/viewer/viewer.h"
+#include "renderscheduler.h"
 #include "renderworker.h"
 
 class RenderBackend : public QObject
@@ -26,6 +29,14 @@ public:
 
   bool IsInitiated();
 
+  /**
+   * @brief Set how many worker threads Init() starts
+   *
+   * 0 (the default) uses one less than the number of CPU cores. Only takes effect the next time the backend is
+   * initialized.
+   */
+  void SetWorkerCount(int count);
+
   ViewerOutput* viewer_node() const;
 
   void CancelQueue();
@@ -33,6 +44,11 @@ public:
 public slots:
   void InvalidateCache(const rational &start_range, const rational &end_range);
 
+  /**
+   * @brief Invalidate several ranges at once, queueing them in one pass rather than one InvalidateCache() each
+   */
+  void InvalidateCacheRanges(const TimeRangeList &ranges);
+
   bool Compile();
 
   void Decompile();
@@ -53,7 +69,22 @@ protected:
 
   virtual bool CanRender();
 
-  virtual TimeRange PopNextFrameFromQueue();
+  /**
+   * @brief Remove up to `count` frames from the queue, highest priority first
+   */
+  virtual QList<TimeRange> PopNextFramesFromQueue(int count);
+
+  /**
+   * @brief Put a frame that was popped from the queue but never rendered back into it
+   */
+  virtual void RequeueFrame(const TimeRange& range);
+
+  /**
+   * @brief Pull every job that no worker has started yet out of the scheduler and back into the queue
+   *
+   * Used when the queue's priorities change so that the jobs are handed out again in the new order.
+   */
+  void ReturnPendingJobs();
 
   rational GetSequenceLength();
 
@@ -64,7 +95,7 @@ protected:
    */
   virtual bool GenerateCacheIDInternal(QCryptographicHash& hash) = 0;
 
-  virtual void InvalidateCacheInternal(const rational &start_range, const rational &end_range);
+  virtual void InvalidateCacheInternal(const TimeRangeList &ranges);
 
   virtual void CacheIDChangedEvent(const QString& id);
 
@@ -76,6 +107,10 @@ protected:
   /**
    * @brief Function called when there are frames in the queue to cache
    *
+   * Schedules one CacheNextInternal() on the event loop, however many times it's called before that runs. This also
+   * lets the input behind an InvalidateCache() be marked dirty by SourceInputChanged() (connected after the Node's own
+   * slot that led there) before anything is compiled from it.
+   *
    * This function is NOT thread-safe and should only be called in the main thread.
    */
   void CacheNext();
@@ -90,8 +125,6 @@ protected:
 
   const QString& cache_id() const;
 
-  void QueueValueUpdate();
-
   bool AllProcessorsAreAvailable() const;
   bool WorkerIsBusy(RenderWorker* worker) const;
   void SetWorkerBusyState(RenderWorker* worker, bool busy);
@@ -107,12 +140,84 @@ protected:
 protected slots:
   void QueueRecompile();
 
+private slots:
+  void WorkerQueueEmpty();
+
+  void SourceInputChanged();
+
+  void SourceNodeDestroyed(QObject* obj);
+
+  /**
+   * @brief Queued by CacheNext() to schedule jobs for the frames in the queue
+   */
+  void CacheNextInternal();
+
 private:
+  /**
+   * @brief A copy of the viewer's node graph for the workers to render from
+   *
+   * Two of these are kept so that workers can finish the jobs they already have from one while the other is brought
+   * up to date. Changes are tracked per input so that only inputs that were actually modified get copied again.
+   */
+  struct GraphSnapshot {
+    GraphSnapshot();
+
+    NodeGraph graph;
+
+    /// Source Node -> its copy in `graph`
+    QHash<Node*, Node*> copies;
+
+    ViewerOutput* viewer;
+
+    /// Inputs of source Nodes that have changed since this snapshot was last synced
+    QHash<Node*, QSet<NodeInput*> > dirty_inputs;
+
+    /// Copies whose source Node was destroyed, deleted on the next sync
+    QVector<Node*> orphaned_copies;
+
+    /// Whether Nodes or connections have changed since this snapshot was last synced
+    bool topology_dirty;
+
+    /// Number of jobs rendering from this snapshot that workers haven't finished yet
+    QAtomicInt jobs;
+  };
+
+  /**
+   * @brief Bring a snapshot up to date with the source graph
+   *
+   * Must only be called on a snapshot that no worker is rendering from.
+   *
+   * @return Whether the snapshot's topology changed.
+   */
+  bool SyncSnapshot(GraphSnapshot* snapshot);
+
+  /**
+   * @brief Start tracking changes to a source Node's inputs
+   */
+  void TrackSourceNode(Node* n);
+
+  void NotifyWorkersNodesChanged(const QVector<const Node*>& nodes);
+
+  /**
+   * @brief Move frames from the queue into the scheduler and wake any idle workers to render them
+   */
+  void ScheduleJobs(Node* node_connected_to_viewer);
+
+  /**
+   * @brief Number of jobs kept in the scheduler for each worker
+   *
+   * Enough that a worker rarely runs dry before the main thread tops it up, but few enough that the queue can still
+   * be reprioritized cheaply.
+   */
+  static const int kJobsPerWorker;
+
   /**
    * @brief Internal list of RenderProcessThreads
    */
   QVector<QThread*> threads_;
 
+  int worker_count_;
+
   /**
    * @brief Internal variable that contains whether the Renderer has started or not
    */
@@ -123,11 +228,6 @@ private:
    */
   ViewerOutput* viewer_node_;
 
-  /**
-   * @brief Internal reference to the copied viewer node we made in the compilation process
-   */
-  ViewerOutput* copied_viewer_node_;
-
   /**
    * @brief Error string that can be set in SetError() to handle failures
    */
@@ -135,16 +235,37 @@ private:
 
   QString cache_id_;
 
-  QList<Node*> source_node_list_;
-  NodeGraph copied_graph_;
+  GraphSnapshot snapshots_[2];
 
-  bool recompile_queued_;
-  bool input_update_queued_;
+  /**
+   * @brief Index of the snapshot new jobs are rendered from, or -1 if the graph hasn't been copied yet
+   */
+  int current_snapshot_;
 
+  /**
+   * @brief Source Nodes whose inputs are being tracked for changes
+   */
+  QSet<Node*> tracked_nodes_;
+
+  /**
+   * @brief Whether each worker has been woken with ProcessQueue() and hasn't reported QueueEmpty() back yet
+   */
   QVector<bool> processor_busy_state_;
 
+  RenderScheduler scheduler_;
+
   RenderCancelDialog* cancel_dialog_;
 
+  /**
+   * @brief Event loop CancelQueue() waits in for busy workers when there's no cancel dialog to do it (headless)
+   */
+  QEventLoop* idle_wait_loop_;
+
+  /**
+   * @brief Set while a CacheNextInternal() call is waiting on the event loop
+   */
+  bool cache_next_queued_;
+
 };
 
 #endif // RENDERBACKEND_H
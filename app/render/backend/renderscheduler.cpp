@@ -0,0 +1,128 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderscheduler.h"
+
+#include <QMutexLocker>
+
+RenderScheduler::RenderScheduler() :
+  pending_count_(0)
+{
+}
+
+void RenderScheduler::SetQueueCount(int count)
+{
+  QMutexLocker locker(&lock_);
+
+  queues_.clear();
+  queues_.resize(count);
+  pending_count_ = 0;
+}
+
+void RenderScheduler::Schedule(const QList<Job> &jobs)
+{
+  QMutexLocker locker(&lock_);
+
+  if (queues_.isEmpty()) {
+    return;
+  }
+
+  foreach (const Job& job, jobs) {
+    int shortest = 0;
+
+    for (int i=1;i<queues_.size();i++) {
+      if (queues_.at(i).size() < queues_.at(shortest).size()) {
+        shortest = i;
+      }
+    }
+
+    queues_[shortest].append(job);
+  }
+
+  pending_count_ += jobs.size();
+}
+
+bool RenderScheduler::TakeJob(int queue, RenderScheduler::Job *job)
+{
+  QMutexLocker locker(&lock_);
+
+  if (pending_count_ == 0 || queue < 0 || queue >= queues_.size()) {
+    return false;
+  }
+
+  QList<Job>& own_queue = queues_[queue];
+
+  if (own_queue.isEmpty()) {
+    // Steal from whichever worker has the most left to do
+    int longest = -1;
+
+    for (int i=0;i<queues_.size();i++) {
+      if (i != queue
+          && !queues_.at(i).isEmpty()
+          && (longest == -1 || queues_.at(i).size() > queues_.at(longest).size())) {
+        longest = i;
+      }
+    }
+
+    if (longest == -1) {
+      return false;
+    }
+
+    // Take the back half (the lowest priority jobs), leaving the front for the worker that's already on it
+    QList<Job>& victim = queues_[longest];
+    int steal_count = (victim.size() + 1) / 2;
+
+    own_queue = victim.mid(victim.size() - steal_count);
+    victim.erase(victim.end() - steal_count, victim.end());
+  }
+
+  *job = own_queue.takeFirst();
+  pending_count_--;
+
+  return true;
+}
+
+QList<RenderScheduler::Job> RenderScheduler::TakePendingJobs()
+{
+  QMutexLocker locker(&lock_);
+
+  QList<Job> jobs;
+
+  for (int i=0;i<queues_.size();i++) {
+    jobs.append(queues_.at(i));
+    queues_[i].clear();
+  }
+
+  pending_count_ = 0;
+
+  return jobs;
+}
+
+int RenderScheduler::PendingJobCount()
+{
+  QMutexLocker locker(&lock_);
+
+  return pending_count_;
+}
+
+bool RenderScheduler::HasPendingJobs()
+{
+  return PendingJobCount() > 0;
+}
@@ -0,0 +1,96 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include "common/constructors.h"
+#include "node/dependency.h"
+
+/**
+ * @brief Thread-safe set of render job queues shared between a RenderBackend and its workers
+ *
+ * Each worker has its own queue, which the backend fills in priority order and the worker drains from the front
+ * without going back through the main thread. When a worker's queue runs dry it steals the back half of the longest
+ * remaining queue, so no worker sits idle while another still has a backlog.
+ *
+ * The backend only keeps a few jobs per worker in here at any time. Everything else stays in the backend's own queue
+ * where it can still be reprioritized (e.g. when the playhead moves), and TakePendingJobs() can be used to pull jobs
+ * that haven't started yet back out for the same reason.
+ */
+class RenderScheduler
+{
+public:
+  struct Job {
+    NodeDependency dependency;
+    qint64 job_time;
+
+    /// Reference count of the graph snapshot `dependency` belongs to, released once the job has been rendered
+    QAtomicInt* graph_refs;
+  };
+
+  RenderScheduler();
+
+  DISABLE_COPY_MOVE(RenderScheduler)
+
+  /**
+   * @brief Set the number of worker queues, discarding any jobs still pending
+   */
+  void SetQueueCount(int count);
+
+  /**
+   * @brief Add jobs, ordered from highest to lowest priority
+   *
+   * Each job goes to whichever queue is currently shortest, so high priority jobs end up near the front of every
+   * queue rather than all in one.
+   */
+  void Schedule(const QList<Job>& jobs);
+
+  /**
+   * @brief Take the next job for a worker, stealing from another queue if this one is empty
+   *
+   * @return False if there are no jobs left anywhere.
+   */
+  bool TakeJob(int queue, Job* job);
+
+  /**
+   * @brief Remove and return every job that hasn't been taken by a worker yet
+   */
+  QList<Job> TakePendingJobs();
+
+  int PendingJobCount();
+
+  bool HasPendingJobs();
+
+private:
+  QMutex lock_;
+
+  QVector< QList<Job> > queues_;
+
+  int pending_count_;
+
+};
+
+#endif // RENDERSCHEDULER_H
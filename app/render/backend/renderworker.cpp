@@ -6,7 +6,10 @@
 
 RenderWorker::RenderWorker(QObject *parent) :
   QObject(parent),
-  started_(false)
+  started_(false),
+  scheduler_(nullptr),
+  queue_index_(-1),
+  job_failed_(false)
 {
 }
 
@@ -27,16 +30,45 @@ void RenderWorker::Close()
 {
   CloseInternal();
 
-  decoder_cache_.Clear();
-
   started_ = false;
 }
 
 void RenderWorker::Render(NodeDependency path, qint64 job_time)
 {
+  job_failed_ = false;
+
   emit CompletedCache(path, RenderInternal(path, job_time), job_time);
 }
 
+void RenderWorker::ProcessQueue()
+{
+  RenderScheduler::Job job;
+
+  while (scheduler_ && scheduler_->TakeJob(queue_index_, &job)) {
+    // The backend may have modified Nodes since our last job, make sure nothing we cached about them is used
+    changed_nodes_lock_.lock();
+    QVector<const Node*> changed_nodes = changed_nodes_;
+    changed_nodes_.clear();
+    changed_nodes_lock_.unlock();
+
+    if (!changed_nodes.isEmpty()) {
+      NodesChangedEvent(changed_nodes);
+    }
+
+    Render(job.dependency, job.job_time);
+
+    // Let the backend know we're done with the graph snapshot this job was rendered from
+    job.graph_refs->deref();
+  }
+
+  emit QueueEmpty();
+}
+
+void RenderWorker::NodesChangedEvent(const QVector<const Node *> &nodes)
+{
+  Q_UNUSED(nodes)
+}
+
 NodeValueTable RenderWorker::RenderInternal(const NodeDependency &path, const qint64 &job_time)
 {
   Q_UNUSED(job_time)
@@ -57,19 +89,15 @@ StreamPtr RenderWorker::ResolveStreamFromInput(NodeInput *input)
   return input->get_value_at_time(0).value<StreamPtr>();
 }
 
-DecoderPtr RenderWorker::ResolveDecoderFromInput(StreamPtr stream)
+DecoderPtr RenderWorker::ResolveDecoderFromInput(StreamPtr stream, const rational &time)
 {
-  // Access a map of Node inputs and decoder instances and retrieve a frame!
-  DecoderPtr decoder = decoder_cache_.Get(stream.get());
-
-  if (decoder == nullptr && stream != nullptr) {
-    // Create a new Decoder here
-    decoder = Decoder::CreateFromID(stream->footage()->decoder());
-    decoder->set_stream(stream);
-    decoder_cache_.Add(stream.get(), decoder);
-  }
+  // Decoders are shared between all workers, the pool will pick one that's already close to this time
+  return DecoderPool::instance()->Get(stream, time);
+}
 
-  return decoder;
+DecoderPtr RenderWorker::PeekDecoderFromInput(StreamPtr stream)
+{
+  return DecoderPool::instance()->Peek(stream);
 }
 
 bool RenderWorker::IsStarted()
@@ -77,6 +105,34 @@ bool RenderWorker::IsStarted()
   return started_;
 }
 
+void RenderWorker::SetScheduler(RenderScheduler *scheduler, int queue_index)
+{
+  scheduler_ = scheduler;
+  queue_index_ = queue_index;
+}
+
+void RenderWorker::SetJobFailed()
+{
+  job_failed_ = true;
+}
+
+bool RenderWorker::JobFailed() const
+{
+  return job_failed_;
+}
+
+int RenderWorker::queue_index() const
+{
+  return queue_index_;
+}
+
+void RenderWorker::NodesChanged(const QVector<const Node *> &nodes)
+{
+  QMutexLocker locker(&changed_nodes_lock_);
+
+  changed_nodes_.append(nodes);
+}
+
 NodeValueTable RenderWorker::ProcessNode(const NodeDependency& dep)
 {
   const Node* node = dep.node();
@@ -133,7 +189,7 @@ NodeValueDatabase RenderWorker::GenerateDatabase(const Node* node, const TimeRan
         StreamPtr stream = ResolveStreamFromInput(input);
 
         if (stream) {
-          DecoderPtr decoder = ResolveDecoderFromInput(stream);
+          DecoderPtr decoder = ResolveDecoderFromInput(stream, input_time.in());
 
           if (decoder) {
             FramePtr frame = RetrieveFromDecoder(decoder, input_time);
@@ -1,12 +1,14 @@
 #ifndef RENDERWORKER_H
 #define RENDERWORKER_H
 
+#include <QMutex>
 #include <QObject>
 
 #include "common/constructors.h"
 #include "node/output/track/track.h"
 #include "node/node.h"
-#include "decodercache.h"
+#include "decoderpool.h"
+#include "renderscheduler.h"
 
 class RenderWorker : public QObject
 {
@@ -20,17 +22,47 @@ public:
 
   bool IsStarted();
 
+  /**
+   * @brief Set the scheduler this worker pulls jobs from in ProcessQueue() and which of its queues is ours
+   */
+  void SetScheduler(RenderScheduler* scheduler, int queue_index);
+
+  int queue_index() const;
+
+  /**
+   * @brief Notify the worker that Nodes it may render from have been modified, added or deleted
+   *
+   * Thread-safe. The worker handles this before starting its next job by calling NodesChangedEvent(), so anything it
+   * has cached about these Nodes can be dropped there.
+   */
+  void NodesChanged(const QVector<const Node*>& nodes);
+
 public slots:
   void Close();
 
   void Render(NodeDependency path, qint64 job_time);
 
+  /**
+   * @brief Render jobs from the scheduler until there are none left, then emit QueueEmpty()
+   */
+  void ProcessQueue();
+
 signals:
   void CompletedCache(NodeDependency dep, NodeValueTable data, qint64 job_time);
 
+  /**
+   * @brief Emitted when ProcessQueue() has run out of jobs
+   *
+   * Since this is emitted after every completion signal for the jobs this worker took, a receiver in another thread
+   * will have handled all of them by the time it receives this.
+   */
+  void QueueEmpty();
+
 protected:
   virtual bool InitInternal() = 0;
 
+  virtual void NodesChangedEvent(const QVector<const Node*>& nodes);
+
   virtual void CloseInternal() = 0;
 
   virtual NodeValueTable RenderInternal(const NodeDependency& path, const qint64& job_time);
@@ -38,7 +70,12 @@ protected:
   virtual void RunNodeAccelerated(const Node *node, const TimeRange& range, const NodeValueDatabase &input_params, NodeValueTable* output_params);
 
   StreamPtr ResolveStreamFromInput(NodeInput* input);
-  DecoderPtr ResolveDecoderFromInput(StreamPtr stream);
+  DecoderPtr ResolveDecoderFromInput(StreamPtr stream, const rational &time);
+
+  /**
+   * @brief Get a decoder for `stream` to query (e.g. for timestamps) without moving any decoder's position
+   */
+  DecoderPtr PeekDecoderFromInput(StreamPtr stream);
 
   virtual FramePtr RetrieveFromDecoder(DecoderPtr decoder, const TimeRange& range) = 0;
 
@@ -50,12 +87,27 @@ protected:
 
   NodeValueTable ProcessInput(const NodeInput* input, const TimeRange &range);
 
+  /**
+   * @brief Mark the job currently being rendered as failed (e.g. a node in it couldn't run) so it isn't cached
+   */
+  void SetJobFailed();
+
+  bool JobFailed() const;
+
 private:
   NodeValueDatabase GenerateDatabase(const Node *node, const TimeRange &range);
 
   bool started_;
 
-  DecoderCache decoder_cache_;
+  RenderScheduler* scheduler_;
+
+  int queue_index_;
+
+  bool job_failed_;
+
+  QMutex changed_nodes_lock_;
+
+  QVector<const Node*> changed_nodes_;
 
 };
 
@@ -30,7 +30,6 @@
 #include "common/timecodefunctions.h"
 #include "config/config.h"
 #include "render/diskmanager.h"
-#include "render/diskmanager.h"
 #include "render/pixelservice.h"
 #include "videorenderworker.h"
 
@@ -44,13 +43,15 @@ VideoRenderBackend::VideoRenderBackend(QObject *parent) :
 
 bool VideoRenderBackend::InitInternal()
 {
-  ResizeCacheLoadBuffer();
+  UpdateMemoryCacheLimit();
+  UpdateFrameCacheCodec();
   return true;
 }
 
 void VideoRenderBackend::CloseInternal()
 {
-  cache_frame_load_buffer_.clear();
+  memory_cache_.clear();
+  current_frame_.clear();
 }
 
 void VideoRenderBackend::ConnectViewer(ViewerOutput *node)
@@ -81,8 +82,10 @@ void VideoRenderBackend::SetParameters(const VideoRenderingParams& params)
   // Set new parameters
   params_ = params;
 
-  // Resize frame load buffer
-  ResizeCacheLoadBuffer();
+  UpdateFrameCacheCodec();
+
+  // Frames in memory were loaded with the old parameters
+  memory_cache_.clear();
 
   // Handle custom events from derivatives
   ParamsChangedEvent();
@@ -152,16 +155,18 @@ void VideoRenderBackend::ConnectWorkerToThis(RenderWorker *processor)
   connect(video_processor, &VideoRenderWorker::HashAlreadyBeingCached, this, &VideoRenderBackend::ThreadSkippedFrame, Qt::QueuedConnection);
   connect(video_processor, &VideoRenderWorker::CompletedDownload, this, &VideoRenderBackend::ThreadCompletedDownload, Qt::QueuedConnection);
   connect(video_processor, &VideoRenderWorker::HashAlreadyExists, this, &VideoRenderBackend::ThreadHashAlreadyExists, Qt::QueuedConnection);
+  connect(video_processor, &VideoRenderWorker::RenderFailed, this, &VideoRenderBackend::ThreadRenderFailed, Qt::QueuedConnection);
 }
 
-void VideoRenderBackend::InvalidateCacheInternal(const rational &start_range, const rational &end_range)
+void VideoRenderBackend::InvalidateCacheInternal(const TimeRangeList &ranges)
 {
-  TimeRange invalidated(start_range, end_range);
-
-  invalidated_.InsertTimeRange(invalidated);
+  invalidated_.InsertTimeRanges(ranges);
 
-  emit RangeInvalidated(invalidated);
+  foreach (const TimeRange& invalidated, ranges) {
+    emit RangeInvalidated(invalidated);
+  }
 
+  // Rebuild the queue once for all of them
   Requeue();
 }
 
@@ -175,22 +180,33 @@ VideoRenderFrameCache *VideoRenderBackend::frame_cache()
 }
 
 const char *VideoRenderBackend::GetCachedFrame(const rational &time)
+{
+  QByteArray frame_hash = GetCachedFrameHash(time);
+
+  if (frame_hash.isEmpty()) {
+    return nullptr;
+  }
+
+  return GetCachedFrameData(frame_hash);
+}
+
+QByteArray VideoRenderBackend::GetCachedFrameHash(const rational &time)
 {
   last_time_requested_ = time;
 
   if (viewer_node() == nullptr) {
     // Nothing is connected - nothing to show or render
-    return nullptr;
+    return QByteArray();
   }
 
   if (cache_id().isEmpty()) {
     qWarning() << "No cache ID";
-    return nullptr;
+    return QByteArray();
   }
 
   if (!params_.is_valid()) {
     qWarning() << "Invalid parameters";
-    return nullptr;
+    return QByteArray();
   }
 
   Requeue();
@@ -198,31 +214,41 @@ const char *VideoRenderBackend::GetCachedFrame(const rational &time)
   // Find frame in map
   QByteArray frame_hash = frame_cache_.TimeToHash(time);
 
-  if (!frame_hash.isEmpty()) {
-    QString fn = frame_cache_.CachePathName(frame_hash, params_.format());
+  if (!frame_hash.isEmpty()
+      && (memory_cache_.contains(frame_hash)
+          || !frame_cache_.FindCachedFile(frame_hash, params_.format()).isEmpty())) {
+    return frame_hash;
+  }
 
-    if (QFileInfo::exists(fn)) {
-      auto in = OIIO::ImageInput::open(fn.toStdString());
+  return QByteArray();
+}
 
-      if (in) {
-        DiskManager::instance()->Accessed(frame_hash);
+const char *VideoRenderBackend::GetCachedFrameData(const QByteArray &hash)
+{
+  // Keep the disk cache's usage order up to date even if we don't read the file
+  DiskManager::instance()->Accessed(hash);
 
-        in->read_image(PixelService::GetPixelFormatInfo(params_.format()).oiio_desc, cache_frame_load_buffer_.data());
+  QByteArray* cached = memory_cache_.object(hash);
 
-        in->close();
+  if (cached) {
+    current_frame_ = *cached;
+    return current_frame_.constData();
+  }
 
-#if OIIO_VERSION < 10903
-        OIIO::ImageInput::destroy(in);
-#endif
+  QByteArray frame(PixelService::GetBufferSize(params_.format(), params_.effective_width(), params_.effective_height()),
+                   Qt::Uninitialized);
 
-        return cache_frame_load_buffer_.constData();
-      } else {
-        qWarning() << "OIIO Error:" << OIIO::geterror().c_str();
-      }
-    }
+  if (!frame_cache_.LoadFrame(hash, params_, frame.data())) {
+    return nullptr;
   }
 
-  return nullptr;
+  UpdateMemoryCacheLimit();
+
+  // Cost is in kilobytes since QCache uses an int
+  memory_cache_.insert(hash, new QByteArray(frame), qMax(1, frame.size() / 1024));
+
+  current_frame_ = frame;
+  return current_frame_.constData();
 }
 
 NodeInput *VideoRenderBackend::GetDependentInput()
@@ -235,62 +261,110 @@ bool VideoRenderBackend::CanRender()
   return params_.is_valid();
 }
 
-TimeRange VideoRenderBackend::PopNextFrameFromQueue()
+QList<TimeRange> VideoRenderBackend::PopNextFramesFromQueue(int count)
 {
-  // Try to find the frame that's closest to the last time requested (the playhead)
+  // Take the frames closest to the last time requested (the playhead). Rather than enumerating every queued frame,
+  // each range gets a cursor starting at its frame nearest the playhead (two if the playhead is inside it, one moving
+  // each way), and we repeatedly take from whichever cursor is closest. This is O(count * ranges).
+  struct FrameCursor {
+    rational time;
+    rational limit;
+    bool forward;
+  };
+
+  const rational& timebase = params_.time_base();
+
+  rational playhead = Timecode::snap_time_to_timebase(last_time_requested_, timebase);
+  if (playhead > last_time_requested_) {
+    playhead -= timebase;
+  }
 
-  // Set up playhead frame range to see if the queue contains this frame precisely
-  TimeRange test_range(last_time_requested_, last_time_requested_ + params_.time_base());
+  QVector<FrameCursor> cursors;
 
-  // Use this variable to find the closest frame in the range
-  rational closest_time = -1;
+  foreach (const TimeRange& range_here, cache_queue_) {
+    rational first = Timecode::snap_time_to_timebase(range_here.in(), timebase);
+    if (first > range_here.in()) {
+      first -= timebase;
+    }
 
-  for (int i=0;i<cache_queue_.size();i++) {
-    const TimeRange& range_here = cache_queue_.at(i);
+    rational last = Timecode::snap_time_to_timebase(range_here.out(), timebase);
+    if (last >= range_here.out()) {
+      last -= timebase;
+    }
 
-    if (range_here.OverlapsWith(test_range, false, false)) {
-      closest_time = -1;
-      break;
+    if (last < first) {
+      continue;
+    }
+
+    if (playhead <= first) {
+      cursors.append({first, last, true});
+    } else if (playhead > last) {
+      cursors.append({last, first, false});
+    } else {
+      cursors.append({playhead, last, true});
+      cursors.append({playhead - timebase, first, false});
     }
+  }
+
+  QList<TimeRange> frames;
+
+  while (frames.size() < count) {
+    int closest = -1;
+    rational closest_distance;
+
+    for (int i=0;i<cursors.size();i++) {
+      const FrameCursor& c = cursors.at(i);
 
-    for (int i=0;i<2;i++) {
-      rational compare;
-
-      if (i == 0) {
-        compare = Timecode::snap_time_to_timebase(range_here.in(), params_.time_base());
-        if (compare > range_here.in()) {
-          compare -= params_.time_base();
-        }
-      } else {
-        compare = Timecode::snap_time_to_timebase(range_here.out(), params_.time_base());
-        if (compare >= range_here.out()) {
-          compare -= params_.time_base();
-        }
+      if (c.forward ? c.time > c.limit : c.time < c.limit) {
+        continue;
       }
 
-      if (closest_time < 0
-          || qAbs(compare - last_time_requested_) < qAbs(closest_time - last_time_requested_)) {
-        closest_time = compare;
+      rational distance = qAbs(c.time - playhead);
+
+      if (closest == -1 || distance < closest_distance) {
+        closest = i;
+        closest_distance = distance;
       }
     }
+
+    if (closest == -1) {
+      break;
+    }
+
+    FrameCursor& c = cursors[closest];
+
+    frames.append(TimeRange(c.time, c.time + timebase));
+
+    if (c.forward) {
+      c.time += timebase;
+    } else {
+      c.time -= timebase;
+    }
   }
 
-  TimeRange frame_range;
+  QList<TimeRange> snapped_frames;
+
+  foreach (const TimeRange& frame_range, frames) {
+    // Remove this particular frame from the queue
+    cache_queue_.RemoveTimeRange(frame_range);
 
-  if (closest_time == -1) {
-    frame_range = test_range;
-  } else {
-    frame_range = TimeRange(closest_time, closest_time + params_.time_base());
+    // Remove this particular frame from missing frames
+    invalidated_.RemoveTimeRange(frame_range);
+
+    // Jobs use the snapped frame time only
+    snapped_frames.append(TimeRange(frame_range.in(), frame_range.in()));
   }
 
-  // Remove this particular frame from the queue
-  cache_queue_.RemoveTimeRange(frame_range);
+  return snapped_frames;
+}
 
-  // Remove this particular frame from missing frames
-  invalidated_.RemoveTimeRange(frame_range);
+void VideoRenderBackend::RequeueFrame(const TimeRange &range)
+{
+  // Jobs only contain the frame's time, so expand it back to the full frame
+  TimeRange frame_range(range.in(), range.in() + params_.time_base());
 
-  // Return the snapped frame
-  return TimeRange(frame_range.in(), frame_range.in());
+  invalidated_.InsertTimeRange(frame_range);
+  cache_queue_.InsertTimeRange(frame_range);
 }
 
 void VideoRenderBackend::ThreadCompletedFrame(NodeDependency path, qint64 job_time, QByteArray hash, QVariant value)
@@ -300,22 +374,23 @@ void VideoRenderBackend::ThreadCompletedFrame(NodeDependency path, qint64 job_ti
   }
 
   if (!(operating_mode_ & VideoRenderWorker::kDownloadOnly)) {
-    // If we're not downloading, the worker is done here
-    SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
+    // If we're not downloading, the job is done here
     CacheNext();
   }
 }
 
 void VideoRenderBackend::ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash, bool texture_existed)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   SetFrameHash(dep, hash, job_time);
 
   // Register frame with the disk manager
   if (texture_existed && operating_mode_ & VideoRenderWorker::kDownloadOnly) {
-    DiskManager::instance()->CreatedFile(frame_cache()->CachePathName(hash, params_.format()), hash);
+    // Workers write with the current codec, if it changed mid-write the file isn't found and the frame renders again
+    QString filename = frame_cache()->FindCachedFile(hash, params_.format());
+
+    if (!filename.isEmpty()) {
+      DiskManager::instance()->CreatedFile(filename, hash);
+    }
   }
 
   QList<rational> hashes_with_time = frame_cache()->FramesWithHash(hash);
@@ -324,32 +399,41 @@ void VideoRenderBackend::ThreadCompletedDownload(NodeDependency dep, qint64 job_
     emit CachedTimeReady(t, job_time);
   }
 
-  // Queue up a new frame for this worker
+  // Top up the scheduler
   CacheNext();
 }
 
 void VideoRenderBackend::ThreadSkippedFrame(NodeDependency dep, qint64 job_time, QByteArray hash)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   if (SetFrameHash(dep, hash, job_time)
       && frame_cache_.HasHash(hash, params_.format())) {
     emit CachedTimeReady(dep.in(), job_time);
   }
 
-  // Queue up a new frame for this worker
+  // Top up the scheduler
   CacheNext();
 }
 
 void VideoRenderBackend::ThreadHashAlreadyExists(NodeDependency dep, qint64 job_time, QByteArray hash)
 {
-  SetWorkerBusyState(static_cast<RenderWorker*>(sender()), false);
-
   if (SetFrameHash(dep, hash, job_time)) {
     emit CachedTimeReady(dep.in(), job_time);
   }
 
-  // Queue up a new frame for this worker
+  // Top up the scheduler
+  CacheNext();
+}
+
+void VideoRenderBackend::ThreadRenderFailed(NodeDependency dep, qint64 job_time)
+{
+  if (JobIsCurrent(dep, job_time)) {
+    render_job_info_.remove(dep.range());
+
+    // Leave the frame missing without queueing it again, it'd only fail again until something changes
+    invalidated_.InsertTimeRange(TimeRange(dep.in(), dep.in() + params_.time_base()));
+  }
+
+  // Top up the scheduler
   CacheNext();
 }
 
@@ -407,8 +491,15 @@ bool VideoRenderBackend::SetFrameHash(const NodeDependency &dep, const QByteArra
 
 void VideoRenderBackend::Requeue()
 {
+  // Jobs that haven't started yet were prioritized around the old playhead, put them back so the frames around the
+  // new one get rendered first
+  ReturnPendingJobs();
+
   cache_queue_.clear();
 
+  // Pick up changes to the setting before scheduling anything, the frame cache can switch while workers are writing
+  UpdateFrameCacheCodec();
+
   // Reset queue around the last time requested
   TimeRange queueable_range(last_time_requested_ - Config::Current()["DiskCacheBehind"].value<rational>(),
                             last_time_requested_ + Config::Current()["DiskCacheAhead"].value<rational>());
@@ -418,7 +509,15 @@ void VideoRenderBackend::Requeue()
   CacheNext();
 }
 
-void VideoRenderBackend::ResizeCacheLoadBuffer()
+void VideoRenderBackend::UpdateMemoryCacheLimit()
+{
+  double gigabytes = Config::Current()["MemoryCacheSize"].toDouble();
+
+  // Convert gigabytes to kilobytes
+  memory_cache_.setMaxCost(qRound(gigabytes * 1048576));
+}
+
+void VideoRenderBackend::UpdateFrameCacheCodec()
 {
-  cache_frame_load_buffer_.resize(PixelService::GetBufferSize(params_.format(), params_.effective_width(), params_.effective_height()));
+  frame_cache_.SetCodec(static_cast<VideoRenderFrameCache::Codec>(Config::Current()["DiskCacheCodec"].toInt()));
 }
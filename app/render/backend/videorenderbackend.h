@@ -21,6 +21,7 @@
 #ifndef VIDEORENDERERBACKEND_H
 #define VIDEORENDERERBACKEND_H
 
+#include <QCache>
 #include <QLinkedList>
 
 #include "colorprocessorcache.h"
@@ -86,11 +87,28 @@ protected:
 
   const char *GetCachedFrame(const rational& time);
 
+  /**
+   * @brief Get the hash of the frame at this time if it's cached in memory or on disk, or an empty array if not
+   *
+   * Like GetCachedFrame(), this also updates the playhead used for queueing.
+   */
+  QByteArray GetCachedFrameHash(const rational& time);
+
+  /**
+   * @brief Get the pixels of a frame returned by GetCachedFrameHash()
+   *
+   * Frames are read from memory if they were used recently and from disk otherwise. The returned data is valid until
+   * the next call.
+   */
+  const char *GetCachedFrameData(const QByteArray& hash);
+
   virtual NodeInput* GetDependentInput() override;
 
   virtual bool CanRender() override;
 
-  virtual TimeRange PopNextFrameFromQueue() override;
+  virtual QList<TimeRange> PopNextFramesFromQueue(int count) override;
+
+  virtual void RequeueFrame(const TimeRange& range) override;
 
   /**
    * @brief Internal function for generating the cache ID
@@ -103,7 +121,7 @@ protected:
 
   virtual void EmitCachedFrameReady(const rational &time, const QVariant& value, qint64 job_time) = 0;
 
-  virtual void InvalidateCacheInternal(const rational &start_range, const rational &end_range) override;
+  virtual void InvalidateCacheInternal(const TimeRangeList &ranges) override;
 
   virtual void ParamsChangedEvent();
 
@@ -124,11 +142,29 @@ private:
 
   void Requeue();
 
-  void ResizeCacheLoadBuffer();
+  /**
+   * @brief Update the memory cache's limit from the config
+   */
+  void UpdateMemoryCacheLimit();
+
+  /**
+   * @brief Update the codec frames are cached to disk with from the config
+   */
+  void UpdateFrameCacheCodec();
 
   VideoRenderingParams params_;
 
-  QByteArray cache_frame_load_buffer_;
+  /**
+   * @brief Recently used frames from the disk cache, keyed by hash with a cost in kilobytes
+   *
+   * Sits in front of the disk cache so that showing a frame again doesn't need to read and decode it.
+   */
+  QCache<QByteArray, QByteArray> memory_cache_;
+
+  /**
+   * @brief Reference to the frame last returned by GetCachedFrameData() so it stays valid if it's evicted
+   */
+  QByteArray current_frame_;
 
   VideoRenderFrameCache frame_cache_;
 
@@ -143,6 +179,7 @@ private slots:
   void ThreadCompletedDownload(NodeDependency dep, qint64 job_time, QByteArray hash, bool texture_existed);
   void ThreadSkippedFrame(NodeDependency dep, qint64 job_time, QByteArray hash);
   void ThreadHashAlreadyExists(NodeDependency dep, qint64 job_time, QByteArray hash);
+  void ThreadRenderFailed(NodeDependency dep, qint64 job_time);
 
   void TruncateFrameCacheLength(const rational& length);
 
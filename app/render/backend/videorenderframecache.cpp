@@ -1,11 +1,23 @@
 #include "videorenderframecache.h"
 
+#include <OpenImageIO/imageio.h>
+#include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 
+#include "common/define.h"
 #include "common/filefunctions.h"
+#include "render/diskmanager.h"
+#include "render/pixelservice.h"
 
-VideoRenderFrameCache::VideoRenderFrameCache()
+// "OFRM" in a little-endian file
+const quint32 VideoRenderFrameCache::kRawMagic = 0x4D52464F;
+
+VideoRenderFrameCache::VideoRenderFrameCache() :
+  cache_dir_(GetMediaCacheLocation()),
+  codec_(kCodecCompressed)
 {
 
 }
@@ -23,7 +35,7 @@ void VideoRenderFrameCache::Clear()
 
 bool VideoRenderFrameCache::HasHash(const QByteArray &hash, const PixelFormat::Format& format)
 {
-  return QFileInfo::exists(CachePathName(hash, format)) && !IsCaching(hash);
+  return !FindCachedFile(hash, format).isEmpty() && !IsCaching(hash);
 }
 
 bool VideoRenderFrameCache::IsCaching(const QByteArray &hash)
@@ -57,6 +69,14 @@ void VideoRenderFrameCache::SetCacheID(const QString &id)
   Clear();
 
   cache_id_ = id;
+
+  // Pick up a change to the cache location here rather than reading the config (and creating the folder) every time a
+  // worker needs a filename
+  QDir cache_dir(GetMediaCacheLocation());
+
+  cache_dir_lock_.lock();
+  cache_dir_ = cache_dir;
+  cache_dir_lock_.unlock();
 }
 
 QByteArray VideoRenderFrameCache::TimeToHash(const rational &time) const
@@ -111,12 +131,18 @@ const QMap<rational, QByteArray> &VideoRenderFrameCache::time_hash_map() const
 
 QString VideoRenderFrameCache::CachePathName(const QByteArray &hash, const PixelFormat::Format& pix_fmt) const
 {
-  QDir this_cache_dir = QDir(GetMediaCacheLocation());
-  this_cache_dir.mkpath(".");
+  return CachePathName(hash, pix_fmt, codec());
+}
 
+QString VideoRenderFrameCache::CachePathName(const QByteArray &hash, const PixelFormat::Format &pix_fmt, Codec codec) const
+{
   QString ext;
 
-  if (pix_fmt == PixelFormat::PIX_FMT_RGBA8 || pix_fmt == PixelFormat::PIX_FMT_RGBA16U) {
+  if (codec == kCodecRaw) {
+    ext = QStringLiteral("raw");
+  } else if (codec == kCodecCompressed) {
+    ext = QStringLiteral("rawz");
+  } else if (pix_fmt == PixelFormat::PIX_FMT_RGBA8 || pix_fmt == PixelFormat::PIX_FMT_RGBA16U) {
     // For some reason, integer EXRs are extremely slow to load, so we use TIFF instead.
     ext = QStringLiteral("tiff");
   } else {
@@ -125,5 +151,266 @@ QString VideoRenderFrameCache::CachePathName(const QByteArray &hash, const Pixel
 
   QString filename = QStringLiteral("%1.%2").arg(QString(hash.toHex()), ext);
 
-  return this_cache_dir.filePath(filename);
+  cache_dir_lock_.lock();
+  QDir cache_dir = cache_dir_;
+  cache_dir_lock_.unlock();
+
+  return cache_dir.filePath(filename);
+}
+
+QString VideoRenderFrameCache::FindCachedFile(const QByteArray &hash, const PixelFormat::Format &pix_fmt, Codec *codec) const
+{
+  // The disk manager records every frame's file, so a frame in any codec is found with a single check
+  QString filename = DiskManager::instance()->GetFileName(hash);
+
+  if (filename.isEmpty()) {
+    // Workers write frames before the backend registers them, and they always use the current codec
+    filename = CachePathName(hash, pix_fmt);
+  }
+
+  if (!QFileInfo::exists(filename)) {
+    return QString();
+  }
+
+  if (codec) {
+    *codec = CodecOfFile(filename);
+  }
+
+  return filename;
+}
+
+VideoRenderFrameCache::Codec VideoRenderFrameCache::CodecOfFile(const QString &filename)
+{
+  if (filename.endsWith(QStringLiteral(".raw"))) {
+    return kCodecRaw;
+  } else if (filename.endsWith(QStringLiteral(".rawz"))) {
+    return kCodecCompressed;
+  } else {
+    return kCodecEXR;
+  }
+}
+
+void VideoRenderFrameCache::SetCodec(VideoRenderFrameCache::Codec codec)
+{
+  codec_.storeRelease(codec);
+}
+
+VideoRenderFrameCache::Codec VideoRenderFrameCache::codec() const
+{
+  return static_cast<Codec>(codec_.loadAcquire());
+}
+
+bool VideoRenderFrameCache::SaveFrame(const QByteArray &hash, const VideoRenderingParams &params, const char *data) const
+{
+  // Read once so the filename and the encoding always agree even if the codec changes while we're writing
+  Codec codec = this->codec();
+
+  QString filename = CachePathName(hash, params.format(), codec);
+
+  if (codec == kCodecRaw || codec == kCodecCompressed) {
+    // QSaveFile writes to a temporary file and only replaces `filename` in commit()
+    QSaveFile f(filename);
+
+    if (!f.open(QFile::WriteOnly)) {
+      qWarning() << "Failed to open output file:" << filename;
+      return false;
+    }
+
+    RawHeader header = {kRawMagic, params.effective_width(), params.effective_height(), static_cast<qint32>(params.format())};
+
+    qint64 data_size = PixelService::GetBufferSize(params.format(), params.effective_width(), params.effective_height());
+
+    if (f.write(reinterpret_cast<const char*>(&header), sizeof(RawHeader)) != static_cast<qint64>(sizeof(RawHeader))) {
+      return false;
+    }
+
+    if (codec == kCodecRaw) {
+      if (f.write(data, data_size) != data_size) {
+        return false;
+      }
+    } else {
+      QByteArray planes(static_cast<int>(data_size), Qt::Uninitialized);
+
+      SplitBytePlanes(data,
+                      planes.data(),
+                      data_size,
+                      PixelService::GetPixelFormatInfo(params.format()).bytes_per_pixel / kRGBAChannels);
+
+      // Level 1 is zlib's fastest, higher levels barely shrink pixel data further and take several times as long
+      QByteArray compressed = qCompress(planes, 1);
+
+      if (compressed.isEmpty()
+          || f.write(compressed) != compressed.size()) {
+        return false;
+      }
+    }
+
+    return f.commit();
+  }
+
+  PixelFormat::Info format_info = PixelService::GetPixelFormatInfo(params.format());
+
+  // Set up OIIO::ImageSpec for compressing cached images on disk
+  OIIO::ImageSpec spec(params.effective_width(), params.effective_height(), kRGBAChannels, format_info.oiio_desc);
+
+  if (params.format() != PixelFormat::PIX_FMT_RGBA8) {
+    // 8-bit doesn't use EXR because EXR loading is really slow on 8-bit
+    spec.attribute("compression", "dwaa:200");
+  }
+
+  // OIIO picks the format from the extension, so the temporary file keeps it
+  QFileInfo file_info(filename);
+  QString working_fn = file_info.dir().filePath(QStringLiteral("%1.tmp.%2").arg(file_info.completeBaseName(),
+                                                                                 file_info.suffix()));
+  std::string working_fn_std = working_fn.toStdString();
+
+  auto out = OIIO::ImageOutput::create(working_fn_std);
+
+  if (!out) {
+    qWarning() << "Failed to open output file:" << working_fn;
+    return false;
+  }
+
+  bool written = out->open(working_fn_std, spec)
+      && out->write_image(format_info.oiio_desc, data);
+
+  written = out->close() && written;
+
+#if OIIO_VERSION < 10903
+  OIIO::ImageOutput::destroy(out);
+#endif
+
+  if (written) {
+    // QFile::rename() won't replace an existing file
+    QFile::remove(filename);
+    written = QFile::rename(working_fn, filename);
+  }
+
+  if (!written) {
+    qWarning() << "Failed to write output file:" << filename;
+    QFile::remove(working_fn);
+  }
+
+  return written;
+}
+
+bool VideoRenderFrameCache::LoadFrame(const QByteArray &hash, const VideoRenderingParams &params, char *data) const
+{
+  Codec codec;
+  QString filename = FindCachedFile(hash, params.format(), &codec);
+
+  if (filename.isEmpty()) {
+    return false;
+  }
+
+  if (codec == kCodecRaw || codec == kCodecCompressed) {
+    QFile f(filename);
+
+    if (!f.open(QFile::ReadOnly)) {
+      return false;
+    }
+
+    qint64 data_size = PixelService::GetBufferSize(params.format(), params.effective_width(), params.effective_height());
+
+    if ((codec == kCodecRaw && f.size() != static_cast<qint64>(sizeof(RawHeader)) + data_size)
+        || f.size() < static_cast<qint64>(sizeof(RawHeader))) {
+      qWarning() << "Cached frame" << filename << "is the wrong size";
+      return false;
+    }
+
+    // Mapping avoids an intermediate copy through QFile's buffer
+    uchar* mapped = f.map(0, f.size());
+
+    if (!mapped) {
+      return false;
+    }
+
+    bool matches = HeaderMatches(reinterpret_cast<const RawHeader*>(mapped), params);
+
+    if (!matches) {
+      qWarning() << "Cached frame" << filename << "doesn't match the current parameters";
+    } else if (codec == kCodecRaw) {
+      memcpy(data, mapped + sizeof(RawHeader), static_cast<size_t>(data_size));
+    } else {
+      QByteArray planes = qUncompress(mapped + sizeof(RawHeader),
+                                      static_cast<int>(f.size() - static_cast<qint64>(sizeof(RawHeader))));
+
+      if (planes.size() == data_size) {
+        JoinBytePlanes(planes.constData(),
+                       data,
+                       data_size,
+                       PixelService::GetPixelFormatInfo(params.format()).bytes_per_pixel / kRGBAChannels);
+      } else {
+        qWarning() << "Cached frame" << filename << "is corrupt";
+        matches = false;
+      }
+    }
+
+    f.unmap(mapped);
+
+    return matches;
+  }
+
+  auto in = OIIO::ImageInput::open(filename.toStdString());
+
+  if (!in) {
+    qWarning() << "OIIO Error:" << OIIO::geterror().c_str();
+    return false;
+  }
+
+  in->read_image(PixelService::GetPixelFormatInfo(params.format()).oiio_desc, data);
+
+  in->close();
+
+#if OIIO_VERSION < 10903
+  OIIO::ImageInput::destroy(in);
+#endif
+
+  return true;
+}
+
+bool VideoRenderFrameCache::HeaderMatches(const VideoRenderFrameCache::RawHeader *header, const VideoRenderingParams &params)
+{
+  return header->magic == kRawMagic
+      && header->width == params.effective_width()
+      && header->height == params.effective_height()
+      && header->format == params.format();
+}
+
+void VideoRenderFrameCache::SplitBytePlanes(const char *in, char *out, qint64 size, int stride)
+{
+  if (stride <= 1) {
+    memcpy(out, in, static_cast<size_t>(size));
+    return;
+  }
+
+  qint64 count = size / stride;
+
+  for (int plane=0;plane<stride;plane++) {
+    char* plane_out = out + plane * count;
+    const char* plane_in = in + plane;
+
+    for (qint64 i=0;i<count;i++) {
+      plane_out[i] = plane_in[i * stride];
+    }
+  }
+}
+
+void VideoRenderFrameCache::JoinBytePlanes(const char *in, char *out, qint64 size, int stride)
+{
+  if (stride <= 1) {
+    memcpy(out, in, static_cast<size_t>(size));
+    return;
+  }
+
+  qint64 count = size / stride;
+
+  for (int plane=0;plane<stride;plane++) {
+    const char* plane_in = in + plane * count;
+    char* plane_out = out + plane;
+
+    for (qint64 i=0;i<count;i++) {
+      plane_out[i * stride] = plane_in[i];
+    }
+  }
 }
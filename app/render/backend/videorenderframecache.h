@@ -1,14 +1,35 @@
 #ifndef VIDEORENDERFRAMECACHE_H
 #define VIDEORENDERFRAMECACHE_H
 
+#include <QAtomicInt>
+#include <QDir>
 #include <QMutex>
 
 #include "common/rational.h"
 #include "render/pixelformat.h"
+#include "render/videoparams.h"
 
 class VideoRenderFrameCache
 {
 public:
+  /**
+   * @brief Formats frames can be stored on disk in
+   */
+  enum Codec {
+    /// A small header followed by the pixels exactly as they are in memory. Fastest to write and read.
+    kCodecRaw,
+
+    /// OpenEXR (or TIFF for integer formats). Much smaller on disk but slow to encode and decode.
+    kCodecEXR,
+
+    /// The raw layout with each channel's bytes split into planes and deflated at the fastest level. Usually a fraction
+    /// of the raw size while staying far quicker than EXR.
+    kCodecCompressed,
+
+    /// Number of codecs, not a codec itself
+    kCodecCount
+  };
+
   VideoRenderFrameCache();
 
   void Clear();
@@ -29,10 +50,44 @@ public:
   bool TryCache(const QByteArray& hash);
 
   /**
-   * @brief Return the path of the cached image at this time
+   * @brief Return the path a frame with this hash is written to with the current codec
    */
   QString CachePathName(const QByteArray &hash, const PixelFormat::Format& pix_fmt) const;
 
+  QString CachePathName(const QByteArray &hash, const PixelFormat::Format& pix_fmt, Codec codec) const;
+
+  /**
+   * @brief Return the path of an existing file for this hash in any codec, or an empty string if there isn't one
+   *
+   * Files the DiskManager knows about are found in whatever codec they were stored with, anything else (i.e. a frame
+   * that's just been written and not registered yet) only in the current codec. If `codec` isn't null, it's set to the
+   * codec of the file found.
+   */
+  QString FindCachedFile(const QByteArray &hash, const PixelFormat::Format& pix_fmt, Codec* codec = nullptr) const;
+
+  /**
+   * @brief Set the codec used for frames written from now on
+   *
+   * Thread-safe, so it can be changed while workers are saving frames. Frames already stored with another codec can
+   * still be loaded.
+   */
+  void SetCodec(Codec codec);
+
+  Codec codec() const;
+
+  /**
+   * @brief Write a frame to CachePathName() using the current codec
+   *
+   * The file is written under a temporary name and then moved into place, so an interrupted write never leaves a
+   * partial frame where LoadFrame() would find it.
+   */
+  bool SaveFrame(const QByteArray& hash, const VideoRenderingParams& params, const char* data) const;
+
+  /**
+   * @brief Read a frame written by SaveFrame() in any codec into `data`, which must be the frame's buffer size
+   */
+  bool LoadFrame(const QByteArray& hash, const VideoRenderingParams& params, char* data) const;
+
   void SetCacheID(const QString& id);
 
   QByteArray TimeToHash(const rational& time) const;
@@ -54,6 +109,47 @@ private:
   QVector<QByteArray> currently_caching_list_;
 
   QString cache_id_;
+
+  /**
+   * @brief Where frames are stored, looked up on the main thread since it comes from the config
+   */
+  QDir cache_dir_;
+
+  mutable QMutex cache_dir_lock_;
+
+  QAtomicInt codec_;
+
+  /**
+   * @brief The codec a file in the cache was written with, from its extension
+   */
+  static Codec CodecOfFile(const QString& filename);
+
+  /**
+   * @brief Header at the start of kCodecRaw and kCodecCompressed files, used to make sure a file matches what we
+   * expect to read
+   */
+  struct RawHeader {
+    quint32 magic;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+  };
+
+  static const quint32 kRawMagic;
+
+  static bool HeaderMatches(const RawHeader* header, const VideoRenderingParams& params);
+
+  /**
+   * @brief Gather byte `n` of every `stride`-byte value into plane `n` so similar bytes end up next to each other
+   *
+   * The high bytes of neighboring pixels rarely differ, so this makes float and 16-bit frames far more compressible.
+   */
+  static void SplitBytePlanes(const char* in, char* out, qint64 size, int stride);
+
+  /**
+   * @brief Reverse SplitBytePlanes()
+   */
+  static void JoinBytePlanes(const char* in, char* out, qint64 size, int stride);
 };
 
 #endif // VIDEORENDERFRAMECACHE_H
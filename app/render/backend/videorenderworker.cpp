@@ -22,21 +22,16 @@ const VideoRenderingParams &VideoRenderWorker::video_params()
 NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, const qint64 &job_time)
 {
   // Get hash of node graph
-  // We use SHA-1 for speed (benchmarks show it's the fastest hash available to us)
+  // This only needs to identify frames, not be secure, so we use a fast non-cryptographic hash
   QByteArray hash;
   if (operating_mode_ & kHashOnly) {
-    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    FastHash hasher;
 
     // Embed video parameters into this hash
-    int vwidth = video_params_.effective_width();
-    int vheight = video_params_.effective_height();
-    PixelFormat::Format vfmt = video_params_.format();
-    RenderMode::Mode vmode = video_params_.mode();
-
-    hasher.addData(reinterpret_cast<const char*>(&vwidth), sizeof(int));
-    hasher.addData(reinterpret_cast<const char*>(&vheight), sizeof(int));
-    hasher.addData(reinterpret_cast<const char*>(&vfmt), sizeof(PixelFormat::Format));
-    hasher.addData(reinterpret_cast<const char*>(&vmode), sizeof(RenderMode::Mode));
+    hasher.addValue(video_params_.effective_width());
+    hasher.addValue(video_params_.effective_height());
+    hasher.addValue(video_params_.format());
+    hasher.addValue(video_params_.mode());
 
     HashNodeRecursively(&hasher, path.node(), path.in());
     hash = hasher.result();
@@ -59,6 +54,15 @@ NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, con
     // This hash is available for us to cache, start traversing graph
     value = ProcessNode(path);
 
+    if (JobFailed()) {
+      // Don't let anything cache or show what was rendered
+      frame_cache_->RemoveHashFromCurrentlyCaching(hash);
+
+      emit RenderFailed(path, job_time);
+
+      return NodeValueTable();
+    }
+
     // Find texture in hash
     QVariant texture = value.Get(NodeParam::kTexture);
 
@@ -67,7 +71,7 @@ NodeValueTable VideoRenderWorker::RenderInternal(const NodeDependency& path, con
 
     // If we actually have a texture, download it into the disk cache
     if ((operating_mode_ & kDownloadOnly) && !texture.isNull()) {
-      Download(texture, frame_cache_->CachePathName(hash, video_params_.format()));
+      Download(texture, hash);
     }
 
     frame_cache_->RemoveHashFromCurrentlyCaching(hash);
@@ -92,31 +96,19 @@ FramePtr VideoRenderWorker::RetrieveFromDecoder(DecoderPtr decoder, const TimeRa
   return decoder->RetrieveVideo(range.in());
 }
 
-void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node* n, const rational& time)
+VideoRenderWorker::NodeHashCache VideoRenderWorker::GetNodeHashCache(const Node *n)
 {
-  // Resolve BlockList
-  if (n->IsTrack()) {
-    n = static_cast<const TrackOutput*>(n)->BlockAtTime(time);
+  QHash<const Node*, NodeHashCache>::const_iterator cached = hash_cache_.constFind(n);
 
-    if (!n) {
-      return;
-    }
+  if (cached != hash_cache_.constEnd()) {
+    return cached.value();
   }
 
-  // Add this Node's ID
-  hash->addData(n->id().toUtf8());
-
-  if (n->IsBlock() && static_cast<const Block*>(n)->type() == Block::kTransition) {
-    const TransitionBlock* transition = static_cast<const TransitionBlock*>(n);
+  NodeHashCache cache;
+  FastHash hash;
 
-    double all_prog = transition->GetTotalProgress(time);
-    double in_prog = transition->GetInProgress(time);
-    double out_prog = transition->GetOutProgress(time);
-
-    hash->addData(reinterpret_cast<const char*>(&all_prog), sizeof(double));
-    hash->addData(reinterpret_cast<const char*>(&in_prog), sizeof(double));
-    hash->addData(reinterpret_cast<const char*>(&out_prog), sizeof(double));
-  }
+  // Add this Node's ID
+  hash.addData(n->id());
 
   foreach (NodeParam* param, n->parameters()) {
     // For each input, try to hash its value
@@ -134,55 +126,119 @@ void VideoRenderWorker::HashNodeRecursively(QCryptographicHash *hash, const Node
         }
       }
 
-      // Get time adjustment
-      // For a single frame, we only care about one of the times
-      rational input_time = n->InputTimeAdjustment(input, TimeRange(time, time)).in();
-
-      if (input->IsConnected()) {
-        // Traverse down this edge
-        HashNodeRecursively(hash, input->get_connected_node(), input_time);
+      if (input->IsConnected() || input->is_keyframing()) {
+        cache.variant_inputs.append(input);
       } else {
-        // Grab the value at this time
-        QVariant value = input->get_value_at_time(input_time);
-        hash->addData(NodeParam::ValueToBytes(input->data_type(), value));
+        // Without keyframes the value is the same at any time
+        hash.addData(NodeParam::ValueToBytes(input->data_type(), input->get_value_at_time(0)));
       }
 
       // We have one exception for FOOTAGE types, since we resolve the footage into a frame in the renderer
       if (input->data_type() == NodeParam::kFootage) {
         StreamPtr stream = ResolveStreamFromInput(input);
-        DecoderPtr decoder = ResolveDecoderFromInput(stream);
+        DecoderPtr decoder = PeekDecoderFromInput(stream);
 
         if (decoder != nullptr) {
-          // Add footage details to hash
+          // Footage settings (e.g. color space) can change without the input changing, so the details themselves are
+          // hashed per frame
+          if (!cache.variant_inputs.contains(input)) {
+            cache.variant_inputs.append(input);
+          }
 
-          // Footage filename
-          hash->addData(stream->footage()->filename().toUtf8());
+          cache.footage.insert(input, {stream, decoder});
+        }
+      }
+    }
+  }
 
-          // Footage last modified date
-          hash->addData(stream->footage()->timestamp().toString().toUtf8());
+  cache.invariant_hash = hash.result();
 
-          // Footage stream
-          hash->addData(QString::number(stream->index()).toUtf8());
+  hash_cache_.insert(n, cache);
 
-          if (stream->type() == Stream::kImage || stream->type() == Stream::kVideo) {
-            ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
+  return cache;
+}
+
+void VideoRenderWorker::HashNodeRecursively(FastHash *hash, const Node* n, const rational& time)
+{
+  // Resolve BlockList
+  if (n->IsTrack()) {
+    n = static_cast<const TrackOutput*>(n)->BlockAtTime(time);
 
-            // Footage timestamp
-            hash->addData(QString::number(decoder->GetTimestampFromTime(input_time)).toUtf8());
+    if (!n) {
+      return;
+    }
+  }
 
-            // Current color config and space
-            hash->addData(video_stream->footage()->project()->ocio_config().toUtf8());
-            hash->addData(video_stream->colorspace().toUtf8());
+  NodeHashCache cache = GetNodeHashCache(n);
 
-            // Alpha associated setting
-            hash->addData(QString::number(video_stream->premultiplied_alpha()).toUtf8());
-          }
-        }
-      }
+  hash->addData(cache.invariant_hash);
+
+  if (n->IsBlock() && static_cast<const Block*>(n)->type() == Block::kTransition) {
+    const TransitionBlock* transition = static_cast<const TransitionBlock*>(n);
+
+    hash->addValue(transition->GetTotalProgress(time));
+    hash->addValue(transition->GetInProgress(time));
+    hash->addValue(transition->GetOutProgress(time));
+  }
+
+  // Only inputs that can differ between frames need to be looked at here
+  foreach (NodeInput* input, cache.variant_inputs) {
+    // Get time adjustment
+    // For a single frame, we only care about one of the times
+    rational input_time = n->InputTimeAdjustment(input, TimeRange(time, time)).in();
+
+    if (input->IsConnected()) {
+      // Traverse down this edge
+      HashNodeRecursively(hash, input->get_connected_node(), input_time);
+    } else if (input->is_keyframing()) {
+      // Grab the value at this time
+      hash->addData(NodeParam::ValueToBytes(input->data_type(), input->get_value_at_time(input_time)));
+    }
+
+    QHash<NodeInput*, FootageHashInfo>::const_iterator footage = cache.footage.constFind(input);
+
+    if (footage != cache.footage.constEnd()) {
+      HashFootage(hash, footage.value(), input_time);
     }
   }
 }
 
+void VideoRenderWorker::HashFootage(FastHash *hash, const VideoRenderWorker::FootageHashInfo &info, const rational &time)
+{
+  const StreamPtr& stream = info.stream;
+
+  // Footage filename
+  hash->addData(stream->footage()->filename());
+
+  // Footage last modified date
+  hash->addValue(stream->footage()->timestamp().toMSecsSinceEpoch());
+
+  // Footage stream
+  hash->addValue(stream->index());
+
+  if (stream->type() == Stream::kImage || stream->type() == Stream::kVideo) {
+    ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
+
+    // Footage timestamp
+    DecoderPtr decoder = info.decoder.lock();
+
+    if (!decoder) {
+      decoder = PeekDecoderFromInput(stream);
+    }
+
+    if (decoder) {
+      hash->addValue(decoder->GetTimestampFromTime(time));
+    }
+
+    // Current color config and space
+    hash->addData(video_stream->footage()->project()->ocio_config());
+    hash->addData(video_stream->colorspace());
+
+    // Alpha associated setting
+    hash->addValue(video_stream->premultiplied_alpha());
+  }
+}
+
 void VideoRenderWorker::SetParameters(const VideoRenderingParams &video_params)
 {
   video_params_ = video_params;
@@ -199,6 +255,13 @@ void VideoRenderWorker::SetOperatingMode(const VideoRenderWorker::OperatingMode
   operating_mode_ = mode;
 }
 
+void VideoRenderWorker::NodesChangedEvent(const QVector<const Node *> &nodes)
+{
+  foreach (const Node* n, nodes) {
+    hash_cache_.remove(n);
+  }
+}
+
 bool VideoRenderWorker::InitInternal()
 {
   ResizeDownloadBuffer();
@@ -208,37 +271,14 @@ bool VideoRenderWorker::InitInternal()
 void VideoRenderWorker::CloseInternal()
 {
   download_buffer_.clear();
+  hash_cache_.clear();
 }
 
-void VideoRenderWorker::Download(QVariant texture, QString filename)
+void VideoRenderWorker::Download(QVariant texture, const QByteArray &hash)
 {
-  PixelFormat::Info format_info = PixelService::GetPixelFormatInfo(video_params().format());
-
-  // Set up OIIO::ImageSpec for compressing cached images on disk
-  OIIO::ImageSpec spec(video_params().effective_width(), video_params().effective_height(), kRGBAChannels, format_info.oiio_desc);
-
-  if (video_params_.format() != PixelFormat::PIX_FMT_RGBA8) {
-    // 8-bit doesn't use EXR because EXR loading is really slow on 8-bit
-    spec.attribute("compression", "dwaa:200");
-  }
-
   TextureToBuffer(texture, download_buffer_);
 
-  std::string working_fn_std = filename.toStdString();
-
-  auto out = OIIO::ImageOutput::create(working_fn_std);
-
-  if (out) {
-    out->open(working_fn_std, spec);
-    out->write_image(format_info.oiio_desc, download_buffer_.data());
-    out->close();
-
-#if OIIO_VERSION < 10903
-    OIIO::ImageOutput::destroy(out);
-#endif
-  } else {
-    qWarning() << "Failed to open output file:" << filename;
-  }
+  frame_cache_->SaveFrame(hash, video_params_, download_buffer_.constData());
 }
 
 void VideoRenderWorker::ResizeDownloadBuffer()
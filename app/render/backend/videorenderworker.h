@@ -1,9 +1,8 @@
 #ifndef VIDEORENDERWORKER_H
 #define VIDEORENDERWORKER_H
 
-#include <QCryptographicHash>
-
 #include "colorprocessorcache.h"
+#include "common/fasthash.h"
 #include "node/dependency.h"
 #include "render/videoparams.h"
 #include "renderworker.h"
@@ -56,6 +55,8 @@ signals:
 
   void HashAlreadyExists(NodeDependency path, qint64 job_time, QByteArray hash);
 
+  void RenderFailed(NodeDependency path, qint64 job_time);
+
 protected:
   virtual bool InitInternal() override;
 
@@ -67,6 +68,8 @@ protected:
 
   virtual void TextureToBuffer(const QVariant& texture, QByteArray& buffer) = 0;
 
+  virtual void NodesChangedEvent(const QVector<const Node*>& nodes) override;
+
   virtual NodeValueTable RenderInternal(const NodeDependency& path, const qint64& job_time) override;
 
   virtual FramePtr RetrieveFromDecoder(DecoderPtr decoder, const TimeRange& range) override;
@@ -76,9 +79,35 @@ protected:
   ColorProcessorCache* color_cache();
 
 private:
-  void HashNodeRecursively(QCryptographicHash* hash, const Node *n, const rational &time);
+  struct FootageHashInfo {
+    StreamPtr stream;
 
-  void Download(QVariant texture, QString filename);
+    /// Only used to look up the footage timestamp for each frame. Not owned, so the DecoderPool can still close it once
+    /// it's idle (HashFootage() peeks another one then).
+    std::weak_ptr<Decoder> decoder;
+  };
+
+  /**
+   * @brief The parts of a Node's hash that are the same for every frame
+   */
+  struct NodeHashCache {
+    /// Hash of the Node's ID and non-keyframed input values
+    QByteArray invariant_hash;
+
+    /// Inputs that have to be revisited for every frame (connected, keyframed or footage)
+    QVector<NodeInput*> variant_inputs;
+
+    /// Resolved footage inputs
+    QHash<NodeInput*, FootageHashInfo> footage;
+  };
+
+  NodeHashCache GetNodeHashCache(const Node* n);
+
+  void HashNodeRecursively(FastHash* hash, const Node *n, const rational &time);
+
+  void HashFootage(FastHash* hash, const FootageHashInfo& info, const rational& time);
+
+  void Download(QVariant texture, const QByteArray& hash);
 
   void ResizeDownloadBuffer();
 
@@ -92,6 +121,12 @@ private:
 
   OperatingMode operating_mode_;
 
+  /**
+   * @brief Memoized NodeHashCache for each Node in the graph, entries (and the footage they resolved) are removed when
+   * their Node changes
+   */
+  QHash<const Node*, NodeHashCache> hash_cache_;
+
 private slots:
 
 };
@@ -1,10 +1,8 @@
 #include "colormanager.h"
 
-#include <QFloat16>
-
-#include "common/define.h"
 #include "config/config.h"
 #include "core.h"
+#include "pixelservice.h"
 
 ColorManager::ColorManager()
 {
@@ -26,22 +24,25 @@ void ColorManager::SetConfig(OCIO::ConstConfigRcPtr config)
 {
   config_ = config;
 
+  // Processors are keyed by config contents so stale ones would never match again, free them now
+  ColorProcessor::ClearProcessorCache();
+
   emit ConfigChanged();
 }
 
 void ColorManager::DisassociateAlpha(FramePtr f)
 {
-  AssociateAlphaPixFmtFilter(kDisassociate, f);
+  ApplyAlphaOperation(PixelKernels::kAlphaDisassociate, f);
 }
 
 void ColorManager::AssociateAlpha(FramePtr f)
 {
-  AssociateAlphaPixFmtFilter(kAssociate, f);
+  ApplyAlphaOperation(PixelKernels::kAlphaAssociate, f);
 }
 
 void ColorManager::ReassociateAlpha(FramePtr f)
 {
-  AssociateAlphaPixFmtFilter(kReassociate, f);
+  ApplyAlphaOperation(PixelKernels::kAlphaReassociate, f);
 }
 
 QStringList ColorManager::ListAvailableDisplays()
@@ -121,46 +122,8 @@ void ColorManager::SetOCIOMethodForMode(RenderMode::Mode mode, ColorManager::OCI
   Core::SetPreferenceForRenderMode(mode, QStringLiteral("OCIOMethod"), method);
 }
 
-void ColorManager::AssociateAlphaPixFmtFilter(ColorManager::AlphaAction action, FramePtr f)
+void ColorManager::ApplyAlphaOperation(PixelKernels::AlphaOperation alpha, FramePtr f)
 {
-  int pixel_count = f->width() * f->height() * kRGBAChannels;
-
-  switch (static_cast<PixelFormat::Format>(f->format())) {
-  case PixelFormat::PIX_FMT_INVALID:
-  case PixelFormat::PIX_FMT_COUNT:
-    qWarning() << "Alpha association functions received an invalid pixel format";
-    break;
-  case PixelFormat::PIX_FMT_RGBA8:
-  case PixelFormat::PIX_FMT_RGBA16U:
-    qWarning() << "Alpha association functions only works on float-based pixel formats at this time";
-    break;
-  case PixelFormat::PIX_FMT_RGBA16F:
-  {
-    AssociateAlphaInternal<qfloat16>(action, reinterpret_cast<qfloat16*>(f->data()), pixel_count);
-    break;
-  }
-  case PixelFormat::PIX_FMT_RGBA32F:
-  {
-    AssociateAlphaInternal<float>(action, reinterpret_cast<float*>(f->data()), pixel_count);
-    break;
-  }
-  }
-}
-
-template<typename T>
-void ColorManager::AssociateAlphaInternal(ColorManager::AlphaAction action, T *data, int pix_count)
-{
-  for (int i=0;i<pix_count;i+=kRGBAChannels) {
-    T alpha = data[i+kRGBChannels];
-
-    if (action == kAssociate || alpha > 0) {
-      for (int j=0;j<kRGBChannels;j++) {
-        if (action == kDisassociate) {
-          data[i+j] /= alpha;
-        } else {
-          data[i+j] *= alpha;
-        }
-      }
-    }
-  }
+  // Converting a frame to its own format just applies the alpha operation in place
+  PixelService::ConvertPixelFormat(f->data(), f->format(), f->data(), f->format(), f->width() * f->height(), alpha);
 }
@@ -5,6 +5,7 @@
 
 #include "codec/frame.h"
 #include "colorprocessor.h"
+#include "pixelkernels.h"
 
 class ColorManager : public QObject
 {
@@ -53,16 +54,7 @@ signals:
 private:
   OCIO::ConstConfigRcPtr config_;
 
-  enum AlphaAction {
-    kAssociate,
-    kDisassociate,
-    kReassociate
-  };
-
-  static void AssociateAlphaPixFmtFilter(AlphaAction action, FramePtr f);
-
-  template<typename T>
-  static void AssociateAlphaInternal(AlphaAction action, T* data, int pix_count);
+  static void ApplyAlphaOperation(PixelKernels::AlphaOperation alpha, FramePtr f);
 };
 
 #endif // COLORSERVICE_H
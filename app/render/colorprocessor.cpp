@@ -1,11 +1,19 @@
 #include "colorprocessor.h"
 
 #include "common/define.h"
+#include "common/parallelfor.h"
+
+const int ColorProcessor::kProcessorCacheSize = 32;
+QCache<QString, OCIO::ConstProcessorRcPtr> ColorProcessor::processor_cache_(ColorProcessor::kProcessorCacheSize);
+QMutex ColorProcessor::processor_cache_lock_;
+const int ColorProcessor::kRowsPerBand = 64;
 
 ColorProcessor::ColorProcessor(OCIO::ConstConfigRcPtr config, const QString& source_space, const QString& dest_space)
 {
-  processor = config->getProcessor(source_space.toUtf8(),
-                                   dest_space.toUtf8());
+  processor = GetCachedProcessor(GenerateID(config, source_space, dest_space), [&]() {
+    return config->getProcessor(source_space.toUtf8(),
+                                dest_space.toUtf8());
+  });
 }
 
 ColorProcessor::ColorProcessor(OCIO::ConstConfigRcPtr config,
@@ -22,25 +30,75 @@ ColorProcessor::ColorProcessor(OCIO::ConstConfigRcPtr config,
     view = config->getDefaultView(display.toUtf8());
   }
 
-  // Get current display stats
-  OCIO::DisplayTransformRcPtr transform = OCIO::DisplayTransform::Create();
-  transform->setInputColorSpaceName(source_space.toUtf8());
-  transform->setDisplay(display.toUtf8());
-  transform->setView(view.toUtf8());
+  QString dest = QStringLiteral("%1/%2/%3").arg(display, view, look);
 
-  if (!look.isEmpty()) {
-    transform->setLooksOverride(look.toUtf8());
-    transform->setLooksOverrideEnabled(true);
-  }
+  processor = GetCachedProcessor(GenerateID(config, source_space, dest), [&]() {
+    // Get current display stats
+    OCIO::DisplayTransformRcPtr transform = OCIO::DisplayTransform::Create();
+    transform->setInputColorSpaceName(source_space.toUtf8());
+    transform->setDisplay(display.toUtf8());
+    transform->setView(view.toUtf8());
+
+    if (!look.isEmpty()) {
+      transform->setLooksOverride(look.toUtf8());
+      transform->setLooksOverrideEnabled(true);
+    }
 
-  processor = config->getProcessor(transform);
+    return config->getProcessor(transform);
+  });
 }
 
 void ColorProcessor::ConvertFrame(FramePtr f)
 {
-  OCIO::PackedImageDesc img(reinterpret_cast<float*>(f->data()), f->width(), f->height(), kRGBAChannels);
+  float* data = reinterpret_cast<float*>(f->data());
+  int width = f->width();
+  int height = f->height();
+
+  // OCIO processors can be applied from several threads at once, so each band of rows is its own image
+  ParallelFor((height + kRowsPerBand - 1) / kRowsPerBand, [&](int band) {
+    int first_row = band * kRowsPerBand;
+
+    OCIO::PackedImageDesc img(data + first_row * width * kRGBAChannels,
+                              width,
+                              qMin(kRowsPerBand, height - first_row),
+                              kRGBAChannels);
+
+    processor->apply(img);
+  });
+}
+
+QString ColorProcessor::GenerateID(OCIO::ConstConfigRcPtr config, const QString &source_space, const QString &dest)
+{
+  return QStringLiteral("%1\n%2\n%3").arg(QString::fromUtf8(config->getCacheID()), source_space, dest);
+}
+
+OCIO::ConstProcessorRcPtr ColorProcessor::GetCachedProcessor(const QString &id, const std::function<OCIO::ConstProcessorRcPtr ()> &create)
+{
+  {
+    QMutexLocker locker(&processor_cache_lock_);
+
+    OCIO::ConstProcessorRcPtr* cached = processor_cache_.object(id);
+
+    if (cached) {
+      return *cached;
+    }
+  }
+
+  // Create outside the lock since it can take a while. If another thread creates the same processor at the same time,
+  // one of them simply replaces the other in the cache.
+  OCIO::ConstProcessorRcPtr processor = create();
+
+  QMutexLocker locker(&processor_cache_lock_);
+  processor_cache_.insert(id, new OCIO::ConstProcessorRcPtr(processor));
+
+  return processor;
+}
+
+void ColorProcessor::ClearProcessorCache()
+{
+  QMutexLocker locker(&processor_cache_lock_);
 
-  processor->apply(img);
+  processor_cache_.clear();
 }
 
 ColorProcessorPtr ColorProcessor::Create(OCIO::ConstConfigRcPtr config, const QString& source_space, const QString& dest_space)
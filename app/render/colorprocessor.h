@@ -4,6 +4,10 @@
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OCIO_NAMESPACE::v1;
 
+#include <functional>
+#include <QCache>
+#include <QMutex>
+
 #include "codec/frame.h"
 #include "common/constructors.h"
 
@@ -33,11 +37,57 @@ public:
 
   OCIO::ConstProcessorRcPtr GetProcessor();
 
+  /**
+   * @brief Convert an RGBA32F frame in place
+   *
+   * The frame is split into bands of rows that are processed in parallel.
+   */
   void ConvertFrame(FramePtr f);
 
+  /**
+   * @brief Generate a string that uniquely identifies a transform from `source_space` to `dest` in `config`
+   *
+   * The config is identified by its contents, so a different config with the same colorspace names won't match.
+   */
+  static QString GenerateID(OCIO::ConstConfigRcPtr config, const QString& source_space, const QString& dest);
+
+  /**
+   * @brief Drop every cached processor, e.g. when the OCIO config is replaced
+   *
+   * ColorProcessors that already exist keep the processor they were created with.
+   */
+  static void ClearProcessorCache();
+
 private:
+  /**
+   * @brief Retrieve a processor from the process-wide cache, or create it with `create` and add it
+   */
+  static OCIO::ConstProcessorRcPtr GetCachedProcessor(const QString& id,
+                                                      const std::function<OCIO::ConstProcessorRcPtr()>& create);
+
   OCIO::ConstProcessorRcPtr processor;
 
+  /**
+   * @brief Processors shared by every ColorProcessor, keyed by GenerateID()
+   *
+   * Creating an OCIO processor is expensive, and every render worker, exporter and viewer asks for the same few. The
+   * least recently used ones are dropped once there are more than kProcessorCacheSize, so trying out many
+   * display/view/look combinations doesn't grow it forever.
+   */
+  static QCache<QString, OCIO::ConstProcessorRcPtr> processor_cache_;
+
+  static QMutex processor_cache_lock_;
+
+  /**
+   * @brief Number of rows ConvertFrame() gives each thread at a time
+   */
+  static const int kRowsPerBand;
+
+  /**
+   * @brief Maximum number of processors kept in processor_cache_
+   */
+  static const int kProcessorCacheSize;
+
 };
 
 #endif // COLORPROCESSOR_H
@@ -5,6 +5,7 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QStandardPaths>
 
 #include "common/filefunctions.h"
@@ -13,28 +14,12 @@
 DiskManager* DiskManager::instance_ = nullptr;
 
 DiskManager::DiskManager() :
-  consumption_(0)
+  least_recent_(nullptr),
+  most_recent_(nullptr),
+  consumption_(0),
+  journal_record_count_(0)
 {
-  // Try to load any current cache index from file
-  QFile cache_index_file(GetCacheIndexFilename());
-
-  if (cache_index_file.open(QFile::ReadOnly)) {
-    QDataStream ds(&cache_index_file);
-
-    while (!cache_index_file.atEnd()) {
-      HashTime h;
-
-      ds >> h.file_name;
-      ds >> h.hash;
-      ds >> h.access_time;
-      ds >> h.file_size;
-
-      if (QFileInfo::exists(h.file_name)) {
-        consumption_ += h.file_size;
-        disk_data_.append(h);
-      }
-    }
-  }
+  LoadJournal();
 }
 
 DiskManager::~DiskManager()
@@ -43,22 +28,13 @@ DiskManager::~DiskManager()
     // Clear all cache data
     ClearDiskCache(true);
   } else {
-    // Save current cache index
-    QFile cache_index_file(GetCacheIndexFilename());
+    // Everything is already in the journal, but leave it compact for the next start
+    CompactJournal();
+  }
 
-    if (cache_index_file.open(QFile::WriteOnly)) {
-      QDataStream ds(&cache_index_file);
+  journal_.close();
 
-      foreach (const HashTime& h, disk_data_) {
-        ds << h.file_name;
-        ds << h.hash;
-        ds << h.access_time;
-        ds << h.file_size;
-      }
-    } else {
-      qWarning() << "Failed to write cache index";
-    }
-  }
+  ClearEntries();
 }
 
 void DiskManager::CreateInstance()
@@ -81,18 +57,13 @@ void DiskManager::Accessed(const QByteArray &hash)
 {
   lock_.lock();
 
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
-
-    if (h.hash == hash) {
-      HashTime moved_hash = h;
+  HashTime* h = hash_index_.value(hash);
 
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
+  if (h) {
+    h->access_time = QDateTime::currentMSecsSinceEpoch();
+    MoveToBack(h);
 
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+    WriteJournalAccessed(h);
   }
 
   lock_.unlock();
@@ -102,38 +73,43 @@ void DiskManager::Accessed(const QString &filename)
 {
   lock_.lock();
 
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
+  HashTime* h = filename_index_.value(filename);
 
-    if (h.file_name == filename) {
-      HashTime moved_hash = h;
+  if (h) {
+    h->access_time = QDateTime::currentMSecsSinceEpoch();
+    MoveToBack(h);
 
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
-
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+    WriteJournalAccessed(h);
   }
 
   lock_.unlock();
 }
 
+QString DiskManager::GetFileName(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  HashTime* h = hash_index_.value(hash);
+
+  return h ? h->file_name : QString();
+}
+
 void DiskManager::CreatedFile(const QString &file_name, const QByteArray &hash)
 {
   lock_.lock();
 
   qint64 file_size = QFile(file_name).size();
 
-  disk_data_.append({file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size});
+  // If this file was already cached (e.g. it's been rendered again), replace its entry
+  HashTime* existing = filename_index_.value(file_name);
 
-  consumption_ += file_size;
+  if (existing) {
+    RemoveEntry(existing);
+  }
 
-  QList<QByteArray> deleted_hashes;
+  WriteJournalAdded(AddEntry(file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size));
 
-  while (consumption_ > DiskLimit()) {
-    deleted_hashes.append(DeleteLeastRecent());
-  }
+  QList<QByteArray> deleted_hashes = TrimToLimit();
 
   lock_.unlock();
 
@@ -142,6 +118,36 @@ void DiskManager::CreatedFile(const QString &file_name, const QByteArray &hash)
   }
 }
 
+void DiskManager::ResizedFile(const QString &file_name)
+{
+  lock_.lock();
+
+  qint64 file_size = QFile(file_name).size();
+
+  HashTime* h = filename_index_.value(file_name);
+
+  if (h) {
+    consumption_ += file_size - h->file_size;
+
+    h->file_size = file_size;
+    h->access_time = QDateTime::currentMSecsSinceEpoch();
+    MoveToBack(h);
+  } else {
+    h = AddEntry(file_name, QByteArray(), QDateTime::currentMSecsSinceEpoch(), file_size);
+  }
+
+  // Size has changed so this is written as a new entry rather than an access
+  WriteJournalAdded(h);
+
+  QList<QByteArray> deleted_hashes = TrimToLimit();
+
+  lock_.unlock();
+
+  foreach (const QByteArray& hash, deleted_hashes) {
+    emit DeletedFrame(hash);
+  }
+}
+
 bool DiskManager::ClearDiskCache(bool quick_delete)
 {
   bool deleted_files;
@@ -151,25 +157,33 @@ bool DiskManager::ClearDiskCache(bool quick_delete)
   if (quick_delete) {
     deleted_files = QDir(GetMediaCacheLocation()).removeRecursively();
 
-    disk_data_.clear();
+    ClearEntries();
   } else {
     deleted_files = true;
 
-    for (int i=0;i<disk_data_.size();i++) {
-      const HashTime& ht = disk_data_.at(i);
+    HashTime* h = least_recent_;
+
+    while (h) {
+      HashTime* next = h->next;
 
       // We return a false result if any of the files fail to delete, but still try to delete as many as we can
-      if (QFile::remove(ht.file_name)) {
-        emit DeletedFrame(ht.hash);
-        disk_data_.removeAt(i);
-        i--;
+      if (QFile::remove(h->file_name)) {
+        // Files without a hash (e.g. FrameStores) aren't rendered frames
+        if (!h->hash.isEmpty()) {
+          emit DeletedFrame(h->hash);
+        }
+        RemoveEntry(h);
       } else {
-        qWarning() << "Failed to delete" << ht.file_name;
+        qWarning() << "Failed to delete" << h->file_name;
         deleted_files = false;
       }
+
+      h = next;
     }
   }
 
+  CompactJournal();
+
   lock_.unlock();
 
   return deleted_files;
@@ -177,13 +191,35 @@ bool DiskManager::ClearDiskCache(bool quick_delete)
 
 QByteArray DiskManager::DeleteLeastRecent()
 {
-  HashTime h = disk_data_.takeFirst();
+  HashTime* h = least_recent_;
 
-  QFile::remove(h.file_name);
+  QByteArray hash = h->hash;
 
-  consumption_ -= h.file_size;
+  QFile::remove(h->file_name);
 
-  return h.hash;
+  WriteJournalRemoved(h);
+
+  RemoveEntry(h);
+
+  return hash;
+}
+
+QList<QByteArray> DiskManager::TrimToLimit()
+{
+  QList<QByteArray> deleted_hashes;
+
+  qint64 limit = DiskLimit();
+
+  while (consumption_ > limit && least_recent_) {
+    QByteArray hash = DeleteLeastRecent();
+
+    // Files without a hash (e.g. FrameStores) aren't rendered frames, so there's nothing to invalidate
+    if (!hash.isEmpty()) {
+      deleted_hashes.append(hash);
+    }
+  }
+
+  return deleted_hashes;
 }
 
 qint64 DiskManager::DiskLimit()
@@ -194,7 +230,300 @@ qint64 DiskManager::DiskLimit()
   return qRound64(gigabytes * 1073741824);
 }
 
+DiskManager::HashTime *DiskManager::AddEntry(const QString &file_name, const QByteArray &hash, qint64 access_time, qint64 file_size)
+{
+  HashTime* h = new HashTime{file_name, hash, access_time, file_size, most_recent_, nullptr};
+
+  if (most_recent_) {
+    most_recent_->next = h;
+  } else {
+    least_recent_ = h;
+  }
+
+  most_recent_ = h;
+
+  filename_index_.insert(file_name, h);
+
+  // Files that grow over time (e.g. FrameStores) have no hash
+  if (!hash.isEmpty()) {
+    hash_index_.insert(hash, h);
+  }
+
+  consumption_ += file_size;
+
+  return h;
+}
+
+void DiskManager::RemoveEntry(HashTime *h)
+{
+  if (h->previous) {
+    h->previous->next = h->next;
+  } else {
+    least_recent_ = h->next;
+  }
+
+  if (h->next) {
+    h->next->previous = h->previous;
+  } else {
+    most_recent_ = h->previous;
+  }
+
+  filename_index_.remove(h->file_name);
+
+  if (hash_index_.value(h->hash) == h) {
+    hash_index_.remove(h->hash);
+  }
+
+  consumption_ -= h->file_size;
+
+  delete h;
+}
+
+void DiskManager::ClearEntries()
+{
+  HashTime* h = least_recent_;
+
+  while (h) {
+    HashTime* next = h->next;
+    delete h;
+    h = next;
+  }
+
+  least_recent_ = nullptr;
+  most_recent_ = nullptr;
+
+  filename_index_.clear();
+  hash_index_.clear();
+
+  consumption_ = 0;
+}
+
+void DiskManager::MoveToBack(HashTime *h)
+{
+  if (h == most_recent_) {
+    return;
+  }
+
+  // Unlink (this can't be the most recent so there's always a next)
+  if (h->previous) {
+    h->previous->next = h->next;
+  } else {
+    least_recent_ = h->next;
+  }
+
+  h->next->previous = h->previous;
+
+  // Relink at the back
+  h->previous = most_recent_;
+  h->next = nullptr;
+
+  most_recent_->next = h;
+  most_recent_ = h;
+}
+
+void DiskManager::LoadJournal()
+{
+  QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).mkpath(".");
+
+  QFile journal_file(GetCacheJournalFilename());
+
+  if (journal_file.open(QFile::ReadOnly)) {
+    QDataStream ds(&journal_file);
+
+    // Replay each change in order. If we crashed while writing, the last record may be incomplete, in which case the
+    // stream status will stop the loop.
+    while (!ds.atEnd()) {
+      quint8 type;
+      QString file_name;
+
+      ds >> type;
+      ds >> file_name;
+
+      if (type == kJournalAdded) {
+        QByteArray hash;
+        qint64 access_time;
+        qint64 file_size;
+
+        ds >> hash;
+        ds >> access_time;
+        ds >> file_size;
+
+        if (ds.status() != QDataStream::Ok) {
+          break;
+        }
+
+        HashTime* existing = filename_index_.value(file_name);
+
+        if (existing) {
+          RemoveEntry(existing);
+        }
+
+        AddEntry(file_name, hash, access_time, file_size);
+      } else if (type == kJournalAccessed) {
+        qint64 access_time;
+
+        ds >> access_time;
+
+        if (ds.status() != QDataStream::Ok) {
+          break;
+        }
+
+        HashTime* h = filename_index_.value(file_name);
+
+        if (h) {
+          h->access_time = access_time;
+          MoveToBack(h);
+        }
+      } else if (type == kJournalRemoved) {
+        if (ds.status() != QDataStream::Ok) {
+          break;
+        }
+
+        HashTime* h = filename_index_.value(file_name);
+
+        if (h) {
+          RemoveEntry(h);
+        }
+      } else {
+        qWarning() << "Cache journal is corrupt, ignoring the rest of it";
+        break;
+      }
+    }
+  } else {
+    // Import the index written by versions before the journal existed
+    QFile cache_index_file(GetCacheIndexFilename());
+
+    if (cache_index_file.open(QFile::ReadOnly)) {
+      QDataStream ds(&cache_index_file);
+
+      while (!cache_index_file.atEnd()) {
+        QString file_name;
+        QByteArray hash;
+        qint64 access_time;
+        qint64 file_size;
+
+        ds >> file_name;
+        ds >> hash;
+        ds >> access_time;
+        ds >> file_size;
+
+        AddEntry(file_name, hash, access_time, file_size);
+      }
+
+      cache_index_file.close();
+      cache_index_file.remove();
+    }
+  }
+
+  // Forget any files that have been deleted since
+  HashTime* h = least_recent_;
+
+  while (h) {
+    HashTime* next = h->next;
+
+    if (!QFileInfo::exists(h->file_name)) {
+      RemoveEntry(h);
+    }
+
+    h = next;
+  }
+
+  CompactJournal();
+}
+
+void DiskManager::CompactJournal()
+{
+  journal_.close();
+
+  QSaveFile compacted(GetCacheJournalFilename());
+
+  if (compacted.open(QFile::WriteOnly)) {
+    QDataStream ds(&compacted);
+
+    // Written from least to most recent so that replaying it restores the same order
+    for (HashTime* h=least_recent_;h;h=h->next) {
+      ds << static_cast<quint8>(kJournalAdded);
+      ds << h->file_name;
+      ds << h->hash;
+      ds << h->access_time;
+      ds << h->file_size;
+    }
+
+    if (!compacted.commit()) {
+      qWarning() << "Failed to write cache journal";
+    }
+  } else {
+    qWarning() << "Failed to write cache journal";
+  }
+
+  journal_record_count_ = filename_index_.size();
+
+  journal_.setFileName(GetCacheJournalFilename());
+
+  if (!journal_.open(QFile::WriteOnly | QFile::Append)) {
+    qWarning() << "Failed to open cache journal";
+  }
+}
+
+void DiskManager::WriteJournalAdded(const HashTime *h)
+{
+  if (journal_.isOpen()) {
+    QDataStream ds(&journal_);
+
+    ds << static_cast<quint8>(kJournalAdded);
+    ds << h->file_name;
+    ds << h->hash;
+    ds << h->access_time;
+    ds << h->file_size;
+
+    FinishJournalRecord();
+  }
+}
+
+void DiskManager::WriteJournalAccessed(const HashTime *h)
+{
+  if (journal_.isOpen()) {
+    QDataStream ds(&journal_);
+
+    ds << static_cast<quint8>(kJournalAccessed);
+    ds << h->file_name;
+    ds << h->access_time;
+
+    FinishJournalRecord();
+  }
+}
+
+void DiskManager::WriteJournalRemoved(const HashTime *h)
+{
+  if (journal_.isOpen()) {
+    QDataStream ds(&journal_);
+
+    ds << static_cast<quint8>(kJournalRemoved);
+    ds << h->file_name;
+
+    FinishJournalRecord();
+  }
+}
+
+void DiskManager::FinishJournalRecord()
+{
+  // Hand the record to the OS so it survives the application crashing
+  journal_.flush();
+
+  journal_record_count_++;
+
+  // Rewrite the journal once most of it is outdated records so it doesn't grow forever
+  if (journal_record_count_ > 4 * filename_index_.size() + 1024) {
+    CompactJournal();
+  }
+}
+
 QString DiskManager::GetCacheIndexFilename()
 {
   return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("diskindex");
 }
+
+QString DiskManager::GetCacheJournalFilename()
+{
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("diskjournal");
+}
@@ -1,6 +1,8 @@
 #ifndef DISKMANAGER_H
 #define DISKMANAGER_H
 
+#include <QFile>
+#include <QHash>
 #include <QMutex>
 #include <QObject>
 
@@ -20,6 +22,18 @@ public:
 
   void CreatedFile(const QString& file_name, const QByteArray& hash);
 
+  /**
+   * @brief Return the file cached for this hash, or an empty string if there isn't one
+   */
+  QString GetFileName(const QByteArray& hash);
+
+  /**
+   * @brief Update the size of a file that grows over time (e.g. a FrameStore)
+   *
+   * Also counts as an access. If the file isn't known yet, it's added as if CreatedFile() was called.
+   */
+  void ResizedFile(const QString& file_name);
+
   bool ClearDiskCache(bool quick_delete);
 
 signals:
@@ -32,23 +46,103 @@ private:
 
   static DiskManager* instance_;
 
-  QByteArray DeleteLeastRecent();
-
-  qint64 DiskLimit();
-
-  static QString GetCacheIndexFilename();
-
+  /**
+   * @brief A cached file, linked into a list from least to most recently used
+   */
   struct HashTime {
     QString file_name;
     QByteArray hash;
     qint64 access_time;
     qint64 file_size;
+
+    HashTime* previous;
+    HashTime* next;
   };
 
-  QList<HashTime> disk_data_;
+  /**
+   * @brief Record types written to the cache journal
+   */
+  enum JournalRecord {
+    kJournalAdded = 1,
+    kJournalAccessed,
+    kJournalRemoved
+  };
+
+  QByteArray DeleteLeastRecent();
+
+  /**
+   * @brief Delete least recently used files until consumption is within the limit
+   *
+   * Must be called with lock_ held. Returns the hashes of the deleted frames, files without one are left out.
+   */
+  QList<QByteArray> TrimToLimit();
+
+  qint64 DiskLimit();
+
+  /**
+   * @brief Create an entry as the most recently used and index it
+   */
+  HashTime* AddEntry(const QString& file_name, const QByteArray& hash, qint64 access_time, qint64 file_size);
+
+  /**
+   * @brief Unlink and free an entry
+   */
+  void RemoveEntry(HashTime* h);
+
+  /**
+   * @brief Remove and free every entry
+   */
+  void ClearEntries();
+
+  /**
+   * @brief Make an entry the most recently used
+   */
+  void MoveToBack(HashTime* h);
+
+  /**
+   * @brief Load entries from the journal (or an index from an older version) and compact it
+   */
+  void LoadJournal();
+
+  /**
+   * @brief Replace the journal with one kJournalAdded record for each current entry
+   */
+  void CompactJournal();
+
+  void WriteJournalAdded(const HashTime* h);
+
+  void WriteJournalAccessed(const HashTime* h);
+
+  void WriteJournalRemoved(const HashTime* h);
+
+  /**
+   * @brief Flush the last record and compact the journal if it's mostly outdated records
+   */
+  void FinishJournalRecord();
+
+  static QString GetCacheIndexFilename();
+
+  static QString GetCacheJournalFilename();
+
+  /**
+   * @brief Least and most recently used entries
+   */
+  HashTime* least_recent_;
+  HashTime* most_recent_;
+
+  QHash<QString, HashTime*> filename_index_;
+
+  QHash<QByteArray, HashTime*> hash_index_;
 
   qint64 consumption_;
 
+  /**
+   * @brief Append-only log of changes to the cache so that it survives the application not closing cleanly
+   */
+  QFile journal_;
+
+  int journal_record_count_;
+
   QMutex lock_;
 
 };
@@ -0,0 +1,426 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "pixelkernels.h"
+
+#include <QFloat16>
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+#include "common/define.h"
+#include "common/simd.h"
+#include "pixelkernelsavx2.h"
+#include "pixelservice.h"
+
+const int PixelKernels::kIntermediateSize = 4096;
+
+bool PixelKernels::Convert(const void *src, PixelFormat::Format src_format, void *dst, PixelFormat::Format dst_format, int count, AlphaOperation alpha)
+{
+  if (src_format <= PixelFormat::PIX_FMT_INVALID || src_format >= PixelFormat::PIX_FMT_COUNT
+      || dst_format <= PixelFormat::PIX_FMT_INVALID || dst_format >= PixelFormat::PIX_FMT_COUNT) {
+    return false;
+  }
+
+  if (alpha != kAlphaNone && dst_format == PixelFormat::PIX_FMT_RGBA32F) {
+    // Convert (or copy) first and then work on the destination in place
+    if (src != dst) {
+      ToFloat(src, src_format, static_cast<float*>(dst), count);
+    }
+
+    ApplyAlpha(static_cast<float*>(dst), count, alpha);
+  } else if (alpha != kAlphaNone) {
+    ConvertThroughFloat(src, src_format, dst, dst_format, count, alpha);
+  } else if (src_format == dst_format) {
+    if (src != dst) {
+      memcpy(dst, src, static_cast<size_t>(count * PixelService::BytesPerChannel(src_format)));
+    }
+  } else if (src_format == PixelFormat::PIX_FMT_RGBA8 && dst_format == PixelFormat::PIX_FMT_RGBA16U) {
+    Int8ToInt16(static_cast<const quint8*>(src), static_cast<quint16*>(dst), count);
+  } else if (src_format == PixelFormat::PIX_FMT_RGBA16U && dst_format == PixelFormat::PIX_FMT_RGBA8) {
+    Int16ToInt8(static_cast<const quint16*>(src), static_cast<quint8*>(dst), count);
+  } else if (src_format == PixelFormat::PIX_FMT_RGBA32F) {
+    FromFloat(static_cast<const float*>(src), dst, dst_format, count);
+  } else if (dst_format == PixelFormat::PIX_FMT_RGBA32F) {
+    ToFloat(src, src_format, static_cast<float*>(dst), count);
+  } else {
+    ConvertThroughFloat(src, src_format, dst, dst_format, count, kAlphaNone);
+  }
+
+  return true;
+}
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+static bool DetectAVX2()
+{
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuid(info, 0);
+
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // F16C and OSXSAVE
+  __cpuid(info, 1);
+
+  if ((info[2] & (1 << 29)) == 0 || (info[2] & (1 << 27)) == 0) {
+    return false;
+  }
+
+  // The OS has to save the AVX registers too
+  if ((_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+
+  return (info[1] & (1 << 5)) != 0;
+#else
+  // These check that the OS saves the AVX registers too
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#endif
+}
+#endif
+
+bool PixelKernels::HasAVX2()
+{
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+  // Checked once, it can't change while we're running
+  static const bool supported = DetectAVX2();
+
+  return supported;
+#else
+  return false;
+#endif
+}
+
+void PixelKernels::ConvertThroughFloat(const void *src, PixelFormat::Format src_format, void *dst, PixelFormat::Format dst_format, int count, AlphaOperation alpha)
+{
+  // Go through float a block at a time so the intermediate stays in cache. Each block is read completely before it's
+  // written, which is what makes it safe for `src` and `dst` to be the same buffer.
+  float intermediate[kIntermediateSize];
+
+  const char* src_bytes = static_cast<const char*>(src);
+  char* dst_bytes = static_cast<char*>(dst);
+  int src_channel_size = PixelService::BytesPerChannel(src_format);
+  int dst_channel_size = PixelService::BytesPerChannel(dst_format);
+
+  for (int i=0;i<count;i+=kIntermediateSize) {
+    int block_count = qMin(kIntermediateSize, count - i);
+
+    ToFloat(src_bytes + i * src_channel_size, src_format, intermediate, block_count);
+
+    if (alpha != kAlphaNone) {
+      ApplyAlpha(intermediate, block_count, alpha);
+    }
+
+    FromFloat(intermediate, dst_bytes + i * dst_channel_size, dst_format, block_count);
+  }
+}
+
+void PixelKernels::Int8ToInt16(const quint8 *src, quint16 *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  // Interleaving a byte with itself gives x * 257
+  for (;i+16<=count;i+=16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, v));
+  }
+#endif
+
+  for (;i<count;i++) {
+    dst[i] = static_cast<quint16>(src[i] * 257);
+  }
+}
+
+void PixelKernels::Int16ToInt8(const quint16 *src, quint8 *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  // ((x + 128) * 0xFF01) >> 24 is exactly x / 257 rounded for every 16-bit value, and saturating the addition
+  // doesn't change the result for the values it affects
+  __m128i reciprocal = _mm_set1_epi16(static_cast<short>(0xFF01));
+  __m128i half = _mm_set1_epi16(128);
+
+  for (;i+16<=count;i+=16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+
+    a = _mm_srli_epi16(_mm_mulhi_epu16(_mm_adds_epu16(a, half), reciprocal), 8);
+    b = _mm_srli_epi16(_mm_mulhi_epu16(_mm_adds_epu16(b, half), reciprocal), 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+  }
+#endif
+
+  for (;i<count;i++) {
+    dst[i] = static_cast<quint8>((src[i] + 128) / 257);
+  }
+}
+
+void PixelKernels::Int8ToFloat(const quint8 *src, float *dst, int count)
+{
+  const float scale = 1.0f / 255.0f;
+  int i = 0;
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+  if (HasAVX2()) {
+    i = PixelKernelsAVX2::Int8ToFloat(src, dst, count);
+  }
+#endif
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 scale_vec = _mm_set1_ps(scale);
+  __m128i zero = _mm_setzero_si128();
+
+  for (;i+16<=count;i+=16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale_vec));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale_vec));
+    _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale_vec));
+    _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale_vec));
+  }
+#endif
+
+  for (;i<count;i++) {
+    dst[i] = src[i] * scale;
+  }
+}
+
+void PixelKernels::Int16ToFloat(const quint16 *src, float *dst, int count)
+{
+  const float scale = 1.0f / 65535.0f;
+  int i = 0;
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+  if (HasAVX2()) {
+    i = PixelKernelsAVX2::Int16ToFloat(src, dst, count);
+  }
+#endif
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 scale_vec = _mm_set1_ps(scale);
+  __m128i zero = _mm_setzero_si128();
+
+  for (;i+8<=count;i+=8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), scale_vec));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), scale_vec));
+  }
+#endif
+
+  for (;i<count;i++) {
+    dst[i] = src[i] * scale;
+  }
+}
+
+void PixelKernels::HalfToFloat(const quint16 *src, float *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+  if (HasAVX2()) {
+    i = PixelKernelsAVX2::HalfToFloat(src, dst, count);
+  }
+#endif
+
+  for (;i<count;i++) {
+    dst[i] = reinterpret_cast<const qfloat16*>(src)[i];
+  }
+}
+
+void PixelKernels::FloatToInt8(const float *src, quint8 *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 scale = _mm_set1_ps(255.0f);
+  __m128 half = _mm_set1_ps(0.5f);
+  __m128 zero = _mm_setzero_ps();
+
+  // Clamping in float first also maps NaN to 0, since max returns its second operand if either is NaN
+  for (;i+16<=count;i+=16) {
+    __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), zero), scale), half));
+    __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), zero), scale), half));
+    __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 8), scale), zero), scale), half));
+    __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 12), scale), zero), scale), half));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+#endif
+
+  for (;i<count;i++) {
+    float v = src[i] * 255.0f;
+    dst[i] = static_cast<quint8>(((v > 0.0f) ? qMin(v, 255.0f) : 0.0f) + 0.5f);
+  }
+}
+
+void PixelKernels::FloatToInt16(const float *src, quint16 *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 scale = _mm_set1_ps(65535.0f);
+  __m128 half = _mm_set1_ps(0.5f);
+  __m128 zero = _mm_setzero_ps();
+
+  // SSE2 can only pack with signed saturation, so shift into the signed range and back again
+  __m128i bias32 = _mm_set1_epi32(32768);
+  __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+
+  for (;i+8<=count;i+=8) {
+    __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), zero), scale), half));
+    __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), zero), scale), half));
+
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(packed, bias16));
+  }
+#endif
+
+  for (;i<count;i++) {
+    float v = src[i] * 65535.0f;
+    dst[i] = static_cast<quint16>(((v > 0.0f) ? qMin(v, 65535.0f) : 0.0f) + 0.5f);
+  }
+}
+
+void PixelKernels::FloatToHalf(const float *src, quint16 *dst, int count)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+  if (HasAVX2()) {
+    i = PixelKernelsAVX2::FloatToHalf(src, dst, count);
+  }
+#endif
+
+  for (;i<count;i++) {
+    reinterpret_cast<qfloat16*>(dst)[i] = src[i];
+  }
+}
+
+void PixelKernels::ApplyAlpha(float *data, int count, AlphaOperation alpha)
+{
+  int i = 0;
+
+#ifdef OLIVE_SIMD_SSE2
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 zero = _mm_setzero_ps();
+
+  // Only the RGB lanes of each pixel are multiplied or divided
+  __m128 rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+  // One pixel per vector. The factor is alpha in the lanes we're changing and 1.0 everywhere else.
+  for (;i+4<=count;i+=4) {
+    __m128 pixel = _mm_loadu_ps(data + i);
+    __m128 pixel_alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 mask = rgb_mask;
+
+    if (alpha != kAlphaAssociate) {
+      mask = _mm_and_ps(mask, _mm_cmpgt_ps(pixel_alpha, zero));
+    }
+
+    __m128 factor = _mm_or_ps(_mm_and_ps(mask, pixel_alpha), _mm_andnot_ps(mask, one));
+
+    if (alpha == kAlphaDisassociate) {
+      pixel = _mm_div_ps(pixel, factor);
+    } else {
+      pixel = _mm_mul_ps(pixel, factor);
+    }
+
+    _mm_storeu_ps(data + i, pixel);
+  }
+#endif
+
+  for (;i<count;i+=kRGBAChannels) {
+    float pixel_alpha = data[i+kRGBChannels];
+
+    if (alpha == kAlphaAssociate || pixel_alpha > 0) {
+      for (int j=0;j<kRGBChannels;j++) {
+        if (alpha == kAlphaDisassociate) {
+          data[i+j] /= pixel_alpha;
+        } else {
+          data[i+j] *= pixel_alpha;
+        }
+      }
+    }
+  }
+}
+
+void PixelKernels::ToFloat(const void *src, PixelFormat::Format src_format, float *dst, int count)
+{
+  switch (src_format) {
+  case PixelFormat::PIX_FMT_RGBA8:
+    Int8ToFloat(static_cast<const quint8*>(src), dst, count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA16U:
+    Int16ToFloat(static_cast<const quint16*>(src), dst, count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA16F:
+    HalfToFloat(static_cast<const quint16*>(src), dst, count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA32F:
+    memcpy(dst, src, static_cast<size_t>(count) * sizeof(float));
+    break;
+  case PixelFormat::PIX_FMT_INVALID:
+  case PixelFormat::PIX_FMT_COUNT:
+    break;
+  }
+}
+
+void PixelKernels::FromFloat(const float *src, void *dst, PixelFormat::Format dst_format, int count)
+{
+  switch (dst_format) {
+  case PixelFormat::PIX_FMT_RGBA8:
+    FloatToInt8(src, static_cast<quint8*>(dst), count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA16U:
+    FloatToInt16(src, static_cast<quint16*>(dst), count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA16F:
+    FloatToHalf(src, static_cast<quint16*>(dst), count);
+    break;
+  case PixelFormat::PIX_FMT_RGBA32F:
+    memcpy(dst, src, static_cast<size_t>(count) * sizeof(float));
+    break;
+  case PixelFormat::PIX_FMT_INVALID:
+  case PixelFormat::PIX_FMT_COUNT:
+    break;
+  }
+}
@@ -0,0 +1,117 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include "pixelformat.h"
+
+/**
+ * @brief Vectorized kernels for converting buffers of channel values between pixel formats
+ *
+ * Counts are in values (i.e. one channel of one pixel), so a buffer of RGBA pixels has a count of four times its
+ * pixel count. Integer formats are normalized to 0.0-1.0 when converted to float and float values are clamped to the
+ * integer range and rounded to the nearest integer when converted back.
+ */
+class PixelKernels
+{
+public:
+  /**
+   * @brief Alpha operations that can be applied during a conversion
+   */
+  enum AlphaOperation {
+    kAlphaNone,
+
+    /// Multiply RGB by alpha
+    kAlphaAssociate,
+
+    /// Divide RGB by alpha, skipping pixels with no alpha
+    kAlphaDisassociate,
+
+    /// Multiply RGB by alpha, skipping pixels with no alpha (undoes kAlphaDisassociate)
+    kAlphaReassociate
+  };
+
+  /**
+   * @brief Convert `count` values from `src` in `src_format` to `dst` in `dst_format`
+   *
+   * `alpha` is applied on the way through so the buffer is only traversed once. If it's anything but kAlphaNone,
+   * `count` must be a multiple of four and `src` and `dst` may be the same buffer (but must not otherwise overlap).
+   *
+   * Returns false if either format is invalid.
+   */
+  static bool Convert(const void* src, PixelFormat::Format src_format,
+                      void* dst, PixelFormat::Format dst_format,
+                      int count, AlphaOperation alpha = kAlphaNone);
+
+  /**
+   * @brief Whether this CPU (and OS) supports AVX2 and F16C, so the kernels in PixelKernelsAVX2 can be used
+   *
+   * Always false unless the build has those kernels (OLIVE_SIMD_AVX2_KERNELS).
+   */
+  static bool HasAVX2();
+
+private:
+  static void Int8ToInt16(const quint8* src, quint16* dst, int count);
+
+  static void Int16ToInt8(const quint16* src, quint8* dst, int count);
+
+  static void Int8ToFloat(const quint8* src, float* dst, int count);
+
+  static void Int16ToFloat(const quint16* src, float* dst, int count);
+
+  static void HalfToFloat(const quint16* src, float* dst, int count);
+
+  static void FloatToInt8(const float* src, quint8* dst, int count);
+
+  static void FloatToInt16(const float* src, quint16* dst, int count);
+
+  static void FloatToHalf(const float* src, quint16* dst, int count);
+
+  /**
+   * @brief Apply an alpha operation to RGBA float pixels in place
+   */
+  static void ApplyAlpha(float* data, int count, AlphaOperation alpha);
+
+  /**
+   * @brief Convert between any two formats a block at a time through a float buffer
+   */
+  static void ConvertThroughFloat(const void* src, PixelFormat::Format src_format,
+                                  void* dst, PixelFormat::Format dst_format,
+                                  int count, AlphaOperation alpha);
+
+  /**
+   * @brief Convert any format to float
+   */
+  static void ToFloat(const void* src, PixelFormat::Format src_format, float* dst, int count);
+
+  /**
+   * @brief Convert float to any format
+   */
+  static void FromFloat(const float* src, void* dst, PixelFormat::Format dst_format, int count);
+
+  /**
+   * @brief Number of values converted through an intermediate float buffer at a time
+   */
+  static const int kIntermediateSize;
+
+};
+
+#endif // PIXELKERNELS_H
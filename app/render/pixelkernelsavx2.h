@@ -0,0 +1,49 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PIXELKERNELSAVX2_H
+#define PIXELKERNELSAVX2_H
+
+#include <QtGlobal>
+
+#ifdef OLIVE_SIMD_AVX2_KERNELS
+
+/**
+ * @brief AVX2 and F16C versions of PixelKernels' conversions to and from float
+ *
+ * Only this class's file is built with AVX2 and F16C enabled, so these must never be called unless
+ * PixelKernels::HasAVX2() is true. Each converts as many values as fit in whole vectors and returns how many that was,
+ * the caller converts the rest.
+ */
+class PixelKernelsAVX2
+{
+public:
+  static int Int8ToFloat(const quint8* src, float* dst, int count);
+
+  static int Int16ToFloat(const quint16* src, float* dst, int count);
+
+  static int HalfToFloat(const quint16* src, float* dst, int count);
+
+  static int FloatToHalf(const float* src, quint16* dst, int count);
+};
+
+#endif
+
+#endif // PIXELKERNELSAVX2_H
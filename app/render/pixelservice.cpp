@@ -23,11 +23,15 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QFloat16>
+#include <QThread>
 
 #include "common/define.h"
+#include "common/parallelfor.h"
 #include "core.h"
+#include "pixelkernels.h"
 
 PixelService* PixelService::instance_ = nullptr;
+const int PixelService::kMinimumConversionChunk = 262144;
 
 void PixelService::CreateInstance()
 {
@@ -129,14 +133,16 @@ int PixelService::BytesPerChannel(const PixelFormat::Format &format)
   return 0;
 }
 
-FramePtr PixelService::ConvertPixelFormat(FramePtr frame, const PixelFormat::Format &dest_format)
+FramePtr PixelService::ConvertPixelFormat(FramePtr frame, const PixelFormat::Format &dest_format, PixelKernels::AlphaOperation alpha)
 {
   if (frame->format() == dest_format) {
+    if (alpha != PixelKernels::kAlphaNone) {
+      ConvertPixelFormat(frame->data(), dest_format, frame->data(), dest_format, frame->width() * frame->height(), alpha);
+    }
+
     return frame;
   }
 
-  // FIXME: It'd be nice if this was multithreaded soon
-
   FramePtr converted = Frame::Create();
 
   // Copy parameters
@@ -146,166 +152,55 @@ FramePtr PixelService::ConvertPixelFormat(FramePtr frame, const PixelFormat::For
   converted->set_format(dest_format);
   converted->allocate();
 
-  int pix_count = frame->width() * frame->height() * kRGBAChannels;
-
-  bool valid = true;
+  if (ConvertPixelFormat(frame->const_data(), frame->format(), converted->data(), dest_format, frame->width() * frame->height(), alpha)) {
+    return converted;
+  }
 
-  switch (static_cast<PixelFormat::Format>(frame->format())) {
-  case PixelFormat::PIX_FMT_RGBA8:
-  {
-    uint8_t* source = reinterpret_cast<uint8_t*>(frame->data());
+  return nullptr;
+}
 
-    switch (dest_format) {
-    case PixelFormat::PIX_FMT_RGBA16U: // 8-bit Integer -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 257);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA16F: // 8-bit Integer -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 255.0f;
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA32F: // 8-bit Integer -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 255.0f;
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_INVALID:
-    case PixelFormat::PIX_FMT_RGBA8:
-    case PixelFormat::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
+bool PixelService::ConvertPixelFormat(const char *src, const PixelFormat::Format &src_format,
+                                      char *dst, const PixelFormat::Format &dst_format,
+                                      int pixel_count, PixelKernels::AlphaOperation alpha)
+{
+  if (src_format <= PixelFormat::PIX_FMT_INVALID || src_format >= PixelFormat::PIX_FMT_COUNT
+      || dst_format <= PixelFormat::PIX_FMT_INVALID || dst_format >= PixelFormat::PIX_FMT_COUNT
+      || (src_format == dst_format && alpha == PixelKernels::kAlphaNone)) {
+    qWarning() << "Invalid parameters called for pixel format conversion";
+    return false;
   }
-  case PixelFormat::PIX_FMT_RGBA16U:
-  {
-    uint16_t* source = reinterpret_cast<uint16_t*>(frame->data());
 
-    switch (dest_format) {
-    case PixelFormat::PIX_FMT_RGBA8: // 16-bit Integer -> 8-bit Integer
-    {
-      uint8_t* destination = reinterpret_cast<uint8_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] / 257);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA16F: // 16-bit Integer -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 65535.0f;
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA32F: // 16-bit Integer -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 65535.0f;
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_INVALID:
-    case PixelFormat::PIX_FMT_RGBA16U:
-    case PixelFormat::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case PixelFormat::PIX_FMT_RGBA16F:
-  {
-    qfloat16* source = reinterpret_cast<qfloat16*>(frame->data());
+  int value_count = pixel_count * kRGBAChannels;
 
-    switch (dest_format) {
-    case PixelFormat::PIX_FMT_RGBA8: // 16-bit Float -> 8-bit Integer
-    {
-      uint8_t* destination = reinterpret_cast<uint8_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] * 255.0f);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA16U: // 16-bit Float -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 65535.0f);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA32F: // 16-bit Float -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i];
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_INVALID:
-    case PixelFormat::PIX_FMT_RGBA16F:
-    case PixelFormat::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case PixelFormat::PIX_FMT_RGBA32F:
-  {
-    float* source = reinterpret_cast<float*>(frame->data());
+  int thread_count = qMin(QThread::idealThreadCount(), value_count / kMinimumConversionChunk);
 
-    switch (dest_format) {
-    case PixelFormat::PIX_FMT_RGBA8: // 32-bit Float -> 8-bit Integer
-    {
-      uint8_t* destination = reinterpret_cast<uint8_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] * 255.0f);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA16U: // 32-bit Float -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 65535.0f);
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_RGBA16F: // 32-bit Float -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i];
-      }
-      break;
-    }
-    case PixelFormat::PIX_FMT_INVALID:
-    case PixelFormat::PIX_FMT_RGBA32F:
-    case PixelFormat::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case PixelFormat::PIX_FMT_INVALID:
-  case PixelFormat::PIX_FMT_COUNT:
-    valid = false;
+  if (thread_count <= 1) {
+    PixelKernels::Convert(src, src_format, dst, dst_format, value_count, alpha);
+    return true;
   }
 
-  if (valid) {
-    return converted;
-  }
+  // Use more chunks than threads so a thread that starts late doesn't hold everyone up
+  int chunk_count = thread_count * 4;
 
-  qWarning() << "Invalid parameters called for pixel format conversion";
-  return nullptr;
+  // Keep chunks a multiple of whole pixels and of the widest SIMD stride
+  int chunk_size = (value_count / chunk_count + 63) & ~63;
+  chunk_count = (value_count + chunk_size - 1) / chunk_size;
+
+  int src_channel_size = BytesPerChannel(src_format);
+  int dst_channel_size = BytesPerChannel(dst_format);
+
+  ParallelFor(chunk_count, [=](int chunk) {
+    int offset = chunk * chunk_size;
+
+    PixelKernels::Convert(src + offset * src_channel_size,
+                          src_format,
+                          dst + offset * dst_channel_size,
+                          dst_format,
+                          qMin(chunk_size, value_count - offset),
+                          alpha);
+  });
+
+  return true;
 }
 
 void PixelService::ConvertRGBtoRGBA(FramePtr frame)
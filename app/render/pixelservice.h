@@ -25,6 +25,7 @@
 
 #include "codec/frame.h"
 #include "pixelformat.h"
+#include "pixelkernels.h"
 #include "render/rendermodes.h"
 
 class PixelService : public QObject
@@ -82,9 +83,27 @@ public:
   /**
    * @brief Convert a frame to a pixel format
    *
-   * If the frame's pixel format == the destination format, this just returns `frame`.
+   * If the frame's pixel format == the destination format, this just returns `frame` (after applying `alpha` to it
+   * in place).
+   *
+   * @param alpha
+   *
+   * An alpha operation to apply while converting, which saves traversing the frame a second time.
    */
-  static FramePtr ConvertPixelFormat(FramePtr frame, const PixelFormat::Format &dest_format);
+  static FramePtr ConvertPixelFormat(FramePtr frame, const PixelFormat::Format &dest_format,
+                                     PixelKernels::AlphaOperation alpha = PixelKernels::kAlphaNone);
+
+  /**
+   * @brief Convert a buffer of RGBA pixels into an existing buffer in another pixel format
+   *
+   * `dst` must be large enough for `pixel_count` pixels in `dst_format` and must not overlap `src` unless they're the
+   * same buffer, which can be used to apply `alpha` in place. Large buffers are split across the global thread pool.
+   * Returns false if the formats are invalid, or if they're the same and there's no alpha operation to apply.
+   */
+  static bool ConvertPixelFormat(const char* src, const PixelFormat::Format& src_format,
+                                 char* dst, const PixelFormat::Format& dst_format,
+                                 int pixel_count,
+                                 PixelKernels::AlphaOperation alpha = PixelKernels::kAlphaNone);
 
   /**
    * @brief Convert an RGB image to an RGBA image
@@ -97,6 +116,11 @@ signals:
 private:
   PixelService() = default;
 
+  /**
+   * @brief Minimum number of values worth handing to another thread
+   */
+  static const int kMinimumConversionChunk;
+
   static PixelService* instance_;
 
 };
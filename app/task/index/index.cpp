@@ -15,12 +15,19 @@ void IndexTask::Action()
   } else {
     DecoderPtr decoder = Decoder::CreateFromID(stream_->footage()->decoder());
 
+    // Index() runs in this thread so forward progress directly
+    connect(decoder.get(), &Decoder::IndexProgress, this, &IndexTask::ProgressChanged, Qt::DirectConnection);
+
     decoder->set_stream(stream_);
 
     decoder->Open();
-    decoder->Index();
+    bool complete = decoder->Index(GetCancelledFlag());
     decoder->Close();
 
-    emit Succeeeded();
+    if (complete) {
+      emit Succeeeded();
+    } else if (!IsCancelled()) {
+      emit Failed(tr("Failed to index %1").arg(stream_->footage()->filename()));
+    }
   }
 }
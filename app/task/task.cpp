@@ -57,3 +57,8 @@ bool Task::IsCancelled()
 {
   return cancelled_;
 }
+
+const QAtomicInt *Task::GetCancelledFlag() const
+{
+  return &cancelled_;
+}
@@ -116,6 +116,11 @@ protected:
    */
   bool IsCancelled();
 
+  /**
+   * @brief Returns the cancelled flag itself for passing to long-running functions that poll it directly
+   */
+  const QAtomicInt* GetCancelledFlag() const;
+
 signals:
   /**
    * @brief Signal emitted whenever progress is made
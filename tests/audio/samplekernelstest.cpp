@@ -0,0 +1,138 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "audio/samplekernels.h"
+
+namespace {
+
+// Odd lengths so both the vectorized loops and their scalar tails run
+const int kFrameCounts[] = {0, 1, 3, 4, 7, 16, 1023};
+
+std::vector<float> MakeSamples(int count)
+{
+  std::vector<float> samples(static_cast<size_t>(count));
+
+  for (int i=0;i<count;i++) {
+    samples[static_cast<size_t>(i)] = static_cast<float>(i % 17) * 0.125f - 1.0f;
+  }
+
+  return samples;
+}
+
+std::vector<float> MakeCurve(int count, float offset)
+{
+  std::vector<float> curve(static_cast<size_t>(count));
+
+  for (int i=0;i<count;i++) {
+    curve[static_cast<size_t>(i)] = offset + static_cast<float>(i) * 0.01f;
+  }
+
+  return curve;
+}
+
+}
+
+TEST(SampleKernelsTest, GainMatchesScalar)
+{
+  for (int count : kFrameCounts) {
+    std::vector<float> input = MakeSamples(count);
+    std::vector<float> output(input.size());
+
+    SampleKernels::Gain(input.data(), output.data(), count, 0.5f);
+
+    for (size_t i=0;i<input.size();i++) {
+      EXPECT_FLOAT_EQ(output[i], input[i] * 0.5f) << "count " << count << " index " << i;
+    }
+  }
+}
+
+TEST(SampleKernelsTest, GainInPlace)
+{
+  std::vector<float> expected = MakeSamples(1023);
+  std::vector<float> buffer = expected;
+
+  SampleKernels::Gain(buffer.data(), buffer.data(), static_cast<int>(buffer.size()), -2.0f);
+
+  for (size_t i=0;i<buffer.size();i++) {
+    EXPECT_FLOAT_EQ(buffer[i], expected[i] * -2.0f);
+  }
+}
+
+TEST(SampleKernelsTest, GainCurveAppliesOneGainPerFrame)
+{
+  for (int channels=1;channels<=6;channels++) {
+    for (int frames : kFrameCounts) {
+      std::vector<float> input = MakeSamples(frames * channels);
+      std::vector<float> gains = MakeCurve(frames, 0.25f);
+      std::vector<float> output(input.size());
+
+      SampleKernels::GainCurve(input.data(), output.data(), frames, channels, gains.data());
+
+      for (int i=0;i<frames;i++) {
+        for (int j=0;j<channels;j++) {
+          size_t index = static_cast<size_t>(i * channels + j);
+
+          EXPECT_FLOAT_EQ(output[index], input[index] * gains[static_cast<size_t>(i)])
+              << channels << " channels, frame " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(SampleKernelsTest, StereoGainKeepsChannelsApart)
+{
+  for (int frames : kFrameCounts) {
+    std::vector<float> input = MakeSamples(frames * 2);
+    std::vector<float> output(input.size());
+
+    SampleKernels::StereoGain(input.data(), output.data(), frames, 0.25f, 4.0f);
+
+    for (int i=0;i<frames;i++) {
+      size_t left = static_cast<size_t>(i * 2);
+
+      EXPECT_FLOAT_EQ(output[left], input[left] * 0.25f);
+      EXPECT_FLOAT_EQ(output[left + 1], input[left + 1] * 4.0f);
+    }
+  }
+}
+
+TEST(SampleKernelsTest, StereoGainCurveMatchesScalar)
+{
+  for (int frames : kFrameCounts) {
+    std::vector<float> input = MakeSamples(frames * 2);
+    std::vector<float> left = MakeCurve(frames, 0.5f);
+    std::vector<float> right = MakeCurve(frames, -0.5f);
+    std::vector<float> output = input;
+
+    // In place, as the audio worker uses it
+    SampleKernels::StereoGainCurve(output.data(), output.data(), frames, left.data(), right.data());
+
+    for (int i=0;i<frames;i++) {
+      size_t frame = static_cast<size_t>(i);
+
+      EXPECT_FLOAT_EQ(output[frame * 2], input[frame * 2] * left[frame]);
+      EXPECT_FLOAT_EQ(output[frame * 2 + 1], input[frame * 2 + 1] * right[frame]);
+    }
+  }
+}
@@ -0,0 +1,170 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QVector>
+
+#include "common/define.h"
+#include "render/backend/videorenderframecache.h"
+#include "render/pixelkernels.h"
+#include "render/pixelservice.h"
+
+namespace {
+
+/**
+ * @brief A smooth gradient with a little grain, closer to a rendered frame than random noise or a flat color
+ */
+QByteArray CreateFrame(const VideoRenderingParams& params)
+{
+  int width = params.effective_width();
+  int height = params.effective_height();
+  int value_count = width * height * kRGBAChannels;
+
+  QVector<float> values(value_count);
+  quint32 seed = 1;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      float* pixel = values.data() + (y * width + x) * kRGBAChannels;
+
+      seed = seed * 1664525u + 1013904223u;
+      float grain = static_cast<float>(seed >> 24) / 255.0f * 0.01f;
+
+      pixel[0] = static_cast<float>(x) / static_cast<float>(width) + grain;
+      pixel[1] = static_cast<float>(y) / static_cast<float>(height) + grain;
+      pixel[2] = 0.5f + grain;
+      pixel[3] = 1.0f;
+    }
+  }
+
+  QByteArray frame(PixelService::GetBufferSize(params.format(), width, height), Qt::Uninitialized);
+
+  PixelKernels::Convert(values.constData(), PixelFormat::PIX_FMT_RGBA32F,
+                        frame.data(), params.format(),
+                        value_count);
+
+  return frame;
+}
+
+VideoRenderingParams ParamsForHeight(int height)
+{
+  return VideoRenderingParams(height * 16 / 9, height, rational(1, 30), PixelFormat::PIX_FMT_RGBA16F, RenderMode::kOffline);
+}
+
+QByteArray HashFor(VideoRenderFrameCache::Codec codec, int height)
+{
+  return QCryptographicHash::hash(QStringLiteral("framecachebenchmark-%1-%2").arg(codec).arg(height).toUtf8(),
+                                  QCryptographicHash::Sha1);
+}
+
+void SetDiskCounters(benchmark::State& state, const VideoRenderFrameCache& cache, const QByteArray& hash,
+                     const VideoRenderingParams& params, qint64 buffer_size)
+{
+  qint64 file_size = QFileInfo(cache.CachePathName(hash, params.format())).size();
+
+  state.counters["file_bytes"] = static_cast<double>(file_size);
+  state.counters["ratio"] = static_cast<double>(file_size) / static_cast<double>(buffer_size);
+}
+
+}
+
+/**
+ * @brief Writing a frame with each codec
+ *
+ * Arguments are the codec and the frame height (1080 or 2160). Alongside the time, `file_bytes` is the size of the
+ * resulting file and `ratio` its size relative to the uncompressed frame.
+ */
+void BM_FrameCacheSave(benchmark::State& state)
+{
+  VideoRenderFrameCache::Codec codec = static_cast<VideoRenderFrameCache::Codec>(state.range(0));
+  VideoRenderingParams params = ParamsForHeight(static_cast<int>(state.range(1)));
+  QByteArray frame = CreateFrame(params);
+  QByteArray hash = HashFor(codec, params.effective_height());
+
+  VideoRenderFrameCache cache;
+  cache.SetCodec(codec);
+
+  for (auto _ : state) {
+    if (!cache.SaveFrame(hash, params, frame.constData())) {
+      state.SkipWithError("Failed to save frame");
+      break;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * frame.size());
+  SetDiskCounters(state, cache, hash, params, frame.size());
+
+  QFile::remove(cache.CachePathName(hash, params.format()));
+}
+
+/**
+ * @brief Reading back a frame written with each codec, arguments are the same as BM_FrameCacheSave
+ */
+void BM_FrameCacheLoad(benchmark::State& state)
+{
+  VideoRenderFrameCache::Codec codec = static_cast<VideoRenderFrameCache::Codec>(state.range(0));
+  VideoRenderingParams params = ParamsForHeight(static_cast<int>(state.range(1)));
+  QByteArray frame = CreateFrame(params);
+  QByteArray hash = HashFor(codec, params.effective_height());
+
+  VideoRenderFrameCache cache;
+  cache.SetCodec(codec);
+
+  if (!cache.SaveFrame(hash, params, frame.constData())) {
+    state.SkipWithError("Failed to save frame");
+    return;
+  }
+
+  QByteArray loaded(frame.size(), Qt::Uninitialized);
+
+  for (auto _ : state) {
+    if (!cache.LoadFrame(hash, params, loaded.data())) {
+      state.SkipWithError("Failed to load frame");
+      break;
+    }
+
+    benchmark::DoNotOptimize(loaded.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * frame.size());
+  SetDiskCounters(state, cache, hash, params, frame.size());
+
+  QFile::remove(cache.CachePathName(hash, params.format()));
+}
+
+namespace {
+
+void FrameCacheArguments(benchmark::internal::Benchmark* b)
+{
+  for (int codec=0;codec<VideoRenderFrameCache::kCodecCount;codec++) {
+    b->Args({codec, 1080});
+    b->Args({codec, 2160});
+  }
+
+  b->Unit(benchmark::kMillisecond);
+  b->UseRealTime();
+}
+
+}
+
+BENCHMARK(BM_FrameCacheSave)->Apply(FrameCacheArguments);
+BENCHMARK(BM_FrameCacheLoad)->Apply(FrameCacheArguments);
@@ -0,0 +1,144 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+
+#include "common/bezier.h"
+#include "node/input.h"
+
+namespace {
+
+/**
+ * @brief An input with `count` bezier keyframes one second apart, like a hand-drawn volume envelope
+ */
+NodeInput* CreateAutomation(int count)
+{
+  NodeInput* input = new NodeInput(QStringLiteral("value_in"), NodeParam::kFloat, 0.0);
+  input->set_is_keyframing(true);
+
+  for (int i=0;i<count;i++) {
+    NodeKeyframePtr key = NodeKeyframe::Create(i, (i % 2) ? 1.0 : 0.0, NodeKeyframe::kBezier, 0);
+    key->set_bezier_control_in(QPointF(-0.4, 0.0));
+    key->set_bezier_control_out(QPointF(0.4, 0.0));
+    input->insert_keyframe(key);
+  }
+
+  return input;
+}
+
+const int kKeyframeCount = 64;
+
+}
+
+/**
+ * @brief Evaluating once per video frame, in order, as the renderer does
+ */
+void BM_KeyframeValueAtTime(benchmark::State& state)
+{
+  NodeInput* input = CreateAutomation(kKeyframeCount);
+  rational timebase(1001, 30000);
+
+  for (auto _ : state) {
+    for (rational t=0;t<kKeyframeCount;t+=timebase) {
+      benchmark::DoNotOptimize(input->get_value_at_time_for_track(t, 0));
+    }
+  }
+
+  delete input;
+}
+BENCHMARK(BM_KeyframeValueAtTime);
+
+/**
+ * @brief Evaluating every sample of an audio block at once, as AudioWorker does for automation
+ */
+void BM_KeyframeValuesBatch(benchmark::State& state)
+{
+  NodeInput* input = CreateAutomation(kKeyframeCount);
+  int block_size = static_cast<int>(state.range(0));
+  double start = 0.0;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(input->get_values_at_times_for_track(start, 1.0 / 48000.0, block_size, 0));
+
+    // Move through the automation like playback would
+    start += static_cast<double>(block_size) / 48000.0;
+    if (start >= kKeyframeCount) {
+      start = 0.0;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * block_size);
+
+  delete input;
+}
+BENCHMARK(BM_KeyframeValuesBatch)->Arg(1024)->Arg(48000);
+
+/**
+ * @brief The per-sample search and bisection that evaluating keyframes used before segments were precalculated
+ */
+void BM_KeyframeBisectionReference(benchmark::State& state)
+{
+  NodeInput* input = CreateAutomation(kKeyframeCount);
+  const QList<NodeKeyframePtr>& keys = input->keyframe_tracks().first();
+  int block_size = static_cast<int>(state.range(0));
+  double start = 0.0;
+
+  for (auto _ : state) {
+    for (int i=0;i<block_size;i++) {
+      double time = start + static_cast<double>(i) / 48000.0;
+      double value = 0.0;
+
+      for (int j=0;j<keys.size()-1;j++) {
+        const NodeKeyframePtr& before = keys.at(j);
+        const NodeKeyframePtr& after = keys.at(j+1);
+
+        double before_time = before->time().toDouble();
+        double after_time = after->time().toDouble();
+
+        if (before_time <= time && after_time > time) {
+          double t = Bezier::CubicXtoT(time,
+                                       before_time,
+                                       before_time + before->bezier_control_out().x(),
+                                       after_time + after->bezier_control_in().x(),
+                                       after_time);
+
+          value = Bezier::CubicTtoY(before->value().toDouble(),
+                                    before->value().toDouble() + before->bezier_control_out().y(),
+                                    after->value().toDouble() + after->bezier_control_in().y(),
+                                    after->value().toDouble(),
+                                    t);
+          break;
+        }
+      }
+
+      benchmark::DoNotOptimize(value);
+    }
+
+    start += static_cast<double>(block_size) / 48000.0;
+    if (start >= kKeyframeCount - 1) {
+      start = 0.0;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * block_size);
+
+  delete input;
+}
+BENCHMARK(BM_KeyframeBisectionReference)->Arg(1024);
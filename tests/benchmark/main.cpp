@@ -0,0 +1,67 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+#include <QApplication>
+#include <QTemporaryDir>
+
+#include "config/config.h"
+#include "core.h"
+#include "node/factory.h"
+#include "render/backend/decoderpool.h"
+#include "render/diskmanager.h"
+#include "render/pixelservice.h"
+
+int main(int argc, char *argv[])
+{
+  // See tests/main.cpp, nodes need an application even though nothing is shown
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QApplication a(argc, argv);
+
+  // Keep frames written by the cache benchmarks out of the real disk cache
+  QTemporaryDir cache_dir;
+  Config::Current()["DiskCachePath"] = cache_dir.path();
+
+  // The services Core::Start() sets up that rendering relies on
+  Core::instance()->DeclareTypesForQt();
+  NodeFactory::Initialize();
+  DiskManager::CreateInstance();
+  DecoderPool::CreateInstance();
+  PixelService::CreateInstance();
+
+  ::benchmark::Initialize(&argc, argv);
+
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+
+  PixelService::DestroyInstance();
+  DecoderPool::DestroyInstance();
+  DiskManager::DestroyInstance();
+  NodeFactory::Destroy();
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+#include <QVector>
+
+#include "common/define.h"
+#include "render/pixelkernels.h"
+#include "render/pixelservice.h"
+
+namespace {
+
+// A 1080p frame
+const int kValueCount = 1920 * 1080 * kRGBAChannels;
+
+QByteArray CreateBuffer(PixelFormat::Format format)
+{
+  QVector<float> values(kValueCount);
+
+  for (int i=0;i<kValueCount;i++) {
+    values[i] = static_cast<float>(i % 251) / 250.0f;
+  }
+
+  QByteArray buffer(kValueCount * PixelService::BytesPerChannel(format), Qt::Uninitialized);
+
+  PixelKernels::Convert(values.constData(), PixelFormat::PIX_FMT_RGBA32F,
+                        buffer.data(), format,
+                        kValueCount);
+
+  return buffer;
+}
+
+}
+
+/**
+ * @brief Converting a frame from one format to another
+ *
+ * Arguments are the source format, destination format and alpha operation. Bytes processed counts the source buffer.
+ */
+void BM_PixelConvert(benchmark::State& state)
+{
+  PixelFormat::Format src_format = static_cast<PixelFormat::Format>(state.range(0));
+  PixelFormat::Format dst_format = static_cast<PixelFormat::Format>(state.range(1));
+  PixelKernels::AlphaOperation alpha = static_cast<PixelKernels::AlphaOperation>(state.range(2));
+
+  QByteArray src = CreateBuffer(src_format);
+  QByteArray dst(kValueCount * PixelService::BytesPerChannel(dst_format), Qt::Uninitialized);
+
+  for (auto _ : state) {
+    PixelKernels::Convert(src.constData(), src_format, dst.data(), dst_format, kValueCount, alpha);
+    benchmark::DoNotOptimize(dst.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * src.size());
+  state.SetLabel(QStringLiteral("%1 -> %2").arg(PixelService::GetPixelFormatInfo(src_format).name,
+                                                PixelService::GetPixelFormatInfo(dst_format).name).toStdString());
+}
+
+/**
+ * @brief Applying an alpha operation in place, like the color manager does before and after OCIO
+ */
+void BM_PixelAlphaInPlace(benchmark::State& state)
+{
+  PixelFormat::Format format = static_cast<PixelFormat::Format>(state.range(0));
+  PixelKernels::AlphaOperation alpha = static_cast<PixelKernels::AlphaOperation>(state.range(1));
+
+  QByteArray buffer = CreateBuffer(format);
+
+  for (auto _ : state) {
+    PixelKernels::Convert(buffer.data(), format, buffer.data(), format, kValueCount, alpha);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+  state.SetLabel(PixelService::GetPixelFormatInfo(format).name.toStdString());
+}
+
+namespace {
+
+void ConvertArguments(benchmark::internal::Benchmark* b)
+{
+  for (int src=0;src<PixelFormat::PIX_FMT_COUNT;src++) {
+    for (int dst=0;dst<PixelFormat::PIX_FMT_COUNT;dst++) {
+      b->Args({src, dst, PixelKernels::kAlphaNone});
+      b->Args({src, dst, PixelKernels::kAlphaAssociate});
+    }
+  }
+
+  b->Unit(benchmark::kMicrosecond);
+}
+
+void AlphaArguments(benchmark::internal::Benchmark* b)
+{
+  for (int format=0;format<PixelFormat::PIX_FMT_COUNT;format++) {
+    b->Args({format, PixelKernels::kAlphaAssociate});
+    b->Args({format, PixelKernels::kAlphaDisassociate});
+  }
+
+  b->Unit(benchmark::kMicrosecond);
+}
+
+}
+
+BENCHMARK(BM_PixelConvert)->Apply(ConvertArguments);
+BENCHMARK(BM_PixelAlphaInPlace)->Apply(AlphaArguments);
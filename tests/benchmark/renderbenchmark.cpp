@@ -0,0 +1,186 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <QTimer>
+
+#include "node/block/clip/clip.h"
+#include "node/factory.h"
+#include "project/item/sequence/sequence.h"
+#include "render/backend/opengl/openglbackend.h"
+
+namespace {
+
+const int kClipCount = 5;
+const int kBlursPerClip = 3;
+
+// Never wait longer than this for a pass over the sequence, in case the backend stalls
+const int kRenderTimeout = 300000;
+
+/**
+ * @brief A sequence of one second clips, each a solid with several gaussian blurs on it
+ *
+ * The blur sigma is keyframed across each clip so every frame hashes differently and has to be rendered. The last
+ * keyframe of every clip is returned in `keys` so the caller can change it to invalidate the whole sequence.
+ */
+void CreateBlurSequence(Sequence* sequence, QList<NodeKeyframePtr>* keys)
+{
+  sequence->set_video_params(VideoParams(1920, 1080, rational(1, 30)));
+  sequence->add_default_nodes();
+
+  TrackOutput* track = sequence->viewer_output()->track_list(Timeline::kTrackTypeVideo)->TrackAt(0);
+
+  for (int i=0;i<kClipCount;i++) {
+    Node* previous = NodeFactory::CreateFromID(QStringLiteral("org.olivevideoeditor.Olive.solidgenerator"));
+    sequence->AddNode(previous);
+
+    for (int j=0;j<kBlursPerClip;j++) {
+      Node* blur = NodeFactory::CreateFromID(QStringLiteral("org.olivevideoeditor.Olive.gaussianblur"));
+      sequence->AddNode(blur);
+
+      NodeParam::ConnectEdge(previous->output(), static_cast<NodeInput*>(blur->GetParameterWithID(QStringLiteral("tex_in"))));
+
+      NodeInput* sigma = static_cast<NodeInput*>(blur->GetParameterWithID(QStringLiteral("sigma_in")));
+      sigma->set_is_keyframing(true);
+      sigma->insert_keyframe(NodeKeyframe::Create(0, 10.0, NodeKeyframe::kLinear, 0));
+
+      NodeKeyframePtr last_key = NodeKeyframe::Create(1, 30.0, NodeKeyframe::kLinear, 0);
+      sigma->insert_keyframe(last_key);
+
+      if (j == 0) {
+        keys->append(last_key);
+      }
+
+      previous = blur;
+    }
+
+    ClipBlock* clip = new ClipBlock();
+    clip->set_length_and_media_out(1);
+    sequence->AddNode(clip);
+    NodeParam::ConnectEdge(previous->output(), clip->texture_input());
+
+    track->AppendBlock(clip);
+  }
+}
+
+}
+
+/**
+ * @brief Rendering a blur-heavy 1080p sequence with the OpenGL backend using `range(0)` worker threads
+ *
+ * Frames are hashed and rendered but not downloaded or written to the disk cache, so this measures how well GPU work
+ * scales with the number of workers. `frames_per_second` is the throughput over the whole run.
+ */
+void BM_OpenGLWorkerScaling(benchmark::State& state)
+{
+  QOffscreenSurface surface;
+  surface.create();
+
+  QOpenGLContext ctx;
+  ctx.setShareContext(QOpenGLContext::globalShareContext());
+
+  if (!ctx.create() || !ctx.makeCurrent(&surface)) {
+    state.SkipWithError("Failed to create an OpenGL context");
+    return;
+  }
+
+  Sequence sequence;
+  QList<NodeKeyframePtr> keys;
+  CreateBlurSequence(&sequence, &keys);
+
+  ViewerOutput* viewer = sequence.viewer_output();
+
+  OpenGLBackend backend;
+  backend.SetWorkerCount(static_cast<int>(state.range(0)));
+  backend.SetOperatingMode(VideoRenderWorker::kHashAndRenderOnly);
+  backend.SetViewerNode(viewer);
+  backend.SetParameters(VideoRenderingParams(viewer->video_params(),
+                                             PixelFormat::PIX_FMT_RGBA16F,
+                                             RenderMode::kOffline));
+
+  QEventLoop loop;
+  QObject::connect(&backend, &OpenGLBackend::QueueComplete, &loop, &QEventLoop::quit);
+
+  QTimer timeout;
+  timeout.setSingleShot(true);
+  QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+  // Render once untimed so shader compiling and thread startup aren't measured
+  backend.InvalidateCache(0, viewer->Length());
+  timeout.start(kRenderTimeout);
+  loop.exec();
+
+  int64_t frame_count = 0;
+  double total_seconds = 0.0;
+  double sigma = 30.0;
+
+  for (auto _ : state) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Changing the keyframes invalidates every frame of its clip
+    sigma += 0.01;
+    foreach (NodeKeyframePtr key, keys) {
+      key->set_value(sigma);
+    }
+
+    timeout.start(kRenderTimeout);
+    loop.exec();
+
+    if (!timeout.isActive()) {
+      state.SkipWithError("Timed out waiting for the sequence to render");
+      break;
+    }
+
+    double seconds = static_cast<double>(timer.nsecsElapsed()) / 1e9;
+    state.SetIterationTime(seconds);
+
+    total_seconds += seconds;
+    frame_count += kClipCount * 30;
+  }
+
+  if (total_seconds > 0.0) {
+    state.counters["frames_per_second"] = static_cast<double>(frame_count) / total_seconds;
+  }
+
+  backend.Close();
+  ctx.doneCurrent();
+}
+
+namespace {
+
+void WorkerCounts(benchmark::internal::Benchmark* b)
+{
+  for (int i=1;i<=QThread::idealThreadCount();i++) {
+    b->Arg(i);
+  }
+
+  b->Unit(benchmark::kMillisecond);
+  b->UseManualTime();
+}
+
+}
+
+BENCHMARK(BM_OpenGLWorkerScaling)->Apply(WorkerCounts);
@@ -0,0 +1,250 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+
+#include "common/rational.h"
+#include "common/timerange.h"
+
+namespace {
+
+const rational kTimebase(1001, 30000);
+
+QVector<rational> FrameTimes(int count)
+{
+  QVector<rational> times(count);
+  rational t;
+
+  for (int i=0;i<count;i++) {
+    times[i] = t;
+    t += kTimebase;
+  }
+
+  return times;
+}
+
+}
+
+/**
+ * @brief Comparing times in the same timebase, which only compares numerators
+ */
+void BM_RationalCompareSameTimebase(benchmark::State& state)
+{
+  QVector<rational> times = FrameTimes(1024);
+  rational pivot(1001 * 500, 30000);
+
+  for (auto _ : state) {
+    int less = 0;
+
+    foreach (const rational& t, times) {
+      less += (t < pivot);
+    }
+
+    benchmark::DoNotOptimize(less);
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_RationalCompareSameTimebase);
+
+/**
+ * @brief Comparing times in unrelated timebases, which needs cross-multiplication
+ */
+void BM_RationalCompareMixedTimebase(benchmark::State& state)
+{
+  QVector<rational> times = FrameTimes(1024);
+  rational pivot(48000 * 8, 48000 + 1);
+
+  for (auto _ : state) {
+    int less = 0;
+
+    foreach (const rational& t, times) {
+      less += (t < pivot);
+    }
+
+    benchmark::DoNotOptimize(less);
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_RationalCompareMixedTimebase);
+
+/**
+ * @brief Stepping through a sequence frame by frame, as the cache queue and exporter do
+ */
+void BM_RationalStepTimebase(benchmark::State& state)
+{
+  for (auto _ : state) {
+    rational t;
+
+    for (int i=0;i<1024;i++) {
+      t += kTimebase;
+    }
+
+    benchmark::DoNotOptimize(t);
+  }
+
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_RationalStepTimebase);
+
+/**
+ * @brief Adding whole seconds to frame times, e.g. offsetting by a block's in point
+ */
+void BM_RationalAddInteger(benchmark::State& state)
+{
+  QVector<rational> times = FrameTimes(1024);
+  rational offset(3);
+
+  for (auto _ : state) {
+    foreach (const rational& t, times) {
+      benchmark::DoNotOptimize(t + offset);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_RationalAddInteger);
+
+void BM_RationalFromDouble(benchmark::State& state)
+{
+  for (auto _ : state) {
+    for (int i=0;i<1024;i++) {
+      benchmark::DoNotOptimize(rational::fromDouble(static_cast<double>(i) / 48000.0));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_RationalFromDouble);
+
+/**
+ * @brief Invalidating every other frame of a sequence, leaving `range(0)` separate ranges
+ */
+void BM_TimeRangeListInsertDisjoint(benchmark::State& state)
+{
+  int count = static_cast<int>(state.range(0));
+  QVector<rational> times = FrameTimes(count * 2);
+
+  for (auto _ : state) {
+    TimeRangeList list;
+
+    for (int i=0;i<count;i++) {
+      list.InsertTimeRange(TimeRange(times.at(i * 2), times.at(i * 2) + kTimebase));
+    }
+
+    benchmark::DoNotOptimize(list.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TimeRangeListInsertDisjoint)->Arg(64)->Arg(1024);
+
+/**
+ * @brief Invalidating frame by frame, every insert merges with the previous range
+ */
+void BM_TimeRangeListInsertContiguous(benchmark::State& state)
+{
+  int count = static_cast<int>(state.range(0));
+  QVector<rational> times = FrameTimes(count);
+
+  for (auto _ : state) {
+    TimeRangeList list;
+
+    foreach (const rational& t, times) {
+      list.InsertTimeRange(TimeRange(t, t + kTimebase));
+    }
+
+    benchmark::DoNotOptimize(list.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TimeRangeListInsertContiguous)->Arg(64)->Arg(1024);
+
+/**
+ * @brief Popping frames off the front of a queue, like RenderBackend::PopNextFramesFromQueue()
+ */
+void BM_TimeRangeListRemoveFrames(benchmark::State& state)
+{
+  int count = static_cast<int>(state.range(0));
+  QVector<rational> times = FrameTimes(count);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    TimeRangeList list;
+    list.InsertTimeRange(TimeRange(0, times.last() + kTimebase));
+    state.ResumeTiming();
+
+    foreach (const rational& t, times) {
+      list.RemoveTimeRange(TimeRange(t, t + kTimebase));
+    }
+
+    benchmark::DoNotOptimize(list.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TimeRangeListRemoveFrames)->Arg(64)->Arg(1024);
+
+/**
+ * @brief Checking whether each frame is queued against a fragmented list, like VideoRenderBackend::TimeIsQueued()
+ */
+void BM_TimeRangeListContains(benchmark::State& state)
+{
+  int count = static_cast<int>(state.range(0));
+  QVector<rational> times = FrameTimes(count * 2);
+  TimeRangeList list;
+
+  for (int i=0;i<count;i++) {
+    list.InsertTimeRange(TimeRange(times.at(i * 2), times.at(i * 2) + kTimebase));
+  }
+
+  for (auto _ : state) {
+    int contained = 0;
+
+    foreach (const rational& t, times) {
+      contained += list.ContainsTimeRange(TimeRange(t, t + kTimebase));
+    }
+
+    benchmark::DoNotOptimize(contained);
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_TimeRangeListContains)->Arg(64)->Arg(1024);
+
+void BM_TimeRangeListIntersects(benchmark::State& state)
+{
+  int count = static_cast<int>(state.range(0));
+  QVector<rational> times = FrameTimes(count * 2);
+  TimeRangeList list;
+
+  for (int i=0;i<count;i++) {
+    list.InsertTimeRange(TimeRange(times.at(i * 2), times.at(i * 2) + kTimebase));
+  }
+
+  TimeRange middle(times.at(count / 2), times.at(count + count / 2));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.Intersects(middle));
+  }
+}
+BENCHMARK(BM_TimeRangeListIntersects)->Arg(64)->Arg(1024);
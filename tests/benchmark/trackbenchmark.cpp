@@ -0,0 +1,147 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <benchmark/benchmark.h>
+
+#include "node/block/gap/gap.h"
+#include "node/graph.h"
+#include "node/output/track/track.h"
+
+namespace {
+
+/**
+ * @brief A track of `count` blocks of varying lengths
+ */
+TrackOutput* CreateTrack(NodeGraph* graph, int count)
+{
+  TrackOutput* track = new TrackOutput();
+  graph->AddNode(track);
+
+  for (int i=0;i<count;i++) {
+    GapBlock* block = new GapBlock();
+    block->set_length_and_media_out(rational(i % 5 + 1, 30));
+    graph->AddNode(block);
+    track->AppendBlock(block);
+  }
+
+  return track;
+}
+
+/**
+ * @brief Evenly spread times across the whole track
+ */
+QVector<rational> LookupTimes(TrackOutput* track, int count)
+{
+  QVector<rational> times(count);
+
+  for (int i=0;i<count;i++) {
+    times[i] = track->track_length() * rational(i, count);
+  }
+
+  return times;
+}
+
+}
+
+void BM_TrackBlockAtTime(benchmark::State& state)
+{
+  NodeGraph graph;
+  TrackOutput* track = CreateTrack(&graph, static_cast<int>(state.range(0)));
+  QVector<rational> times = LookupTimes(track, 1024);
+
+  for (auto _ : state) {
+    foreach (const rational& t, times) {
+      benchmark::DoNotOptimize(track->BlockAtTime(t));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_TrackBlockAtTime)->Arg(100)->Arg(1000)->Arg(10000);
+
+/**
+ * @brief The linear scan BlockAtTime() used before it binary searched, for comparison
+ */
+void BM_TrackBlockAtTimeLinearScan(benchmark::State& state)
+{
+  NodeGraph graph;
+  TrackOutput* track = CreateTrack(&graph, static_cast<int>(state.range(0)));
+  QVector<rational> times = LookupTimes(track, 1024);
+
+  for (auto _ : state) {
+    foreach (const rational& t, times) {
+      Block* found = nullptr;
+
+      foreach (Block* block, track->Blocks()) {
+        if (block && block->in() <= t && block->out() > t) {
+          found = block;
+          break;
+        }
+      }
+
+      benchmark::DoNotOptimize(found);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_TrackBlockAtTimeLinearScan)->Arg(100)->Arg(1000)->Arg(10000);
+
+void BM_TrackBlocksAtTimeRange(benchmark::State& state)
+{
+  NodeGraph graph;
+  TrackOutput* track = CreateTrack(&graph, static_cast<int>(state.range(0)));
+  QVector<rational> times = LookupTimes(track, 1024);
+
+  // About a second of audio, the size of an audio render job
+  rational length(1);
+
+  for (auto _ : state) {
+    foreach (const rational& t, times) {
+      benchmark::DoNotOptimize(track->BlocksAtTimeRange(TimeRange(t, t + length)));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * times.size());
+}
+BENCHMARK(BM_TrackBlocksAtTimeRange)->Arg(100)->Arg(10000);
+
+/**
+ * @brief Inserting at the start of a track, which moves every block after it
+ */
+void BM_TrackPrependBlock(benchmark::State& state)
+{
+  for (auto _ : state) {
+    state.PauseTiming();
+    NodeGraph graph;
+    TrackOutput* track = CreateTrack(&graph, static_cast<int>(state.range(0)));
+    GapBlock* block = new GapBlock();
+    block->set_length_and_media_out(1);
+    graph.AddNode(block);
+    state.ResumeTiming();
+
+    track->PrependBlock(block);
+
+    state.PauseTiming();
+    graph.Clear();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_TrackPrependBlock)->Arg(100)->Arg(1000);
@@ -0,0 +1,104 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+
+#include "common/bezier.h"
+
+namespace {
+
+// Control points of curves shaped like keyframe timings, each monotonic in x
+const double kCubicCurves[][4] = {
+  {0.0, 0.0, 1.0, 1.0},
+  {0.0, 0.42, 0.58, 1.0},
+  {0.0, 0.9, 0.1, 1.0},
+  {2.0, 2.0, 2.0, 5.0},
+  {-3.0, -1.0, 4.0, 10.0}
+};
+
+const double kTolerance = 0.000001;
+
+}
+
+TEST(BezierTest, PolynomialMatchesCubic)
+{
+  for (const auto& curve : kCubicCurves) {
+    double coeffs[4];
+    Bezier::CubicToPolynomial(curve[0], curve[1], curve[2], curve[3], coeffs);
+
+    for (int i=0;i<=20;i++) {
+      double t = i / 20.0;
+
+      EXPECT_NEAR(Bezier::PolynomialTtoY(coeffs, t),
+                  Bezier::CubicTtoY(curve[0], curve[1], curve[2], curve[3], t),
+                  kTolerance);
+    }
+  }
+}
+
+TEST(BezierTest, PolynomialMatchesQuadratic)
+{
+  double coeffs[4];
+  Bezier::QuadraticToPolynomial(1.0, 4.0, 2.0, coeffs);
+
+  for (int i=0;i<=20;i++) {
+    double t = i / 20.0;
+
+    EXPECT_NEAR(Bezier::PolynomialTtoY(coeffs, t), Bezier::QuadraticTtoY(1.0, 4.0, 2.0, t), kTolerance);
+  }
+}
+
+TEST(BezierTest, NewtonSolvesLikeBisection)
+{
+  // Guesses that are exact, nearby, far off and out of range should all arrive at the same answer
+  const double guesses[] = {0.0, 0.25, 0.5, 0.99, -1.0, 2.0};
+
+  for (const auto& curve : kCubicCurves) {
+    double coeffs[4];
+    Bezier::CubicToPolynomial(curve[0], curve[1], curve[2], curve[3], coeffs);
+
+    for (int i=0;i<=16;i++) {
+      double x = curve[0] + (curve[3] - curve[0]) * i / 16.0;
+
+      double expected_t = Bezier::CubicXtoT(x, curve[0], curve[1], curve[2], curve[3]);
+
+      for (double guess : guesses) {
+        double t = Bezier::PolynomialXtoT(x, coeffs, guess);
+
+        // Compare where the solutions land rather than `t` itself, flat parts of a curve have many valid `t` values
+        EXPECT_NEAR(Bezier::PolynomialTtoY(coeffs, t), x, 0.00001) << "guess " << guess;
+        EXPECT_NEAR(Bezier::CubicTtoY(curve[0], curve[1], curve[2], curve[3], t),
+                    Bezier::CubicTtoY(curve[0], curve[1], curve[2], curve[3], expected_t),
+                    0.0001);
+      }
+    }
+  }
+}
+
+TEST(BezierTest, NewtonHandlesFlatDerivative)
+{
+  // The derivative is zero at t = 0.5, where Newton's method can't continue and bisection has to take over
+  double coeffs[4];
+  Bezier::CubicToPolynomial(0.0, 1.0, 0.0, 1.0, coeffs);
+
+  double t = Bezier::PolynomialXtoT(0.5, coeffs, 0.5);
+
+  EXPECT_NEAR(Bezier::PolynomialTtoY(coeffs, t), 0.5, 0.00001);
+}
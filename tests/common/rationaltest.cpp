@@ -0,0 +1,212 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+
+#include "common/rational.h"
+
+namespace {
+
+intType ReferenceGcd(intType a, intType b)
+{
+  a = qAbs(a);
+  b = qAbs(b);
+
+  while (b != 0) {
+    intType tmp = a % b;
+    a = b;
+    b = tmp;
+  }
+
+  return a;
+}
+
+/**
+ * @brief Build the canonical form of `n/d` without going through any of rational's arithmetic
+ */
+rational Reduced(intType n, intType d)
+{
+  if (n == 0 || d == 0) {
+    return rational();
+  }
+
+  if (d < 0) {
+    n = -n;
+    d = -d;
+  }
+
+  intType g = ReferenceGcd(n, d);
+
+  return rational(n / g, d / g);
+}
+
+/**
+ * @brief Cross-multiplying comparison, which the fast paths must always agree with
+ */
+int ReferenceCompare(const rational& a, const rational& b)
+{
+  // 0/0 is zero, give it a denominator so cross-multiplying works
+  intType a_denom = a.denominator() ? a.denominator() : 1;
+  intType b_denom = b.denominator() ? b.denominator() : 1;
+
+  intType lhs = a.numerator() * b_denom;
+  intType rhs = b.numerator() * a_denom;
+
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * @brief Values that hit every fast path: zero, integers, shared denominators, negatives and unrelated fractions
+ */
+QList<rational> SampleValues()
+{
+  return {
+    rational(),
+    rational(1),
+    rational(-3),
+    rational(7),
+    rational(1, 2),
+    rational(-1, 2),
+    rational(3, 2),
+    rational(1, 3),
+    rational(2, 3),
+    rational(1, 6),
+    rational(5, 6),
+    rational(-5, 6),
+    rational(1, 30),
+    rational(29, 30),
+    rational(1001, 30000),
+    rational(-1001, 30000),
+    rational(1, 48000),
+    rational(47999, 48000),
+    rational(90000, 1)
+  };
+}
+
+}
+
+TEST(RationalTest, ConstructsInLowestTerms)
+{
+  rational r(2, 4);
+
+  EXPECT_EQ(r.numerator(), 1);
+  EXPECT_EQ(r.denominator(), 2);
+
+  rational n(3, -6);
+
+  EXPECT_EQ(n.numerator(), -1);
+  EXPECT_EQ(n.denominator(), 2);
+
+  EXPECT_TRUE(rational(0, 5).isNull());
+  EXPECT_TRUE(rational(5, 0).isNull());
+}
+
+TEST(RationalTest, CompareMatchesCrossMultiplication)
+{
+  QList<rational> values = SampleValues();
+
+  foreach (const rational& a, values) {
+    foreach (const rational& b, values) {
+      int expected = ReferenceCompare(a, b);
+
+      EXPECT_EQ(a < b, expected < 0) << a << " < " << b;
+      EXPECT_EQ(a <= b, expected <= 0) << a << " <= " << b;
+      EXPECT_EQ(a > b, expected > 0) << a << " > " << b;
+      EXPECT_EQ(a >= b, expected >= 0) << a << " >= " << b;
+      EXPECT_EQ(a == b, expected == 0) << a << " == " << b;
+      EXPECT_EQ(a != b, expected != 0) << a << " != " << b;
+    }
+  }
+}
+
+TEST(RationalTest, AddAndSubtractStayCanonical)
+{
+  QList<rational> values = SampleValues();
+
+  foreach (const rational& a, values) {
+    foreach (const rational& b, values) {
+      intType a_denom = a.denominator() ? a.denominator() : 1;
+      intType b_denom = b.denominator() ? b.denominator() : 1;
+
+      rational expected_sum = Reduced(a.numerator() * b_denom + b.numerator() * a_denom, a_denom * b_denom);
+      rational expected_difference = Reduced(a.numerator() * b_denom - b.numerator() * a_denom, a_denom * b_denom);
+
+      // Compare the exact representation, not just the value, so later fast paths can rely on it
+      rational sum = a + b;
+      EXPECT_EQ(sum.numerator(), expected_sum.numerator()) << a << " + " << b;
+      EXPECT_EQ(sum.denominator(), expected_sum.denominator()) << a << " + " << b;
+
+      rational difference = a - b;
+      EXPECT_EQ(difference.numerator(), expected_difference.numerator()) << a << " - " << b;
+      EXPECT_EQ(difference.denominator(), expected_difference.denominator()) << a << " - " << b;
+
+      rational accumulated = a;
+      accumulated += b;
+      EXPECT_EQ(accumulated, sum);
+    }
+  }
+}
+
+TEST(RationalTest, SameDenominatorAdditionReduces)
+{
+  // Both have a denominator of 6 but the result doesn't
+  rational r = rational(1, 6) + rational(1, 6);
+
+  EXPECT_EQ(r.numerator(), 1);
+  EXPECT_EQ(r.denominator(), 3);
+
+  // Cancelling out is zero, which is stored as 0/0
+  EXPECT_TRUE((rational(5, 6) - rational(5, 6)).isNull());
+}
+
+TEST(RationalTest, MultiplyStaysCanonical)
+{
+  QList<rational> values = SampleValues();
+
+  foreach (const rational& a, values) {
+    foreach (const rational& b, values) {
+      rational expected = Reduced(a.numerator() * b.numerator(), a.denominator() * b.denominator());
+      rational product = a * b;
+
+      EXPECT_EQ(product.numerator(), expected.numerator()) << a << " * " << b;
+      EXPECT_EQ(product.denominator(), expected.denominator()) << a << " * " << b;
+    }
+  }
+}
+
+TEST(RationalTest, StepThroughTimebase)
+{
+  // Stepping frame by frame is how the cache queue and exporters walk a sequence
+  rational timebase(1001, 30000);
+  rational t;
+
+  for (int i=0;i<1000;i++) {
+    EXPECT_EQ(t, Reduced(1001 * i, 30000));
+    t += timebase;
+  }
+}
+
+TEST(RationalTest, FromDoubleWholeNumbers)
+{
+  EXPECT_EQ(rational::fromDouble(0.0), rational());
+  EXPECT_EQ(rational::fromDouble(5.0), rational(5));
+  EXPECT_EQ(rational::fromDouble(-12.0), rational(-12));
+  EXPECT_EQ(rational::fromDouble(0.5), rational(1, 2));
+}
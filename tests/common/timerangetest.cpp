@@ -0,0 +1,111 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+
+#include "common/timerange.h"
+
+namespace {
+
+/**
+ * @brief Build the expected result by inserting one range at a time, then tidy it the same way
+ */
+TimeRangeList InsertOneByOne(const TimeRangeList& base, const TimeRangeList& ranges)
+{
+  TimeRangeList list = base;
+
+  foreach (const TimeRange& range, ranges) {
+    list.InsertTimeRange(range);
+  }
+
+  // InsertTimeRange() only merges into the first range it overlaps, so normalize before comparing
+  TimeRangeList normalized;
+  normalized.InsertTimeRanges(list);
+
+  return normalized;
+}
+
+}
+
+TEST(TimeRangeListTest, InsertRangesSortsAndMerges)
+{
+  TimeRangeList ranges;
+  ranges.append(TimeRange(10, 12));
+  ranges.append(TimeRange(0, 2));
+  ranges.append(TimeRange(1, 4));
+  ranges.append(TimeRange(6, 8));
+
+  TimeRangeList list;
+  list.InsertTimeRanges(ranges);
+
+  ASSERT_EQ(list.size(), 3);
+  EXPECT_EQ(list.at(0), TimeRange(0, 4));
+  EXPECT_EQ(list.at(1), TimeRange(6, 8));
+  EXPECT_EQ(list.at(2), TimeRange(10, 12));
+}
+
+TEST(TimeRangeListTest, InsertRangesMergesTouchingRanges)
+{
+  // Consecutive frames, as the exporter queues them
+  rational timebase(1001, 30000);
+
+  TimeRangeList ranges;
+  for (int i=0;i<10;i++) {
+    ranges.append(TimeRange(timebase * i, timebase * (i + 1)));
+  }
+
+  TimeRangeList list;
+  list.InsertTimeRanges(ranges);
+
+  ASSERT_EQ(list.size(), 1);
+  EXPECT_EQ(list.first(), TimeRange(0, timebase * 10));
+}
+
+TEST(TimeRangeListTest, InsertRangesMatchesInsertingOneByOne)
+{
+  TimeRangeList base;
+  base.append(TimeRange(rational(1, 2), 3));
+  base.append(TimeRange(20, 25));
+
+  TimeRangeList ranges;
+  ranges.append(TimeRange(2, 5));
+  ranges.append(TimeRange(30, 31));
+  ranges.append(TimeRange(rational(49, 2), 26));
+  ranges.append(TimeRange(8, 9));
+  ranges.append(TimeRange(0, rational(1, 4)));
+
+  TimeRangeList list = base;
+  list.InsertTimeRanges(ranges);
+
+  TimeRangeList expected = InsertOneByOne(base, ranges);
+
+  ASSERT_EQ(list.size(), expected.size());
+  for (int i=0;i<list.size();i++) {
+    EXPECT_EQ(list.at(i), expected.at(i)) << "range " << i;
+  }
+}
+
+TEST(TimeRangeListTest, InsertRangesIntoEmptyListIsNoOp)
+{
+  TimeRangeList list;
+  list.InsertTimeRanges(TimeRangeList());
+
+  EXPECT_TRUE(list.isEmpty());
+}
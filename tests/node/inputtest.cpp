@@ -0,0 +1,225 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "common/bezier.h"
+#include "common/lerp.h"
+#include "node/input.h"
+
+namespace {
+
+/**
+ * @brief Evaluate keyframes the way NodeInput did before segments were precalculated
+ *
+ * Searches for the surrounding keyframes on every call and solves the bezier from scratch.
+ */
+double ReferenceValueAtTime(const QList<NodeKeyframePtr>& keys, const rational& time)
+{
+  if (keys.first()->time() >= time) {
+    return keys.first()->value().toDouble();
+  }
+
+  if (keys.last()->time() <= time) {
+    return keys.last()->value().toDouble();
+  }
+
+  for (int i=0;i<keys.size()-1;i++) {
+    NodeKeyframePtr before = keys.at(i);
+    NodeKeyframePtr after = keys.at(i+1);
+
+    if (before->time() == time
+        || (before->time() < time && before->type() == NodeKeyframe::kHold)) {
+      return before->value().toDouble();
+    } else if (after->time() == time) {
+      return after->value().toDouble();
+    } else if (before->time() < time && after->time() > time) {
+      double before_time = before->time().toDouble();
+      double after_time = after->time().toDouble();
+      double before_value = before->value().toDouble();
+      double after_value = after->value().toDouble();
+
+      if (before->type() == NodeKeyframe::kBezier && after->type() == NodeKeyframe::kBezier) {
+        double t = Bezier::CubicXtoT(time.toDouble(),
+                                     before_time,
+                                     before_time + before->bezier_control_out().x(),
+                                     after_time + after->bezier_control_in().x(),
+                                     after_time);
+
+        return Bezier::CubicTtoY(before_value,
+                                 before_value + before->bezier_control_out().y(),
+                                 after_value + after->bezier_control_in().y(),
+                                 after_value,
+                                 t);
+      } else if (before->type() == NodeKeyframe::kBezier || after->type() == NodeKeyframe::kBezier) {
+        QPointF control = (before->type() == NodeKeyframe::kBezier) ? before->bezier_control_out()
+                                                                     : after->bezier_control_in();
+        double control_time = ((before->type() == NodeKeyframe::kBezier) ? before_time : after_time) + control.x();
+        double control_value = ((before->type() == NodeKeyframe::kBezier) ? before_value : after_value) + control.y();
+
+        double t = Bezier::QuadraticXtoT(time.toDouble(), before_time, control_time, after_time);
+
+        return Bezier::QuadraticTtoY(before_value, control_value, after_value, t);
+      } else {
+        return lerp(before_value, after_value, (time.toDouble() - before_time) / (after_time - before_time));
+      }
+    }
+  }
+
+  return 0.0;
+}
+
+}
+
+class NodeInputKeyframeTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp() override
+  {
+    input_ = new NodeInput(QStringLiteral("value_in"), NodeParam::kFloat, 0.0);
+    input_->set_is_keyframing(true);
+  }
+
+  virtual void TearDown() override
+  {
+    keys_.clear();
+    delete input_;
+  }
+
+  NodeKeyframePtr AddKey(const rational& time, double value, NodeKeyframe::Type type)
+  {
+    NodeKeyframePtr key = NodeKeyframe::Create(time, value, type, 0);
+    input_->insert_keyframe(key);
+    keys_.append(key);
+    return key;
+  }
+
+  /**
+   * @brief Check single lookups in order, out of order and batched against the reference
+   */
+  void ExpectMatchesReference(const rational& start, const rational& end, int steps, double tolerance)
+  {
+    // Keyframes are kept sorted by the input, the reference needs the same
+    std::sort(keys_.begin(), keys_.end(), [](const NodeKeyframePtr& a, const NodeKeyframePtr& b) -> bool {
+      return a->time() < b->time();
+    });
+
+    rational interval = (end - start) / rational(steps);
+    QVector<rational> times;
+
+    for (int i=0;i<=steps;i++) {
+      times.append(start + interval * rational(i));
+    }
+
+    // Forwards, which is what the evaluation cursor is optimized for
+    foreach (const rational& t, times) {
+      EXPECT_NEAR(input_->get_value_at_time_for_track(t, 0).toDouble(), ReferenceValueAtTime(keys_, t), tolerance)
+          << "at " << t.toDouble();
+    }
+
+    // Backwards and jumping around must give the same results
+    for (int i=times.size()-1;i>=0;i-=3) {
+      EXPECT_NEAR(input_->get_value_at_time_for_track(times.at(i), 0).toDouble(),
+                  ReferenceValueAtTime(keys_, times.at(i)),
+                  tolerance);
+    }
+
+    // Batched
+    QVector<double> batch = input_->get_values_at_times_for_track(start.toDouble(), interval.toDouble(), times.size(), 0);
+
+    ASSERT_EQ(batch.size(), times.size());
+
+    for (int i=0;i<times.size();i++) {
+      EXPECT_NEAR(batch.at(i), ReferenceValueAtTime(keys_, times.at(i)), tolerance) << "batch index " << i;
+    }
+  }
+
+  NodeInput* input_;
+
+  QList<NodeKeyframePtr> keys_;
+};
+
+TEST_F(NodeInputKeyframeTest, Linear)
+{
+  AddKey(1, 0.0, NodeKeyframe::kLinear);
+  AddKey(2, 10.0, NodeKeyframe::kLinear);
+  AddKey(rational(7, 2), -5.0, NodeKeyframe::kLinear);
+
+  EXPECT_DOUBLE_EQ(input_->get_value_at_time_for_track(rational(3, 2), 0).toDouble(), 5.0);
+
+  ExpectMatchesReference(0, 5, 300, 0.0000001);
+}
+
+TEST_F(NodeInputKeyframeTest, Hold)
+{
+  AddKey(0, 1.0, NodeKeyframe::kHold);
+  AddKey(1, 2.0, NodeKeyframe::kLinear);
+  AddKey(2, 4.0, NodeKeyframe::kLinear);
+
+  EXPECT_DOUBLE_EQ(input_->get_value_at_time_for_track(rational(999, 1000), 0).toDouble(), 1.0);
+  EXPECT_DOUBLE_EQ(input_->get_value_at_time_for_track(1, 0).toDouble(), 2.0);
+
+  ExpectMatchesReference(-1, 3, 240, 0.0000001);
+}
+
+TEST_F(NodeInputKeyframeTest, CubicBezier)
+{
+  NodeKeyframePtr a = AddKey(0, 0.0, NodeKeyframe::kBezier);
+  NodeKeyframePtr b = AddKey(2, 1.0, NodeKeyframe::kBezier);
+
+  a->set_bezier_control_out(QPointF(1.5, 0.0));
+  b->set_bezier_control_in(QPointF(-0.1, 0.0));
+
+  ExpectMatchesReference(0, 2, 480, 0.00001);
+}
+
+TEST_F(NodeInputKeyframeTest, QuadraticBezier)
+{
+  NodeKeyframePtr a = AddKey(0, 0.0, NodeKeyframe::kBezier);
+  AddKey(1, 1.0, NodeKeyframe::kLinear);
+  NodeKeyframePtr c = AddKey(3, -1.0, NodeKeyframe::kBezier);
+
+  a->set_bezier_control_out(QPointF(0.5, 2.0));
+  c->set_bezier_control_in(QPointF(-1.0, 0.5));
+
+  ExpectMatchesReference(0, 3, 360, 0.00001);
+}
+
+TEST_F(NodeInputKeyframeTest, SegmentsFollowKeyframeChanges)
+{
+  NodeKeyframePtr a = AddKey(0, 0.0, NodeKeyframe::kLinear);
+  NodeKeyframePtr b = AddKey(1, 1.0, NodeKeyframe::kLinear);
+
+  ExpectMatchesReference(0, 1, 10, 0.0000001);
+
+  b->set_value(3.0);
+  a->set_time(rational(1, 2));
+  b->set_type(NodeKeyframe::kBezier);
+  a->set_type(NodeKeyframe::kBezier);
+  a->set_bezier_control_out(QPointF(0.25, 1.0));
+
+  ExpectMatchesReference(0, 2, 60, 0.00001);
+
+  // Moving a keyframe past another reorders them
+  a->set_time(2);
+
+  ExpectMatchesReference(0, 3, 60, 0.00001);
+}
@@ -0,0 +1,256 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+
+#include "node/block/gap/gap.h"
+#include "node/graph.h"
+#include "node/output/track/track.h"
+
+namespace {
+
+/**
+ * @brief Linear scan over the track's Blocks, what the binary searches used to do
+ */
+Block* ReferenceBlockAtTime(TrackOutput* track, const rational& time)
+{
+  foreach (Block* block, track->Blocks()) {
+    if (block && block->in() <= time && block->out() > time) {
+      return block;
+    }
+  }
+
+  return nullptr;
+}
+
+QList<Block*> ReferenceBlocksAtTimeRange(TrackOutput* track, const TimeRange& range)
+{
+  QList<Block*> list;
+
+  foreach (Block* block, track->Blocks()) {
+    if (block && block->out() > range.in() && block->in() < range.out()) {
+      list.append(block);
+    }
+  }
+
+  return list;
+}
+
+}
+
+class TrackOutputTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp() override
+  {
+    track_ = new TrackOutput();
+    graph_.AddNode(track_);
+  }
+
+  GapBlock* CreateBlock(const rational& length)
+  {
+    GapBlock* block = new GapBlock();
+    block->set_length_and_media_out(length);
+    graph_.AddNode(block);
+    return block;
+  }
+
+  /**
+   * @brief Every time a Block starts or ends, and halfway through each one
+   */
+  QList<rational> InterestingTimes()
+  {
+    QList<rational> times;
+
+    times.append(rational(-1));
+
+    foreach (Block* block, track_->Blocks()) {
+      if (block) {
+        times.append(block->in());
+        times.append((block->in() + block->out()) / rational(2));
+        times.append(block->out());
+      }
+    }
+
+    times.append(track_->track_length() + rational(1));
+
+    return times;
+  }
+
+  void ExpectInOutContiguous()
+  {
+    rational expected_in = 0;
+
+    foreach (Block* block, track_->Blocks()) {
+      ASSERT_NE(block, nullptr);
+      EXPECT_EQ(block->in(), expected_in);
+      EXPECT_EQ(block->out(), block->in() + block->length());
+
+      expected_in = block->out();
+    }
+
+    EXPECT_EQ(track_->track_length(), expected_in);
+  }
+
+  void ExpectLookupsMatchReference()
+  {
+    QList<rational> times = InterestingTimes();
+
+    foreach (const rational& t, times) {
+      EXPECT_EQ(track_->BlockAtTime(t), ReferenceBlockAtTime(track_, t)) << t.toDouble();
+    }
+
+    for (int i=0;i<times.size();i++) {
+      for (int j=i+1;j<times.size();j++) {
+        TimeRange range(times.at(i), times.at(j));
+
+        EXPECT_EQ(track_->BlocksAtTimeRange(range), ReferenceBlocksAtTimeRange(track_, range))
+            << range.in().toDouble() << " - " << range.out().toDouble();
+      }
+    }
+  }
+
+  NodeGraph graph_;
+
+  TrackOutput* track_;
+};
+
+TEST_F(TrackOutputTest, EmptyTrackHasNoBlocks)
+{
+  EXPECT_EQ(track_->BlockAtTime(0), nullptr);
+  EXPECT_TRUE(track_->BlocksAtTimeRange(TimeRange(0, 10)).isEmpty());
+  EXPECT_EQ(track_->NearestBlockBefore(0), nullptr);
+  EXPECT_EQ(track_->NearestBlockAfter(0), nullptr);
+}
+
+TEST_F(TrackOutputTest, LookupsMatchLinearScan)
+{
+  track_->AppendBlock(CreateBlock(1));
+  track_->AppendBlock(CreateBlock(rational(3, 2)));
+  track_->AppendBlock(CreateBlock(rational(1, 30)));
+  track_->AppendBlock(CreateBlock(5));
+
+  ExpectInOutContiguous();
+  ExpectLookupsMatchReference();
+}
+
+TEST_F(TrackOutputTest, BoundariesBelongToTheLaterBlock)
+{
+  Block* a = CreateBlock(2);
+  Block* b = CreateBlock(3);
+
+  track_->AppendBlock(a);
+  track_->AppendBlock(b);
+
+  EXPECT_EQ(track_->BlockAtTime(0), a);
+  EXPECT_EQ(track_->BlockAtTime(2), b);
+  EXPECT_EQ(track_->BlockAtTime(5), nullptr);
+
+  // Exactly on a cut there's no block containing the time, only ones that start or end there
+  EXPECT_EQ(track_->BlockContainingTime(2), nullptr);
+  EXPECT_EQ(track_->BlockContainingTime(1), a);
+  EXPECT_EQ(track_->NearestBlockBefore(2), a);
+  EXPECT_EQ(track_->NearestBlockAfter(2), b);
+  EXPECT_EQ(track_->NearestBlockAfter(0), a);
+}
+
+TEST_F(TrackOutputTest, InsertShiftsLaterBlocks)
+{
+  Block* a = CreateBlock(1);
+  Block* b = CreateBlock(2);
+  Block* c = CreateBlock(3);
+
+  track_->AppendBlock(a);
+  track_->AppendBlock(c);
+  track_->InsertBlockAtIndex(b, 1);
+
+  ASSERT_EQ(track_->Blocks().size(), 3);
+  EXPECT_EQ(track_->Blocks().at(1), b);
+  EXPECT_EQ(c->in(), rational(3));
+
+  Block* first = CreateBlock(rational(1, 2));
+  track_->PrependBlock(first);
+
+  EXPECT_EQ(a->in(), rational(1, 2));
+
+  ExpectInOutContiguous();
+  ExpectLookupsMatchReference();
+}
+
+TEST_F(TrackOutputTest, RippleRemovePullsLaterBlocksIn)
+{
+  Block* a = CreateBlock(1);
+  Block* b = CreateBlock(2);
+  Block* c = CreateBlock(3);
+
+  track_->AppendBlock(a);
+  track_->AppendBlock(b);
+  track_->AppendBlock(c);
+
+  track_->RippleRemoveBlock(b);
+
+  ASSERT_EQ(track_->Blocks().size(), 2);
+  EXPECT_EQ(c->in(), rational(1));
+  EXPECT_EQ(track_->BlockAtTime(rational(3, 2)), c);
+
+  ExpectInOutContiguous();
+  ExpectLookupsMatchReference();
+}
+
+TEST_F(TrackOutputTest, ReplaceKeepsTimes)
+{
+  Block* a = CreateBlock(1);
+  Block* b = CreateBlock(2);
+  Block* replacement = CreateBlock(2);
+
+  track_->AppendBlock(a);
+  track_->AppendBlock(b);
+  track_->ReplaceBlock(b, replacement);
+
+  EXPECT_EQ(track_->BlockAtTime(2), replacement);
+  EXPECT_EQ(replacement->in(), rational(1));
+
+  ExpectInOutContiguous();
+}
+
+TEST_F(TrackOutputTest, MutedTrackHasNoBlocks)
+{
+  track_->AppendBlock(CreateBlock(1));
+  track_->SetMuted(true);
+
+  EXPECT_EQ(track_->BlockAtTime(0), nullptr);
+  EXPECT_TRUE(track_->BlocksAtTimeRange(TimeRange(0, 1)).isEmpty());
+}
+
+TEST_F(TrackOutputTest, LongTrack)
+{
+  const int kBlockCount = 2000;
+
+  for (int i=0;i<kBlockCount;i++) {
+    track_->AppendBlock(CreateBlock(rational(i % 5 + 1, 30)));
+  }
+
+  ExpectInOutContiguous();
+
+  // Every frame of the track, plus one past the end
+  for (rational t=0;t<=track_->track_length();t+=rational(1, 30)) {
+    ASSERT_EQ(track_->BlockAtTime(t), ReferenceBlockAtTime(track_, t)) << t.toDouble();
+  }
+}
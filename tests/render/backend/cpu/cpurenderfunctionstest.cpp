@@ -0,0 +1,450 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+
+#include "common/define.h"
+#include "render/backend/cpu/cpurenderfunctions.h"
+
+namespace {
+
+const float kTolerance = 1e-5f;
+
+// Heights around the 16 row bands so a single partial band, exact bands and an odd number of bands with a partial
+// last one are all covered
+const int kBandHeights[] = {1, 15, 16, 17, 37};
+
+float* Pixel(FramePtr frame, int x, int y)
+{
+  return reinterpret_cast<float*>(frame->data()) + (y * frame->width() + x) * kRGBAChannels;
+}
+
+float Value(FramePtr frame, int x, int y, int channel)
+{
+  return Pixel(frame, x, y)[channel];
+}
+
+/**
+ * @brief A frame where every pixel and channel differs, with associated alpha from fully transparent to opaque
+ */
+FramePtr MakeFrame(int width, int height, int seed = 0)
+{
+  FramePtr frame = CPURenderFunctions::CreateFrame(width, height);
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      float* px = Pixel(frame, x, y);
+      float alpha = static_cast<float>((x + y * 3 + seed) % 5) * 0.25f;
+
+      for (int c=0;c<kRGBChannels;c++) {
+        px[c] = static_cast<float>((x * 7 + y * 13 + c * 5 + seed) % 17) / 16.0f * alpha;
+      }
+
+      px[kRGBChannels] = alpha;
+    }
+  }
+
+  return frame;
+}
+
+/**
+ * @brief A frame filled with NaN so any pixel a function fails to write shows up
+ */
+FramePtr MakeDestination(int width, int height)
+{
+  FramePtr frame = CPURenderFunctions::CreateFrame(width, height);
+
+  float* data = reinterpret_cast<float*>(frame->data());
+  std::fill(data, data + width * height * kRGBAChannels, std::numeric_limits<float>::quiet_NaN());
+
+  return frame;
+}
+
+/**
+ * @brief Bilinear sample of a GL_CLAMP_TO_EDGE texture at a position in texels
+ */
+float ReferenceSample(FramePtr frame, float x, float y, int channel)
+{
+  x -= 0.5f;
+  y -= 0.5f;
+
+  int x0 = static_cast<int>(std::floor(x));
+  int y0 = static_cast<int>(std::floor(y));
+  float fx = x - static_cast<float>(x0);
+  float fy = y - static_cast<float>(y0);
+
+  auto texel = [&](int tx, int ty) {
+    return Value(frame, qBound(0, tx, frame->width() - 1), qBound(0, ty, frame->height() - 1), channel);
+  };
+
+  float top = texel(x0, y0) * (1.0f - fx) + texel(x0 + 1, y0) * fx;
+  float bottom = texel(x0, y0 + 1) * (1.0f - fx) + texel(x0 + 1, y0 + 1) * fx;
+
+  return top * (1.0f - fy) + bottom * fy;
+}
+
+/**
+ * @brief Convolution over whole pixels with the edge pixels repeated
+ */
+float ReferenceConvolve(FramePtr frame, int x, int y, int channel, bool horizontal,
+                        const CPURenderFunctions::Kernel& kernel)
+{
+  float sum = 0.0f;
+
+  for (int k=0;k<kernel.weights.size();k++) {
+    int offset = kernel.first + k;
+    int sx = horizontal ? qBound(0, x + offset, frame->width() - 1) : x;
+    int sy = horizontal ? y : qBound(0, y + offset, frame->height() - 1);
+
+    sum += Value(frame, sx, sy, channel) * kernel.weights.at(k);
+  }
+
+  return sum;
+}
+
+void ExpectFramesNear(FramePtr expected, FramePtr actual)
+{
+  ASSERT_EQ(expected->width(), actual->width());
+  ASSERT_EQ(expected->height(), actual->height());
+
+  for (int y=0;y<actual->height();y++) {
+    for (int x=0;x<actual->width();x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_NEAR(Value(expected, x, y, c), Value(actual, x, y, c), kTolerance)
+            << "at " << x << "," << y << " channel " << c;
+      }
+    }
+  }
+}
+
+}
+
+TEST(CPURenderFunctionsTest, FillCoversEveryBand)
+{
+  QVector4D color(0.1f, 0.2f, 0.3f, 0.4f);
+
+  for (int height : kBandHeights) {
+    FramePtr dst = MakeDestination(3, height);
+
+    CPURenderFunctions::Fill(dst, color);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<3;x++) {
+        for (int c=0;c<kRGBAChannels;c++) {
+          ASSERT_EQ(Value(dst, x, y, c), color[c]) << "height " << height << " at " << x << "," << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, MixMatchesReference)
+{
+  for (int height : kBandHeights) {
+    FramePtr a = MakeFrame(5, height, 0);
+    FramePtr b = MakeFrame(5, height, 3);
+    FramePtr dst = MakeDestination(5, height);
+
+    CPURenderFunctions::Mix(a, 0.25f, b, 0.75f, dst);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<5;x++) {
+        for (int c=0;c<kRGBAChannels;c++) {
+          ASSERT_NEAR(Value(dst, x, y, c), Value(a, x, y, c) * 0.25f + Value(b, x, y, c) * 0.75f, kTolerance)
+              << "height " << height << " at " << x << "," << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, MixWithMissingInputs)
+{
+  FramePtr a = MakeFrame(3, 17);
+  FramePtr dst = MakeDestination(3, 17);
+
+  CPURenderFunctions::Mix(a, 0.5f, nullptr, 1.0f, dst);
+
+  for (int y=0;y<17;y++) {
+    for (int x=0;x<3;x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_NEAR(Value(dst, x, y, c), Value(a, x, y, c) * 0.5f, kTolerance);
+      }
+    }
+  }
+
+  CPURenderFunctions::Mix(nullptr, 1.0f, a, 2.0f, dst);
+
+  for (int y=0;y<17;y++) {
+    for (int x=0;x<3;x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_NEAR(Value(dst, x, y, c), Value(a, x, y, c) * 2.0f, kTolerance);
+      }
+    }
+  }
+
+  CPURenderFunctions::Mix(nullptr, 1.0f, nullptr, 1.0f, dst);
+
+  for (int y=0;y<17;y++) {
+    for (int x=0;x<3;x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_EQ(Value(dst, x, y, c), 0.0f);
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, AlphaOverMatchesReference)
+{
+  for (int height : kBandHeights) {
+    FramePtr base = MakeFrame(7, height, 1);
+    FramePtr blend = MakeFrame(7, height, 2);
+    FramePtr dst = MakeDestination(7, height);
+
+    CPURenderFunctions::AlphaOver(base, blend, dst);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<7;x++) {
+        float inverse_alpha = 1.0f - Value(blend, x, y, kRGBChannels);
+
+        for (int c=0;c<kRGBAChannels;c++) {
+          ASSERT_NEAR(Value(dst, x, y, c), Value(base, x, y, c) * inverse_alpha + Value(blend, x, y, c), kTolerance)
+              << "height " << height << " at " << x << "," << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, ShadowMatchesReference)
+{
+  QVector4D color(0.2f, 0.4f, 0.6f, 0.8f);
+
+  for (int height : kBandHeights) {
+    FramePtr src = MakeFrame(7, height, 1);
+    FramePtr shadow = MakeFrame(7, height, 4);
+    FramePtr dst = MakeDestination(7, height);
+
+    CPURenderFunctions::Shadow(src, shadow, color, dst);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<7;x++) {
+        float inverse_alpha = 1.0f - Value(src, x, y, kRGBChannels);
+
+        for (int c=0;c<kRGBChannels;c++) {
+          ASSERT_NEAR(Value(dst, x, y, c), color[c] * inverse_alpha + Value(src, x, y, c), kTolerance);
+        }
+
+        float shadow_alpha = color.w() * Value(shadow, x, y, kRGBChannels);
+
+        ASSERT_NEAR(Value(dst, x, y, kRGBChannels),
+                    shadow_alpha * inverse_alpha + Value(src, x, y, kRGBChannels),
+                    kTolerance);
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, FoldTapsSplitsBetweenPixels)
+{
+  QVector<float> offsets = {-1.5f, 0.0f, 1.5f};
+  QVector<float> weights = {0.25f, 0.5f, 0.25f};
+
+  CPURenderFunctions::Kernel kernel = CPURenderFunctions::FoldTaps(offsets, weights);
+
+  EXPECT_EQ(kernel.first, -2);
+
+  QVector<float> expected = {0.125f, 0.125f, 0.5f, 0.125f, 0.125f};
+
+  ASSERT_EQ(kernel.weights.size(), expected.size());
+
+  for (int i=0;i<expected.size();i++) {
+    EXPECT_FLOAT_EQ(kernel.weights.at(i), expected.at(i)) << "at " << i;
+  }
+}
+
+TEST(CPURenderFunctionsTest, FoldTapsKeepsTotalWeight)
+{
+  QVector<float> offsets = {-3.25f, -0.75f, 0.5f, 2.125f};
+  QVector<float> weights = {0.1f, 0.2f, 0.3f, 0.4f};
+
+  CPURenderFunctions::Kernel kernel = CPURenderFunctions::FoldTaps(offsets, weights);
+
+  EXPECT_EQ(kernel.first, -4);
+
+  float total = 0.0f;
+
+  foreach (float w, kernel.weights) {
+    total += w;
+  }
+
+  EXPECT_NEAR(total, 1.0f, kTolerance);
+
+  EXPECT_TRUE(CPURenderFunctions::FoldTaps(QVector<float>(), QVector<float>()).weights.isEmpty());
+}
+
+TEST(CPURenderFunctionsTest, ConvolveMatchesReference)
+{
+  CPURenderFunctions::Kernel kernel = CPURenderFunctions::FoldTaps({-1.5f, 0.0f, 1.5f}, {0.25f, 0.5f, 0.25f});
+
+  // Reaches well past every edge of the frame
+  CPURenderFunctions::Kernel wide;
+  wide.first = -9;
+  for (int i=0;i<19;i++) {
+    wide.weights.append(static_cast<float>(i % 4 + 1) / 50.0f);
+  }
+
+  for (int height : kBandHeights) {
+    FramePtr src = MakeFrame(5, height);
+
+    for (const CPURenderFunctions::Kernel& k : {kernel, wide}) {
+      for (bool horizontal : {true, false}) {
+        FramePtr dst = MakeDestination(5, height);
+
+        CPURenderFunctions::Convolve(src, dst, horizontal, k);
+
+        for (int y=0;y<height;y++) {
+          for (int x=0;x<5;x++) {
+            for (int c=0;c<kRGBAChannels;c++) {
+              ASSERT_NEAR(Value(dst, x, y, c), ReferenceConvolve(src, x, y, c, horizontal, k), kTolerance)
+                  << "height " << height << (horizontal ? " horizontal" : " vertical") << " at " << x << "," << y;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, BlitIdentityCopies)
+{
+  FramePtr src = MakeFrame(7, 17);
+  FramePtr dst = MakeDestination(7, 17);
+
+  CPURenderFunctions::Blit(src, dst, QMatrix4x4());
+
+  ExpectFramesNear(src, dst);
+}
+
+TEST(CPURenderFunctionsTest, BlitMagnifyMatchesBilinear)
+{
+  FramePtr src = MakeFrame(3, 5);
+  FramePtr dst = MakeDestination(6, 10);
+
+  CPURenderFunctions::Blit(src, dst, QMatrix4x4());
+
+  // Includes the edge pixels, which sample outside the source and clamp to its edge
+  for (int y=0;y<dst->height();y++) {
+    for (int x=0;x<dst->width();x++) {
+      float sx = (static_cast<float>(x) + 0.5f) * 0.5f;
+      float sy = (static_cast<float>(y) + 0.5f) * 0.5f;
+
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_NEAR(Value(dst, x, y, c), ReferenceSample(src, sx, sy, c), kTolerance) << "at " << x << "," << y;
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, BlitMinifyAveragesFootprint)
+{
+  // Halving lands every tap on a texel center, so each pixel is exactly the average of a 2x2 block
+  FramePtr src = MakeFrame(10, 6);
+  FramePtr dst = MakeDestination(5, 3);
+
+  CPURenderFunctions::Blit(src, dst, QMatrix4x4());
+
+  for (int y=0;y<dst->height();y++) {
+    for (int x=0;x<dst->width();x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        float expected = (Value(src, x * 2, y * 2, c) + Value(src, x * 2 + 1, y * 2, c)
+                          + Value(src, x * 2, y * 2 + 1, c) + Value(src, x * 2 + 1, y * 2 + 1, c)) * 0.25f;
+
+        ASSERT_NEAR(Value(dst, x, y, c), expected, kTolerance) << "at " << x << "," << y;
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, BlitClearsOutsideQuad)
+{
+  FramePtr src = MakeFrame(8, 8);
+  FramePtr dst = MakeDestination(8, 8);
+
+  // The quad covers the middle 4x4 pixels, which see the whole source at half size
+  QMatrix4x4 matrix;
+  matrix.scale(0.5f, 0.5f);
+
+  CPURenderFunctions::Blit(src, dst, matrix);
+
+  for (int y=0;y<8;y++) {
+    for (int x=0;x<8;x++) {
+      bool inside = (x >= 2 && x < 6 && y >= 2 && y < 6);
+
+      for (int c=0;c<kRGBAChannels;c++) {
+        if (inside) {
+          int sx = (x - 2) * 2;
+          int sy = (y - 2) * 2;
+          float expected = (Value(src, sx, sy, c) + Value(src, sx + 1, sy, c)
+                            + Value(src, sx, sy + 1, c) + Value(src, sx + 1, sy + 1, c)) * 0.25f;
+
+          ASSERT_NEAR(Value(dst, x, y, c), expected, kTolerance) << "at " << x << "," << y;
+        } else {
+          ASSERT_EQ(Value(dst, x, y, c), 0.0f) << "at " << x << "," << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, BlitDegenerateMatrixClears)
+{
+  FramePtr src = MakeFrame(4, 4);
+  FramePtr dst = MakeDestination(4, 17);
+
+  QMatrix4x4 matrix;
+  matrix.scale(0.0f, 1.0f);
+
+  CPURenderFunctions::Blit(src, dst, matrix);
+
+  for (int y=0;y<17;y++) {
+    for (int x=0;x<4;x++) {
+      for (int c=0;c<kRGBAChannels;c++) {
+        ASSERT_EQ(Value(dst, x, y, c), 0.0f);
+      }
+    }
+  }
+}
+
+TEST(CPURenderFunctionsTest, MatchSizeOnlyResizesWhenNeeded)
+{
+  FramePtr src = MakeFrame(4, 4);
+
+  EXPECT_EQ(CPURenderFunctions::MatchSize(src, 4, 4), src);
+  EXPECT_EQ(CPURenderFunctions::MatchSize(nullptr, 4, 4), nullptr);
+
+  FramePtr resized = CPURenderFunctions::MatchSize(src, 2, 6);
+
+  ASSERT_NE(resized, src);
+  EXPECT_EQ(resized->width(), 2);
+  EXPECT_EQ(resized->height(), 6);
+}
@@ -0,0 +1,224 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "render/backend/opengl/opengltexturecache.h"
+
+namespace {
+
+// Three kinds of texture that all take the same number of bytes but belong in different buckets
+const VideoRenderingParams kSquareHalf(64, 64, rational(1, 30), PixelFormat::PIX_FMT_RGBA16F, RenderMode::kOffline);
+const VideoRenderingParams kWideByte(128, 64, rational(1, 30), PixelFormat::PIX_FMT_RGBA8, RenderMode::kOffline);
+const VideoRenderingParams kTallByte(64, 128, rational(1, 30), PixelFormat::PIX_FMT_RGBA8, RenderMode::kOffline);
+
+const qint64 kTextureSize = 64 * 64 * 8;
+
+}
+
+/**
+ * @brief Runs each test with its own cache and a current context to create textures in
+ *
+ * Skipped where no OpenGL context can be created, e.g. on machines without a GL driver, unless OLIVE_REQUIRE_GL is
+ * set in the environment (see REQUIRE_GL_TESTS in tests/CMakeLists.txt). Then they fail so CI can't pass without
+ * running them.
+ */
+class OpenGLTextureCacheTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp() override
+  {
+    surface_.create();
+
+    if (!ctx_.create() || !ctx_.makeCurrent(&surface_)) {
+      if (qEnvironmentVariableIsSet("OLIVE_REQUIRE_GL")) {
+        FAIL() << "No OpenGL context available but OLIVE_REQUIRE_GL is set";
+      }
+
+      GTEST_SKIP() << "No OpenGL context available";
+    }
+
+    cache_.reset(new OpenGLTextureCache());
+    cache_->SetBudget(kTextureSize * 16);
+  }
+
+  virtual void TearDown() override
+  {
+    // Textures are deleted with the cache, so it has to go while the context is still current
+    cache_.reset();
+
+    if (ctx_.isValid()) {
+      ctx_.doneCurrent();
+    }
+  }
+
+  OpenGLTextureCache::ReferencePtr Get(const VideoRenderingParams& params)
+  {
+    return cache_->Get(&ctx_, params);
+  }
+
+  QOffscreenSurface surface_;
+
+  QOpenGLContext ctx_;
+
+  std::unique_ptr<OpenGLTextureCache> cache_;
+
+};
+
+TEST_F(OpenGLTextureCacheTest, ReusesIdleTextureOfSameKind)
+{
+  OpenGLTextureCache::ReferencePtr ref = Get(kSquareHalf);
+  OpenGLTexturePtr texture = ref->texture();
+  ref = nullptr;
+
+  ref = Get(kSquareHalf);
+
+  EXPECT_EQ(ref->texture(), texture);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.allocated_textures, 1);
+  EXPECT_EQ(stats.allocated_bytes, kTextureSize);
+}
+
+TEST_F(OpenGLTextureCacheTest, DoesNotReuseAcrossBuckets)
+{
+  // Same size in bytes, but a different width, height or format can't be reused
+  Get(kSquareHalf);
+
+  OpenGLTextureCache::ReferencePtr wide = Get(kWideByte);
+  OpenGLTextureCache::ReferencePtr tall = Get(kTallByte);
+
+  EXPECT_EQ(wide->texture()->width(), 128);
+  EXPECT_EQ(tall->texture()->height(), 128);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_EQ(stats.allocated_textures, 3);
+}
+
+TEST_F(OpenGLTextureCacheTest, ReusesMostRecentlyRelinquished)
+{
+  OpenGLTextureCache::ReferencePtr first = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr second = Get(kSquareHalf);
+  OpenGLTexturePtr second_texture = second->texture();
+
+  first = nullptr;
+  second = nullptr;
+
+  EXPECT_EQ(Get(kSquareHalf)->texture(), second_texture);
+}
+
+TEST_F(OpenGLTextureCacheTest, TracksTexturesInUse)
+{
+  OpenGLTextureCache::ReferencePtr a = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr b = Get(kWideByte);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.textures_in_use, 2);
+  EXPECT_EQ(stats.in_use_bytes, kTextureSize * 2);
+
+  a = nullptr;
+
+  stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.textures_in_use, 1);
+  EXPECT_EQ(stats.in_use_bytes, kTextureSize);
+  EXPECT_EQ(stats.allocated_bytes, kTextureSize * 2);
+}
+
+TEST_F(OpenGLTextureCacheTest, EvictsLeastRecentlyUsedOverBudget)
+{
+  cache_->SetBudget(kTextureSize * 2);
+
+  OpenGLTextureCache::ReferencePtr square = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr wide = Get(kWideByte);
+  OpenGLTexturePtr wide_texture = wide->texture();
+
+  // The square texture becomes idle first, so it's the oldest
+  square = nullptr;
+  wide = nullptr;
+
+  // A third kind doesn't fit, so the oldest idle texture has to go
+  OpenGLTextureCache::ReferencePtr tall = Get(kTallByte);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.allocated_textures, 2);
+  EXPECT_EQ(stats.allocated_bytes, kTextureSize * 2);
+
+  // The more recently used texture survived
+  EXPECT_EQ(Get(kWideByte)->texture(), wide_texture);
+
+  stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 3u);
+}
+
+TEST_F(OpenGLTextureCacheTest, NeverEvictsTexturesInUse)
+{
+  cache_->SetBudget(kTextureSize);
+
+  // Nothing is idle, so the pool has to go over budget rather than take textures that are being used
+  OpenGLTextureCache::ReferencePtr a = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr b = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr c = Get(kSquareHalf);
+
+  EXPECT_NE(a->texture(), b->texture());
+  EXPECT_NE(b->texture(), c->texture());
+  EXPECT_EQ(cache_->GetStatistics().allocated_bytes, kTextureSize * 3);
+
+  // Once they're returned, the next Get() trims back down to the budget
+  a = nullptr;
+  b = nullptr;
+  c = nullptr;
+
+  Get(kSquareHalf);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.allocated_textures, 1);
+  EXPECT_EQ(stats.allocated_bytes, kTextureSize);
+}
+
+TEST_F(OpenGLTextureCacheTest, LoweringBudgetTrimsOnNextGet)
+{
+  OpenGLTextureCache::ReferencePtr a = Get(kSquareHalf);
+  OpenGLTextureCache::ReferencePtr b = Get(kWideByte);
+  OpenGLTextureCache::ReferencePtr c = Get(kTallByte);
+
+  a = nullptr;
+  b = nullptr;
+  c = nullptr;
+
+  EXPECT_EQ(cache_->GetStatistics().allocated_textures, 3);
+
+  cache_->SetBudget(kTextureSize);
+
+  // Reusing the newest texture leaves the two older ones over budget
+  OpenGLTextureCache::ReferencePtr tall = Get(kTallByte);
+
+  OpenGLTextureCache::Statistics stats = cache_->GetStatistics();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.allocated_textures, 1);
+  EXPECT_EQ(stats.allocated_bytes, kTextureSize);
+}
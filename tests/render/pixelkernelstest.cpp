@@ -0,0 +1,326 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+#include <QFloat16>
+#include <vector>
+
+#include "render/pixelkernels.h"
+
+namespace {
+
+// Odd lengths so both the vectorized loops and their scalar tails run, plus one spanning several intermediate blocks
+const int kValueCounts[] = {0, 1, 4, 7, 16, 37, 4096 * 2 + 12};
+
+std::vector<quint8> AllInt8Values()
+{
+  std::vector<quint8> values(256);
+
+  for (int i=0;i<256;i++) {
+    values[static_cast<size_t>(i)] = static_cast<quint8>(i);
+  }
+
+  return values;
+}
+
+std::vector<quint16> AllInt16Values()
+{
+  std::vector<quint16> values(65536);
+
+  for (int i=0;i<65536;i++) {
+    values[static_cast<size_t>(i)] = static_cast<quint16>(i);
+  }
+
+  return values;
+}
+
+/**
+ * @brief RGBA pixels with a mix of opaque, translucent and fully transparent alpha
+ */
+std::vector<float> MakePixels(int count)
+{
+  std::vector<float> values(static_cast<size_t>(count));
+
+  for (int i=0;i<count;i++) {
+    if (i % 4 == 3) {
+      values[static_cast<size_t>(i)] = static_cast<float>((i / 4) % 5) * 0.25f;
+    } else {
+      values[static_cast<size_t>(i)] = static_cast<float>(i % 11) * 0.1f;
+    }
+  }
+
+  return values;
+}
+
+/**
+ * @brief Straightforward per-pixel alpha operation to check the kernels against
+ */
+void ReferenceAlpha(std::vector<float>& values, PixelKernels::AlphaOperation alpha)
+{
+  for (size_t i=0;i+3<values.size();i+=4) {
+    float a = values[i+3];
+
+    if (alpha == PixelKernels::kAlphaAssociate || a > 0) {
+      for (size_t j=0;j<3;j++) {
+        if (alpha == PixelKernels::kAlphaDisassociate) {
+          values[i+j] /= a;
+        } else {
+          values[i+j] *= a;
+        }
+      }
+    }
+  }
+}
+
+}
+
+TEST(PixelKernelsTest, RejectsInvalidFormats)
+{
+  float src[4] = {};
+  float dst[4] = {};
+
+  EXPECT_FALSE(PixelKernels::Convert(src, PixelFormat::PIX_FMT_INVALID, dst, PixelFormat::PIX_FMT_RGBA32F, 4));
+  EXPECT_FALSE(PixelKernels::Convert(src, PixelFormat::PIX_FMT_RGBA32F, dst, PixelFormat::PIX_FMT_COUNT, 4));
+}
+
+TEST(PixelKernelsTest, Int8ToInt16IsExact)
+{
+  std::vector<quint8> src = AllInt8Values();
+  std::vector<quint16> dst(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA8,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA16U,
+                                    static_cast<int>(src.size())));
+
+  for (size_t i=0;i<src.size();i++) {
+    EXPECT_EQ(dst[i], src[i] * 257) << "at " << i;
+  }
+}
+
+TEST(PixelKernelsTest, Int16ToInt8Rounds)
+{
+  std::vector<quint16> src = AllInt16Values();
+  std::vector<quint8> dst(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA16U,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA8,
+                                    static_cast<int>(src.size())));
+
+  for (size_t i=0;i<src.size();i++) {
+    ASSERT_EQ(dst[i], static_cast<quint8>(std::lround(src[i] / 257.0))) << "at " << i;
+  }
+}
+
+TEST(PixelKernelsTest, Int8RoundTripsThroughFloat)
+{
+  std::vector<quint8> src = AllInt8Values();
+  std::vector<float> intermediate(src.size());
+  std::vector<quint8> dst(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA8,
+                                    intermediate.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    static_cast<int>(src.size())));
+  ASSERT_TRUE(PixelKernels::Convert(intermediate.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA8,
+                                    static_cast<int>(src.size())));
+
+  for (size_t i=0;i<src.size();i++) {
+    EXPECT_FLOAT_EQ(intermediate[i], src[i] / 255.0f);
+    EXPECT_EQ(dst[i], src[i]);
+  }
+}
+
+TEST(PixelKernelsTest, Int16RoundTripsThroughFloat)
+{
+  std::vector<quint16> src = AllInt16Values();
+  std::vector<float> intermediate(src.size());
+  std::vector<quint16> dst(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA16U,
+                                    intermediate.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    static_cast<int>(src.size())));
+  ASSERT_TRUE(PixelKernels::Convert(intermediate.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA16U,
+                                    static_cast<int>(src.size())));
+
+  for (size_t i=0;i<src.size();i++) {
+    ASSERT_EQ(dst[i], src[i]) << "at " << i;
+  }
+}
+
+TEST(PixelKernelsTest, HalfMatchesQFloat16)
+{
+  for (int count : kValueCounts) {
+    std::vector<float> src(static_cast<size_t>(count));
+
+    for (int i=0;i<count;i++) {
+      src[static_cast<size_t>(i)] = static_cast<float>(i - count / 2) * 0.37f;
+    }
+
+    std::vector<quint16> half(src.size());
+    std::vector<float> dst(src.size());
+
+    ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                      half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                      count));
+    ASSERT_TRUE(PixelKernels::Convert(half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                      dst.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                      count));
+
+    for (size_t i=0;i<src.size();i++) {
+      float expected = qfloat16(src[i]);
+      ASSERT_EQ(dst[i], expected) << "count " << count << " at " << i;
+    }
+  }
+}
+
+TEST(PixelKernelsTest, FloatToIntegerClamps)
+{
+  // 20 values so the last few land in the scalar tail
+  std::vector<float> src = {-1.0f, 2.0f, std::numeric_limits<float>::quiet_NaN(), 0.5f,
+                            -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), 0.0f, 1.0f,
+                            -1.0f, 2.0f, std::numeric_limits<float>::quiet_NaN(), 0.5f,
+                            -1.0f, 2.0f, 0.0f, 1.0f,
+                            -1.0f, 2.0f, std::numeric_limits<float>::quiet_NaN(), 1.0f};
+
+  std::vector<quint8> int8(src.size());
+  std::vector<quint16> int16(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    int8.data(), PixelFormat::PIX_FMT_RGBA8,
+                                    static_cast<int>(src.size())));
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    int16.data(), PixelFormat::PIX_FMT_RGBA16U,
+                                    static_cast<int>(src.size())));
+
+  for (size_t i=0;i<src.size();i++) {
+    float clamped = (src[i] > 0.0f) ? std::min(src[i], 1.0f) : 0.0f;
+
+    EXPECT_EQ(int8[i], static_cast<quint8>(std::lround(clamped * 255.0f))) << "at " << i;
+    EXPECT_EQ(int16[i], static_cast<quint16>(std::lround(clamped * 65535.0f))) << "at " << i;
+  }
+}
+
+TEST(PixelKernelsTest, SameFormatCopies)
+{
+  std::vector<quint16> src = AllInt16Values();
+  std::vector<quint16> dst(src.size());
+
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    static_cast<int>(src.size())));
+
+  EXPECT_EQ(dst, src);
+}
+
+TEST(PixelKernelsTest, AlphaOperationsMatchReference)
+{
+  const PixelKernels::AlphaOperation operations[] = {PixelKernels::kAlphaAssociate,
+                                                      PixelKernels::kAlphaDisassociate,
+                                                      PixelKernels::kAlphaReassociate};
+
+  for (PixelKernels::AlphaOperation alpha : operations) {
+    for (int count : kValueCounts) {
+      // Alpha operations work on whole pixels
+      count -= count % 4;
+
+      std::vector<float> src = MakePixels(count);
+      std::vector<float> expected = src;
+      ReferenceAlpha(expected, alpha);
+
+      // Float to float, in place
+      std::vector<float> in_place = src;
+      ASSERT_TRUE(PixelKernels::Convert(in_place.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        in_place.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        count, alpha));
+
+      // Float to float, separate buffers
+      std::vector<float> separate(src.size());
+      ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        separate.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        count, alpha));
+
+      for (size_t i=0;i<src.size();i++) {
+        ASSERT_FLOAT_EQ(in_place[i], expected[i]) << "operation " << alpha << " count " << count << " at " << i;
+        ASSERT_FLOAT_EQ(separate[i], expected[i]) << "operation " << alpha << " count " << count << " at " << i;
+      }
+    }
+  }
+}
+
+TEST(PixelKernelsTest, AlphaOperationThroughHalfInPlace)
+{
+  int count = 4096 * 2 + 12;
+
+  std::vector<float> src = MakePixels(count);
+  std::vector<float> expected = src;
+  ReferenceAlpha(expected, PixelKernels::kAlphaAssociate);
+
+  std::vector<quint16> half(src.size());
+  ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    count));
+
+  // Half to half goes through the intermediate float buffer block by block
+  ASSERT_TRUE(PixelKernels::Convert(half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    count, PixelKernels::kAlphaAssociate));
+
+  std::vector<float> dst(src.size());
+  ASSERT_TRUE(PixelKernels::Convert(half.data(), PixelFormat::PIX_FMT_RGBA16F,
+                                    dst.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                    count));
+
+  for (size_t i=0;i<src.size();i++) {
+    // Two roundings to half precision
+    ASSERT_NEAR(dst[i], expected[i], 2e-3) << "at " << i;
+  }
+}
+
+TEST(PixelKernelsTest, ConvertsBetweenEveryPair)
+{
+  // 0.0 and 1.0 are exactly representable in every format
+  std::vector<float> src = {0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f};
+
+  for (int s=0;s<PixelFormat::PIX_FMT_COUNT;s++) {
+    for (int d=0;d<PixelFormat::PIX_FMT_COUNT;d++) {
+      PixelFormat::Format src_format = static_cast<PixelFormat::Format>(s);
+      PixelFormat::Format dst_format = static_cast<PixelFormat::Format>(d);
+
+      std::vector<float> src_buffer(src.size());
+      std::vector<float> dst_buffer(src.size());
+      std::vector<float> result(src.size());
+
+      ASSERT_TRUE(PixelKernels::Convert(src.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        src_buffer.data(), src_format,
+                                        static_cast<int>(src.size())));
+      ASSERT_TRUE(PixelKernels::Convert(src_buffer.data(), src_format,
+                                        dst_buffer.data(), dst_format,
+                                        static_cast<int>(src.size())));
+      ASSERT_TRUE(PixelKernels::Convert(dst_buffer.data(), dst_format,
+                                        result.data(), PixelFormat::PIX_FMT_RGBA32F,
+                                        static_cast<int>(src.size())));
+
+      EXPECT_EQ(result, src) << "from " << s << " to " << d;
+    }
+  }
+}